@@ -691,24 +691,43 @@ void set_column_family(http_context& ctx, routes& r) {
         return make_ready_future<json::json_return_type>(0);
     });
 
-    cf::get_speculative_retries.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        //auto id = get_uuid(req->param["name"], ctx.db.local());
-        return make_ready_future<json::json_return_type>(0);
+    cf::get_speculative_retries.set(r, [&ctx] (std::unique_ptr<request> req) {
+        auto uuid = get_uuid(req->param["name"], ctx.db.local());
+        return ctx.sp.map_reduce0([uuid] (service::storage_proxy& sp) {
+            return sp.get_speculative_retries(uuid);
+        }, uint64_t(0), std::plus<uint64_t>()).then([] (uint64_t res) {
+            return make_ready_future<json::json_return_type>(res);
+        });
     });
 
-    cf::get_all_speculative_retries.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        return make_ready_future<json::json_return_type>(0);
+    cf::get_all_speculative_retries.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return ctx.sp.map_reduce0([] (service::storage_proxy& sp) {
+            return sp.get_stats().speculative_retries;
+        }, uint64_t(0), std::plus<uint64_t>()).then([] (uint64_t res) {
+            return make_ready_future<json::json_return_type>(res);
+        });
     });
 
-    cf::get_key_cache_hit_rate.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        //auto id = get_uuid(req->param["name"], ctx.db.local());
-        return make_ready_future<json::json_return_type>(0);
+    // The key cache is implemented by the sstable index page cache.
+    cf::get_key_cache_hit_rate.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return map_reduce_cf(ctx, req->param["name"], ratio_holder(), [] (column_family& cf) {
+            auto& stats = *cf.get_stats().index_cache;
+            ratio_holder res;
+            res.add(stats.hits + stats.misses, stats.hits);
+            return res;
+        }, std::plus<ratio_holder>());
+    });
+
+    cf::get_index_cache_hits.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return map_reduce_cf(ctx, req->param["name"], uint64_t(0), [] (column_family& cf) {
+            return cf.get_stats().index_cache->hits;
+        }, std::plus<uint64_t>());
+    });
+
+    cf::get_index_cache_misses.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return map_reduce_cf(ctx, req->param["name"], uint64_t(0), [] (column_family& cf) {
+            return cf.get_stats().index_cache->misses;
+        }, std::plus<uint64_t>());
     });
 
     cf::get_true_snapshots_size.set(r, [&ctx] (std::unique_ptr<request> req) {
@@ -99,6 +99,10 @@ void set_compaction_manager(http_context& ctx, routes& r) {
         return make_ready_future<json::json_return_type>(0);
     });
 
+    cm::get_bytes_reclaimed_by_expiry.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return get_cm_stats(ctx, &compaction_manager::stats::bytes_reclaimed_by_expiry);
+    });
+
     cm::get_compaction_history.set(r, [] (std::unique_ptr<request> req) {
         return db::system_keyspace::get_compaction_history().then([] (std::vector<db::system_keyspace::compaction_history_entry> history) {
             std::vector<cm::history> res;
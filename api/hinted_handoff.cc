@@ -21,6 +21,9 @@
 
 #include "hinted_handoff.hh"
 #include "api/api-doc/hinted_handoff.json.hh"
+#include "db/hints_manager.hh"
+#include <boost/range/adaptor/transformed.hpp>
+#include <set>
 
 namespace api {
 
@@ -28,49 +31,66 @@ using namespace scollectd;
 using namespace json;
 namespace hh = httpd::hinted_handoff_json;
 
+template<typename Func>
+static future<json::json_return_type> sum_endpoint_stat(gms::inet_address ep, Func&& func) {
+    return db::get_hints_manager().map_reduce0([ep, func = std::forward<Func>(func)] (db::hints_manager& hm) {
+        return func(hm.get_endpoint_stats(ep));
+    }, uint64_t(0), std::plus<uint64_t>()).then([] (uint64_t res) {
+        return make_ready_future<json::json_return_type>(res);
+    });
+}
+
 void set_hinted_handoff(http_context& ctx, routes& r) {
     hh::list_endpoints_pending_hints.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        std::vector<sstring> res;
-        return make_ready_future<json::json_return_type>(res);
+        auto res = make_lw_shared<std::set<gms::inet_address>>();
+        return db::get_hints_manager().map_reduce([res] (std::vector<gms::inet_address> eps) {
+            res->insert(eps.begin(), eps.end());
+        }, [] (db::hints_manager& hm) {
+            return hm.endpoints_pending_hints();
+        }).then([res] {
+            return make_ready_future<json::json_return_type>(boost::copy_range<std::vector<sstring>>(*res
+                    | boost::adaptors::transformed([] (gms::inet_address ep) { return ep.to_sstring(); })));
+        });
     });
 
     hh::truncate_all_hints.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
         sstring host = req->get_query_param("host");
-        return make_ready_future<json::json_return_type>(json_void());
+        return db::get_hints_manager().invoke_on_all([host] (db::hints_manager& hm) {
+            return host.empty() ? hm.truncate_all_hints() : hm.truncate_hints(gms::inet_address(host));
+        }).then([] {
+            return make_ready_future<json::json_return_type>(json_void());
+        });
     });
 
     hh::schedule_hint_delivery.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        sstring host = req->get_query_param("host");
-        return make_ready_future<json::json_return_type>(json_void());
+        gms::inet_address host(req->get_query_param("host"));
+        return db::get_hints_manager().invoke_on_all([host] (db::hints_manager& hm) {
+            return hm.send_hints(host);
+        }).then([] {
+            return make_ready_future<json::json_return_type>(json_void());
+        });
     });
 
     hh::pause_hints_delivery.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        sstring pause = req->get_query_param("pause");
-        return make_ready_future<json::json_return_type>(json_void());
+        bool pause = strcasecmp(req->get_query_param("pause").c_str(), "true") == 0;
+        return db::get_hints_manager().invoke_on_all([pause] (db::hints_manager& hm) {
+            hm.pause_delivery(pause);
+        }).then([] {
+            return make_ready_future<json::json_return_type>(json_void());
+        });
     });
 
     hh::get_create_hint_count.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        sstring host = req->get_query_param("host");
-        return make_ready_future<json::json_return_type>(0);
+        return sum_endpoint_stat(gms::inet_address(req->param["addr"]), [] (const db::hints_manager::endpoint_stats& s) {
+            return s.written;
+        });
     });
 
     hh::get_not_stored_hints_count.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        sstring host = req->get_query_param("host");
-        return make_ready_future<json::json_return_type>(0);
+        return sum_endpoint_stat(gms::inet_address(req->param["addr"]), [] (const db::hints_manager::endpoint_stats& s) {
+            return s.dropped;
+        });
     });
 }
 
 }
-
@@ -150,6 +150,26 @@ void set_messaging_service(http_context& ctx, routes& r) {
             return make_ready_future<json::json_return_type>(res);
         });
     });
+
+    get_compression_stats.set(r, [](std::unique_ptr<request> req) {
+        using stats = messaging_service::compression_stats;
+        return net::get_messaging_service().map_reduce0([](messaging_service& ms) {
+            return ms.get_compression_stats();
+        }, stats(), [](stats a, const stats& b) {
+            a.sent_uncompressed_bytes += b.sent_uncompressed_bytes;
+            a.sent_compressed_bytes += b.sent_compressed_bytes;
+            a.received_compressed_bytes += b.received_compressed_bytes;
+            a.received_uncompressed_bytes += b.received_uncompressed_bytes;
+            return a;
+        }).then([](stats s) {
+            httpd::messaging_service_json::compression_stats res;
+            res.sent_uncompressed_bytes = s.sent_uncompressed_bytes;
+            res.sent_compressed_bytes = s.sent_compressed_bytes;
+            res.received_compressed_bytes = s.received_compressed_bytes;
+            res.received_uncompressed_bytes = s.received_uncompressed_bytes;
+            return make_ready_future<json::json_return_type>(res);
+        });
+    });
 }
 }
 
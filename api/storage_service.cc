@@ -365,6 +365,18 @@ void set_storage_service(http_context& ctx, routes& r) {
         });
     });
 
+    ss::get_repair_concurrency_limit.set(r, [&ctx](std::unique_ptr<request> req) {
+        return repair_get_concurrency(ctx.db).then([] (repair_concurrency rc) {
+            return make_ready_future<json::json_return_type>(rc.limit);
+        });
+    });
+
+    ss::get_repair_queue_depth.set(r, [&ctx](std::unique_ptr<request> req) {
+        return repair_get_concurrency(ctx.db).then([] (repair_concurrency rc) {
+            return make_ready_future<json::json_return_type>(rc.queued);
+        });
+    });
+
     ss::force_terminate_all_repair_sessions.set(r, [](std::unique_ptr<request> req) {
         //TBD
         unimplemented();
@@ -51,12 +51,17 @@ class atomic_cell_or_collection;
  *
  *  <live>  := <int8_t:flags><int64_t:timestamp>(<int32_t:expiry><int32_t:ttl>)?<value>
  *  <dead>  := <int8_t:    0><int64_t:timestamp><int32_t:deletion_time>
+ *
+ * Live cells of counter columns hold either a list of counter shards (see
+ * counters.hh) or, when COUNTER_UPDATE_FLAG is set, an <int64_t:delta> which
+ * is yet to be turned into a shard by the leader replica.
  */
 class atomic_cell_type final {
 private:
     static constexpr int8_t LIVE_FLAG = 0x01;
     static constexpr int8_t EXPIRY_FLAG = 0x02; // When present, expiry field is present. Set only for live cells
     static constexpr int8_t REVERT_FLAG = 0x04; // transient flag used to efficiently implement ReversiblyMergeable for atomic cells.
+    static constexpr int8_t COUNTER_UPDATE_FLAG = 0x08; // Value is a counter delta. Set only for live cells
     static constexpr unsigned flags_size = 1;
     static constexpr unsigned timestamp_offset = flags_size;
     static constexpr unsigned timestamp_size = 8;
@@ -80,6 +85,9 @@ class atomic_cell_type final {
     static bool is_live_and_has_ttl(const bytes_view& cell) {
         return cell[0] & EXPIRY_FLAG;
     }
+    static bool is_counter_update(const bytes_view& cell) {
+        return cell[0] & COUNTER_UPDATE_FLAG;
+    }
     static bool is_dead(const bytes_view& cell) {
         return !is_live(cell);
     }
@@ -94,6 +102,11 @@ class atomic_cell_type final {
         cell.remove_prefix(value_offset);
         return cell;
     }
+    // Can be called only when is_counter_update() is true.
+    static int64_t counter_update_value(const bytes_view& cell) {
+        assert(is_counter_update(cell));
+        return get_field<int64_t>(cell, flags_size + timestamp_size);
+    }
     // Can be called only when is_dead() is true.
     static gc_clock::time_point deletion_time(const bytes_view& cell) {
         assert(is_dead(cell));
@@ -126,6 +139,14 @@ class atomic_cell_type final {
         std::copy_n(value.begin(), value.size(), b.begin() + value_offset);
         return b;
     }
+    static managed_bytes make_live_counter_update(api::timestamp_type timestamp, int64_t value) {
+        auto value_offset = flags_size + timestamp_size;
+        managed_bytes b(managed_bytes::initialized_later(), value_offset + sizeof(value));
+        b[0] = LIVE_FLAG | COUNTER_UPDATE_FLAG;
+        set_field(b, timestamp_offset, timestamp);
+        set_field(b, value_offset, value);
+        return b;
+    }
     static managed_bytes make_live(api::timestamp_type timestamp, bytes_view value, gc_clock::time_point expiry, gc_clock::duration ttl) {
         auto value_offset = flags_size + timestamp_size + expiry_size + ttl_size;
         managed_bytes b(managed_bytes::initialized_later(), value_offset + value.size());
@@ -164,6 +185,9 @@ class atomic_cell_base {
     bool is_live_and_has_ttl() const {
         return atomic_cell_type::is_live_and_has_ttl(_data);
     }
+    bool is_counter_update() const {
+        return atomic_cell_type::is_counter_update(_data);
+    }
     bool is_dead(gc_clock::time_point now) const {
         return atomic_cell_type::is_dead(_data) || has_expired(now);
     }
@@ -178,6 +202,10 @@ class atomic_cell_base {
     bytes_view value() const {
         return atomic_cell_type::value(_data);
     }
+    // Can be called on live counter update cells only
+    int64_t counter_update_value() const {
+        return atomic_cell_type::counter_update_value(_data);
+    }
     // Can be called only when is_dead(gc_clock::time_point)
     gc_clock::time_point deletion_time() const {
         return !is_live() ? atomic_cell_type::deletion_time(_data) : expiry() - ttl();
@@ -236,6 +264,9 @@ class atomic_cell final : public atomic_cell_base<managed_bytes> {
     static atomic_cell make_live(api::timestamp_type timestamp, bytes_view value) {
         return atomic_cell_type::make_live(timestamp, value);
     }
+    static atomic_cell make_live_counter_update(api::timestamp_type timestamp, int64_t value) {
+        return atomic_cell_type::make_live_counter_update(timestamp, value);
+    }
     static atomic_cell make_live(api::timestamp_type timestamp, bytes_view value,
         gc_clock::time_point expiry, gc_clock::duration ttl)
     {
@@ -56,9 +56,10 @@ class bytes_ostream {
         value_type data[0];
         void operator delete(void* ptr) { free(ptr); }
     };
-    // FIXME: consider increasing chunk size as the buffer grows
-    static constexpr size_type chunk_size{512};
-    static constexpr size_type usable_chunk_size{chunk_size - sizeof(chunk)};
+    // Chunks grow geometrically from default_chunk_size up to max_chunk_size,
+    // so that small buffers stay small and large ones are made of few fragments.
+    static constexpr size_type default_chunk_size{512};
+    static constexpr size_type max_chunk_size{128 * 1024};
 private:
     std::unique_ptr<chunk> _begin;
     chunk* _current;
@@ -93,6 +94,20 @@ class bytes_ostream {
         }
     };
 private:
+    // Size of the allocation for the next chunk, which must fit data_size bytes.
+    size_type next_alloc_size(size_type data_size) const {
+        size_type next_size = default_chunk_size;
+        if (_current) {
+            next_size = (_current->size + sizeof(chunk)) * 2;
+            if (next_size > max_chunk_size) {
+                next_size = max_chunk_size;
+            }
+        }
+        if (data_size + sizeof(chunk) > next_size) {
+            next_size = data_size + sizeof(chunk);
+        }
+        return next_size;
+    }
     inline size_type current_space_left() const {
         if (!_current) {
             return 0;
@@ -109,7 +124,7 @@ class bytes_ostream {
             _size += size;
             return ret;
         } else {
-            auto alloc_size = size <= usable_chunk_size ? chunk_size : (size + sizeof(chunk));
+            auto alloc_size = next_alloc_size(size);
             auto space = malloc(alloc_size);
             if (!space) {
                 throw std::bad_alloc();
@@ -97,6 +97,29 @@ class partition_slice_clustering_key_filter_factory : public clustering_key_filt
     }
 };
 
+class ranges_clustering_key_filter_factory : public clustering_key_filter_factory {
+    clustering_row_ranges _ranges;
+    clustering_key_prefix::prefix_equal_tri_compare _cmp;
+public:
+    ranges_clustering_key_filter_factory(schema_ptr s, clustering_row_ranges ranges)
+        : _ranges(std::move(ranges)), _cmp(*s) {}
+
+    virtual clustering_key_filter get_filter(const partition_key& key) override {
+        return [this] (const clustering_key& key) {
+            return std::any_of(std::begin(_ranges), std::end(_ranges),
+                [this, &key] (const range<clustering_key_prefix>& r) { return r.contains(key, _cmp); });
+        };
+    }
+
+    virtual clustering_key_filter get_filter_for_sorted(const partition_key& key) override {
+        return get_filter(key);
+    }
+
+    virtual const std::vector<range<clustering_key_prefix>>& get_ranges(const partition_key& key) override {
+        return _ranges;
+    }
+};
+
 static const shared_ptr<clustering_key_filter_factory>
 create_partition_slice_filter(schema_ptr s, const partition_slice& slice) {
     return ::make_shared<partition_slice_clustering_key_filter_factory>(std::move(s), slice);
@@ -111,8 +134,10 @@ clustering_key_filtering_context::create(schema_ptr schema, const partition_slic
         ::make_shared<stateless_clustering_key_filter_factory>(std::vector<range<clustering_key_prefix>>{},
                                                        [](const clustering_key&) { return false; }));
 
+    auto reversed = slice.options.contains(query::partition_slice::option::reversed);
+
     if (slice.get_specific_ranges()) {
-        return clustering_key_filtering_context(create_partition_slice_filter(schema, slice));
+        return clustering_key_filtering_context(create_partition_slice_filter(schema, slice), reversed);
     }
 
     const clustering_row_ranges& ranges = slice.default_row_ranges();
@@ -122,9 +147,15 @@ clustering_key_filtering_context::create(schema_ptr schema, const partition_slic
     }
 
     if (ranges.size() == 1 && ranges[0].is_full()) {
-        return accept_all;
+        return clustering_key_filtering_context(accept_all._factory, reversed);
     }
-    return clustering_key_filtering_context(create_partition_slice_filter(schema, slice));
+    return clustering_key_filtering_context(create_partition_slice_filter(schema, slice), reversed);
+}
+
+clustering_key_filtering_context
+clustering_key_filtering_context::create_for_ranges(schema_ptr schema, clustering_row_ranges ranges) {
+    return clustering_key_filtering_context(
+        ::make_shared<ranges_clustering_key_filter_factory>(std::move(schema), std::move(ranges)));
 }
 
 }
@@ -52,8 +52,10 @@ class clustering_key_filter_factory {
 class clustering_key_filtering_context {
 private:
     shared_ptr<clustering_key_filter_factory> _factory;
+    bool _reversed = false;
     clustering_key_filtering_context() {};
-    clustering_key_filtering_context(shared_ptr<clustering_key_filter_factory> factory) : _factory(factory) {}
+    clustering_key_filtering_context(shared_ptr<clustering_key_filter_factory> factory, bool reversed = false)
+        : _factory(factory), _reversed(reversed) {}
 public:
     // Create a clustering key filter that can be used for multiple clustering keys with no restrictions.
     clustering_key_filter get_filter(const partition_key& key) const {
@@ -65,8 +67,19 @@ class clustering_key_filtering_context {
     }
     const std::vector<range<clustering_key_prefix>>& get_ranges(const partition_key& key) const;
 
+    // True if the sources are asked to produce reversed streamed_mutations.
+    // Ranges returned by get_ranges() are then in the reverse order, too.
+    // Sources which cannot do it natively return regular streams and leave
+    // reversing to the consumer.
+    bool is_reversed() const {
+        return _reversed;
+    }
+
     static const clustering_key_filtering_context create(schema_ptr, const partition_slice&);
 
+    // Create a context which selects given clustering ranges in every partition.
+    static clustering_key_filtering_context create_for_ranges(schema_ptr, std::vector<range<clustering_key_prefix>>);
+
     static clustering_key_filtering_context create_no_filtering();
 };
 
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <limits>
 #include "exceptions/exceptions.hh"
 
 enum class compressor {
@@ -28,20 +29,30 @@ enum class compressor {
     lz4,
     snappy,
     deflate,
+    zstd,
 };
 
 class compression_parameters {
 public:
     static constexpr int32_t DEFAULT_CHUNK_LENGTH = 4 * 1024;
     static constexpr double DEFAULT_CRC_CHECK_CHANCE = 1.0;
+    static constexpr int32_t DEFAULT_COMPRESSION_LEVEL = 3;
+    static constexpr int32_t MAX_COMPRESSION_LEVEL = 22;
+    static constexpr int32_t MAX_DICTIONARY_SIZE = 1024 * 1024;
 
     static constexpr auto SSTABLE_COMPRESSION = "sstable_compression";
     static constexpr auto CHUNK_LENGTH_KB = "chunk_length_kb";
     static constexpr auto CRC_CHECK_CHANCE = "crc_check_chance";
+    // zstd only. A dictionary of dictionary_size_kb is trained from the
+    // first chunks of every sstable; 0 (the default) disables it.
+    static constexpr auto COMPRESSION_LEVEL = "compression_level";
+    static constexpr auto DICTIONARY_SIZE_KB = "dictionary_size_kb";
 private:
     compressor _compressor = compressor::none;
     std::experimental::optional<int> _chunk_length;
     std::experimental::optional<double> _crc_check_chance;
+    std::experimental::optional<int> _compression_level;
+    std::experimental::optional<int> _dictionary_size;
 public:
     compression_parameters() = default;
     compression_parameters(compressor c) : _compressor(c) { }
@@ -59,16 +70,14 @@ class compression_parameters {
             _compressor = compressor::snappy;
         } else if (is_compressor_class(compressor_class, "DeflateCompressor")) {
             _compressor = compressor::deflate;
+        } else if (is_compressor_class(compressor_class, "ZstdCompressor")) {
+            _compressor = compressor::zstd;
         } else {
             throw exceptions::configuration_exception(sstring("Unsupported compression class '") + compressor_class + "'.");
         }
         auto chunk_length = options.find(CHUNK_LENGTH_KB);
         if (chunk_length != options.end()) {
-            try {
-                _chunk_length = std::stoi(chunk_length->second) * 1024;
-            } catch (const std::exception& e) {
-                throw exceptions::syntax_exception(sstring("Invalid integer value ") + chunk_length->second + " for " + CHUNK_LENGTH_KB);
-            }
+            _chunk_length = parse_int(CHUNK_LENGTH_KB, chunk_length->second, 1024);
         }
         auto crc_chance = options.find(CRC_CHECK_CHANCE);
         if (crc_chance != options.end()) {
@@ -78,11 +87,21 @@ class compression_parameters {
                 throw exceptions::syntax_exception(sstring("Invalid double value ") + crc_chance->second + "for " + CRC_CHECK_CHANCE);
             }
         }
+        auto level = options.find(COMPRESSION_LEVEL);
+        if (level != options.end()) {
+            _compression_level = parse_int(COMPRESSION_LEVEL, level->second, 1);
+        }
+        auto dictionary_size = options.find(DICTIONARY_SIZE_KB);
+        if (dictionary_size != options.end()) {
+            _dictionary_size = parse_int(DICTIONARY_SIZE_KB, dictionary_size->second, 1024);
+        }
     }
 
     compressor get_compressor() const { return _compressor; }
     int32_t chunk_length() const { return _chunk_length.value_or(int(DEFAULT_CHUNK_LENGTH)); }
     double crc_check_chance() const { return _crc_check_chance.value_or(double(DEFAULT_CRC_CHECK_CHANCE)); }
+    int32_t compression_level() const { return _compression_level.value_or(int(DEFAULT_COMPRESSION_LEVEL)); }
+    int32_t dictionary_size() const { return _dictionary_size.value_or(0); }
 
     void validate() {
         if (_chunk_length) {
@@ -98,6 +117,16 @@ class compression_parameters {
         if (_crc_check_chance && (_crc_check_chance.value() < 0.0 || _crc_check_chance.value() > 1.0)) {
             throw exceptions::configuration_exception(sstring(CRC_CHECK_CHANCE) + " must be between 0.0 and 1.0.");
         }
+        if ((_compression_level || _dictionary_size) && _compressor != compressor::zstd) {
+            throw exceptions::configuration_exception(sprint("%s and %s are only supported by ZstdCompressor.",
+                    sstring(COMPRESSION_LEVEL), sstring(DICTIONARY_SIZE_KB)));
+        }
+        if (_compression_level && (_compression_level.value() < 1 || _compression_level.value() > MAX_COMPRESSION_LEVEL)) {
+            throw exceptions::configuration_exception(sprint("%s must be between 1 and %d.", sstring(COMPRESSION_LEVEL), int(MAX_COMPRESSION_LEVEL)));
+        }
+        if (_dictionary_size && (_dictionary_size.value() < 0 || _dictionary_size.value() > MAX_DICTIONARY_SIZE)) {
+            throw exceptions::configuration_exception(sprint("%s must be between 0 and %d.", sstring(DICTIONARY_SIZE_KB), MAX_DICTIONARY_SIZE / 1024));
+        }
     }
 
     std::map<sstring, sstring> get_options() const {
@@ -112,23 +141,33 @@ class compression_parameters {
         if (_crc_check_chance) {
             opts.emplace(sstring(CRC_CHECK_CHANCE), std::to_string(_crc_check_chance.value()));
         }
+        if (_compression_level) {
+            opts.emplace(sstring(COMPRESSION_LEVEL), std::to_string(_compression_level.value()));
+        }
+        if (_dictionary_size) {
+            opts.emplace(sstring(DICTIONARY_SIZE_KB), std::to_string(_dictionary_size.value() / 1024));
+        }
         return opts;
     }
     bool operator==(const compression_parameters& other) const {
         return _compressor == other._compressor
                && _chunk_length == other._chunk_length
-               && _crc_check_chance == other._crc_check_chance;
+               && _crc_check_chance == other._crc_check_chance
+               && _compression_level == other._compression_level
+               && _dictionary_size == other._dictionary_size;
     }
     bool operator!=(const compression_parameters& other) const {
         return !(*this == other);
     }
 private:
     void validate_options(const std::map<sstring, sstring>& options) {
-        // currently, there are no options specific to a particular compressor
+        // compressor-specific options are checked against the compressor in validate()
         static std::set<sstring> keywords({
             sstring(SSTABLE_COMPRESSION),
             sstring(CHUNK_LENGTH_KB),
             sstring(CRC_CHECK_CHANCE),
+            sstring(COMPRESSION_LEVEL),
+            sstring(DICTIONARY_SIZE_KB),
         });
         for (auto&& opt : options) {
             if (!keywords.count(opt.first)) {
@@ -136,6 +175,26 @@ class compression_parameters {
             }
         }
     }
+    // Parses an integer option and scales it by unit, in 64 bits so that
+    // out of range values are reported rather than overflowing.
+    static int32_t parse_int(const char* name, const sstring& value, int64_t unit) {
+        int64_t v;
+        try {
+            size_t pos;
+            v = std::stoll(value, &pos);
+            if (pos != value.size()) {
+                throw std::invalid_argument(value);
+            }
+        } catch (const std::invalid_argument&) {
+            throw exceptions::configuration_exception(sprint("Invalid integer value %s for %s.", value, name));
+        } catch (const std::out_of_range&) {
+            throw exceptions::configuration_exception(sprint("Value %s for %s is out of range.", value, name));
+        }
+        if (v > std::numeric_limits<int32_t>::max() / unit || v < std::numeric_limits<int32_t>::min() / unit) {
+            throw exceptions::configuration_exception(sprint("Value %s for %s is out of range.", value, name));
+        }
+        return v * unit;
+    }
     bool is_compressor_class(const sstring& value, const sstring& class_name) {
         static const sstring namespace_prefix = "org.apache.cassandra.io.compress.";
         return value == class_name || value == namespace_prefix + class_name;
@@ -148,6 +207,8 @@ class compression_parameters {
             return "org.apache.cassandra.io.compress.SnappyCompressor";
         case compressor::deflate:
             return "org.apache.cassandra.io.compress.DeflateCompressor";
+        case compressor::zstd:
+            return "ZstdCompressor";
         default:
             abort();
         }
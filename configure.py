@@ -206,6 +206,9 @@ scylla_tests = [
     'tests/network_topology_strategy_test',
     'tests/query_processor_test',
     'tests/batchlog_manager_test',
+    'tests/hints_manager_test',
+    'tests/counter_test',
+    'tests/secondary_index_test',
     'tests/bytes_ostream_test',
     'tests/UUID_test',
     'tests/murmur_hash_test',
@@ -215,11 +218,14 @@ scylla_tests = [
     'tests/crc_test',
     'tests/flush_queue_test',
     'tests/dynamic_bitset_test',
+    'tests/histogram_test',
     'tests/auth_test',
     'tests/idl_test',
     'tests/range_tombstone_list_test',
     'tests/anchorless_list_test',
     'tests/database_test',
+    'tests/repair_test',
+    'tests/cql_transport_test',
 ]
 
 apps = [
@@ -293,6 +299,7 @@ scylla_core = (['database.cc',
                  'utils/logalloc.cc',
                  'utils/large_bitset.cc',
                  'mutation_partition.cc',
+                 'counters.cc',
                  'mutation_partition_view.cc',
                  'mutation_partition_serializer.cc',
                  'mutation_reader.cc',
@@ -301,6 +308,7 @@ scylla_core = (['database.cc',
                  'keys.cc',
                  'clustering_key_filter.cc',
                  'sstables/sstables.cc',
+                 'sstables/index_cache.cc',
                  'sstables/compress.cc',
                  'sstables/row.cc',
                  'sstables/key.cc',
@@ -332,6 +340,7 @@ scylla_core = (['database.cc',
                  'cql3/statements/create_user_statement.cc',
                  'cql3/statements/drop_keyspace_statement.cc',
                  'cql3/statements/drop_table_statement.cc',
+                 'cql3/statements/drop_index_statement.cc',
                  'cql3/statements/drop_type_statement.cc',
                  'cql3/statements/schema_altering_statement.cc',
                  'cql3/statements/ks_prop_defs.cc',
@@ -403,6 +412,7 @@ scylla_core = (['database.cc',
                  'db/index/secondary_index.cc',
                  'db/marshal/type_parser.cc',
                  'db/batchlog_manager.cc',
+                 'db/hints_manager.cc',
                  'io/io.cc',
                  'utils/utils.cc',
                  'utils/UUID_gen.cc',
@@ -544,6 +554,7 @@ idls = ['idl/gossip_digest.idl.hh',
         'idl/idl_test.idl.hh',
         'idl/commitlog.idl.hh',
         'idl/tracing.idl.hh',
+        'idl/consistency_level.idl.hh',
         ]
 
 scylla_tests_dependencies = scylla_core + api + idls + [
@@ -585,6 +596,7 @@ tests_not_using_seastar_test_framework = set([
     'tests/perf/perf_sstable',
     'tests/managed_vector_test',
     'tests/dynamic_bitset_test',
+    'tests/histogram_test',
     'tests/idl_test',
     'tests/range_tombstone_list_test',
     'tests/anchorless_list_test',
@@ -733,7 +745,7 @@ for mode in build_modes:
 seastar_deps = 'practically_anything_can_change_so_lets_run_it_every_time_and_restat.'
 
 args.user_cflags += " " + pkg_config("--cflags", "jsoncpp")
-libs = "-lyaml-cpp -llz4 -lz -lsnappy " + pkg_config("--libs", "jsoncpp") + ' -lboost_filesystem' + ' -lcrypt' + ' -lboost_date_time'
+libs = "-lyaml-cpp -llz4 -lz -lsnappy -lzstd " + pkg_config("--libs", "jsoncpp") + ' -lboost_filesystem' + ' -lcrypt' + ' -lboost_date_time'
 for pkg in pkgs:
     args.user_cflags += ' ' + pkg_config('--cflags', pkg)
     libs += ' ' + pkg_config('--libs', pkg)
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <deque>
+#include <boost/range/algorithm/find_if.hpp>
+#include <boost/range/numeric.hpp>
+#include <boost/range/adaptor/transformed.hpp>
+
+#include "counters.hh"
+#include "mutation.hh"
+
+std::ostream& operator<<(std::ostream& os, const counter_id& id) {
+    return os << id.to_uuid();
+}
+
+std::ostream& operator<<(std::ostream& os, counter_cell_view ccv) {
+    os << "{counter_cell timestamp: " << ccv.timestamp() << " shards: {";
+    bool first = true;
+    for (auto&& csv : ccv.shards()) {
+        if (!first) {
+            os << ", ";
+        }
+        first = false;
+        os << "{" << csv.id() << ", " << csv.value() << ", " << csv.logical_clock() << "}";
+    }
+    return os << "}}";
+}
+
+void counter_shard::serialize(bytes::iterator& out) const {
+    auto write = [&out] (int64_t value) {
+        auto v = net::hton(value);
+        out = std::copy_n(reinterpret_cast<const bytes::value_type*>(&v), sizeof(v), out);
+    };
+    write(_id.to_uuid().get_most_significant_bits());
+    write(_id.to_uuid().get_least_significant_bits());
+    write(_value);
+    write(_logical_clock);
+}
+
+bytes counter_cell_builder::serialize() const {
+    bytes b(bytes::initialized_later(), _shards.size() * counter_shard::serialized_size);
+    auto out = b.begin();
+    for (auto&& cs : _shards) {
+        cs.serialize(out);
+    }
+    return b;
+}
+
+atomic_cell counter_cell_builder::build(api::timestamp_type timestamp) const {
+    return atomic_cell::make_live(timestamp, serialize());
+}
+
+atomic_cell counter_cell_builder::from_single_shard(api::timestamp_type timestamp, const counter_shard& cs) {
+    bytes b(bytes::initialized_later(), counter_shard::serialized_size);
+    auto out = b.begin();
+    cs.serialize(out);
+    return atomic_cell::make_live(timestamp, b);
+}
+
+int64_t counter_cell_view::total_value() const {
+    return boost::accumulate(shards() | boost::adaptors::transformed([] (counter_shard_view csv) {
+        return csv.value();
+    }), int64_t(0));
+}
+
+std::experimental::optional<counter_shard_view> counter_cell_view::get_shard(const counter_id& id) const {
+    auto it = boost::range::find_if(shards(), [&id] (counter_shard_view csv) {
+        return csv.id() == id;
+    });
+    if (it == shards().end()) {
+        return { };
+    }
+    return *it;
+}
+
+// Merges the shards of two counter cells. For each id the shard with the
+// higher logical clock wins.
+static atomic_cell merge_counter_cells(counter_cell_view a, counter_cell_view b) {
+    counter_cell_builder builder(std::max(a.shard_count(), b.shard_count()));
+    auto a_shards = a.shards();
+    auto b_shards = b.shards();
+    auto a_it = a_shards.begin();
+    auto b_it = b_shards.begin();
+    while (a_it != a_shards.end() && b_it != b_shards.end()) {
+        auto a_id = (*a_it).id();
+        auto b_id = (*b_it).id();
+        if (a_id < b_id) {
+            builder.add_shard(counter_shard(*a_it++));
+        } else if (b_id < a_id) {
+            builder.add_shard(counter_shard(*b_it++));
+        } else {
+            builder.add_shard(counter_shard(*a_it++).apply(counter_shard(*b_it++)));
+        }
+    }
+    for (; a_it != a_shards.end(); ++a_it) {
+        builder.add_shard(counter_shard(*a_it));
+    }
+    for (; b_it != b_shards.end(); ++b_it) {
+        builder.add_shard(counter_shard(*b_it));
+    }
+    return builder.build(std::max(a.timestamp(), b.timestamp()));
+}
+
+void counter_cell_view::apply_reversibly(atomic_cell_or_collection& dst, atomic_cell_or_collection& src) {
+    // Must be run via with_linearized_managed_bytes() context, but assume it is
+    // provided via an upper layer
+    auto dst_ac = dst.as_atomic_cell();
+    auto src_ac = src.as_atomic_cell();
+
+    // A counter cannot be brought back to life once deleted, so tombstones
+    // win regardless of their timestamps.
+    if (!src_ac.is_live() || !dst_ac.is_live()) {
+        if (dst_ac.is_live() || (!src_ac.is_live() && compare_atomic_cell_for_merge(dst_ac, src_ac) < 0)) {
+            std::swap(dst, src);
+            src.as_atomic_cell_ref().set_revert(true);
+        } else {
+            src.as_atomic_cell_ref().set_revert(false);
+        }
+        return;
+    }
+
+    if (dst_ac.is_counter_update() != src_ac.is_counter_update()) {
+        throw std::logic_error("cannot merge counter updates with counter shards");
+    }
+
+    auto merged = [&] {
+        if (dst_ac.is_counter_update()) {
+            return atomic_cell::make_live_counter_update(std::max(dst_ac.timestamp(), src_ac.timestamp()),
+                                                         dst_ac.counter_update_value() + src_ac.counter_update_value());
+        }
+        return merge_counter_cells(counter_cell_view(dst_ac), counter_cell_view(src_ac));
+    }();
+    src = std::move(merged);
+    std::swap(dst, src);
+    src.as_atomic_cell_ref().set_revert(true);
+}
+
+std::experimental::optional<atomic_cell> counter_cell_view::difference(atomic_cell_view a, atomic_cell_view b) {
+    if (!a.is_live() || !b.is_live()) {
+        if (!a.is_live() && (b.is_live() || compare_atomic_cell_for_merge(a, b) > 0)) {
+            return atomic_cell(a);
+        }
+        return { };
+    }
+
+    counter_cell_view a_ccv(a);
+    counter_cell_view b_ccv(b);
+    counter_cell_builder builder;
+    auto b_shards = b_ccv.shards();
+    auto b_it = b_shards.begin();
+    for (auto&& a_shard : a_ccv.shards()) {
+        while (b_it != b_shards.end() && (*b_it).id() < a_shard.id()) {
+            ++b_it;
+        }
+        if (b_it == b_shards.end() || (*b_it).id() != a_shard.id()
+                || (*b_it).logical_clock() < a_shard.logical_clock()) {
+            builder.add_shard(counter_shard(a_shard));
+        }
+    }
+    auto diff = builder.build(a.timestamp());
+    if (diff.value().empty() && a.timestamp() <= b.timestamp()) {
+        return { };
+    }
+    return diff;
+}
+
+void transform_counter_updates_to_shards(mutation& m, const mutation* current_state, counter_id local_id) {
+    auto transform_new_row_to_shards = [&] (row& cells) {
+        cells.for_each_cell([&] (column_id id, atomic_cell_or_collection& ac_o_c) {
+            auto acv = ac_o_c.as_atomic_cell();
+            if (!acv.is_live()) {
+                return; // continue -- we are in lambda
+            }
+            auto cs = counter_shard(local_id, acv.counter_update_value(), 1);
+            ac_o_c = counter_cell_builder::from_single_shard(acv.timestamp(), cs);
+        });
+    };
+
+    if (!current_state) {
+        transform_new_row_to_shards(m.partition().static_row());
+        for (auto& cr : m.partition().clustered_rows()) {
+            transform_new_row_to_shards(cr.row().cells());
+        }
+        return;
+    }
+
+    // Both rows iterate over their cells in the order of column ids.
+    auto transform_row_to_shards = [&] (row& transformee, const row& state) {
+        std::deque<std::pair<column_id, counter_shard>> shards;
+        state.for_each_cell([&] (column_id id, const atomic_cell_or_collection& ac_o_c) {
+            auto acv = ac_o_c.as_atomic_cell();
+            if (!acv.is_live()) {
+                return; // continue -- we are in lambda
+            }
+            auto cs = counter_cell_view(acv).get_shard(local_id);
+            if (!cs) {
+                return; // continue
+            }
+            shards.emplace_back(id, counter_shard(*cs));
+        });
+
+        transformee.for_each_cell([&] (column_id id, atomic_cell_or_collection& ac_o_c) {
+            auto acv = ac_o_c.as_atomic_cell();
+            if (!acv.is_live()) {
+                return; // continue -- we are in lambda
+            }
+            while (!shards.empty() && shards.front().first < id) {
+                shards.pop_front();
+            }
+
+            auto delta = acv.counter_update_value();
+            if (shards.empty() || shards.front().first > id) {
+                auto cs = counter_shard(local_id, delta, 1);
+                ac_o_c = counter_cell_builder::from_single_shard(acv.timestamp(), cs);
+            } else {
+                auto& cs = shards.front().second;
+                cs.update(delta, 1);
+                ac_o_c = counter_cell_builder::from_single_shard(acv.timestamp(), cs);
+                shards.pop_front();
+            }
+        });
+    };
+
+    transform_row_to_shards(m.partition().static_row(), current_state->partition().static_row());
+
+    auto& cstate = current_state->partition();
+    auto it = cstate.clustered_rows().begin();
+    auto end = cstate.clustered_rows().end();
+    clustering_key::less_compare cmp(*m.schema());
+    for (auto& cr : m.partition().clustered_rows()) {
+        while (it != end && cmp(it->key(), cr.key())) {
+            ++it;
+        }
+        if (it == end || cmp(cr.key(), it->key())) {
+            transform_new_row_to_shards(cr.row().cells());
+            continue;
+        }
+        transform_row_to_shards(cr.row().cells(), it->row().cells());
+    }
+}
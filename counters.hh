@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <experimental/optional>
+#include <boost/range/iterator_range.hpp>
+
+#include "atomic_cell_or_collection.hh"
+#include "types.hh"
+#include "utils/UUID.hh"
+
+class mutation;
+
+// Identifies the node which owns a counter shard. It is the host id of
+// that node.
+class counter_id {
+    int64_t _least_significant;
+    int64_t _most_significant;
+public:
+    counter_id() = default;
+    explicit counter_id(utils::UUID uuid) noexcept
+        : _least_significant(uuid.get_least_significant_bits())
+        , _most_significant(uuid.get_most_significant_bits())
+    { }
+
+    utils::UUID to_uuid() const {
+        return utils::UUID(_most_significant, _least_significant);
+    }
+
+    // Shards are ordered like the serialized form of their ids, which is
+    // the order Origin expects them in sstables.
+    bool operator<(const counter_id& other) const {
+        if (_most_significant != other._most_significant) {
+            return uint64_t(_most_significant) < uint64_t(other._most_significant);
+        }
+        return uint64_t(_least_significant) < uint64_t(other._least_significant);
+    }
+    bool operator==(const counter_id& other) const {
+        return to_uuid() == other.to_uuid();
+    }
+    bool operator!=(const counter_id& other) const {
+        return !(*this == other);
+    }
+};
+
+std::ostream& operator<<(std::ostream& os, const counter_id& id);
+
+class counter_shard_view;
+
+// The part of a counter value contributed by the updates led by a single
+// node. Shards with the same id are merged by picking the one with the
+// higher logical clock, which is incremented by the owner on every update.
+class counter_shard {
+    counter_id _id;
+    int64_t _value;
+    int64_t _logical_clock;
+public:
+    static constexpr size_t serialized_size = 4 * sizeof(int64_t);
+
+    counter_shard(counter_id id, int64_t value, int64_t logical_clock) noexcept
+        : _id(id)
+        , _value(value)
+        , _logical_clock(logical_clock)
+    { }
+    explicit counter_shard(const counter_shard_view& csv) noexcept;
+
+    counter_id id() const { return _id; }
+    int64_t value() const { return _value; }
+    int64_t logical_clock() const { return _logical_clock; }
+
+    counter_shard& update(int64_t value_delta, int64_t clock_increment) noexcept {
+        _value += value_delta;
+        _logical_clock += clock_increment;
+        return *this;
+    }
+
+    counter_shard& apply(const counter_shard& other) noexcept {
+        if (_logical_clock < other._logical_clock) {
+            _value = other._value;
+            _logical_clock = other._logical_clock;
+        }
+        return *this;
+    }
+
+    void serialize(bytes::iterator& out) const;
+};
+
+// View of a shard in the serialized form of a counter cell:
+//
+//  <shard> := <int64_t:id_msb><int64_t:id_lsb><int64_t:value><int64_t:logical_clock>
+class counter_shard_view {
+    bytes_view::const_pointer _base;
+private:
+    template<typename T>
+    T read(size_t offset) const {
+        T value;
+        std::copy_n(_base + offset, sizeof(T), reinterpret_cast<bytes_view::value_type*>(&value));
+        return net::ntoh(value);
+    }
+public:
+    explicit counter_shard_view(bytes_view::const_pointer ptr) noexcept : _base(ptr) { }
+
+    counter_id id() const {
+        return counter_id(utils::UUID(read<int64_t>(0), read<int64_t>(8)));
+    }
+    int64_t value() const { return read<int64_t>(16); }
+    int64_t logical_clock() const { return read<int64_t>(24); }
+};
+
+inline counter_shard::counter_shard(const counter_shard_view& csv) noexcept
+    : counter_shard(csv.id(), csv.value(), csv.logical_clock())
+{ }
+
+// Builds the serialized form of a counter cell. Shards must be added in
+// the order of their ids.
+class counter_cell_builder {
+    std::vector<counter_shard> _shards;
+public:
+    counter_cell_builder() = default;
+    explicit counter_cell_builder(size_t shard_count) {
+        _shards.reserve(shard_count);
+    }
+
+    void add_shard(const counter_shard& cs) {
+        _shards.emplace_back(cs);
+    }
+
+    bytes serialize() const;
+    atomic_cell build(api::timestamp_type timestamp) const;
+
+    static atomic_cell from_single_shard(api::timestamp_type timestamp, const counter_shard& cs);
+};
+
+// View of a live counter cell which is not a counter update.
+//
+//  <counter_cell> := <shard>*, sorted by id
+class counter_cell_view {
+    atomic_cell_view _cell;
+public:
+    class shard_iterator : public std::iterator<std::input_iterator_tag, counter_shard_view> {
+        bytes_view::const_pointer _current = nullptr;
+    public:
+        shard_iterator() = default;
+        explicit shard_iterator(bytes_view::const_pointer ptr) noexcept : _current(ptr) { }
+
+        counter_shard_view operator*() const noexcept {
+            return counter_shard_view(_current);
+        }
+        shard_iterator& operator++() noexcept {
+            _current += counter_shard::serialized_size;
+            return *this;
+        }
+        shard_iterator operator++(int) noexcept {
+            auto it = *this;
+            operator++();
+            return it;
+        }
+        bool operator==(const shard_iterator& other) const noexcept {
+            return _current == other._current;
+        }
+        bool operator!=(const shard_iterator& other) const noexcept {
+            return !(*this == other);
+        }
+    };
+public:
+    explicit counter_cell_view(atomic_cell_view ac) noexcept : _cell(ac) {
+        assert(_cell.is_live() && !_cell.is_counter_update());
+    }
+
+    api::timestamp_type timestamp() const { return _cell.timestamp(); }
+
+    boost::iterator_range<shard_iterator> shards() const {
+        auto value = _cell.value();
+        return boost::make_iterator_range(shard_iterator(value.data()), shard_iterator(value.data() + value.size()));
+    }
+
+    size_t shard_count() const {
+        return _cell.value().size() / counter_shard::serialized_size;
+    }
+
+    // The value of a counter is the sum of its shards.
+    int64_t total_value() const;
+
+    std::experimental::optional<counter_shard_view> get_shard(const counter_id& id) const;
+
+    // Reversibly merges two counter cells of the same column, see
+    // apply_reversibly() in mutation_partition.cc. Dead cells win over live
+    // ones, live cells are merged shard by shard and counter updates are
+    // added up.
+    static void apply_reversibly(atomic_cell_or_collection& dst, atomic_cell_or_collection& src);
+
+    // Returns the part of a which is not already present in b.
+    static std::experimental::optional<atomic_cell> difference(atomic_cell_view a, atomic_cell_view b);
+
+    friend std::ostream& operator<<(std::ostream& os, counter_cell_view ccv);
+};
+
+// Counter cells are exposed to CQL as bigint.
+inline bytes serialize_counter_value(int64_t value) {
+    return long_type->decompose(value);
+}
+
+// Turns counter updates in m into shards owned by local_id. The shards are
+// based on the local shards of the matching cells in current_state, which
+// is the current content of those cells on this replica, or nullptr if
+// there is none. The caller must make sure that no other update of the same
+// cells runs concurrently.
+void transform_counter_updates_to_shards(mutation& m, const mutation* current_state, counter_id local_id);
@@ -153,6 +153,27 @@ constants::literal::prepare(database& db, const sstring& keyspace, ::shared_ptr<
     return ::make_shared<value>(std::experimental::make_optional(parsed_value(receiver->type)));
 }
 
+void constants::adder::execute(mutation& m, const exploded_clustering_prefix& prefix, const update_parameters& params) {
+    auto value = _t->bind_and_get(params._options);
+    if (!value) {
+        throw exceptions::invalid_request_exception("Invalid null value for counter increment");
+    }
+    auto increment = value_cast<int64_t>(long_type->deserialize_value(*value));
+    m.set_cell(prefix, column, params.make_counter_update_cell(increment));
+}
+
+void constants::subtracter::execute(mutation& m, const exploded_clustering_prefix& prefix, const update_parameters& params) {
+    auto value = _t->bind_and_get(params._options);
+    if (!value) {
+        throw exceptions::invalid_request_exception("Invalid null value for counter increment");
+    }
+    auto increment = value_cast<int64_t>(long_type->deserialize_value(*value));
+    if (increment == std::numeric_limits<int64_t>::min()) {
+        throw exceptions::invalid_request_exception(sprint("The negation of %d overflows supported counter precision (signed 8 bytes integer)", increment));
+    }
+    m.set_cell(prefix, column, params.make_counter_update_cell(-increment));
+}
+
 void constants::deleter::execute(mutation& m, const exploded_clustering_prefix& prefix, const update_parameters& params) {
     if (column.type->is_multi_cell()) {
         collection_type_impl::mutation coll_m;
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+#include "core/shared_ptr.hh"
+#include "cql3/statements/prepared_statement.hh"
+
+namespace cql3 {
+
+// Prepared statements keyed by their ids, bounded by the estimated memory
+// they use. When the bound is exceeded the least recently used statements
+// are evicted; clients executing them get an unprepared error and prepare
+// them again.
+template <typename Key>
+class prepared_statements_cache {
+public:
+    using value_type = ::shared_ptr<statements::prepared_statement>;
+
+    struct stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+private:
+    struct entry {
+        Key key;
+        value_type prepared;
+        size_t size;
+    };
+    // Most recently used first.
+    using lru_type = std::list<entry>;
+
+    lru_type _lru;
+    std::unordered_map<Key, typename lru_type::iterator> _index;
+    size_t _max_size;
+    size_t _size = 0;
+    stats _stats;
+private:
+    void erase(typename lru_type::iterator it) {
+        _size -= it->size;
+        _index.erase(it->key);
+        _lru.erase(it);
+    }
+public:
+    explicit prepared_statements_cache(size_t max_size) : _max_size(max_size) { }
+
+    prepared_statements_cache(const prepared_statements_cache&) = delete;
+    prepared_statements_cache& operator=(const prepared_statements_cache&) = delete;
+
+    // Looks up a statement to execute it. Returns nullptr if there is no
+    // statement with this id.
+    value_type get(const Key& key) {
+        auto it = _index.find(key);
+        if (it == _index.end()) {
+            ++_stats.misses;
+            return value_type();
+        }
+        ++_stats.hits;
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return it->second->prepared;
+    }
+
+    // Like get(), but not counted in the stats. Preparing a statement looks
+    // it up first, and a miss there is expected for every new statement.
+    value_type find(const Key& key) {
+        auto it = _index.find(key);
+        if (it == _index.end()) {
+            return value_type();
+        }
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return it->second->prepared;
+    }
+
+    // Statements which are already cached are left alone. The caller makes
+    // sure that size does not exceed max_size().
+    void insert(const Key& key, value_type prepared, size_t size) {
+        if (_index.count(key)) {
+            return;
+        }
+        _lru.emplace_front(entry{key, std::move(prepared), size});
+        _index.emplace(key, _lru.begin());
+        _size += size;
+        while (_size > _max_size) {
+            erase(std::prev(_lru.end()));
+            ++_stats.evictions;
+        }
+    }
+
+    template <typename Pred>
+    void remove_if(Pred filter) {
+        for (auto it = _lru.begin(); it != _lru.end(); ) {
+            auto next = std::next(it);
+            if (filter(it->prepared)) {
+                erase(it);
+            }
+            it = next;
+        }
+    }
+
+    size_t size() const {
+        return _lru.size();
+    }
+    // Estimated memory used by the cached statements, in bytes.
+    size_t memory_usage() const {
+        return _size;
+    }
+    size_t max_size() const {
+        return _max_size;
+    }
+    const stats& get_stats() const {
+        return _stats;
+    }
+};
+
+}
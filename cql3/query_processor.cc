@@ -45,6 +45,7 @@
 #include "cql3/statements/batch_statement.hh"
 
 #include "transport/messages/result_message.hh"
+#include "core/memory.hh"
 
 #define CRYPTOPP_ENABLE_NAMESPACE_WEAK 1
 #include <cryptopp/md5.h>
@@ -93,12 +94,46 @@ query_processor::query_processor(distributed<service::storage_proxy>& proxy,
     , _proxy(proxy)
     , _db(db)
     , _internal_state(new internal_state())
+    , _prepared_statements(memory::stats().total_memory() / prepared_statements_cache_memory_divisor)
+    , _thrift_prepared_statements(memory::stats().total_memory() / prepared_statements_cache_memory_divisor)
 {
     _collectd_regs.push_back(
         scollectd::add_polled_metric(scollectd::type_instance_id("query_processor"
                 , scollectd::per_cpu_plugin_instance
                 , "total_operations", "statements_prepared")
                 , scollectd::make_typed(scollectd::data_type::DERIVE, _stats.prepare_invocations)));
+    _collectd_regs.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("query_processor"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "prepared_statements_evicted")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, [this] {
+                    return _prepared_statements.get_stats().evictions + _thrift_prepared_statements.get_stats().evictions;
+                })));
+    _collectd_regs.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("query_processor"
+                , scollectd::per_cpu_plugin_instance
+                , "objects", "prepared_statements")
+                , scollectd::make_typed(scollectd::data_type::GAUGE, [this] {
+                    return _prepared_statements.size() + _thrift_prepared_statements.size();
+                })));
+    _collectd_regs.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("query_processor"
+                , scollectd::per_cpu_plugin_instance
+                , "bytes", "prepared_statements_memory")
+                , scollectd::make_typed(scollectd::data_type::GAUGE, [this] {
+                    return _prepared_statements.memory_usage() + _thrift_prepared_statements.memory_usage();
+                })));
+    _collectd_regs.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("query_processor"
+                , scollectd::per_cpu_plugin_instance
+                , "percent", "prepared_statements_hit_rate")
+                , scollectd::make_typed(scollectd::data_type::GAUGE, [this] {
+                    auto& cql = _prepared_statements.get_stats();
+                    auto& thrift = _thrift_prepared_statements.get_stats();
+                    auto hits = cql.hits + thrift.hits;
+                    auto lookups = hits + cql.misses + thrift.misses;
+                    return lookups ? 100.0 * hits / lookups : 0.0;
+                })));
     service::get_local_migration_manager().register_listener(_migration_subscriber.get());
 }
 
@@ -190,43 +225,52 @@ query_processor::get_stored_prepared_statement(const std::experimental::string_v
 {
     if (for_thrift) {
         auto statement_id = compute_thrift_id(query_string, keyspace);
-        auto it = _thrift_prepared_statements.find(statement_id);
-        if (it == _thrift_prepared_statements.end()) {
+        auto prepared = _thrift_prepared_statements.find(statement_id);
+        if (!prepared) {
             return ::shared_ptr<result_message::prepared>();
         }
-        return ::make_shared<result_message::prepared::thrift>(statement_id, it->second);
+        return ::make_shared<result_message::prepared::thrift>(statement_id, std::move(prepared));
     } else {
         auto statement_id = compute_id(query_string, keyspace);
-        auto it = _prepared_statements.find(statement_id);
-        if (it == _prepared_statements.end()) {
+        auto prepared = _prepared_statements.find(statement_id);
+        if (!prepared) {
             return ::shared_ptr<result_message::prepared>();
         }
-        return ::make_shared<result_message::prepared::cql>(statement_id, it->second);
+        return ::make_shared<result_message::prepared::cql>(statement_id, std::move(prepared));
     }
 }
 
+// Parsed statements are not measured, their size is estimated from the
+// query text which they grow with.
+static size_t estimate_prepared_statement_size(const std::experimental::string_view& query_string,
+        const statements::prepared_statement& prepared)
+{
+    constexpr size_t statement_overhead = 1024;
+    constexpr size_t bytes_per_query_character = 8;
+    constexpr size_t bytes_per_bound_name = 256;
+    return statement_overhead
+            + query_string.size() * bytes_per_query_character
+            + prepared.bound_names.size() * bytes_per_bound_name;
+}
+
 future<::shared_ptr<transport::messages::result_message::prepared>>
 query_processor::store_prepared_statement(const std::experimental::string_view& query_string, const sstring& keyspace,
         ::shared_ptr<statements::prepared_statement> prepared, bool for_thrift)
 {
-#if 0
-    // Concatenate the current keyspace so we don't mix prepared statements between keyspace (#5352).
-    // (if the keyspace is null, queryString has to have a fully-qualified keyspace so it's fine.
-    long statementSize = measure(prepared.statement);
-    // don't execute the statement if it's bigger than the allowed threshold
-    if (statementSize > MAX_CACHE_PREPARED_MEMORY)
-        throw new InvalidRequestException(String.format("Prepared statement of size %d bytes is larger than allowed maximum of %d bytes.",
-                                                        statementSize,
-                                                        MAX_CACHE_PREPARED_MEMORY));
-#endif
+    auto size = estimate_prepared_statement_size(query_string, *prepared);
+    auto max_size = for_thrift ? _thrift_prepared_statements.max_size() : _prepared_statements.max_size();
+    if (size > max_size) {
+        throw exceptions::invalid_request_exception(sprint("Prepared statement of size %d bytes is larger than allowed maximum of %d bytes.",
+                size, max_size));
+    }
     if (for_thrift) {
         auto statement_id = compute_thrift_id(query_string, keyspace);
-        _thrift_prepared_statements.emplace(statement_id, prepared);
+        _thrift_prepared_statements.insert(statement_id, prepared, size);
         auto msg = ::make_shared<result_message::prepared::thrift>(statement_id, prepared);
         return make_ready_future<::shared_ptr<result_message::prepared>>(std::move(msg));
     } else {
         auto statement_id = compute_id(query_string, keyspace);
-        _prepared_statements.emplace(statement_id, prepared);
+        _prepared_statements.insert(statement_id, prepared, size);
         auto msg = ::make_shared<result_message::prepared::cql>(statement_id, prepared);
         return make_ready_future<::shared_ptr<result_message::prepared>>(std::move(msg));
     }
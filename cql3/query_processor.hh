@@ -54,6 +54,7 @@
 #include "log.hh"
 #include "core/distributed.hh"
 #include "statements/prepared_statement.hh"
+#include "prepared_statements_cache.hh"
 #include "transport/messages/result_message.hh"
 #include "untyped_result_set.hh"
 
@@ -96,32 +97,12 @@ class query_processor {
     public static final QueryProcessor instance = new QueryProcessor();
 #endif
 private:
-#if 0
-    private static final Logger logger = LoggerFactory.getLogger(QueryProcessor.class);
-    private static final MemoryMeter meter = new MemoryMeter().withGuessing(MemoryMeter.Guess.FALLBACK_BEST).ignoreKnownSingletons();
-    private static final long MAX_CACHE_PREPARED_MEMORY = Runtime.getRuntime().maxMemory() / 256;
+    // Each of the caches of statements prepared by clients may use up to
+    // this share of the shard's memory.
+    static constexpr unsigned prepared_statements_cache_memory_divisor = 256;
 
-    private static EntryWeigher<MD5Digest, ParsedStatement.Prepared> cqlMemoryUsageWeigher = new EntryWeigher<MD5Digest, ParsedStatement.Prepared>()
-    {
-        @Override
-        public int weightOf(MD5Digest key, ParsedStatement.Prepared value)
-        {
-            return Ints.checkedCast(measure(key) + measure(value.statement) + measure(value.boundNames));
-        }
-    };
-
-    private static EntryWeigher<Integer, ParsedStatement.Prepared> thriftMemoryUsageWeigher = new EntryWeigher<Integer, ParsedStatement.Prepared>()
-    {
-        @Override
-        public int weightOf(Integer key, ParsedStatement.Prepared value)
-        {
-            return Ints.checkedCast(measure(key) + measure(value.statement) + measure(value.boundNames));
-        }
-    };
-#endif
-
-    std::unordered_map<bytes, ::shared_ptr<statements::prepared_statement>> _prepared_statements;
-    std::unordered_map<int32_t, ::shared_ptr<statements::prepared_statement>> _thrift_prepared_statements;
+    prepared_statements_cache<bytes> _prepared_statements;
+    prepared_statements_cache<int32_t> _thrift_prepared_statements;
     std::unordered_map<sstring, ::shared_ptr<statements::prepared_statement>> _internal_statements;
 #if 0
 
@@ -133,53 +114,6 @@ class query_processor {
     // counters. Callers of processStatement are responsible for correctly notifying metrics
     public static final CQLMetrics metrics = new CQLMetrics();
 
-    private static final AtomicInteger lastMinuteEvictionsCount = new AtomicInteger(0);
-
-    static
-    {
-        preparedStatements = new ConcurrentLinkedHashMap.Builder<MD5Digest, ParsedStatement.Prepared>()
-                             .maximumWeightedCapacity(MAX_CACHE_PREPARED_MEMORY)
-                             .weigher(cqlMemoryUsageWeigher)
-                             .listener(new EvictionListener<MD5Digest, ParsedStatement.Prepared>()
-                             {
-                                 public void onEviction(MD5Digest md5Digest, ParsedStatement.Prepared prepared)
-                                 {
-                                     metrics.preparedStatementsEvicted.inc();
-                                     lastMinuteEvictionsCount.incrementAndGet();
-                                 }
-                             }).build();
-
-        thriftPreparedStatements = new ConcurrentLinkedHashMap.Builder<Integer, ParsedStatement.Prepared>()
-                                   .maximumWeightedCapacity(MAX_CACHE_PREPARED_MEMORY)
-                                   .weigher(thriftMemoryUsageWeigher)
-                                   .listener(new EvictionListener<Integer, ParsedStatement.Prepared>()
-                                   {
-                                       public void onEviction(Integer integer, ParsedStatement.Prepared prepared)
-                                       {
-                                           metrics.preparedStatementsEvicted.inc();
-                                           lastMinuteEvictionsCount.incrementAndGet();
-                                       }
-                                   })
-                                   .build();
-
-        ScheduledExecutors.scheduledTasks.scheduleAtFixedRate(new Runnable()
-        {
-            public void run()
-            {
-                long count = lastMinuteEvictionsCount.getAndSet(0);
-                if (count > 0)
-                    logger.info("{} prepared statements discarded in the last minute because cache limit reached ({} bytes)",
-                                count,
-                                MAX_CACHE_PREPARED_MEMORY);
-            }
-        }, 1, 1, TimeUnit.MINUTES);
-    }
-
-    public static int preparedStatementsCount()
-    {
-        return preparedStatements.size() + thriftPreparedStatements.size();
-    }
-
     // Work around initialization dependency
     private static enum InternalStateInstance
     {
@@ -214,19 +148,11 @@ class query_processor {
 #endif
 public:
     ::shared_ptr<statements::prepared_statement> get_prepared(const bytes& id) {
-        auto it = _prepared_statements.find(id);
-        if (it == _prepared_statements.end()) {
-            return ::shared_ptr<statements::prepared_statement>{};
-        }
-        return it->second;
+        return _prepared_statements.get(id);
     }
 
     ::shared_ptr<statements::prepared_statement> get_prepared_for_thrift(int32_t id) {
-        auto it = _thrift_prepared_statements.find(id);
-        if (it == _thrift_prepared_statements.end()) {
-            return ::shared_ptr<statements::prepared_statement>{};
-        }
-        return it->second;
+        return _thrift_prepared_statements.get(id);
     }
 #if 0
     public static void validateKey(ByteBuffer key) throws InvalidRequestException
@@ -447,20 +373,11 @@ class query_processor {
     void invalidate_prepared_statements(Pred filter) {
         static_assert(std::is_same<bool, std::result_of_t<Pred(::shared_ptr<cql_statement>)>>::value,
                       "bad Pred signature");
-        for (auto it = _prepared_statements.begin(); it != _prepared_statements.end(); ) {
-            if (filter(it->second->statement)) {
-                it = _prepared_statements.erase(it);
-            } else {
-                ++it;
-            }
-        }
-        for (auto it = _thrift_prepared_statements.begin(); it != _thrift_prepared_statements.end(); ) {
-            if (filter(it->second->statement)) {
-                it = _thrift_prepared_statements.erase(it);
-            } else {
-                ++it;
-            }
-        }
+        auto pred = [&filter] (const ::shared_ptr<statements::prepared_statement>& p) {
+            return filter(p->statement);
+        };
+        _prepared_statements.remove_if(pred);
+        _thrift_prepared_statements.remove_if(pred);
     }
 
 #if 0
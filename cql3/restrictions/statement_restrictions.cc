@@ -27,6 +27,7 @@
 #include "statement_restrictions.hh"
 #include "single_column_primary_key_restrictions.hh"
 #include "token_restriction.hh"
+#include "db/index/secondary_index.hh"
 
 namespace cql3 {
 namespace restrictions {
@@ -153,15 +154,17 @@ statement_restrictions::statement_restrictions(database& db,
         }
     }
 
-    warn(unimplemented::cause::INDEXES);
-#if 0
-    ColumnFamilyStore cfs = Keyspace.open(cfm.ks_name).getColumnFamilyStore(cfm.cfName);
-    secondary_index_manager secondaryIndexManager = cfs.index_manager;
-#endif
-    bool has_queriable_clustering_column_index = false; /*_clustering_columns_restrictions->has_supporting_index(secondaryIndexManager);*/
-    bool has_queriable_index = false; /*has_queriable_clustering_column_index
-            || _partition_key_restrictions->has_supporting_index(secondaryIndexManager)
-            || nonprimary_key_restrictions->has_supporting_index(secondaryIndexManager);*/
+    // Secondary indexes are only kept for regular columns and only support
+    // equality.
+    for (auto&& e : _nonprimary_key_restrictions->restrictions()) {
+        if (e.first->is_indexed() && db::index::is_indexable(*e.first) && e.second->is_EQ()) {
+            _indexed_column = e.first;
+            _index_restriction = e.second;
+            break;
+        }
+    }
+    bool has_queriable_clustering_column_index = false;
+    bool has_queriable_index = bool(_indexed_column);
 
     // At this point, the select statement if fully constructed, but we still have a few things to validate
     process_partition_key_restrictions(has_queriable_index);
@@ -220,10 +223,15 @@ statement_restrictions::statement_restrictions(database& db,
     }
 
     if (_uses_secondary_indexing) {
-        fail(unimplemented::cause::INDEXES);
-#if 0
+        if (!has_queriable_index) {
+            throw exceptions::invalid_request_exception("No secondary indexes on the restricted columns support the provided operators");
+        }
+        if (!_partition_key_restrictions->empty() || !_clustering_columns_restrictions->empty()
+                || _nonprimary_key_restrictions->size() != 1) {
+            throw exceptions::invalid_request_exception(
+                "Secondary index queries restricting columns other than the indexed one are not supported");
+        }
         validate_secondary_index_selections(selects_only_static_columns);
-#endif
     }
 }
 
@@ -93,6 +93,12 @@ class statement_restrictions {
      */
     bool _uses_secondary_indexing = false;
 
+    /**
+     * The EQ restriction on an indexed column used to query its secondary index
+     */
+    ::shared_ptr<restriction> _index_restriction;
+    const column_definition* _indexed_column = nullptr;
+
     /**
      * Specify if the query will return a range of partition keys.
      */
@@ -147,6 +153,20 @@ class statement_restrictions {
         return _uses_secondary_indexing;
     }
 
+    /**
+     * Returns the column whose secondary index is queried, if uses_secondary_indexing().
+     */
+    const column_definition* get_indexed_column() const {
+        return _indexed_column;
+    }
+
+    /**
+     * Returns the value the indexed column is looked up by.
+     */
+    bytes_opt get_indexed_value(const query_options& options) const {
+        return _index_restriction->value(options);
+    }
+
 private:
     void process_partition_key_restrictions(bool has_queriable_index);
 
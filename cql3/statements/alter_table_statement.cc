@@ -43,6 +43,7 @@
 #include "service/migration_manager.hh"
 #include "validation.hh"
 #include "db/config.hh"
+#include "db/index/secondary_index.hh"
 
 namespace cql3 {
 
@@ -86,6 +87,7 @@ future<bool> alter_table_statement::announce_migration(distributed<service::stor
     if (_validator) {
         validator = _validator->prepare(db, keyspace());
     }
+    std::vector<schema_ptr> dropped_index_tables;
     shared_ptr<column_identifier> column_name;
     const column_definition* def = nullptr;
     if (_raw_column_name) {
@@ -124,6 +126,13 @@ future<bool> alter_table_statement::announce_migration(distributed<service::stor
         }
 
         auto type = validator->get_type();
+        if (type->is_counter() && !schema->is_counter()) {
+            throw exceptions::invalid_request_exception(sprint("Cannot add a counter column (%s) in a non counter column family", column_name));
+        }
+        if (!type->is_counter() && schema->is_counter()) {
+            throw exceptions::invalid_request_exception(sprint("Cannot add a non counter column (%s) in a counter column family", column_name));
+        }
+
         if (type->is_collection() && type->is_multi_cell()) {
             if (!schema->is_compound()) {
                 throw exceptions::invalid_request_exception("Cannot use non-frozen collections with a non-composite PRIMARY KEY");
@@ -218,6 +227,13 @@ future<bool> alter_table_statement::announce_migration(distributed<service::stor
                     break;
                 }
             }
+            // The index of the column is dropped with it.
+            if (def->is_indexed()) {
+                auto index_schema = db::index::find_index_schema(db, *schema, *def);
+                if (index_schema) {
+                    dropped_index_tables.emplace_back(std::move(index_schema));
+                }
+            }
         }
         break;
 
@@ -262,6 +278,11 @@ future<bool> alter_table_statement::announce_migration(distributed<service::stor
         break;
     }
 
+    if (!dropped_index_tables.empty()) {
+        return service::get_local_migration_manager().announce_index_update(cfm.build(), { }, std::move(dropped_index_tables), is_local_only).then([] {
+            return true;
+        });
+    }
     return service::get_local_migration_manager().announce_column_family_update(cfm.build(), false, is_local_only).then([] {
         return true;
     });
@@ -45,6 +45,7 @@
 #include "service/migration_manager.hh"
 #include "schema.hh"
 #include "schema_builder.hh"
+#include "db/index/secondary_index.hh"
 
 cql3::statements::create_index_statement::create_index_statement(
         ::shared_ptr<cf_name> name, ::shared_ptr<index_name> index_name,
@@ -164,12 +165,21 @@ cql3::statements::create_index_statement::validate(distributed<service::storage_
                         "Cannot create secondary index on partition key column %s",
                         *target->column));
     }
+    if (!db::index::is_indexable(*cd)) {
+        throw exceptions::invalid_request_exception(
+                sprint(
+                        "Cannot create secondary index on %s: only regular columns of non-collection types can be indexed",
+                        *target->column));
+    }
+    if (!_index_name.empty() && proxy.local().get_db().local().existing_index_names().count(_index_name)) {
+        throw exceptions::invalid_request_exception(sprint("Duplicate index name %s", _index_name));
+    }
 }
 
 future<bool>
 cql3::statements::create_index_statement::announce_migration(distributed<service::storage_proxy>& proxy, bool is_local_only) {
-    throw std::runtime_error("Indexes are not supported yet");
-    auto schema = proxy.local().get_db().local().find_schema(keyspace(), column_family());
+    auto& db = proxy.local().get_db().local();
+    auto schema = db.find_schema(keyspace(), column_family());
     auto target = _raw_target->prepare(schema);
 
     schema_builder cfm(schema);
@@ -196,11 +206,16 @@ cql3::statements::create_index_statement::announce_migration(distributed<service
         idx.index_options = index_options_map();
     }
 
-    idx.index_name = _index_name;
-    cfm.add_default_index_names(proxy.local().get_db().local());
+    if (!_index_name.empty()) {
+        idx.index_name = _index_name;
+    }
+    cfm.find_column(*target->column).idx_info = idx;
+    cfm.add_default_index_names(db);
 
-    return service::get_local_migration_manager().announce_column_family_update(
-            cfm.build(), false, is_local_only).then([]() {
+    auto new_schema = cfm.build();
+    auto index_schema = db::index::make_index_schema(*new_schema, *new_schema->get_column_definition(cd->name()));
+    return service::get_local_migration_manager().announce_index_update(
+            new_schema, { index_schema }, { }, is_local_only).then([]() {
         return make_ready_future<bool>(true);
     });
 }
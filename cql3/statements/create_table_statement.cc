@@ -45,6 +45,8 @@
 
 #include <boost/range/adaptor/map.hpp>
 #include <boost/range/algorithm/adjacent_find.hpp>
+#include <boost/algorithm/cxx11/any_of.hpp>
+#include <boost/algorithm/cxx11/all_of.hpp>
 
 #include "cql3/statements/create_table_statement.hh"
 #include "cql3/statements/prepared_statement.hh"
@@ -132,10 +134,10 @@ void create_table_statement::apply_properties_to(schema_builder& builder) {
     for (auto&& column : columns) {
         builder.with_column(column);
     }
-#if 0
-    cfmd.defaultValidator(defaultValidator)
-        .addAllColumnDefinitions(getColumns(cfmd))
-#endif
+    // The default validator marks counter tables, see schema::is_counter().
+    if (boost::algorithm::any_of(_columns | boost::adaptors::map_values, std::mem_fn(&abstract_type::is_counter))) {
+        builder.set_default_validator(counter_type);
+    }
     add_column_metadata_from_aliases(builder, _key_aliases, _partition_key_types, column_kind::partition_key);
     add_column_metadata_from_aliases(builder, _column_aliases, _clustering_key_types, column_kind::clustering_key);
 #if 0
@@ -188,10 +190,6 @@ ::shared_ptr<prepared_statement> create_table_statement::raw_statement::prepare(
     for (auto&& entry : _definitions) {
         ::shared_ptr<column_identifier> id = entry.first;
         ::shared_ptr<cql3_type> pt = entry.second->prepare(db, keyspace());
-        // FIXME: remove this check once we support counters
-        if (pt->is_counter()) {
-            fail(unimplemented::cause::COUNTERS);
-        }
         if (pt->is_collection() && pt->get_type()->is_multi_cell()) {
             if (!defined_multi_cell_collections) {
                 defined_multi_cell_collections = std::map<bytes, data_type>{};
@@ -277,6 +275,15 @@ ::shared_ptr<prepared_statement> create_table_statement::raw_statement::prepare(
         }
     }
 
+    bool has_counters = boost::algorithm::any_of(stmt->_columns | boost::adaptors::map_values, std::mem_fn(&abstract_type::is_counter));
+    bool has_non_counters = !boost::algorithm::all_of(stmt->_columns | boost::adaptors::map_values, std::mem_fn(&abstract_type::is_counter));
+    if (has_counters && has_non_counters) {
+        throw exceptions::invalid_request_exception("Cannot mix counter and non counter columns in the same table");
+    }
+    if (has_counters && properties->get_default_time_to_live() > 0) {
+        throw exceptions::invalid_request_exception("Cannot set default_time_to_live on a table with counters");
+    }
+
     if (!_static_columns.empty()) {
         // Only CQL3 tables can have static columns
         if (_use_compact_storage) {
@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2016 ScyllaDB
+ *
+ * Modified by ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cql3/statements/drop_index_statement.hh"
+#include "cql3/column_identifier.hh"
+#include "service/migration_manager.hh"
+#include "service/storage_proxy.hh"
+#include "schema_builder.hh"
+#include "db/index/secondary_index.hh"
+
+#include <boost/range/adaptor/map.hpp>
+
+namespace cql3 {
+
+namespace statements {
+
+drop_index_statement::drop_index_statement(::shared_ptr<index_name> index_name, bool if_exists)
+    : schema_altering_statement{index_name->get_cf_name()}
+    , _index_name{index_name->get_idx()}
+    , _if_exists{if_exists}
+{
+}
+
+const sstring& drop_index_statement::column_family() const
+{
+    auto cfm = lookup_indexed_table();
+    _indexed_table = cfm ? cfm->cf_name() : sstring();
+    return _indexed_table;
+}
+
+future<> drop_index_statement::check_access(const service::client_state& state)
+{
+    auto cfm = lookup_indexed_table();
+    if (!cfm) {
+        return make_ready_future<>();
+    }
+    return state.has_column_family_access(cfm->ks_name(), cfm->cf_name(), auth::permission::ALTER);
+}
+
+void drop_index_statement::validate(distributed<service::storage_proxy>&, const service::client_state& state)
+{
+    find_indexed_table();
+}
+
+future<bool> drop_index_statement::announce_migration(distributed<service::storage_proxy>& proxy, bool is_local_only)
+{
+    auto cfm = find_indexed_table();
+    if (!cfm) {
+        return make_ready_future<bool>(false);
+    }
+    auto& db = proxy.local().get_db().local();
+    schema_builder builder(cfm);
+    std::vector<schema_ptr> dropped_index_tables;
+    for (auto&& cdef : cfm->regular_columns()) {
+        if (cdef.idx_info.index_name && *cdef.idx_info.index_name == _index_name) {
+            auto index_schema = db::index::find_index_schema(db, *cfm, cdef);
+            if (index_schema) {
+                dropped_index_tables.emplace_back(std::move(index_schema));
+            }
+            builder.find_column(column_identifier(cdef.name(), cdef.type)).idx_info = index_info();
+        }
+    }
+    return service::get_local_migration_manager().announce_index_update(builder.build(), { }, std::move(dropped_index_tables), is_local_only).then([] {
+        return true;
+    });
+}
+
+shared_ptr<transport::event::schema_change> drop_index_statement::change_event()
+{
+    using namespace transport;
+
+    return make_shared<event::schema_change>(event::schema_change::change_type::UPDATED,
+                                             event::schema_change::target_type::TABLE,
+                                             keyspace(),
+                                             column_family());
+}
+
+schema_ptr drop_index_statement::lookup_indexed_table() const
+{
+    auto& db = service::get_local_storage_proxy().get_db().local();
+    if (!db.has_keyspace(keyspace())) {
+        return nullptr;
+    }
+    for (auto&& cfm : db.find_keyspace(keyspace()).metadata()->cf_meta_data() | boost::adaptors::map_values) {
+        for (auto&& cdef : cfm->regular_columns()) {
+            if (cdef.idx_info.index_name && *cdef.idx_info.index_name == _index_name) {
+                return cfm;
+            }
+        }
+    }
+    return nullptr;
+}
+
+schema_ptr drop_index_statement::find_indexed_table() const
+{
+    auto cfm = lookup_indexed_table();
+    if (!cfm && !_if_exists) {
+        throw exceptions::invalid_request_exception(sprint("Index '%s' could not be found in any of the tables of keyspace '%s'",
+                                                           _index_name, keyspace()));
+    }
+    return cfm;
+}
+
+}
+
+}
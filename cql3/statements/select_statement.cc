@@ -48,6 +48,12 @@
 #include "query-result-reader.hh"
 #include "query_result_merger.hh"
 #include "service/pager/query_pagers.hh"
+#include "db/index/secondary_index.hh"
+#include "dht/i_partitioner.hh"
+#include "database.hh"
+
+#include <boost/range/irange.hpp>
+#include <map>
 
 namespace cql3 {
 
@@ -222,6 +228,10 @@ select_statement::execute(distributed<service::storage_proxy>& proxy,
 
     validate_for_read(_schema->ks_name(), cl);
 
+    if (_restrictions->uses_secondary_indexing()) {
+        return execute_using_index(proxy, state, options, cl);
+    }
+
     int32_t limit = get_limit(options);
     auto now = db_clock::now();
 
@@ -325,6 +335,10 @@ select_statement::execute_internal(distributed<service::storage_proxy>& proxy,
                                    service::query_state& state,
                                    const query_options& options)
 {
+    if (_restrictions->uses_secondary_indexing()) {
+        return execute_using_index(proxy, state, options, db::consistency_level::ONE);
+    }
+
     int32_t limit = get_limit(options);
     auto now = db_clock::now();
     auto command = ::make_lw_shared<query::read_command>(_schema->id(), _schema->version(),
@@ -372,6 +386,263 @@ select_statement::process_results(foreign_ptr<lw_shared_ptr<query::result>> resu
     return ::make_shared<transport::messages::result_message::rows>(std::move(rs));
 }
 
+namespace {
+
+// Index entries are read in batches of at most this many.
+constexpr uint32_t index_page_size = 1000;
+
+struct index_entry {
+    clustering_key key;
+    api::timestamp_type timestamp;
+};
+
+// Collects the entries of an index partition, read along with their
+// timestamp column.
+class index_entries_visitor {
+    std::vector<index_entry>& _entries;
+public:
+    explicit index_entries_visitor(std::vector<index_entry>& entries) : _entries(entries) { }
+
+    void accept_new_partition(const partition_key& key, uint32_t row_count) { }
+    void accept_new_partition(uint32_t row_count) { }
+    void accept_new_row(const clustering_key& key, const query::result_row_view& static_row, const query::result_row_view& row) {
+        auto cell = row.iterator().next_atomic_cell();
+        _entries.push_back(index_entry{key, cell ? cell->timestamp() : api::missing_timestamp});
+    }
+    void accept_new_row(const query::result_row_view& static_row, const query::result_row_view& row) { }
+    void accept_partition_end(const query::result_row_view& static_row) { }
+};
+
+struct stale_index_entry {
+    clustering_key index_ck;
+    api::timestamp_type timestamp;
+};
+
+using index_entry_timestamps = std::map<clustering_key, api::timestamp_type, clustering_key::less_compare>;
+
+// Passes on the base rows whose indexed column still holds the looked up
+// value. The indexed column is read at the given position of the regular
+// columns of the slice. Entries whose base row no longer holds the value
+// are recorded, so that they can be deleted; every base row found is
+// removed from pending, leaving the entries whose base row is gone.
+class index_filtering_visitor : public cql3::selection::result_set_builder::visitor {
+    const schema& _index_schema;
+    const column_definition& _indexed_column;
+    const std::vector<column_id>& _regular_columns;
+    size_t _position;
+    const bytes& _value;
+    index_entry_timestamps& _pending;
+    std::vector<stale_index_entry>& _stale_entries;
+    uint32_t& _matched;
+    std::experimental::optional<partition_key> _key;
+public:
+    index_filtering_visitor(cql3::selection::result_set_builder& builder, const schema& s, const cql3::selection::selection& selection,
+            const schema& index_schema, const column_definition& indexed_column, const std::vector<column_id>& regular_columns,
+            size_t position, const bytes& value, index_entry_timestamps& pending, std::vector<stale_index_entry>& stale_entries,
+            uint32_t& matched)
+        : visitor(builder, s, selection)
+        , _index_schema(index_schema)
+        , _indexed_column(indexed_column)
+        , _regular_columns(regular_columns)
+        , _position(position)
+        , _value(value)
+        , _pending(pending)
+        , _stale_entries(stale_entries)
+        , _matched(matched)
+    { }
+
+    void accept_new_partition(const partition_key& key, uint32_t row_count) {
+        _key = key;
+        visitor::accept_new_partition(key, row_count);
+    }
+
+    void accept_new_row(const clustering_key& key, const query::result_row_view& static_row, const query::result_row_view& row) {
+        auto index_ck = db::index::make_index_clustering_key(_index_schema, _schema, *_key, key);
+        auto entry = _pending.find(index_ck);
+        if (entry == _pending.end()) {
+            return;
+        }
+        auto timestamp = entry->second;
+        _pending.erase(entry);
+
+        auto i = row.iterator();
+        for (size_t n = 0; n < _position; ++n) {
+            i.skip(_schema.regular_column_at(_regular_columns[n]));
+        }
+        auto cell = i.next_atomic_cell();
+        if (cell && _indexed_column.type->equal(cell->value(), _value)) {
+            visitor::accept_new_row(key, static_row, row);
+            ++_matched;
+        } else {
+            _stale_entries.push_back(stale_index_entry{std::move(index_ck), timestamp});
+        }
+    }
+
+    // Partitions without matching rows must not show up in the result.
+    void accept_partition_end(const query::result_row_view& static_row) { }
+};
+
+struct index_query_state {
+    cql3::selection::result_set_builder builder;
+    std::experimental::optional<clustering_key> last_entry;
+    std::vector<stale_index_entry> stale_entries;
+    uint32_t matched = 0;
+    bool exhausted = false;
+
+    index_query_state(const cql3::selection::selection& selection, db_clock::time_point now, cql_serialization_format sf)
+        : builder(selection, now, sf)
+    { }
+};
+
+}
+
+// Paging is not supported, all matching rows up to the limit are returned in
+// one response.
+future<shared_ptr<transport::messages::result_message>>
+select_statement::execute_using_index(distributed<service::storage_proxy>& proxy,
+                                      service::query_state& state,
+                                      const query_options& options,
+                                      db::consistency_level cl)
+{
+    auto& cdef = *_restrictions->get_indexed_column();
+    auto index_schema = db::index::find_index_schema(proxy.local().get_db().local(), *_schema, cdef);
+    if (!index_schema) {
+        throw exceptions::invalid_request_exception(sprint("Index %s on %s.%s is not available",
+            *cdef.idx_info.index_name, keyspace(), column_family()));
+    }
+    auto value = _restrictions->get_indexed_value(options);
+    if (!value) {
+        throw exceptions::invalid_request_exception(sprint("Unsupported null value for indexed column %s", cdef.name_as_text()));
+    }
+    uint32_t limit = get_limit(options);
+    auto now = db_clock::now();
+    auto timestamp = options.get_timestamp(state);
+
+    // The base rows are read along with the indexed column, so that they can
+    // be checked against the index entries pointing at them.
+    auto slice = make_partition_slice(options);
+    auto static_columns = slice.static_columns;
+    auto regular_columns = slice.regular_columns;
+    size_t position = std::distance(regular_columns.begin(), std::find(regular_columns.begin(), regular_columns.end(), cdef.id));
+    if (position == regular_columns.size()) {
+        regular_columns.push_back(cdef.id);
+    }
+    auto opts = _opts;
+    opts.set(query::partition_slice::option::send_partition_key);
+    opts.set(query::partition_slice::option::send_clustering_key);
+    opts.set(query::partition_slice::option::send_timestamp);
+
+    auto index_key = dht::global_partitioner().decorate_key(*index_schema, partition_key::from_single_value(*index_schema, *value));
+    auto st = make_lw_shared<index_query_state>(*_selection, now, options.get_cql_serialization_format());
+
+    return do_with(std::move(static_columns), std::move(regular_columns), std::move(*value), std::move(index_key),
+            [this, &proxy, &options, cl, limit, now, timestamp, position, opts, index_schema, st]
+            (auto& static_columns, auto& regular_columns, auto& value, auto& index_key) {
+        return do_until([st, limit] { return st->exhausted || st->matched >= limit; },
+                [this, &proxy, &options, cl, limit, now, timestamp, position, opts, index_schema, &index_key, st, &static_columns, &regular_columns, &value] {
+            auto batch_size = std::min(limit - st->matched, index_page_size);
+            auto range = st->last_entry
+                    ? query::clustering_range(query::clustering_range::bound(*st->last_entry, false), {})
+                    : query::clustering_range::make_open_ended_both_sides();
+            query::partition_slice::option_set index_opts;
+            index_opts.set(query::partition_slice::option::send_clustering_key);
+            index_opts.set(query::partition_slice::option::send_timestamp);
+            std::vector<column_id> index_columns{ db::index::index_timestamp_column(*index_schema).id };
+            auto index_cmd = ::make_lw_shared<query::read_command>(index_schema->id(), index_schema->version(),
+                query::partition_slice({ range }, {}, std::move(index_columns), index_opts, nullptr, options.get_cql_serialization_format()),
+                batch_size, to_gc_clock(now), std::experimental::nullopt, timestamp);
+            std::vector<query::partition_range> index_ranges{ query::partition_range::make_singular(index_key) };
+            return proxy.local().query(index_schema, index_cmd, std::move(index_ranges), cl).then(
+                    [this, &proxy, &options, cl, now, timestamp, position, opts, index_schema, index_cmd, batch_size, st, &static_columns, &regular_columns, &value]
+                    (foreign_ptr<lw_shared_ptr<query::result>> result) {
+                std::vector<index_entry> entries;
+                query::result_view::consume(*result, index_cmd->slice, index_entries_visitor(entries));
+                if (entries.size() < batch_size) {
+                    st->exhausted = true;
+                }
+                if (entries.empty()) {
+                    return make_ready_future<>();
+                }
+                st->last_entry = entries.back().key;
+                auto pending = make_lw_shared<index_entry_timestamps>(clustering_key::less_compare(*index_schema));
+                for (auto&& e : entries) {
+                    pending->emplace(e.key, e.timestamp);
+                }
+
+                // Entries pointing at the same base partition are adjacent,
+                // each partition is read with a single command.
+                std::vector<lw_shared_ptr<query::read_command>> cmds;
+                std::vector<query::partition_range> ranges;
+                query::clustering_row_ranges row_ranges;
+                std::experimental::optional<partition_key> pk;
+                auto add_command = [&] {
+                    auto row_limit = row_ranges.size();
+                    cmds.push_back(::make_lw_shared<query::read_command>(_schema->id(), _schema->version(),
+                        query::partition_slice(std::move(row_ranges), static_columns, regular_columns, opts, nullptr, options.get_cql_serialization_format()),
+                        row_limit, to_gc_clock(now), std::experimental::nullopt, timestamp));
+                    ranges.push_back(query::partition_range::make_singular(dht::global_partitioner().decorate_key(*_schema, std::move(*pk))));
+                    row_ranges = { };
+                };
+                for (auto&& e : entries) {
+                    auto keys = db::index::base_key_of_index_entry(*_schema, *index_schema, e.key);
+                    if (pk && !pk->equal(*_schema, keys.first)) {
+                        add_command();
+                    }
+                    pk = std::move(keys.first);
+                    if (_schema->clustering_key_size() > 0) {
+                        row_ranges.push_back(query::clustering_range::make_singular(std::move(keys.second)));
+                    } else if (row_ranges.empty()) {
+                        row_ranges.push_back(query::clustering_range::make_open_ended_both_sides());
+                    }
+                }
+                add_command();
+
+                auto results = make_lw_shared<std::vector<foreign_ptr<lw_shared_ptr<query::result>>>>(cmds.size());
+                return do_with(std::move(cmds), std::move(ranges), [this, &proxy, cl, position, index_schema, results, pending, st, &regular_columns, &value]
+                        (auto& cmds, auto& ranges) {
+                    return parallel_for_each(boost::irange<size_t>(0, cmds.size()), [this, &proxy, cl, results, &cmds, &ranges] (size_t i) {
+                        std::vector<query::partition_range> prange{ ranges[i] };
+                        return proxy.local().query(_schema, cmds[i], std::move(prange), cl).then([results, i] (foreign_ptr<lw_shared_ptr<query::result>> r) {
+                            (*results)[i] = std::move(r);
+                        });
+                    }).then([this, &proxy, position, index_schema, results, pending, st, &cmds, &regular_columns, &value] {
+                        auto& cdef = *_restrictions->get_indexed_column();
+                        for (size_t i = 0; i < cmds.size(); ++i) {
+                            query::result_view::consume(*(*results)[i], cmds[i]->slice,
+                                index_filtering_visitor(st->builder, *_schema, *_selection, *index_schema, cdef, regular_columns,
+                                    position, value, *pending, st->stale_entries, st->matched));
+                        }
+                        // The base rows of the entries left were deleted.
+                        for (auto&& e : *pending) {
+                            st->stale_entries.push_back(stale_index_entry{e.first, e.second});
+                        }
+                        if (st->stale_entries.empty()) {
+                            return make_ready_future<>();
+                        }
+                        std::vector<mutation> deletions;
+                        for (auto&& e : st->stale_entries) {
+                            // Without the entry's timestamp a newer entry could be deleted.
+                            if (e.timestamp == api::missing_timestamp) {
+                                continue;
+                            }
+                            deletions.emplace_back(db::index::make_index_entry_deletion(index_schema, value, e.index_ck, e.timestamp));
+                        }
+                        st->stale_entries.clear();
+                        return proxy.local().mutate(std::move(deletions), db::consistency_level::ONE).handle_exception([] (auto ep) {
+                            // Left over entries are found again by later reads.
+                        });
+                    });
+                });
+            });
+        });
+    }).then([st, limit] {
+        auto rs = st->builder.build();
+        rs->trim(limit);
+        return make_ready_future<shared_ptr<transport::messages::result_message>>(
+            ::make_shared<transport::messages::result_message::rows>(std::move(rs)));
+    });
+}
+
 namespace raw {
 
 select_statement::select_statement(::shared_ptr<cf_name> cf_name,
@@ -397,6 +668,9 @@ ::shared_ptr<prepared_statement> select_statement::prepare(database& db) {
     auto restrictions = prepare_restrictions(db, schema, bound_names, selection);
 
     if (_parameters->is_distinct()) {
+        if (restrictions->uses_secondary_indexing()) {
+            throw exceptions::invalid_request_exception("SELECT DISTINCT queries using secondary indexes are not supported");
+        }
         validate_distinct_selection(schema, selection, restrictions);
     }
 
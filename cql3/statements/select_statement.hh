@@ -126,6 +126,11 @@ class select_statement : public cql_statement {
 
     shared_ptr<transport::messages::result_message> process_results(foreign_ptr<lw_shared_ptr<query::result>> results,
         lw_shared_ptr<query::read_command> cmd, const query_options& options, db_clock::time_point now);
+
+    // Looks the rows up in the secondary index restricted by the query and
+    // reads them from the base table.
+    future<::shared_ptr<transport::messages::result_message>> execute_using_index(distributed<service::storage_proxy>& proxy,
+        service::query_state& state, const query_options& options, db::consistency_level cl);
 #if 0
     private ResultMessage.Rows pageAggregateQuery(QueryPager pager, QueryOptions options, int pageSize, long now)
             throws RequestValidationException, RequestExecutionException
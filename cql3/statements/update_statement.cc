@@ -43,6 +43,7 @@
 #include "raw/update_statement.hh"
 #include "raw/insert_statement.hh"
 #include "unimplemented.hh"
+#include "db/index/secondary_index.hh"
 
 #include "cql3/operation_impl.hh"
 
@@ -90,24 +91,27 @@ void update_statement::add_update_for_key(mutation& m, const exploded_clustering
         update->execute(m, prefix, params);
     }
 
-    warn(unimplemented::cause::INDEXES);
-#if 0
-        SecondaryIndexManager indexManager = Keyspace.open(cfm.ksName).getColumnFamilyStore(cfm.cfId).indexManager;
-        if (indexManager.hasIndexes())
-        {
-            for (Cell cell : cf)
-            {
-                // Indexed values must be validated by any applicable index. See CASSANDRA-3057/4240/8081 for more details
-                if (!indexManager.validate(cell))
-                    throw new InvalidRequestException(String.format("Can't index column value of size %d for index %s on %s.%s",
-                                                                    cell.value().remaining(),
-                                                                    cfm.getColumnDefinition(cell.name()).getIndexName(),
-                                                                    cfm.ksName,
-                                                                    cfm.cfName));
-            }
+    // Indexed values are the partition keys of the index tables, so they
+    // are bounded like partition keys.
+    for (auto&& update : _column_operations) {
+        auto& def = update->column;
+        if (!def.is_indexed() || !db::index::is_indexable(def)) {
+            continue;
+        }
+        auto& cells = m.partition().clustered_row(clustering_key::from_clustering_prefix(*s, prefix)).cells();
+        auto cell = cells.find_cell(def.id);
+        if (!cell) {
+            continue;
+        }
+        auto size = with_linearized_managed_bytes([&] {
+            auto ac = cell->as_atomic_cell();
+            return ac.is_live() ? ac.value().size() : 0;
+        });
+        if (size > std::numeric_limits<uint16_t>::max()) {
+            throw exceptions::invalid_request_exception(sprint("Can't index column value of size %d for index %s on %s.%s",
+                    size, *def.idx_info.index_name, s->ks_name(), s->cf_name()));
         }
     }
-#endif
 }
 
 namespace raw {
@@ -146,13 +146,9 @@ class update_parameters final {
         }
     };
 
-#if 0
-     public Cell makeCounter(CellName name, long delta) throws InvalidRequestException
-     {
-         QueryProcessor.validateCellName(name, metadata.comparator);
-         return new BufferCounterUpdateCell(name, delta, FBUtilities.timestampMicros());
-     }
-#endif
+    atomic_cell make_counter_update_cell(int64_t delta) const {
+        return atomic_cell::make_live_counter_update(_timestamp, delta);
+    }
 
     tombstone make_tombstone() const {
         return {_timestamp, _local_deletion_time};
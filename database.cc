@@ -227,6 +227,7 @@ class range_sstable_reader final : public mutation_reader::impl {
 
 class single_key_sstable_reader final : public mutation_reader::impl {
     schema_ptr _schema;
+    partition_key _pk;
     dht::ring_position _rp;
     sstables::key _key;
     std::vector<streamed_mutation> _mutations;
@@ -236,25 +237,40 @@ class single_key_sstable_reader final : public mutation_reader::impl {
     // the priority changes.
     const io_priority_class& _pc;
     query::clustering_key_filtering_context _ck_filtering;
+    bool _use_clustering_key_filter;
+private:
+    std::vector<sstables::shared_sstable> select_sstables() const {
+        auto sstables = _sstables->select(query::partition_range(_rp));
+        if (_use_clustering_key_filter) {
+            auto& ranges = _ck_filtering.get_ranges(_pk);
+            sstables.erase(boost::remove_if(sstables, [&] (const sstables::shared_sstable& sst) {
+                return !sst->may_contain_rows(*_schema, ranges);
+            }), sstables.end());
+        }
+        return sstables;
+    }
 public:
     single_key_sstable_reader(schema_ptr schema,
                               lw_shared_ptr<sstables::sstable_set> sstables,
                               const partition_key& key,
                               query::clustering_key_filtering_context ck_filtering,
-                              const io_priority_class& pc)
+                              const io_priority_class& pc,
+                              bool use_clustering_key_filter)
         : _schema(std::move(schema))
+        , _pk(key)
         , _rp(dht::global_partitioner().decorate_key(*_schema, key))
         , _key(sstables::key::from_partition_key(*_schema, key))
         , _sstables(std::move(sstables))
         , _pc(pc)
         , _ck_filtering(ck_filtering)
+        , _use_clustering_key_filter(use_clustering_key_filter)
     { }
 
     virtual future<streamed_mutation_opt> operator()() override {
         if (_done) {
             return make_ready_future<streamed_mutation_opt>();
         }
-        return parallel_for_each(_sstables->select(query::partition_range(_rp)),
+        return parallel_for_each(select_sstables(),
             [this](const lw_shared_ptr<sstables::sstable>& sstable) {
                 return sstable->read_row(_schema, _key, _ck_filtering, _pc).then([this](auto smo) {
                     if (smo) {
@@ -290,7 +306,12 @@ column_family::make_sstable_reader(schema_ptr s,
         if (dht::shard_of(pos.token()) != engine().cpu_id()) {
             return make_empty_reader(); // range doesn't belong to this shard
         }
-        return restrict_reader(make_mutation_reader<single_key_sstable_reader>(std::move(s), _sstables, *pos.key(), ck_filtering, pc));
+        // Static rows are not bounded by clustering keys, so sstables can't be
+        // ruled out by them when there are static columns.
+        auto use_clustering_key_filter = _compaction_strategy.use_clustering_key_filter()
+                && s->clustering_key_size() && !s->has_static_columns();
+        return restrict_reader(make_mutation_reader<single_key_sstable_reader>(std::move(s), _sstables, *pos.key(), ck_filtering, pc,
+                use_clustering_key_filter));
     } else {
         // range_sstable_reader is not movable so we need to wrap it
         return restrict_reader(make_mutation_reader<range_sstable_reader>(std::move(s), _sstables, pr, ck_filtering, pc));
@@ -398,6 +419,27 @@ column_family::make_reader(schema_ptr s,
     return make_combined_reader(std::move(readers));
 }
 
+mutation_reader
+column_family::make_streaming_reader(schema_ptr s,
+                           const query::partition_range& range,
+                           const io_priority_class& pc) const {
+    if (query::is_wrap_around(range, *s)) {
+        fail(unimplemented::cause::WRAP_AROUND);
+    }
+
+    std::vector<mutation_reader> readers;
+    readers.reserve(_memtables->size() + 1);
+
+    // Memtables which are flushed while being read fall back to reading the
+    // flushed sstable, so nothing is missed.
+    for (auto&& mt : *_memtables) {
+        readers.emplace_back(mt->make_reader(s, range, query::no_clustering_key_filtering, pc));
+    }
+    readers.emplace_back(make_sstable_reader(s, range, query::no_clustering_key_filtering, pc));
+
+    return make_combined_reader(std::move(readers));
+}
+
 // Not performance critical. Currently used for testing only.
 template <typename Func>
 future<bool>
@@ -645,6 +687,7 @@ void column_family::add_sstable(lw_shared_ptr<sstables::sstable> sstable) {
     // allow in-progress reads to continue using old list
     _sstables = make_lw_shared(*_sstables);
     update_stats_for_new_sstable(sstable->bytes_on_disk());
+    sstable->set_index_cache_stats(_stats.index_cache);
     _sstables->insert(std::move(sstable));
 }
 
@@ -1039,6 +1082,9 @@ column_family::rebuild_sstable_list(const std::vector<sstables::shared_sstable>&
            sstables_to_remove.begin(), sstables_to_remove.end());
 
     // First, add the new sstables.
+    for (auto&& tab : new_sstables) {
+        tab->set_index_cache_stats(_stats.index_cache);
+    }
 
     // this might seem dangerous, but "move" here just avoids constness,
     // making the two ranges compatible when compiling with boost 1.55.
@@ -1099,9 +1145,21 @@ column_family::compact_sstables(sstables::compaction_descriptor descriptor, bool
                 sst->set_unshared();
                 return sst;
         };
+        // Compactions which split their output into sstables of bounded size,
+        // like leveled ones, may be long; they release the input sstables as
+        // soon as their data was written out.
+        auto incremental = !cleanup && descriptor.max_sstable_bytes != std::numeric_limits<uint64_t>::max();
+        sstables::replacer_fn replacer;
+        if (incremental) {
+            replacer = [this] (const std::vector<sstables::shared_sstable>& removed, const std::vector<sstables::shared_sstable>& added) {
+                this->rebuild_sstable_list(added, removed);
+            };
+        }
         return sstables::compact_sstables(*sstables_to_compact, *this, create_sstable, descriptor.max_sstable_bytes, descriptor.level,
-                cleanup).then([this, sstables_to_compact] (auto new_sstables) {
-            return this->rebuild_sstable_list(new_sstables, *sstables_to_compact);
+                cleanup, std::move(replacer)).then([this, sstables_to_compact, incremental] (auto new_sstables) {
+            if (!incremental) {
+                this->rebuild_sstable_list(new_sstables, *sstables_to_compact);
+            }
         });
     });
 }
@@ -1139,6 +1197,12 @@ future<> column_family::cleanup_sstables(sstables::compaction_descriptor descrip
     });
 }
 
+future<> column_family::drop_expired_sstables(std::vector<sstables::shared_sstable> expired) {
+    return with_lock(_sstables_lock.for_read(), [this, expired = std::move(expired)] {
+        rebuild_sstable_list({}, expired);
+    });
+}
+
 future<>
 column_family::load_new_sstables(std::vector<sstables::entry_descriptor> new_tables) {
     return parallel_for_each(new_tables, [this] (auto comps) {
@@ -1214,6 +1278,10 @@ lw_shared_ptr<sstable_list> column_family::get_sstables() {
     return _sstables->all();
 }
 
+std::vector<sstables::shared_sstable> column_family::select_sstables(const query::partition_range& range) const {
+    return _sstables->select(range);
+}
+
 // Gets the list of all sstables in the column family, including ones that are
 // not used for active queries because they have already been compacted, but are
 // waiting for delete_atomically() to return.
@@ -1986,7 +2054,7 @@ struct query_state {
                          const std::vector<query::partition_range>& ranges)
             : schema(std::move(s))
             , cmd(cmd)
-            , builder(cmd.slice, request)
+            , builder(cmd.slice, request, cmd.digest_algo)
             , limit(cmd.row_limit)
             , partition_limit(cmd.partition_limit)
             , current_partition_range(ranges.begin())
@@ -2235,6 +2303,10 @@ future<> database::apply_in_memory(const frozen_mutation& m, schema_ptr m_schema
     });
 }
 
+future<> database::apply_replayed(const frozen_mutation& m, schema_ptr m_schema) {
+    return apply_in_memory(m, std::move(m_schema), db::replay_position());
+}
+
 future<> database::do_apply(schema_ptr s, const frozen_mutation& m) {
     // I'm doing a nullcheck here since the init code path for db etc
     // is a little in flux and commitlog is created only when db is
@@ -2275,6 +2347,40 @@ future<> database::apply(schema_ptr s, const frozen_mutation& m) {
     });
 }
 
+future<mutation> database::apply_counter_update(schema_ptr s, const frozen_mutation& fm, counter_id local_id) {
+    if (!s->is_synced()) {
+        throw std::runtime_error(sprint("attempted to mutate using not synced schema of %s.%s, version=%s",
+                                 s->ks_name(), s->cf_name(), s->version()));
+    }
+    auto m = fm.unfreeze(s);
+    auto& cf = find_column_family(m.column_family_id());
+    auto token = m.token();
+    return cf.with_counter_lock(token, [this, &cf, s, m = std::move(m), local_id] () mutable {
+        // Only the rows being updated need to be read.
+        std::vector<query::clustering_range> ranges;
+        for (auto&& cr : m.partition().clustered_rows()) {
+            ranges.emplace_back(query::clustering_range::make_singular(cr.key()));
+        }
+        auto ck_filtering = query::clustering_key_filtering_context::create_for_ranges(s, std::move(ranges));
+        auto pr = query::partition_range::make_singular(m.decorated_key());
+        return do_with(std::move(pr), std::move(ck_filtering), std::move(m), [this, &cf, s, local_id] (auto& pr, auto& ck_filtering, mutation& m) {
+            return do_with(cf.make_reader(s, pr, ck_filtering), [] (mutation_reader& reader) {
+                return reader().then([] (auto sm) {
+                    return mutation_from_streamed_mutation(std::move(sm));
+                });
+            }).then([this, s, local_id, &m] (mutation_opt current) {
+                transform_counter_updates_to_shards(m, current ? &*current : nullptr, local_id);
+                return do_with(freeze(m), [this, s] (const frozen_mutation& fm) {
+                    return do_apply(s, fm);
+                });
+            }).then([this, &m] {
+                ++_stats->total_writes;
+                return std::move(m);
+            });
+        });
+    });
+}
+
 future<> database::apply_streaming_mutation(schema_ptr s, utils::UUID plan_id, const frozen_mutation& m, bool fragmented) {
     if (!s->is_synced()) {
         throw std::runtime_error(sprint("attempted to mutate using not synced schema of %s.%s, version=%s",
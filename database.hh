@@ -68,9 +68,11 @@
 #include "utils/exponential_backoff_retry.hh"
 #include "utils/histogram.hh"
 #include "sstables/estimated_histogram.hh"
+#include "sstables/index_cache.hh"
 #include "sstables/compaction.hh"
 #include "sstables/sstable_set.hh"
 #include "key_reader.hh"
+#include "counters.hh"
 #include <seastar/core/rwlock.hh>
 #include <seastar/core/shared_future.hh>
 
@@ -340,6 +342,8 @@ class column_family {
         sstables::estimated_histogram estimated_sstable_per_read;
         utils::timed_rate_moving_average_and_histogram tombstone_scanned;
         utils::timed_rate_moving_average_and_histogram live_scanned;
+        /** Index cache hits and misses of this column family's sstables */
+        lw_shared_ptr<sstables::index_cache_stats> index_cache = make_lw_shared<sstables::index_cache_stats>();
     };
 
     struct snapshot_details {
@@ -434,6 +438,11 @@ class column_family {
     // Last but not least, we seldom need to guarantee any ordering here: as long
     // as all data is waited for, we're good.
     seastar::gate _streaming_flush_gate;
+
+    // Serializes counter updates of a partition, so that each of them is
+    // based on the state left by the previous one. Entries are removed once
+    // nobody holds or waits for them.
+    std::unordered_map<dht::token, lw_shared_ptr<semaphore>> _counter_locks;
 private:
     void update_stats_for_new_sstable(uint64_t disk_space_used_by_sstable);
     void add_sstable(sstables::sstable&& sstable);
@@ -515,6 +524,14 @@ class column_family {
 
     mutation_source as_mutation_source() const;
 
+    // Creates a mutation reader which covers memtables and sstables, but
+    // neither reads from the cache nor populates it. Meant for bulk reads,
+    // like repair, which would otherwise evict the working set of queries.
+    // The same liveness requirements as for make_reader() apply.
+    mutation_reader make_streaming_reader(schema_ptr schema,
+            const query::partition_range& range,
+            const io_priority_class& pc) const;
+
     // Queries can be satisfied from multiple data sources, so they are returned
     // as temporaries.
     //
@@ -552,6 +569,21 @@ class column_family {
     void apply(const mutation& m, const db::replay_position& = db::replay_position());
     void apply_streaming_mutation(schema_ptr, utils::UUID plan_id, const frozen_mutation&, bool fragmented);
 
+    // Runs func with the counter lock of the partition with the given token held.
+    template<typename Func>
+    futurize_t<std::result_of_t<Func()>> with_counter_lock(const dht::token& t, Func&& func) {
+        auto& sem = _counter_locks[t];
+        if (!sem) {
+            sem = make_lw_shared<semaphore>(1);
+        }
+        return with_semaphore(*sem, 1, std::forward<Func>(func)).finally([this, t, sem] {
+            // The map and this continuation are the only holders left.
+            if (sem.use_count() == 2) {
+                _counter_locks.erase(t);
+            }
+        });
+    }
+
     // Returns at most "cmd.limit" rows
     future<lw_shared_ptr<query::result>> query(schema_ptr,
         const query::read_command& cmd, query::result_request request,
@@ -637,6 +669,8 @@ class column_family {
     // given sstable, e.g. after node loses part of its token range because
     // of a newly added node.
     future<> cleanup_sstables(sstables::compaction_descriptor descriptor);
+    // Removes sstables whose data have all expired, without rewriting them.
+    future<> drop_expired_sstables(std::vector<sstables::shared_sstable> expired);
 
     future<bool> snapshot_exists(sstring name);
 
@@ -655,6 +689,8 @@ class column_family {
 
     lw_shared_ptr<sstable_list> get_sstables();
     lw_shared_ptr<sstable_list> get_sstables_including_compacted_undeleted();
+    // The sstables which may hold data in the given range.
+    std::vector<sstables::shared_sstable> select_sstables(const query::partition_range& range) const;
     size_t sstables_count();
     int64_t get_unleveled_sstables() const;
 
@@ -1048,6 +1084,15 @@ class database {
     future<lw_shared_ptr<query::result>> query(schema_ptr, const query::read_command& cmd, query::result_request request, const std::vector<query::partition_range>& ranges);
     future<reconcilable_result> query_mutations(schema_ptr, const query::read_command& cmd, const query::partition_range& range);
     future<> apply(schema_ptr, const frozen_mutation&);
+    // Applies a mutation replayed from the commitlog. Waits for dirty memory
+    // like regular writes do, so memtables are flushed as they fill up.
+    future<> apply_replayed(const frozen_mutation&, schema_ptr);
+    // Applies a mutation containing counter updates on the leader replica.
+    // The updates are turned into shards owned by local_id, based on the
+    // current state of the counters. Returns the mutation which was applied
+    // and has to be replicated. Must be called on the shard owning the
+    // partition.
+    future<mutation> apply_counter_update(schema_ptr, const frozen_mutation&, counter_id local_id);
     future<> apply_streaming_mutation(schema_ptr, utils::UUID plan_id, const frozen_mutation&, bool fragmented);
     keyspace::config make_keyspace_config(const keyspace_metadata& ksm);
     const sstring& get_snitch_name() const;
@@ -55,6 +55,7 @@
 #include <core/rwlock.hh>
 #include <core/gate.hh>
 #include <core/fstream.hh>
+#include <core/shared_future.hh>
 #include <seastar/core/memory.hh>
 #include <net/byteorder.hh>
 
@@ -64,6 +65,7 @@
 #include "utils/crc.hh"
 #include "utils/runtime.hh"
 #include "utils/flush_queue.hh"
+#include "utils/histogram.hh"
 #include "log.hh"
 #include "commitlog_entry.hh"
 #include "service/priority_manager.hh"
@@ -102,6 +104,12 @@ db::commitlog::config::config(const db::config& cfg)
     , commitlog_total_space_in_mb(cfg.commitlog_total_space_in_mb() >= 0 ? cfg.commitlog_total_space_in_mb() : memory::stats().total_memory() >> 20)
     , commitlog_segment_size_in_mb(cfg.commitlog_segment_size_in_mb())
     , commitlog_sync_period_in_ms(cfg.commitlog_sync_period_in_ms())
+    // The millisecond window predates the microsecond one; honour it for
+    // existing configurations which don't set the new option.
+    , commitlog_sync_batch_window_in_us(!cfg.commitlog_sync_batch_window_in_us.is_set() && cfg.commitlog_sync_batch_window_in_ms.is_set()
+            ? uint64_t(cfg.commitlog_sync_batch_window_in_ms()) * 1000 : cfg.commitlog_sync_batch_window_in_us())
+    , commitlog_sync_batch_max_bytes(cfg.commitlog_sync_batch_max_bytes())
+    , reuse_segments(cfg.commitlog_reuse_segments())
     , mode(cfg.commitlog_sync() == "batch" ? sync_mode::BATCH : sync_mode::PERIODIC)
 {}
 
@@ -182,6 +190,7 @@ class db::commitlog::segment_manager : public ::enable_shared_from_this<segment_
         uint64_t bytes_slack = 0;
         uint64_t segments_created = 0;
         uint64_t segments_destroyed = 0;
+        uint64_t segments_recycled = 0;
         uint64_t pending_writes = 0;
         uint64_t pending_flushes = 0;
         uint64_t pending_allocations = 0;
@@ -190,6 +199,11 @@ class db::commitlog::segment_manager : public ::enable_shared_from_this<segment_
         uint64_t total_size = 0;
         uint64_t buffer_list_bytes = 0;
         uint64_t total_size_on_disk = 0;
+        uint64_t batch_commits = 0;
+        // Entries per batch mode group commit, and microseconds from the
+        // first entry of a group until the group is on disk.
+        utils::ihistogram batch_size;
+        utils::ihistogram batch_latency;
     };
 
     stats totals;
@@ -271,6 +285,7 @@ class db::commitlog::segment_manager : public ::enable_shared_from_this<segment_
     future<sseg_ptr> new_segment();
     future<sseg_ptr> active_segment();
     future<sseg_ptr> allocate_segment(bool active);
+    bool recycle_segment(const sstring& file_name);
 
     future<> clear();
     future<> sync_all_segments(bool shutdown = false);
@@ -317,6 +332,9 @@ class db::commitlog::segment_manager : public ::enable_shared_from_this<segment_
     segment_id_type _ids = 0;
     std::vector<sseg_ptr> _segments;
     std::deque<sseg_ptr> _reserve_segments;
+    // Files of discarded segments, to be renamed and overwritten by
+    // new segments.
+    std::deque<sstring> _recycled_segments;
     std::vector<buffer_type> _temp_buffers;
     std::unordered_map<flush_handler_id, flush_handler> _flush_handlers;
     flush_handler_id _flush_ids = 0;
@@ -387,6 +405,9 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
     uint64_t _flush_pos = 0;
     uint64_t _buf_pos = 0;
     bool _closed = false;
+    // The file holds data of a previous segment past our position.
+    bool _recycled = false;
+    semaphore _write_order{1};
 
     size_t _needed_size = 0;
 
@@ -404,6 +425,17 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
 
     uint64_t _num_allocs = 0;
 
+    // Entries waiting for a batch mode group commit. They are all
+    // acknowledged by the sync which ends the group.
+    struct pending_batch {
+        shared_promise<sseg_ptr> done;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+    };
+    std::unique_ptr<pending_batch> _batch;
+    timer<> _batch_timer;
+
     std::unordered_set<table_schema_version> _known_schema_versions;
 
     friend std::ostream& operator<<(std::ostream&, const segment&);
@@ -450,20 +482,28 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
     // TODO : tune initial / default size
     static constexpr size_t default_size = align_up<size_t>(128 * 1024, alignment);
 
-    segment(::shared_ptr<segment_manager> m, const descriptor& d, file && f, bool active)
+    segment(::shared_ptr<segment_manager> m, const descriptor& d, file && f, bool active, bool recycled = false)
             : _segment_manager(std::move(m)), _desc(std::move(d)), _file(std::move(f)),
-        _file_name(_segment_manager->cfg.commit_log_location + "/" + _desc.filename()), _sync_time(
+        _file_name(_segment_manager->cfg.commit_log_location + "/" + _desc.filename()), _recycled(recycled), _sync_time(
                     clock_type::now())
     {
+        _batch_timer.set_callback([this] {
+            // Errors are reported to the writers of the group.
+            sync().discard_result().handle_exception([] (auto ep) {});
+        });
         ++_segment_manager->totals.segments_created;
         logger.debug("Created new {} segment {}", active ? "active" : "reserve", *this);
     }
     ~segment() {
         if (is_clean()) {
-            logger.debug("Segment {} is no longer active and will be deleted now", *this);
             ++_segment_manager->totals.segments_destroyed;
             _segment_manager->totals.total_size_on_disk -= size_on_disk();
             _segment_manager->totals.total_size -= (size_on_disk() + _buffer.size());
+            if (_segment_manager->recycle_segment(_file_name)) {
+                logger.debug("Segment {} is no longer active and will be recycled", *this);
+                return;
+            }
+            logger.debug("Segment {} is no longer active and will be deleted now", *this);
             try {
                 commit_io_check(::unlink, _file_name.c_str());
             } catch (...) {
@@ -533,7 +573,34 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
         // Note: this is not a marker for when sync was finished.
         // It is when it was initiated
         reset_sync_time();
-        return cycle(true);
+        return complete_batch(cycle(true));
+    }
+    /**
+     * Entries of a pending group commit are all in the buffer being
+     * synced, or were written before it, so the group is done when
+     * the sync is.
+     */
+    future<sseg_ptr> complete_batch(future<sseg_ptr> f) {
+        if (!_batch) {
+            return f;
+        }
+        _batch_timer.cancel();
+        auto batch = std::move(_batch);
+        auto& totals = _segment_manager->totals;
+        ++totals.batch_commits;
+        totals.batch_size.mark(batch->entries);
+        return f.then_wrapped([sm = _segment_manager, batch = std::move(batch)] (future<sseg_ptr> f) {
+            auto elapsed = std::chrono::steady_clock::now() - batch->start;
+            sm->totals.batch_latency.mark(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+            if (f.failed()) {
+                auto ep = f.get_exception();
+                batch->done.set_exception(ep);
+                return make_exception_future<sseg_ptr>(ep);
+            }
+            auto me = std::get<0>(f.get());
+            batch->done.set_value(me);
+            return make_ready_future<sseg_ptr>(std::move(me));
+        });
     }
     // See class comment for info
     future<sseg_ptr> flush(uint64_t pos = 0) {
@@ -596,7 +663,7 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
             overhead += descriptor_header_size;
         }
 
-        auto a = align_up(s + overhead, alignment);
+        auto a = align_up(s + overhead, alignment) + terminator_size();
         auto k = std::max(a, default_size);
 
         for (;;) {
@@ -619,6 +686,15 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
         _segment_manager->totals.total_size += k;
     }
 
+    /**
+     * Writes to a recycled file are followed by a zeroed block, so that
+     * replay stops there instead of reading on into the previous
+     * segment's chunks. The block is overwritten by the next write.
+     */
+    size_t terminator_size() const {
+        return _recycled ? alignment : 0;
+    }
+
     bool buffer_is_empty() const {
         return _buf_pos <= segment_overhead_size
                         || (_file_pos == 0 && _buf_pos <= (segment_overhead_size + descriptor_header_size));
@@ -637,6 +713,10 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
         auto off = _file_pos;
         auto top = off + size;
         auto num = _num_allocs;
+        // A full segment has nothing after it to terminate, and the
+        // terminator must not extend the file past max_size.
+        auto room = _segment_manager->max_size - std::min<uint64_t>(_segment_manager->max_size, top);
+        auto tail = std::min<size_t>({terminator_size(), buf.size() - size, room});
 
         _file_pos = top;
         _buf_pos = 0;
@@ -674,6 +754,8 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
         out.write(uint32_t(_file_pos));
         out.write(crc.checksum());
 
+        std::fill(p + size, p + size + tail, 0);
+
         forget_schema_versions();
 
         replay_position rp(_desc.id, position_type(off));
@@ -682,40 +764,45 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
 
         // The write will be allowed to start now, but flush (below) must wait for not only this,
         // but all previous write/flush pairs.
-        return _pending_ops.run_with_ordered_post_op(rp, [this, size, off, buf = std::move(buf)]() mutable {
-            // This could "block", if we have to many pending writes.
-            return begin_write().then([this, size, off, buf = std::move(buf)]() mutable {
-                auto written = make_lw_shared<size_t>(0);
-                auto p = buf.get();
-                return repeat([this, size, off, written, p]() mutable {
-                    auto&& priority_class = service::get_local_commitlog_priority();
-                    return _file.dma_write(off + *written, p + *written, size - *written, priority_class).then_wrapped([this, size, written](future<size_t>&& f) {
-                        try {
-                            auto bytes = std::get<0>(f.get());
-                            *written += bytes;
-                            _segment_manager->totals.bytes_written += bytes;
-                            _segment_manager->totals.total_size_on_disk += bytes;
-                            ++_segment_manager->totals.cycle_count;
-                            if (*written == size) {
-                                return make_ready_future<stop_iteration>(stop_iteration::yes);
+        return _pending_ops.run_with_ordered_post_op(rp, [this, size, tail, off, buf = std::move(buf)]() mutable {
+            // The terminator overlaps the start of the next write, so writes
+            // to a recycled file are issued one at a time, in order.
+            return with_semaphore(_write_order, _recycled ? 1 : 0, [this, size, tail, off, buf = std::move(buf)]() mutable {
+                // This could "block", if we have to many pending writes.
+                return begin_write().then([this, size, tail, off, buf = std::move(buf)]() mutable {
+                    auto written = make_lw_shared<size_t>(0);
+                    auto p = buf.get();
+                    return repeat([this, size, tail, off, written, p]() mutable {
+                        auto&& priority_class = service::get_local_commitlog_priority();
+                        return _file.dma_write(off + *written, p + *written, size + tail - *written, priority_class).then_wrapped([this, size, tail, written](future<size_t>&& f) {
+                            try {
+                                auto bytes = std::get<0>(f.get());
+                                // the terminator does not count as data on disk
+                                _segment_manager->totals.total_size_on_disk += std::min(bytes, size - std::min(size, *written));
+                                *written += bytes;
+                                _segment_manager->totals.bytes_written += bytes;
+                                ++_segment_manager->totals.cycle_count;
+                                if (*written == size + tail) {
+                                    return make_ready_future<stop_iteration>(stop_iteration::yes);
+                                }
+                                // gah, partial write. should always get here with dma chunk sized
+                                // "bytes", but lets make sure...
+                                logger.debug("Partial write {}: {}/{} bytes", *this, *written, size + tail);
+                                *written = align_down(*written, alignment);
+                                return make_ready_future<stop_iteration>(stop_iteration::no);
+                                // TODO: retry/ignore/fail/stop - optional behaviour in origin.
+                                // we fast-fail the whole commit.
+                            } catch (...) {
+                                logger.error("Failed to persist commits to disk for {}: {}", *this, std::current_exception());
+                                throw;
                             }
-                            // gah, partial write. should always get here with dma chunk sized
-                            // "bytes", but lets make sure...
-                            logger.debug("Partial write {}: {}/{} bytes", *this, *written, size);
-                            *written = align_down(*written, alignment);
-                            return make_ready_future<stop_iteration>(stop_iteration::no);
-                            // TODO: retry/ignore/fail/stop - optional behaviour in origin.
-                            // we fast-fail the whole commit.
-                        } catch (...) {
-                            logger.error("Failed to persist commits to disk for {}: {}", *this, std::current_exception());
-                            throw;
-                        }
+                        });
+                    }).finally([this, buf = std::move(buf)]() mutable {
+                        _segment_manager->release_buffer(std::move(buf));
                     });
-                }).finally([this, buf = std::move(buf)]() mutable {
-                    _segment_manager->release_buffer(std::move(buf));
+                }).finally([this]() {
+                    end_write(); // release
                 });
-            }).finally([this]() {
-                end_write(); // release
             });
         }, [me, flush_after, top] { // lambda instead of bind, so we keep "me" alive.
             return flush_after ? me->do_flush(top) : make_ready_future<sseg_ptr>(me);
@@ -787,6 +874,28 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
             return me->sync();
         });
     }
+    /**
+     * Batch mode with a group commit window: the entry joins the pending
+     * group, which is synced when the window expires or when it grows
+     * past the byte threshold, whichever comes first.
+     */
+    future<sseg_ptr> group_commit(size_t size) {
+        auto& cfg = _segment_manager->cfg;
+        if (cfg.commitlog_sync_batch_window_in_us == 0) {
+            return batch_cycle();
+        }
+        if (!_batch) {
+            _batch = std::make_unique<pending_batch>();
+            _batch_timer.arm(std::chrono::microseconds(cfg.commitlog_sync_batch_window_in_us));
+        }
+        ++_batch->entries;
+        _batch->bytes += size;
+        auto f = _batch->done.get_shared_future();
+        if (_batch->bytes >= cfg.commitlog_sync_batch_max_bytes) {
+            sync().discard_result().handle_exception([] (auto ep) {});
+        }
+        return f;
+    }
     /**
      * Add a "mutation" to the segment.
      */
@@ -812,7 +921,7 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
             op = finish_and_get_new();
         } else if (_buffer.empty()) {
             new_buffer(s);
-        } else if (s > (_buffer.size() - _buf_pos)) { // enough data?
+        } else if (s > (_buffer.size() - terminator_size() - _buf_pos)) { // enough data?
             _needed_size += s; // hint to next new_buffer, in case we are not first.
             if (_segment_manager->cfg.mode == sync_mode::BATCH) {
                 // TODO: this could cause starvation if we're really unlucky.
@@ -862,7 +971,7 @@ class db::commitlog::segment: public enable_lw_shared_from_this<segment> {
         _gate.leave();
 
         if (_segment_manager->cfg.mode == sync_mode::BATCH) {
-            return batch_cycle().then([rp](auto s) {
+            return group_commit(s).then([rp](auto s) {
                 return make_ready_future<replay_position>(rp);
             });
         }
@@ -1009,13 +1118,17 @@ scollectd::registrations db::commitlog::segment_manager::create_counters() {
     using scollectd::per_cpu_plugin_instance;
     using scollectd::data_type;
 
+    if (cfg.metrics_category_name.empty()) {
+        return {};
+    }
+
     return {
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "queue_length", "segments")
                 , make_typed(data_type::GAUGE
                         , std::bind(&decltype(_segments)::size, &_segments))
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "queue_length", "allocating_segments")
                 , make_typed(data_type::GAUGE
                         , [this]() {
@@ -1024,7 +1137,7 @@ scollectd::registrations db::commitlog::segment_manager::create_counters() {
                                     });
                         })
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "queue_length", "unused_segments")
                 , make_typed(data_type::GAUGE
                         , [this]() {
@@ -1033,54 +1146,84 @@ scollectd::registrations db::commitlog::segment_manager::create_counters() {
                                     });
                         })
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
+                        , per_cpu_plugin_instance, "queue_length", "recycled_segments")
+                , make_typed(data_type::GAUGE
+                        , std::bind(&decltype(_recycled_segments)::size, &_recycled_segments))
+        ),
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
+                        , per_cpu_plugin_instance, "total_operations", "segments_recycled")
+                , make_typed(data_type::DERIVE, totals.segments_recycled)
+        ),
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "total_operations", "alloc")
                 , make_typed(data_type::DERIVE, totals.allocation_count)
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "total_operations", "cycle")
                 , make_typed(data_type::DERIVE, totals.cycle_count)
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "total_operations", "flush")
                 , make_typed(data_type::DERIVE, totals.flush_count)
         ),
 
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "total_bytes", "written")
                 , make_typed(data_type::DERIVE, totals.bytes_written)
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "total_bytes", "slack")
                 , make_typed(data_type::DERIVE, totals.bytes_slack)
         ),
 
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "queue_length", "pending_writes")
                 , make_typed(data_type::GAUGE, totals.pending_writes)
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "queue_length", "pending_flushes")
                 , make_typed(data_type::GAUGE, totals.pending_flushes)
         ),
 
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "total_operations", "write_limit_exceeded")
                 , make_typed(data_type::DERIVE, totals.write_limit_exceeded)
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "total_operations", "flush_limit_exceeded")
                 , make_typed(data_type::DERIVE, totals.flush_limit_exceeded)
         ),
 
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "memory", "total_size")
                 , make_typed(data_type::GAUGE, totals.total_size)
         ),
-        add_polled_metric(type_instance_id("commitlog"
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
                         , per_cpu_plugin_instance, "memory", "buffer_list_bytes")
                 , make_typed(data_type::GAUGE, totals.buffer_list_bytes)
         ),
+
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
+                        , per_cpu_plugin_instance, "total_operations", "batch_commits")
+                , make_typed(data_type::DERIVE, totals.batch_commits)
+        ),
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
+                        , per_cpu_plugin_instance, "batch_size", "mean")
+                , make_typed(data_type::GAUGE, [this] { return totals.batch_size.mean; })
+        ),
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
+                        , per_cpu_plugin_instance, "batch_size", "max")
+                , make_typed(data_type::GAUGE, [this] { return totals.batch_size.max; })
+        ),
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
+                        , per_cpu_plugin_instance, "latency", "batch_commit_mean_us")
+                , make_typed(data_type::GAUGE, [this] { return totals.batch_latency.mean; })
+        ),
+        add_polled_metric(type_instance_id(cfg.metrics_category_name
+                        , per_cpu_plugin_instance, "latency", "batch_commit_max_us")
+                , make_typed(data_type::GAUGE, [this] { return totals.batch_latency.max; })
+        ),
     };
 }
 
@@ -1127,6 +1270,21 @@ future<db::commitlog::segment_manager::sseg_ptr> db::commitlog::segment_manager:
     descriptor d(next_id());
     file_open_options opt;
     opt.extent_allocation_size_hint = max_size;
+    if (!_recycled_segments.empty()) {
+        // The file is already allocated and extended, so it is just
+        // renamed to the new id and overwritten.
+        auto old_name = std::move(_recycled_segments.front());
+        _recycled_segments.pop_front();
+        auto name = cfg.commit_log_location + "/" + d.filename();
+        return commit_io_check(rename_file, old_name, name).then([this, name, opt] {
+            return open_checked_file_dma(commit_error, name, open_flags::wo, opt);
+        }).then([this, d, active](file f) {
+            ++totals.segments_recycled;
+            auto s = make_lw_shared<segment>(this->shared_from_this(), d, std::move(f), active, true);
+            logger.debug("Recycled segment file for {}", *s);
+            return make_ready_future<sseg_ptr>(s);
+        });
+    }
     return open_checked_file_dma(commit_error, cfg.commit_log_location + "/" + d.filename(), open_flags::wo | open_flags::create, opt).then([this, d, active](file f) {
         // xfs doesn't like files extended betond eof, so enlarge the file
         return f.truncate(max_size).then([this, d, active, f] () mutable {
@@ -1136,6 +1294,14 @@ future<db::commitlog::segment_manager::sseg_ptr> db::commitlog::segment_manager:
     });
 }
 
+bool db::commitlog::segment_manager::recycle_segment(const sstring& file_name) {
+    if (!cfg.reuse_segments || _shutdown || _recycled_segments.size() >= cfg.max_reserve_segments) {
+        return false;
+    }
+    _recycled_segments.push_back(file_name);
+    return true;
+}
+
 future<db::commitlog::segment_manager::sseg_ptr> db::commitlog::segment_manager::new_segment() {
     if (_shutdown) {
         throw std::runtime_error("Commitlog has been shut down. Cannot add data");
@@ -1241,7 +1407,13 @@ future<> db::commitlog::segment_manager::shutdown() {
         _timer.cancel(); // no more timer calls
         // Now first wait for periodic task to finish, then sync and close all
         // segments, flushing out any remaining data.
-        return _gate.close().then(std::bind(&segment_manager::sync_all_segments, this, true));
+        return _gate.close().then(std::bind(&segment_manager::sync_all_segments, this, true)).then([this] {
+            // Not needed anymore, and replay would only skip them.
+            auto files = std::exchange(_recycled_segments, {});
+            return parallel_for_each(files, [] (const sstring& f) {
+                return commit_io_check(remove_file, f);
+            });
+        });
     }
     return make_ready_future<>();
 }
@@ -1531,22 +1703,24 @@ const db::commitlog::config& db::commitlog::active_config() const {
 // on error at startup if required
 future<std::unique_ptr<subscription<temporary_buffer<char>, db::replay_position>>>
 db::commitlog::read_log_file(const sstring& filename, commit_load_reader_func next, position_type off) {
-    return open_checked_file_dma(commit_error, filename, open_flags::ro).then([next = std::move(next), off](file f) {
+    auto id = descriptor(filename).id;
+    return open_checked_file_dma(commit_error, filename, open_flags::ro).then([next = std::move(next), off, id](file f) {
        return std::make_unique<subscription<temporary_buffer<char>, replay_position>>(
-           read_log_file(std::move(f), std::move(next), off));
+           read_log_file(std::move(f), std::move(next), off, id));
     });
 }
 
 // No commit_io_check needed in the log reader since the database will fail
 // on error at startup if required
 subscription<temporary_buffer<char>, db::replay_position>
-db::commitlog::read_log_file(file f, commit_load_reader_func next, position_type off) {
+db::commitlog::read_log_file(file f, commit_load_reader_func next, position_type off, segment_id_type expected_id) {
     struct work {
         file f;
         stream<temporary_buffer<char>, replay_position> s;
         input_stream<char> fin;
         input_stream<char> r;
         uint64_t id = 0;
+        uint64_t expected_id = 0;
         size_t pos = 0;
         size_t next = 0;
         size_t start_off = 0;
@@ -1556,8 +1730,17 @@ db::commitlog::read_log_file(file f, commit_load_reader_func next, position_type
         bool eof = false;
         bool header = true;
 
-        work(file f, position_type o = 0)
-                : f(f), fin(make_file_input_stream(f)), start_off(o) {
+        work(file f, position_type o = 0, segment_id_type eid = 0)
+                : f(f), fin(make_file_input_stream(f, stream_options())), expected_id(eid), start_off(o) {
+        }
+        // Segments are read sequentially, so keep a few buffers in
+        // flight ahead of the parser.
+        static file_input_stream_options stream_options() {
+            file_input_stream_options options;
+            options.buffer_size = 128 * 1024;
+            options.read_ahead = 4;
+            options.io_priority_class = service::get_local_commitlog_priority();
+            return options;
         }
         work(work&&) = default;
 
@@ -1620,6 +1803,13 @@ db::commitlog::read_log_file(file f, commit_load_reader_func next, position_type
                     throw std::runtime_error("Checksum error in file header");
                 }
 
+                if (expected_id != 0 && id != expected_id) {
+                    // a recycled segment which was renamed, but never
+                    // written to. Its contents belong to the old segment.
+                    logger.debug("Segment header id {} does not match expected {}. Skipping stale file.", id, expected_id);
+                    return stop();
+                }
+
                 this->id = id;
                 this->next = 0;
 
@@ -1744,7 +1934,7 @@ db::commitlog::read_log_file(file f, commit_load_reader_func next, position_type
         }
     };
 
-    auto w = make_lw_shared<work>(std::move(f), off);
+    auto w = make_lw_shared<work>(std::move(f), off, expected_id);
     auto ret = w->s.listen(std::move(next));
 
     w->s.started().then(std::bind(&work::read_file, w.get())).then([w] {
@@ -1797,6 +1987,14 @@ uint64_t db::commitlog::get_flush_limit_exceeded_count() const {
     return _segment_manager->totals.flush_limit_exceeded;
 }
 
+uint64_t db::commitlog::get_num_segments_recycled() const {
+    return _segment_manager->totals.segments_recycled;
+}
+
+uint64_t db::commitlog::get_batch_commit_count() const {
+    return _segment_manager->totals.batch_commits;
+}
+
 uint64_t db::commitlog::get_num_segments_created() const {
     return _segment_manager->totals.segments_created;
 }
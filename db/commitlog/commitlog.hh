@@ -112,13 +112,28 @@ class commitlog {
         uint64_t commitlog_total_space_in_mb = 0;
         uint64_t commitlog_segment_size_in_mb = 32;
         uint64_t commitlog_sync_period_in_ms = 10 * 1000; //TODO: verify default!
+        // Batch mode group commit: writes arriving within this many
+        // microseconds of each other share one write and one flush.
+        // Zero syncs every write on its own.
+        uint64_t commitlog_sync_batch_window_in_us = 0;
+        // A pending group is committed before its window expires once
+        // it holds this many bytes.
+        uint64_t commitlog_sync_batch_max_bytes = 1024 * 1024;
         // Max number of segments to keep in pre-alloc reserve.
         // Not (yet) configurable from scylla.conf.
         uint64_t max_reserve_segments = 12;
+        // Segments no longer needed are renamed and overwritten in place
+        // by a later segment instead of being deleted. At most
+        // max_reserve_segments of them are kept.
+        bool reuse_segments = true;
         // Max active writes/flushes. Default value
         // zero means try to figure it out ourselves
         uint64_t max_active_writes = 0;
         uint64_t max_active_flushes = 0;
+        // Collectd plugin name of the log's counters. Logs created in
+        // numbers (e.g. one per hinted endpoint) leave it empty and
+        // register no counters at all.
+        sstring metrics_category_name = "commitlog";
 
         sync_mode mode = sync_mode::PERIODIC;
     };
@@ -250,8 +265,13 @@ class commitlog {
     uint64_t get_pending_allocations() const;
     uint64_t get_write_limit_exceeded_count() const;
     uint64_t get_flush_limit_exceeded_count() const;
+    /**
+     * Get number of batch mode group commits
+     */
+    uint64_t get_batch_commit_count() const;
     uint64_t get_num_segments_created() const;
     uint64_t get_num_segments_destroyed() const;
+    uint64_t get_num_segments_recycled() const;
     /**
      * Get number of inactive (finished), segments lingering
      * due to still being dirty
@@ -313,7 +333,9 @@ class commitlog {
         uint64_t _bytes;
     };
 
-    static subscription<temporary_buffer<char>, replay_position> read_log_file(file, commit_load_reader_func, position_type = 0);
+    // When id is non-zero, a file whose header carries a different segment
+    // id is a recycled segment not yet written to, and yields no entries.
+    static subscription<temporary_buffer<char>, replay_position> read_log_file(file, commit_load_reader_func, position_type = 0, segment_id_type id = 0);
     static future<std::unique_ptr<subscription<temporary_buffer<char>, replay_position>>> read_log_file(
             const sstring&, commit_load_reader_func, position_type = 0);
 private:
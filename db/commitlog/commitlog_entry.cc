@@ -33,21 +33,26 @@
 #include "idl/mutation.dist.impl.hh"
 #include "idl/commitlog.dist.impl.hh"
 
-commitlog_entry::commitlog_entry(stdx::optional<column_mapping> mapping, frozen_mutation&& mutation)
+commitlog_entry::commitlog_entry(stdx::optional<column_mapping> mapping, frozen_mutation&& mutation,
+        stdx::optional<gc_clock::time_point> written_at)
     : _mapping(std::move(mapping))
       , _mutation_storage(std::move(mutation))
       , _mutation(*_mutation_storage)
+      , _written_at(written_at)
 { }
 
-commitlog_entry::commitlog_entry(stdx::optional<column_mapping> mapping, const frozen_mutation& mutation)
+commitlog_entry::commitlog_entry(stdx::optional<column_mapping> mapping, const frozen_mutation& mutation,
+        stdx::optional<gc_clock::time_point> written_at)
     : _mapping(std::move(mapping))
       , _mutation(mutation)
+      , _written_at(written_at)
 { }
 
 commitlog_entry::commitlog_entry(commitlog_entry&& ce)
     : _mapping(std::move(ce._mapping))
     , _mutation_storage(std::move(ce._mutation_storage))
     , _mutation(_mutation_storage ? *_mutation_storage : ce._mutation)
+    , _written_at(ce._written_at)
 {
 }
 
@@ -62,9 +67,9 @@ commitlog_entry& commitlog_entry::operator=(commitlog_entry&& ce)
 
 commitlog_entry commitlog_entry_writer::get_entry() const {
     if (_with_schema) {
-        return commitlog_entry(_schema->get_column_mapping(), _mutation);
+        return commitlog_entry(_schema->get_column_mapping(), _mutation, _written_at);
     } else {
-        return commitlog_entry({}, _mutation);
+        return commitlog_entry({}, _mutation, _written_at);
     }
 }
 
@@ -33,28 +33,35 @@ class commitlog_entry {
     stdx::optional<column_mapping> _mapping;
     stdx::optional<frozen_mutation> _mutation_storage;
     const frozen_mutation& _mutation;
+    stdx::optional<gc_clock::time_point> _written_at;
 public:
-    commitlog_entry(stdx::optional<column_mapping> mapping, frozen_mutation&& mutation);
-    commitlog_entry(stdx::optional<column_mapping> mapping, const frozen_mutation& mutation);
+    commitlog_entry(stdx::optional<column_mapping> mapping, frozen_mutation&& mutation,
+            stdx::optional<gc_clock::time_point> written_at = {});
+    commitlog_entry(stdx::optional<column_mapping> mapping, const frozen_mutation& mutation,
+            stdx::optional<gc_clock::time_point> written_at = {});
     commitlog_entry(commitlog_entry&&);
     commitlog_entry(const commitlog_entry&) = delete;
     commitlog_entry& operator=(commitlog_entry&&);
     commitlog_entry& operator=(const commitlog_entry&) = delete;
     const stdx::optional<column_mapping>& mapping() const { return _mapping; }
     const frozen_mutation& mutation() const { return _mutation; }
+    const stdx::optional<gc_clock::time_point>& written_at() const { return _written_at; }
 };
 
 class commitlog_entry_writer {
     schema_ptr _schema;
     const frozen_mutation& _mutation;
+    stdx::optional<gc_clock::time_point> _written_at;
     bool _with_schema = true;
     size_t _size;
 private:
     void compute_size();
     commitlog_entry get_entry() const;
 public:
-    commitlog_entry_writer(schema_ptr s, const frozen_mutation& fm)
-        : _schema(std::move(s)), _mutation(fm)
+    // written_at is recorded only when given, so ordinary commitlog
+    // entries don't pay for it.
+    commitlog_entry_writer(schema_ptr s, const frozen_mutation& fm, stdx::optional<gc_clock::time_point> written_at = {})
+        : _schema(std::move(s)), _mutation(fm), _written_at(written_at)
     {
         compute_size();
     }
@@ -84,4 +91,5 @@ class commitlog_entry_reader {
 
     const stdx::optional<column_mapping>& get_column_mapping() const { return _ce.mapping(); }
     const frozen_mutation& mutation() const { return _ce.mutation(); }
+    const stdx::optional<gc_clock::time_point>& written_at() const { return _ce.written_at(); }
 };
\ No newline at end of file
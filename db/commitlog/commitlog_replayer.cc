@@ -45,8 +45,15 @@
 #include <unordered_map>
 #include <boost/range/adaptor/map.hpp>
 
+#include <boost/range/irange.hpp>
+
 #include <core/future.hh>
+#include <core/future-util.hh>
+#include <core/reactor.hh>
 #include <core/sharded.hh>
+#include <core/gate.hh>
+#include <core/semaphore.hh>
+#include <core/scollectd.hh>
 
 #include "commitlog.hh"
 #include "commitlog_replayer.hh"
@@ -62,7 +69,6 @@
 static logging::logger logger("commitlog_replayer");
 
 class db::commitlog_replayer::impl {
-    std::unordered_map<table_schema_version, column_mapping> _column_mappings;
 public:
     impl(seastar::sharded<cql3::query_processor>& db);
 
@@ -88,8 +94,47 @@ class db::commitlog_replayer::impl {
         }
     };
 
-    future<> process(stats*, temporary_buffer<char> buf, replay_position rp);
-    future<stats> recover(sstring file);
+    // Replay is spread over all shards. Each shard reads and decodes a
+    // share of the segments and sends the mutations to their owning
+    // shards in batches. The state below is only read once init() is
+    // done, so it is shared by all shards.
+    struct replay_entry {
+        commitlog_entry_reader cer;
+        const column_mapping* cm;
+        replay_position rp;
+    };
+    using replay_batch = std::vector<replay_entry>;
+
+    // Bytes of mutations sent to a shard at a time, and the most a
+    // reading shard keeps in flight.
+    static constexpr size_t batch_size = 128 * 1024;
+    static constexpr size_t max_bytes_in_flight = 8 * 1024 * 1024;
+
+    // State of the segment being read on a shard.
+    struct segment_state {
+        stats s;
+        std::unordered_map<table_schema_version, column_mapping> column_mappings;
+        std::vector<replay_batch> batches;
+        std::vector<size_t> batch_bytes;
+        semaphore memory{max_bytes_in_flight};
+        seastar::gate in_flight;
+
+        segment_state() : batches(smp::count), batch_bytes(smp::count) {}
+    };
+
+    // Progress of the replay on a shard, exported to collectd.
+    struct progress {
+        uint64_t total_bytes = 0;
+        uint64_t replayed_bytes = 0;
+        uint64_t segment_pos = 0;
+        scollectd::registrations regs;
+    };
+
+    future<> process(segment_state&, progress&, temporary_buffer<char> buf, replay_position rp);
+    future<> send_batch(segment_state&, unsigned shard);
+    static future<stats> apply_batch(database& db, replay_batch& batch);
+    future<stats> recover(sstring file, progress&);
+    future<stats> recover_on_this_shard(std::vector<sstring> files);
 
     typedef std::unordered_map<utils::UUID, replay_position> rp_map;
     typedef std::unordered_map<unsigned, rp_map> shard_rpm_map;
@@ -182,9 +227,10 @@ future<> db::commitlog_replayer::impl::init() {
 }
 
 future<db::commitlog_replayer::impl::stats>
-db::commitlog_replayer::impl::recover(sstring file) {
+db::commitlog_replayer::impl::recover(sstring file, progress& pr) {
     replay_position rp{commitlog::descriptor(file)};
-    auto gp = _min_pos[rp.shard_id()];
+    auto mi = _min_pos.find(rp.shard_id());
+    auto gp = mi != _min_pos.end() ? mi->second : replay_position();
 
     if (rp.id < gp.id) {
         logger.debug("skipping replay of fully-flushed {}", file);
@@ -195,93 +241,140 @@ db::commitlog_replayer::impl::recover(sstring file) {
         p = gp.pos;
     }
 
-    auto s = make_lw_shared<stats>();
+    auto st = make_lw_shared<segment_state>();
+    pr.segment_pos = 0;
 
     return db::commitlog::read_log_file(file,
-            std::bind(&impl::process, this, s.get(), std::placeholders::_1,
+            std::bind(&impl::process, this, std::ref(*st), std::ref(pr), std::placeholders::_1,
                     std::placeholders::_2), p).then([](auto s) {
         auto f = s->done();
         return f.finally([s = std::move(s)] {});
-    }).then_wrapped([s](future<> f) {
+    }).then_wrapped([this, st](future<> f) {
+        // Send what is left, and wait for everything sent to be applied,
+        // even if reading failed half way.
+        return parallel_for_each(boost::irange(0u, smp::count), [this, st] (unsigned shard) {
+            return st->batches[shard].empty() ? make_ready_future<>() : send_batch(*st, shard);
+        }).then([st] {
+            return st->in_flight.close();
+        }).then([f = std::move(f)] () mutable {
+            return std::move(f);
+        });
+    }).then_wrapped([st](future<> f) {
         try {
             f.get();
         } catch (commitlog::segment_data_corruption_error& e) {
-            s->corrupt_bytes += e.bytes();
+            st->s.corrupt_bytes += e.bytes();
         } catch (...) {
             throw;
         }
-        return make_ready_future<stats>(*s);
+        return make_ready_future<stats>(st->s);
     });
 }
 
-future<> db::commitlog_replayer::impl::process(stats* s, temporary_buffer<char> buf, replay_position rp) {
+future<db::commitlog_replayer::impl::stats>
+db::commitlog_replayer::impl::recover_on_this_shard(std::vector<sstring> files) {
+    using namespace scollectd;
+
+    auto pr = make_lw_shared<progress>();
+    pr->regs = {
+        add_polled_metric(type_instance_id("commitlog_replay"
+                , per_cpu_plugin_instance, "bytes", "total")
+                , make_typed(data_type::GAUGE, pr->total_bytes)
+        ),
+        add_polled_metric(type_instance_id("commitlog_replay"
+                , per_cpu_plugin_instance, "bytes", "replayed")
+                , make_typed(data_type::GAUGE, [pr = pr.get()] { return pr->replayed_bytes + pr->segment_pos; })
+        ),
+    };
+    return do_with(std::move(files), stats(), [this, pr] (std::vector<sstring>& files, stats& totals) {
+        return parallel_for_each(files, [pr] (const sstring& f) {
+            return file_size(f).then([pr] (uint64_t size) {
+                pr->total_bytes += size;
+            });
+        }).then([this, pr, &files, &totals] {
+            // One segment at a time; read-ahead and the batches in flight
+            // keep the disk and the other shards busy.
+            return do_for_each(files, [this, pr, &totals] (sstring f) {
+                logger.debug("Replaying {}", f);
+                return recover(f, *pr).then([f, pr, &totals](stats stats) {
+                    if (stats.corrupt_bytes != 0) {
+                        logger.warn("Corrupted file: {}. {} bytes skipped.", f, stats.corrupt_bytes);
+                    }
+                    logger.debug("Log replay of {} complete, {} replayed mutations ({} invalid, {} skipped)"
+                                    , f
+                                    , stats.applied_mutations
+                                    , stats.invalid_mutations
+                                    , stats.skipped_mutations
+                    );
+                    totals += stats;
+                    return file_size(f).then([f, pr] (uint64_t size) {
+                        pr->replayed_bytes += size;
+                        pr->segment_pos = 0;
+                        logger.info("Replayed {} ({} of {} MB on this shard)", f,
+                                pr->replayed_bytes >> 20, pr->total_bytes >> 20);
+                    });
+                }).handle_exception([f](auto ep) {
+                    logger.error("Error recovering {}: {}", f, ep);
+                    try {
+                        std::rethrow_exception(ep);
+                    } catch (std::invalid_argument&) {
+                        logger.error("Scylla cannot process {}. Make sure to fully flush all Cassandra commit log files to sstable before migrating.", f);
+                        throw;
+                    } catch (...) {
+                        throw;
+                    }
+                });
+            });
+        }).then([&totals] {
+            return totals;
+        });
+    }).finally([pr] {});
+}
+
+future<> db::commitlog_replayer::impl::process(segment_state& st, progress& pr, temporary_buffer<char> buf, replay_position rp) {
+    pr.segment_pos = rp.pos;
     try {
 
         commitlog_entry_reader cer(buf);
         auto& fm = cer.mutation();
 
-        auto cm_it = _column_mappings.find(fm.schema_version());
-        if (cm_it == _column_mappings.end()) {
+        auto cm_it = st.column_mappings.find(fm.schema_version());
+        if (cm_it == st.column_mappings.end()) {
             if (!cer.get_column_mapping()) {
                 throw std::runtime_error(sprint("unknown schema version {}", fm.schema_version()));
             }
             logger.debug("new schema version {} in entry {}", fm.schema_version(), rp);
-            cm_it = _column_mappings.emplace(fm.schema_version(), *cer.get_column_mapping()).first;
+            cm_it = st.column_mappings.emplace(fm.schema_version(), *cer.get_column_mapping()).first;
         }
 
         auto shard_id = rp.shard_id();
-        if (rp < _min_pos[shard_id]) {
+        auto mi = _min_pos.find(shard_id);
+        if (mi != _min_pos.end() && rp < mi->second) {
             logger.trace("entry {} is less than global min position. skipping", rp);
-            s->skipped_mutations++;
+            st.s.skipped_mutations++;
             return make_ready_future<>();
         }
 
         auto uuid = fm.column_family_id();
-        auto& map = _rpm[shard_id];
-        auto i = map.find(uuid);
-        if (i != map.end() && rp <= i->second) {
-            logger.trace("entry {} at {} is younger than recorded replay position {}. skipping", fm.column_family_id(), rp, i->second);
-            s->skipped_mutations++;
-            return make_ready_future<>();
+        auto ri = _rpm.find(shard_id);
+        if (ri != _rpm.end()) {
+            auto i = ri->second.find(uuid);
+            if (i != ri->second.end() && rp <= i->second) {
+                logger.trace("entry {} at {} is younger than recorded replay position {}. skipping", fm.column_family_id(), rp, i->second);
+                st.s.skipped_mutations++;
+                return make_ready_future<>();
+            }
         }
 
         auto shard = _qp.local().db().local().shard_of(fm);
-        return _qp.local().db().invoke_on(shard, [this, cer = std::move(cer), cm_it, rp, shard, s] (database& db) -> future<> {
-            auto& fm = cer.mutation();
-            // TODO: might need better verification that the deserialized mutation
-            // is schema compatible. My guess is that just applying the mutation
-            // will not do this.
-            auto& cf = db.find_column_family(fm.column_family_id());
-
-            if (logger.is_enabled(logging::log_level::debug)) {
-                logger.debug("replaying at {} v={} {}:{} at {}", fm.column_family_id(), fm.schema_version(),
-                        cf.schema()->ks_name(), cf.schema()->cf_name(), rp);
-            }
-            // Removed forwarding "new" RP. Instead give none/empty.
-            // This is what origin does, and it should be fine.
-            // The end result should be that once sstables are flushed out
-            // their "replay_position" attribute will be empty, which is
-            // lower than anything the new session will produce.
-            if (cf.schema()->version() != fm.schema_version()) {
-                const column_mapping& cm = cm_it->second;
-                mutation m(fm.decorated_key(*cf.schema()), cf.schema());
-                converting_mutation_partition_applier v(cm, *cf.schema(), m.partition());
-                fm.partition().accept(cm, v);
-                cf.apply(std::move(m));
-            } else {
-                cf.apply(fm, cf.schema());
-            }
-            s->applied_mutations++;
-            return make_ready_future<>();
-        }).handle_exception([s](auto ep) {
-            s->invalid_mutations++;
-            // TODO: write mutation to file like origin.
-            logger.warn("error replaying: {}", ep);
-        });
-    } catch (no_such_column_family&) {
-        // No such CF now? Origin just ignores this.
+        auto size = fm.representation().size();
+        st.batches[shard].push_back(replay_entry{std::move(cer), &cm_it->second, rp});
+        st.batch_bytes[shard] += size;
+        if (st.batch_bytes[shard] >= batch_size) {
+            return send_batch(st, shard);
+        }
     } catch (...) {
-        s->invalid_mutations++;
+        st.s.invalid_mutations++;
         // TODO: write mutation to file like origin.
         logger.warn("error replaying: {}", std::current_exception());
     }
@@ -289,6 +382,76 @@ future<> db::commitlog_replayer::impl::process(stats* s, temporary_buffer<char>
     return make_ready_future<>();
 }
 
+// Waits only until the batch fits in the memory allowed in flight, so that
+// reading goes on while earlier batches are applied.
+future<> db::commitlog_replayer::impl::send_batch(segment_state& st, unsigned shard) {
+    auto bytes = std::min(std::exchange(st.batch_bytes[shard], 0), size_t(max_bytes_in_flight));
+    auto batch = std::exchange(st.batches[shard], replay_batch());
+    return st.memory.wait(bytes).then([this, &st, shard, bytes, batch = std::move(batch)] () mutable {
+        // Not waited for here; the end of the segment waits for the gate.
+        seastar::with_gate(st.in_flight, [this, &st, shard, batch = std::move(batch)] () mutable {
+            return _qp.local().db().invoke_on(shard, [batch = std::move(batch)] (database& db) mutable {
+                return do_with(std::move(batch), [&db] (replay_batch& batch) {
+                    return apply_batch(db, batch);
+                });
+            }).then([&st] (stats s) {
+                st.s += s;
+            });
+        }).finally([&st, bytes] {
+            st.memory.signal(bytes);
+        }).handle_exception([] (auto ep) {
+            logger.warn("error replaying: {}", ep);
+        });
+    });
+}
+
+future<db::commitlog_replayer::impl::stats> db::commitlog_replayer::impl::apply_batch(database& db, replay_batch& batch) {
+    return do_with(stats(), [&db, &batch] (stats& s) {
+        return do_for_each(batch, [&db, &s] (const replay_entry& e) {
+            auto& fm = e.cer.mutation();
+            return futurize_apply([&db, &fm, &e] {
+                // TODO: might need better verification that the deserialized mutation
+                // is schema compatible. My guess is that just applying the mutation
+                // will not do this.
+                auto& cf = db.find_column_family(fm.column_family_id());
+
+                if (logger.is_enabled(logging::log_level::debug)) {
+                    logger.debug("replaying at {} v={} {}:{} at {}", fm.column_family_id(), fm.schema_version(),
+                            cf.schema()->ks_name(), cf.schema()->cf_name(), e.rp);
+                }
+                // Removed forwarding "new" RP. Instead give none/empty.
+                // This is what origin does, and it should be fine.
+                // The end result should be that once sstables are flushed out
+                // their "replay_position" attribute will be empty, which is
+                // lower than anything the new session will produce.
+                if (cf.schema()->version() != fm.schema_version()) {
+                    mutation m(fm.decorated_key(*cf.schema()), cf.schema());
+                    converting_mutation_partition_applier v(*e.cm, *cf.schema(), m.partition());
+                    fm.partition().accept(*e.cm, v);
+                    return do_with(freeze(m), [&db, s = cf.schema()] (const frozen_mutation& converted) {
+                        return db.apply_replayed(converted, s);
+                    });
+                }
+                return db.apply_replayed(fm, cf.schema());
+            }).then([&s] {
+                s.applied_mutations++;
+            }).handle_exception([&s] (auto ep) {
+                try {
+                    std::rethrow_exception(ep);
+                } catch (no_such_column_family&) {
+                    // No such CF now? Origin just ignores this.
+                } catch (...) {
+                    s.invalid_mutations++;
+                    // TODO: write mutation to file like origin.
+                    logger.warn("error replaying: {}", ep);
+                }
+            });
+        }).then([&s] {
+            return s;
+        });
+    });
+}
+
 db::commitlog_replayer::commitlog_replayer(seastar::sharded<cql3::query_processor>& qp)
     : _impl(std::make_unique<impl>(qp))
 {}
@@ -311,31 +474,17 @@ future<db::commitlog_replayer> db::commitlog_replayer::create_replayer(seastar::
 
 future<> db::commitlog_replayer::recover(std::vector<sstring> files) {
     logger.info("Replaying {}", join(", ", files));
-    return map_reduce(files, [this](auto f) {
-        logger.debug("Replaying {}", f);
-        return _impl->recover(f).then([f](impl::stats stats) {
-            if (stats.corrupt_bytes != 0) {
-                logger.warn("Corrupted file: {}. {} bytes skipped.", f, stats.corrupt_bytes);
-            }
-            logger.debug("Log replay of {} complete, {} replayed mutations ({} invalid, {} skipped)"
-                            , f
-                            , stats.applied_mutations
-                            , stats.invalid_mutations
-                            , stats.skipped_mutations
-            );
-            return make_ready_future<impl::stats>(stats);
-        }).handle_exception([f](auto ep) -> future<impl::stats> {
-            logger.error("Error recovering {}: {}", f, ep);
-            try {
-                std::rethrow_exception(ep);
-            } catch (std::invalid_argument&) {
-                logger.error("Scylla cannot process {}. Make sure to fully flush all Cassandra commit log files to sstable before migrating.", f);
-                throw;
-            } catch (...) {
-                throw;
+    return do_with(std::move(files), [this] (std::vector<sstring>& files) {
+        return map_reduce(boost::irange(0u, smp::count), [this, &files] (unsigned shard) {
+            std::vector<sstring> mine;
+            for (auto i = shard; i < files.size(); i += smp::count) {
+                mine.push_back(files[i]);
             }
-        });
-    }, impl::stats(), std::plus<impl::stats>()).then([](impl::stats totals) {
+            return smp::submit_to(shard, [this, mine = std::move(mine)] () mutable {
+                return _impl->recover_on_this_shard(std::move(mine));
+            });
+        }, impl::stats(), std::plus<impl::stats>());
+    }).then([](impl::stats totals) {
         logger.info("Log replay complete, {} replayed mutations ({} invalid, {} skipped)"
                         , totals.applied_mutations
                         , totals.invalid_mutations
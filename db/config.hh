@@ -290,7 +290,7 @@ class config {
             "The method that Cassandra uses to acknowledge writes in milliseconds:\n"   \
             "\n"    \
             "\tperiodic : Used with commitlog_sync_period_in_ms (Default: 10000 - 10 seconds ) to control how often the commit log is synchronized to disk. Periodic syncs are acknowledged immediately.\n"   \
-            "\tbatch : Used with commitlog_sync_batch_window_in_ms (Default: disabled **) to control how long Cassandra waits for other writes before performing a sync. When using this method, writes are not acknowledged until fsynced to disk.\n"  \
+            "\tbatch : Used with commitlog_sync_batch_window_in_us (Default: 500) and commitlog_sync_batch_max_bytes to control how long Cassandra waits for other writes before performing a sync. When using this method, writes are not acknowledged until fsynced to disk.\n"  \
             "Related information: Durability"   \
     )                                                   \
     val(commitlog_segment_size_in_mb, uint32_t, 64, Used,     \
@@ -303,7 +303,16 @@ class config {
     )   \
     /* Note: does not exist on the listing page other than in above comment, wtf? */    \
     val(commitlog_sync_batch_window_in_ms, uint32_t, 10000, Used,     \
-            "Controls how long the system waits for other writes before performing a sync in \"batch\" mode."    \
+            "Controls how long the system waits for other writes before performing a sync in \"batch\" mode. Deprecated in favour of commitlog_sync_batch_window_in_us, and only used when that option is not set."    \
+    )   \
+    val(commitlog_sync_batch_window_in_us, uint32_t, 500, Used,     \
+            "In \"batch\" mode, writes arriving within this many microseconds of each other are written and synced to disk together, and acknowledged together once the sync completes. Set to 0 to sync every write on its own."    \
+    )   \
+    val(commitlog_sync_batch_max_bytes, uint32_t, 1024 * 1024, Used,     \
+            "In \"batch\" mode, a group of writes is synced before its window expires once it holds this many bytes."    \
+    )   \
+    val(commitlog_reuse_segments, bool, true, Used,     \
+            "Whether to rename and overwrite commitlog segments which are no longer needed instead of deleting them and allocating new files."    \
     )   \
     val(commitlog_total_space_in_mb, int64_t, -1, Used,     \
             "Total space used for commitlogs. If the used space goes above this value, Cassandra rounds up to the next nearest segment multiple and flushes memtables to disk for the oldest commitlog segments, removing those log segments. This reduces the amount of data to replay on startup, and prevents infrequently-updated tables from indefinitely keeping commitlog segments. A small total commitlog space tends to cause more flush activity on less-active tables.\n"  \
@@ -326,6 +335,24 @@ class config {
     val(sstable_preemptive_open_interval_in_mb, uint32_t, 50, Unused,     \
             "When compacting, the replacement opens SSTables before they are completely written and uses in place of the prior SSTables for any range previously written. This setting helps to smoothly transfer reads between the SSTables by reducing page cache churn and keeps hot rows hot."  \
     )                                                   \
+    val(sstable_query_read_buffer_size_in_kb, uint32_t, 128, Used,     \
+            "Size of each read issued by queries reading sstable data files. Adjacent compressed chunks are read together, and a read covers at least one whole chunk."  \
+    )                                                   \
+    val(sstable_query_read_ahead, uint32_t, 4, Used,     \
+            "Number of reads queries keep in flight ahead of the data being parsed when reading sstable data files."  \
+    )                                                   \
+    val(compaction_read_buffer_size_in_kb, uint32_t, 128, Used,     \
+            "Size of each read issued by compaction when reading sstable data files. Adjacent compressed chunks are read together, and a read covers at least one whole chunk."  \
+    )                                                   \
+    val(compaction_read_ahead, uint32_t, 4, Used,     \
+            "Number of reads compaction keeps in flight ahead of the data being parsed when reading sstable data files."  \
+    )                                                   \
+    val(streaming_read_buffer_size_in_kb, uint32_t, 128, Used,     \
+            "Size of each read issued by streaming and repair when reading sstable data files. Adjacent compressed chunks are read together, and a read covers at least one whole chunk."  \
+    )                                                   \
+    val(streaming_read_ahead, uint32_t, 4, Used,     \
+            "Number of reads streaming and repair keep in flight ahead of the data being parsed when reading sstable data files."  \
+    )                                                   \
     val(defragment_memory_on_idle, bool, true, Used, "Set to true to defragment memory when the cpu is idle.  This reduces the amount of work Scylla performs when processing client requests.") \
     /* Memtable settings */ \
     val(memtable_allocation_type, sstring, "heap_buffers", Invalid,     \
@@ -519,7 +546,7 @@ class config {
     val(internode_recv_buff_size_in_bytes, uint32_t, 0, Unused,     \
             "Sets the receiving socket buffer size in bytes for inter-node calls."  \
     )   \
-    val(internode_compression, sstring, "all", Unused,     \
+    val(internode_compression, sstring, "none", Used,     \
             "Controls whether traffic between nodes is compressed. The valid values are:\n" \
             "\n"    \
             "\tall: All traffic is compressed.\n"   \
@@ -593,23 +620,32 @@ class config {
     val(dynamic_snitch_update_interval_in_ms, uint32_t, 100, Unused,     \
             "The time interval for how often the snitch calculates node scores. Because score calculation is CPU intensive, be careful when reducing this interval."  \
     )   \
-    val(hinted_handoff_enabled, bool, true, Unused,     \
+    val(hinted_handoff_enabled, bool, true, Used,     \
             "Enable or disable hinted handoff. To enable per data center, add data center list. For example: hinted_handoff_enabled: DC1,DC2. A hint indicates that the write needs to be replayed to an unavailable node. Where Cassandra writes the hint depends on the version:\n"  \
             "\n"    \
             "\tPrior to 1.0: Writes to a live replica node.\n"  \
             "\t1.0 and later: Writes to the coordinator node.\n"  \
             "Related information: About hinted handoff writes"  \
     )   \
-    val(hinted_handoff_throttle_in_kb, uint32_t, 1024, Unused,     \
+    val(hinted_handoff_throttle_in_kb, uint32_t, 1024, Used,     \
             "Maximum throttle per delivery thread in kilobytes per second. This rate reduces proportionally to the number of nodes in the cluster. For example, if there are two nodes in the cluster, each delivery thread will use the maximum rate. If there are three, each node will throttle to half of the maximum, since the two nodes are expected to deliver hints simultaneously."  \
     )   \
-    val(max_hint_window_in_ms, uint32_t, 10800000, Unused,     \
+    val(max_hint_window_in_ms, uint32_t, 10800000, Used,     \
             "Maximum amount of time that hints are generates hints for an unresponsive node. After this interval, new hints are no longer generated until the node is back up and responsive. If the node goes down again, a new interval begins. This setting can prevent a sudden demand for resources when a node is brought back online and the rest of the cluster attempts to replay a large volume of hinted writes.\n"  \
             "Related information: Failure detection and recovery"  \
     )   \
     val(max_hints_delivery_threads, uint32_t, 2, Invalid,     \
             "Number of threads with which to deliver hints. In multiple data-center deployments, consider increasing this number because cross data-center handoff is generally slower."  \
     )   \
+    val(hints_directory, sstring, "/var/lib/scylla/hints", Used,   \
+            "The directory where hints files are stored if hinted handoff is enabled. Each shard keeps one append-only log per target endpoint below it."   \
+    )                                           \
+    val(max_hints_file_size_in_mb, uint32_t, 128, Used,     \
+            "The size of the individual hints log segments. A hinted mutation must fit in half a segment."  \
+    )   \
+    val(max_hints_disk_space_in_mb, uint32_t, 10240, Used,     \
+            "Total disk space hints may occupy on this node. Once exceeded, new hints are dropped (and counted as not stored) until delivery frees space."  \
+    )   \
     val(batchlog_replay_throttle_in_kb, uint32_t, 1024, Unused,     \
             "Total maximum throttle. Throttling is reduced proportionally to the number of nodes in the cluster."  \
     )   \
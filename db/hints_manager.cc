@@ -0,0 +1,460 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/do_with.hh>
+#include <seastar/core/reactor.hh>
+#include <boost/range/adaptor/map.hpp>
+#include <boost/range/algorithm/sort.hpp>
+
+#include "hints_manager.hh"
+#include "db/commitlog/commitlog_entry.hh"
+#include "db/config.hh"
+#include "converting_mutation_partition_applier.hh"
+#include "database.hh"
+#include "service/storage_proxy.hh"
+#include "service/storage_service.hh"
+#include "gms/gossiper.hh"
+#include "disk-error-handler.hh"
+#include "checked-file-impl.hh"
+#include "log.hh"
+
+static logging::logger logger("hints_manager");
+
+distributed<db::hints_manager> db::_the_hints_manager;
+
+const uint32_t db::hints_manager::replay_interval;
+
+namespace db {
+
+// Thrown to stop delivery when the target goes away or delivery is paused;
+// the remaining hints are kept for the next attempt.
+class hints_delivery_interrupted : public std::exception {
+public:
+    virtual const char* what() const noexcept override {
+        return "hints delivery interrupted";
+    }
+};
+
+}
+
+db::hints_manager::hints_manager(distributed<database>& db, distributed<service::storage_proxy>& proxy)
+        : _db(db)
+        , _proxy(proxy)
+        , _hints_dir(sprint("%s/%d", db.local().get_config().hints_directory(), engine().cpu_id()))
+        , _max_size_on_disk(uint64_t(db.local().get_config().max_hints_disk_space_in_mb()) * 1024 * 1024 / smp::count) {
+    auto add_counter = [this] (const char* name, uint64_t& value) {
+        _collectd_registrations.push_back(
+            scollectd::add_polled_metric(scollectd::type_instance_id("hints_manager"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", name)
+                , scollectd::make_typed(scollectd::data_type::DERIVE, value)));
+    };
+    add_counter("written", _stats.written);
+    add_counter("dropped", _stats.dropped);
+    add_counter("sent", _stats.sent);
+    add_counter("errors", _stats.errors);
+    _collectd_registrations.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("hints_manager"
+            , scollectd::per_cpu_plugin_instance
+            , "bytes", "size_on_disk")
+            , scollectd::make_typed(scollectd::data_type::GAUGE, [this] { return size_on_disk(); })));
+}
+
+sstring db::hints_manager::endpoint_dir(gms::inet_address ep) const {
+    return _hints_dir + "/" + ep.to_sstring();
+}
+
+db::hints_manager::endpoint_hints& db::hints_manager::get_endpoint_hints(gms::inet_address ep) {
+    auto it = _endpoints.find(ep);
+    if (it == _endpoints.end()) {
+        it = _endpoints.emplace(ep, std::make_unique<endpoint_hints>()).first;
+    }
+    return *it->second;
+}
+
+uint64_t db::hints_manager::size_on_disk() const {
+    uint64_t size = _sealed_size_on_disk;
+    for (auto& eh : _endpoints | boost::adaptors::map_values) {
+        if (eh->log) {
+            size += eh->log->get_total_size();
+        }
+    }
+    return size;
+}
+
+future<> db::hints_manager::open_log(endpoint_hints& eh, gms::inet_address ep) {
+    if (eh.log) {
+        return make_ready_future<>();
+    }
+    auto& cfg = _db.local().get_config();
+    commitlog::config cl_cfg;
+    cl_cfg.commit_log_location = endpoint_dir(ep);
+    cl_cfg.commitlog_segment_size_in_mb = cfg.max_hints_file_size_in_mb();
+    cl_cfg.commitlog_sync_period_in_ms = cfg.commitlog_sync_period_in_ms();
+    // Segments are only needed when hints are actually written, and the
+    // logs of all endpoints would otherwise clash in collectd.
+    cl_cfg.max_reserve_segments = 0;
+    cl_cfg.metrics_category_name = "";
+    return io_check(recursive_touch_directory, cl_cfg.commit_log_location).then([cl_cfg] {
+        return commitlog::create_commitlog(cl_cfg);
+    }).then([&eh] (commitlog log) {
+        eh.log = std::move(log);
+    });
+}
+
+static future<struct stat> stat_segment(sstring name) {
+    return open_checked_file_dma(commit_error, name, open_flags::ro).then([] (file f) {
+        return f.stat().finally([f] () mutable {
+            return f.close();
+        });
+    });
+}
+
+// Must be called with eh.log_sem held. Closes the active log, if any, and
+// queues all segments of the endpoint for delivery.
+future<> db::hints_manager::seal_log(endpoint_hints& eh, gms::inet_address ep) {
+    return open_log(eh, ep).then([&eh] {
+        return eh.log->shutdown().then([&eh] {
+            return eh.log->list_existing_descriptors();
+        });
+    }).then([this, &eh, ep] (std::vector<commitlog::descriptor> descs) {
+        eh.log = {};
+        boost::sort(descs, [] (const commitlog::descriptor& a, const commitlog::descriptor& b) {
+            return a.id < b.id;
+        });
+        auto dir = endpoint_dir(ep);
+        auto names = make_lw_shared<std::vector<sstring>>();
+        for (auto& d : descs) {
+            auto name = dir + "/" + d.filename();
+            auto queued = std::any_of(eh.sealed.begin(), eh.sealed.end(), [&name] (const sealed_segment& s) {
+                return s.name == name;
+            });
+            if (!queued) {
+                names->push_back(std::move(name));
+            }
+        }
+        return do_for_each(*names, [this, &eh] (const sstring& name) {
+            return stat_segment(name).then([this, &eh, name] (struct stat st) {
+                uint64_t size = uint64_t(st.st_blocks) * 512;
+                _sealed_size_on_disk += size;
+                eh.sealed.push_back(sealed_segment{name, size, gc_clock::time_point(gc_clock::duration(st.st_mtime))});
+            });
+        }).finally([names] {});
+    });
+}
+
+future<> db::hints_manager::store_hint(gms::inet_address ep, schema_ptr s, lw_shared_ptr<const frozen_mutation> fm) {
+    auto& es = _endpoint_stats[ep];
+    auto now = gc_clock::now();
+    if (_stop || size_on_disk() + commitlog_entry_writer(s, *fm, now).size() > _max_size_on_disk) {
+        logger.trace("Dropping hint for {}: {} bytes of hints on disk", ep, size_on_disk());
+        ++_stats.dropped;
+        ++es.dropped;
+        return make_ready_future<>();
+    }
+    auto& eh = get_endpoint_hints(ep);
+    return with_gate(_gate, [this, ep, &eh, s = std::move(s), fm = std::move(fm)] () mutable {
+        return with_semaphore(eh.log_sem, 1, [this, ep, &eh, now, s = std::move(s), fm = std::move(fm)] () mutable {
+            return open_log(eh, ep).then([&eh, now, s = std::move(s), fm = std::move(fm)] {
+                // The writer refers to fm until the entry is written.
+                return eh.log->add_entry(s->id(), commitlog_entry_writer(s, *fm, now)).finally([fm] {});
+            });
+        });
+    }).then_wrapped([this, ep, &es] (future<replay_position> f) {
+        try {
+            f.get();
+            ++_stats.written;
+            ++es.written;
+        } catch (...) {
+            ++_stats.dropped;
+            ++es.dropped;
+            logger.warn("Failed to store hint for {}: {}", ep, std::current_exception());
+        }
+    });
+}
+
+void db::hints_manager::note_hint_past_window(gms::inet_address ep) {
+    ++_stats.dropped;
+    ++_endpoint_stats[ep].dropped;
+}
+
+future<> db::hints_manager::send_hint(gms::inet_address ep, std::unordered_map<table_schema_version, column_mapping>& mappings,
+        temporary_buffer<char> buf, gc_clock::time_point segment_written_at, lw_shared_ptr<utils::rate_limiter> limiter) {
+    if (_stop || _paused || !gms::get_local_gossiper().is_alive(ep)) {
+        return make_exception_future<>(hints_delivery_interrupted());
+    }
+    try {
+        auto size = buf.size();
+        commitlog_entry_reader cer(buf);
+        auto& fm = cer.mutation();
+
+        // Schemas are written once per segment, with the first hint using them.
+        auto cm_it = mappings.find(fm.schema_version());
+        if (cm_it == mappings.end()) {
+            if (!cer.get_column_mapping()) {
+                throw std::runtime_error(sprint("unknown schema version %s", fm.schema_version()));
+            }
+            cm_it = mappings.emplace(fm.schema_version(), *cer.get_column_mapping()).first;
+        }
+
+        schema_ptr s;
+        try {
+            s = _db.local().find_schema(fm.column_family_id());
+        } catch (no_such_column_family&) {
+            logger.debug("Dropping hint for {} of a dropped table {}", ep, fm.column_family_id());
+            ++_stats.dropped;
+            return make_ready_future<>();
+        }
+        // Tombstones in hints older than gc_grace_seconds may already be
+        // purged elsewhere; delivering the hint could resurrect data.
+        // Hints stored before write times were recorded fall back to the
+        // segment's mtime, the time of its newest hint.
+        auto written_at = cer.written_at().value_or(segment_written_at);
+        if (written_at + s->gc_grace_seconds() < gc_clock::now()) {
+            logger.debug("Dropping hint for {} older than gc_grace_seconds of {}.{}", ep, s->ks_name(), s->cf_name());
+            ++_stats.dropped;
+            return make_ready_future<>();
+        }
+
+        auto m = [&] {
+            if (s->version() == fm.schema_version()) {
+                return fm.unfreeze(s);
+            }
+            const column_mapping& cm = cm_it->second;
+            mutation m(fm.decorated_key(*s), s);
+            converting_mutation_partition_applier v(cm, *s, m.partition());
+            fm.partition().accept(cm, v);
+            return m;
+        }();
+
+        return limiter->reserve(size).then([this, ep, m = std::move(m)] () mutable {
+            return _proxy.local().send_hint_to_endpoint(std::move(m), ep);
+        }).then([this] {
+            ++_stats.sent;
+        });
+    } catch (...) {
+        return make_exception_future<>(std::current_exception());
+    }
+}
+
+future<> db::hints_manager::send_segment(gms::inet_address ep, const sealed_segment& seg, lw_shared_ptr<utils::rate_limiter> limiter) {
+    logger.debug("Sending hints from {} to {}", seg.name, ep);
+    auto mappings = make_lw_shared<std::unordered_map<table_schema_version, column_mapping>>();
+    return commitlog::read_log_file(seg.name, [this, ep, mappings, segment_written_at = seg.last_modified, limiter] (temporary_buffer<char> buf, replay_position rp) {
+        return send_hint(ep, *mappings, std::move(buf), segment_written_at, limiter);
+    }).then([] (auto s) {
+        auto f = s->done();
+        return f.finally([s = std::move(s)] {});
+    }).then_wrapped([this, name = seg.name] (future<> f) {
+        try {
+            f.get();
+        } catch (commitlog::segment_data_corruption_error& e) {
+            // Whatever could be read was delivered, the rest is lost.
+            logger.warn("Hints segment {} is corrupted, {} bytes skipped", name, e.bytes());
+            ++_stats.errors;
+        }
+    });
+}
+
+future<> db::hints_manager::send_hints(gms::inet_address ep) {
+    auto it = _endpoints.find(ep);
+    if (it == _endpoints.end() || it->second->sending || _stop || _paused) {
+        return make_ready_future<>();
+    }
+    auto& eh = *it->second;
+    eh.sending = true;
+
+    // Same scaling as origin: every other node is expected to be sending
+    // its hints to the same endpoint, and so is every shard of this one.
+    auto throttle_in_kb = _db.local().get_config().hinted_handoff_throttle_in_kb();
+    auto nodes = service::get_local_storage_service().get_token_metadata().get_all_endpoints().size();
+    auto rate = uint64_t(throttle_in_kb) * 1024 / (std::max<size_t>(nodes, 2) - 1) / smp::count;
+    auto limiter = make_lw_shared<utils::rate_limiter>(throttle_in_kb ? std::max<uint64_t>(rate, 1) : 0);
+
+    return with_gate(_gate, [this, ep, &eh, limiter] {
+        return with_semaphore(eh.log_sem, 1, [this, ep, &eh] {
+            return seal_log(eh, ep);
+        }).then([this, ep, &eh, limiter] {
+            return repeat([this, ep, &eh, limiter] {
+                if (eh.sealed.empty()) {
+                    return make_ready_future<stop_iteration>(stop_iteration::yes);
+                }
+                auto seg = eh.sealed.front();
+                return send_segment(ep, seg, limiter).then([this, &eh, seg] {
+                    if (eh.sealed.empty() || eh.sealed.front().name != seg.name) {
+                        // truncated while being sent
+                        return make_ready_future<stop_iteration>(stop_iteration::no);
+                    }
+                    eh.sealed.pop_front();
+                    _sealed_size_on_disk -= seg.size_on_disk;
+                    return commit_io_check(remove_file, seg.name).then([] {
+                        return stop_iteration::no;
+                    });
+                });
+            });
+        });
+    }).then_wrapped([this, ep] (future<> f) {
+        try {
+            f.get();
+            logger.debug("Finished sending hints to {}", ep);
+        } catch (hints_delivery_interrupted&) {
+            logger.debug("Sending hints to {} interrupted", ep);
+        } catch (...) {
+            ++_stats.errors;
+            logger.warn("Failed to send hints to {}: {}", ep, std::current_exception());
+        }
+    }).finally([&eh] {
+        eh.sending = false;
+    });
+}
+
+void db::hints_manager::send_all_hints() {
+    for (auto& p : _endpoints) {
+        auto& eh = *p.second;
+        auto pending = !eh.sealed.empty() || (eh.log && eh.log->get_total_size() > 0);
+        if (pending && gms::get_local_gossiper().is_alive(p.first)) {
+            send_hints(p.first);
+        }
+    }
+}
+
+future<> db::hints_manager::truncate_hints(gms::inet_address ep) {
+    auto it = _endpoints.find(ep);
+    if (it == _endpoints.end()) {
+        return make_ready_future<>();
+    }
+    auto& eh = *it->second;
+    return with_gate(_gate, [this, ep, &eh] {
+        return with_semaphore(eh.log_sem, 1, [this, ep, &eh] {
+            return seal_log(eh, ep).then([this, &eh] {
+                auto sealed = std::move(eh.sealed);
+                eh.sealed.clear();
+                return do_with(std::move(sealed), [this] (std::deque<sealed_segment>& sealed) {
+                    return parallel_for_each(sealed, [this] (sealed_segment& seg) {
+                        _sealed_size_on_disk -= seg.size_on_disk;
+                        return commit_io_check(remove_file, seg.name);
+                    });
+                });
+            });
+        });
+    }).then([ep] {
+        logger.info("Truncated hints for {}", ep);
+    });
+}
+
+future<> db::hints_manager::truncate_all_hints() {
+    auto eps = boost::copy_range<std::vector<gms::inet_address>>(_endpoints | boost::adaptors::map_keys);
+    return do_with(std::move(eps), [this] (std::vector<gms::inet_address>& eps) {
+        return parallel_for_each(eps, [this] (gms::inet_address ep) {
+            return truncate_hints(ep);
+        });
+    });
+}
+
+std::vector<gms::inet_address> db::hints_manager::endpoints_pending_hints() const {
+    std::vector<gms::inet_address> res;
+    for (auto& p : _endpoints) {
+        auto& eh = *p.second;
+        if (!eh.sealed.empty() || (eh.log && eh.log->get_total_size() > 0)) {
+            res.push_back(p.first);
+        }
+    }
+    return res;
+}
+
+db::hints_manager::endpoint_stats db::hints_manager::get_endpoint_stats(gms::inet_address ep) const {
+    auto it = _endpoint_stats.find(ep);
+    return it == _endpoint_stats.end() ? endpoint_stats() : it->second;
+}
+
+void db::hints_manager::on_alive(gms::inet_address endpoint, gms::endpoint_state state) {
+    get_hints_manager().invoke_on_all([endpoint] (hints_manager& hm) {
+        hm.send_hints(endpoint);
+    });
+}
+
+// Picks up the hints left over by a previous run of this shard.
+future<> db::hints_manager::load_endpoints() {
+    return engine().file_exists(_hints_dir).then([this] (bool exists) {
+        if (!exists) {
+            return make_ready_future<>();
+        }
+        return do_with(std::vector<gms::inet_address>(), [this] (std::vector<gms::inet_address>& eps) {
+            return open_checked_directory(commit_error, _hints_dir).then([&eps] (file dir) {
+                auto listing = make_lw_shared<subscription<directory_entry>>(dir.list_directory([&eps] (directory_entry de) {
+                    if (de.type && *de.type != directory_entry_type::directory) {
+                        return make_ready_future<>();
+                    }
+                    try {
+                        eps.push_back(gms::inet_address(de.name));
+                    } catch (...) {
+                        logger.warn("Ignoring unexpected entry {} in the hints directory", de.name);
+                    }
+                    return make_ready_future<>();
+                }));
+                return listing->done().finally([listing, dir] {});
+            }).then([this, &eps] {
+                return parallel_for_each(eps, [this] (gms::inet_address ep) {
+                    auto& eh = get_endpoint_hints(ep);
+                    return with_semaphore(eh.log_sem, 1, [this, ep, &eh] {
+                        return seal_log(eh, ep);
+                    });
+                });
+            });
+        });
+    }).then([this] {
+        if (!_endpoints.empty()) {
+            logger.info("Found hints for {} endpoints, {} bytes", _endpoints.size(), _sealed_size_on_disk);
+        }
+    });
+}
+
+future<> db::hints_manager::start() {
+    return load_endpoints().then([this] {
+        if (engine().cpu_id() == 0) {
+            gms::get_local_gossiper().register_(shared_from_this());
+        }
+        _timer.set_callback([this] {
+            send_all_hints();
+        });
+        _timer.arm_periodic(std::chrono::milliseconds(replay_interval));
+    });
+}
+
+future<> db::hints_manager::stop() {
+    if (_stop) {
+        return make_ready_future<>();
+    }
+    _stop = true;
+    _timer.cancel();
+    if (engine().cpu_id() == 0 && gms::get_gossiper().local_is_initialized()) {
+        gms::get_local_gossiper().unregister_(shared_from_this());
+    }
+    return _gate.close().then([this] {
+        return parallel_for_each(_endpoints, [] (auto& p) {
+            auto& eh = *p.second;
+            return eh.log ? eh.log->shutdown() : make_ready_future<>();
+        });
+    });
+}
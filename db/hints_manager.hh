@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <experimental/optional>
+#include <seastar/core/future.hh>
+#include <seastar/core/distributed.hh>
+#include <seastar/core/timer.hh>
+#include <seastar/core/gate.hh>
+#include <seastar/core/semaphore.hh>
+#include <seastar/core/scollectd.hh>
+
+#include "db/commitlog/commitlog.hh"
+#include "gms/inet_address.hh"
+#include "gms/i_endpoint_state_change_subscriber.hh"
+#include "frozen_mutation.hh"
+#include "schema.hh"
+#include "gc_clock.hh"
+#include "utils/rate_limiter.hh"
+
+class database;
+
+namespace service {
+class storage_proxy;
+}
+
+namespace db {
+
+/**
+ * Keeps writes which could not be delivered to a replica ("hints") and
+ * delivers them once the replica is back.
+ *
+ * Each shard keeps one append-only commitlog per target endpoint, under
+ * <hints_directory>/<shard>/<endpoint>. Storing a hint is an append to it.
+ * When gossip marks the endpoint alive, and periodically to pick up hints
+ * left over by a previous run, the log is sealed: new hints go to a fresh
+ * log while the sealed segments are read back and sent to the endpoint,
+ * throttled by hinted_handoff_throttle_in_kb. A segment is deleted once all
+ * of its hints are delivered.
+ *
+ * The space used by the hints of a shard is bounded by its share of
+ * max_hints_disk_space_in_mb; hints above the limit are dropped.
+ */
+class hints_manager : public gms::i_endpoint_state_change_subscriber, public enable_shared_from_this<hints_manager> {
+public:
+    struct stats {
+        uint64_t written = 0;
+        uint64_t dropped = 0;
+        uint64_t sent = 0;
+        uint64_t errors = 0;
+    };
+    struct endpoint_stats {
+        uint64_t written = 0;
+        uint64_t dropped = 0;
+    };
+private:
+    static constexpr uint32_t replay_interval = 10 * 1000; // milliseconds
+
+    using clock_type = lowres_clock;
+
+    struct sealed_segment {
+        sstring name;
+        uint64_t size_on_disk;
+        gc_clock::time_point last_modified;
+    };
+
+    struct endpoint_hints {
+        // Created on the first hint after the previous log was sealed.
+        std::experimental::optional<commitlog> log;
+        // Segments waiting for delivery, oldest first.
+        std::deque<sealed_segment> sealed;
+        // Serializes appends against sealing of the log.
+        semaphore log_sem{1};
+        bool sending = false;
+    };
+
+    distributed<database>& _db;
+    distributed<service::storage_proxy>& _proxy;
+    sstring _hints_dir;
+    uint64_t _max_size_on_disk;
+    // Space used by sealed segments; active logs are asked for theirs.
+    uint64_t _sealed_size_on_disk = 0;
+    std::unordered_map<gms::inet_address, std::unique_ptr<endpoint_hints>> _endpoints;
+    std::unordered_map<gms::inet_address, endpoint_stats> _endpoint_stats;
+    stats _stats;
+    std::vector<scollectd::registration> _collectd_registrations;
+    timer<clock_type> _timer;
+    seastar::gate _gate;
+    bool _paused = false;
+    bool _stop = false;
+
+    sstring endpoint_dir(gms::inet_address ep) const;
+    endpoint_hints& get_endpoint_hints(gms::inet_address ep);
+    uint64_t size_on_disk() const;
+    future<> open_log(endpoint_hints& eh, gms::inet_address ep);
+    future<> seal_log(endpoint_hints& eh, gms::inet_address ep);
+    future<> send_segment(gms::inet_address ep, const sealed_segment& seg, lw_shared_ptr<utils::rate_limiter> limiter);
+    future<> send_hint(gms::inet_address ep, std::unordered_map<table_schema_version, column_mapping>& mappings,
+            temporary_buffer<char> buf, gc_clock::time_point segment_written_at, lw_shared_ptr<utils::rate_limiter> limiter);
+    future<> load_endpoints();
+    void send_all_hints();
+public:
+    hints_manager(distributed<database>& db, distributed<service::storage_proxy>& proxy);
+
+    future<> start();
+    future<> stop();
+
+    /**
+     * Appends a hint for ep to its log. The returned future resolves once
+     * the hint is written or dropped and never fails.
+     */
+    future<> store_hint(gms::inet_address ep, schema_ptr s, lw_shared_ptr<const frozen_mutation> fm);
+    // Accounts a hint not stored because ep is down past max_hint_window_in_ms.
+    void note_hint_past_window(gms::inet_address ep);
+
+    // Delivers all stored hints for ep, provided it is alive.
+    future<> send_hints(gms::inet_address ep);
+    // Drops all stored hints for ep.
+    future<> truncate_hints(gms::inet_address ep);
+    future<> truncate_all_hints();
+    void pause_delivery(bool pause) {
+        _paused = pause;
+    }
+
+    std::vector<gms::inet_address> endpoints_pending_hints() const;
+    const stats& get_stats() const {
+        return _stats;
+    }
+    endpoint_stats get_endpoint_stats(gms::inet_address ep) const;
+
+    virtual void on_join(gms::inet_address endpoint, gms::endpoint_state ep_state) override {}
+    virtual void before_change(gms::inet_address endpoint, gms::endpoint_state current_state, gms::application_state new_state_key, const gms::versioned_value& new_value) override {}
+    virtual void on_change(gms::inet_address endpoint, gms::application_state state, const gms::versioned_value& value) override {}
+    virtual void on_alive(gms::inet_address endpoint, gms::endpoint_state state) override;
+    virtual void on_dead(gms::inet_address endpoint, gms::endpoint_state state) override {}
+    virtual void on_remove(gms::inet_address endpoint) override {}
+    virtual void on_restart(gms::inet_address endpoint, gms::endpoint_state state) override {}
+};
+
+extern distributed<hints_manager> _the_hints_manager;
+
+inline distributed<hints_manager>& get_hints_manager() {
+    return _the_hints_manager;
+}
+
+inline hints_manager& get_local_hints_manager() {
+    return _the_hints_manager.local();
+}
+
+}
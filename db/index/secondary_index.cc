@@ -39,10 +39,287 @@
  * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <boost/range/adaptor/map.hpp>
+
 #include "secondary_index.hh"
+#include "database.hh"
+#include "schema_builder.hh"
+#include "schema_registry.hh"
+#include "mutation_reader.hh"
+#include "db/system_keyspace.hh"
+#include "service/storage_proxy.hh"
+#include "service/migration_manager.hh"
+#include "service/priority_manager.hh"
+#include "log.hh"
+
+static logging::logger logger("secondary_index");
 
 const sstring db::index::secondary_index::custom_index_option_name = "class_name";
 const sstring db::index::secondary_index::index_keys_option_name = "index_keys";
 const sstring db::index::secondary_index::index_values_option_name = "index_values";
 const sstring db::index::secondary_index::index_entries_option_name = "index_keys_and_values";
 
+
+namespace db {
+namespace index {
+
+static const sstring index_table_suffix = "_index";
+
+sstring index_table_name(const sstring& index_name) {
+    return index_name + index_table_suffix;
+}
+
+std::experimental::optional<sstring> index_name_of_table(const sstring& cf_name) {
+    if (cf_name.size() <= index_table_suffix.size()
+            || cf_name.compare(cf_name.size() - index_table_suffix.size(), index_table_suffix.size(), index_table_suffix) != 0) {
+        return { };
+    }
+    return cf_name.substr(0, cf_name.size() - index_table_suffix.size());
+}
+
+bool is_indexable(const column_definition& cdef) {
+    return cdef.is_regular() && !cdef.type->is_collection();
+}
+
+schema_ptr make_index_schema(const schema& base, const column_definition& cdef) {
+    schema_builder builder(base.ks_name(), index_table_name(*cdef.idx_info.index_name));
+    builder.with_column(cdef.name(), cdef.type, column_kind::partition_key);
+    // The column holding the base partition key must not clash with the
+    // base clustering columns, which follow it.
+    sstring pk_column_name = "partition_key";
+    while (base.get_column_definition(to_bytes(pk_column_name))) {
+        pk_column_name = "_" + pk_column_name;
+    }
+    builder.with_column(to_bytes(pk_column_name), bytes_type, column_kind::clustering_key);
+    for (auto&& ck : base.clustering_key_columns()) {
+        builder.with_column(ck.name(), ck.type, column_kind::clustering_key);
+    }
+    sstring timestamp_column_name = "timestamp";
+    while (base.get_column_definition(to_bytes(timestamp_column_name)) || timestamp_column_name == pk_column_name) {
+        timestamp_column_name = "_" + timestamp_column_name;
+    }
+    builder.with_column(to_bytes(timestamp_column_name), bytes_type);
+    builder.set_comment(sprint("Secondary index %s on %s.%s", *cdef.idx_info.index_name, base.cf_name(), cdef.name_as_text()));
+    return builder.build();
+}
+
+const column_definition& index_timestamp_column(const schema& index_schema) {
+    return *index_schema.regular_columns().begin();
+}
+
+schema_ptr find_index_schema(const database& db, const schema& base, const column_definition& cdef) {
+    if (!cdef.idx_info.index_name) {
+        return nullptr;
+    }
+    auto cf_name = index_table_name(*cdef.idx_info.index_name);
+    if (!db.has_schema(base.ks_name(), cf_name)) {
+        return nullptr;
+    }
+    auto s = db.find_schema(base.ks_name(), cf_name);
+    // Guard against a user table which happens to be named like the index.
+    if (s->partition_key_size() != 1 || s->partition_key_columns().begin()->name() != cdef.name()
+            || s->clustering_key_size() != base.clustering_key_size() + 1
+            || s->regular_columns_count() != 1) {
+        return nullptr;
+    }
+    return s;
+}
+
+clustering_key make_index_clustering_key(const schema& index_schema, const schema& base,
+        const partition_key& pk, const clustering_key_prefix& ck) {
+    std::vector<bytes> components;
+    components.reserve(base.clustering_key_size() + 1);
+    components.emplace_back(to_bytes(pk.representation()));
+    for (auto&& c : ck.components(base)) {
+        components.emplace_back(to_bytes(c));
+    }
+    return clustering_key::from_exploded(index_schema, components);
+}
+
+std::pair<partition_key, clustering_key> base_key_of_index_entry(const schema& base, const schema& index_schema, const clustering_key& index_ck) {
+    auto components = index_ck.explode(index_schema);
+    auto pk = partition_key::from_bytes(components.front());
+    components.erase(components.begin());
+    return { std::move(pk), clustering_key::from_exploded(base, components) };
+}
+
+std::vector<mutation> make_index_mutations(const mutation& m, const column_definition& cdef, schema_ptr index_schema) {
+    std::vector<mutation> mutations;
+    auto& base = *m.schema();
+    with_linearized_managed_bytes([&] {
+        for (auto&& cr : m.partition().clustered_rows()) {
+            auto cell = cr.row().cells().find_cell(cdef.id);
+            if (!cell) {
+                continue;
+            }
+            auto ac = cell->as_atomic_cell();
+            // Partition keys cannot be empty, so neither can indexed values.
+            if (!ac.is_live() || ac.value().empty()) {
+                continue;
+            }
+            auto marker = ac.is_live_and_has_ttl() ? row_marker(ac.timestamp(), ac.ttl(), ac.expiry()) : row_marker(ac.timestamp());
+            auto timestamp_cell = ac.is_live_and_has_ttl()
+                    ? atomic_cell::make_live(ac.timestamp(), bytes_view(), ac.expiry(), ac.ttl())
+                    : atomic_cell::make_live(ac.timestamp(), bytes_view());
+            mutation im(partition_key::from_single_value(*index_schema, to_bytes(ac.value())), index_schema);
+            auto index_ck = make_index_clustering_key(*index_schema, base, m.key(), cr.key());
+            im.partition().clustered_row(index_ck).apply(marker);
+            im.set_clustered_cell(index_ck, index_timestamp_column(*index_schema), std::move(timestamp_cell));
+            mutations.emplace_back(std::move(im));
+        }
+    });
+    return mutations;
+}
+
+std::vector<mutation> make_index_mutations(const database& db, const std::vector<mutation>& mutations) {
+    std::vector<mutation> index_mutations;
+    for (auto&& m : mutations) {
+        auto& base = *m.schema();
+        for (auto&& cdef : base.regular_columns()) {
+            if (!cdef.is_indexed() || !is_indexable(cdef)) {
+                continue;
+            }
+            auto index_schema = find_index_schema(db, base, cdef);
+            if (!index_schema) {
+                continue;
+            }
+            auto im = make_index_mutations(m, cdef, std::move(index_schema));
+            std::move(im.begin(), im.end(), std::back_inserter(index_mutations));
+        }
+    }
+    return index_mutations;
+}
+
+mutation make_index_entry_deletion(schema_ptr index_schema, const bytes& value,
+        const clustering_key& index_ck, api::timestamp_type timestamp) {
+    mutation m(partition_key::from_single_value(*index_schema, value), index_schema);
+    m.partition().apply_delete(*index_schema, index_ck, tombstone(timestamp, gc_clock::now()));
+    return m;
+}
+
+distributed<index_builder> _the_index_builder;
+
+index_builder::index_builder(distributed<database>& db)
+    : _db(db)
+{
+    _retry_timer.set_callback([this] { build_pending_indexes(); });
+}
+
+future<> index_builder::start() {
+    if (engine().cpu_id() != 0) {
+        return make_ready_future<>();
+    }
+    service::get_local_migration_manager().register_listener(this);
+    build_pending_indexes();
+    return make_ready_future<>();
+}
+
+future<> index_builder::stop() {
+    if (engine().cpu_id() != 0) {
+        return make_ready_future<>();
+    }
+    _stopped = true;
+    _retry_timer.cancel();
+    service::get_local_migration_manager().unregister_listener(this);
+    return _gate.close();
+}
+
+void index_builder::build_pending_indexes() {
+    if (_stopped) {
+        return;
+    }
+    auto& db = _db.local();
+    for (auto&& cf : db.get_column_families() | boost::adaptors::map_values) {
+        auto base = cf->schema();
+        for (auto&& cdef : base->regular_columns()) {
+            if (!cdef.is_indexed() || !is_indexable(cdef)) {
+                continue;
+            }
+            auto index_schema = find_index_schema(db, *base, cdef);
+            if (!index_schema) {
+                continue;
+            }
+            auto key = std::make_pair(base->ks_name(), *cdef.idx_info.index_name);
+            if (!_building.insert(key).second) {
+                continue;
+            }
+            with_gate(_gate, [this, base, name = cdef.name(), index_schema, key] {
+                // The index table is created on the other shards concurrently
+                // with this one, wait for all of them to have it.
+                return _db.map_reduce0([id = index_schema->id()] (database& db) {
+                    return db.get_column_families().count(id) > 0;
+                }, true, std::logical_and<bool>()).then([this, base, name, index_schema, key] (bool created) {
+                    if (!created) {
+                        if (!_retry_timer.armed()) {
+                            _retry_timer.arm(std::chrono::seconds(1));
+                        }
+                        return make_ready_future<>();
+                    }
+                    return db::system_keyspace::is_index_built(key.first, key.second).then([this, base, name, index_schema, key] (bool built) {
+                        if (built) {
+                            return make_ready_future<>();
+                        }
+                        logger.info("Building index {}.{}", key.first, key.second);
+                        return build_index(base, *base->get_column_definition(name), index_schema).then([key] {
+                            logger.info("Index {}.{} built", key.first, key.second);
+                            return db::system_keyspace::set_index_built(key.first, key.second);
+                        });
+                    });
+                }).handle_exception([key] (auto ep) {
+                    logger.warn("Failed to build index {}.{}: {}", key.first, key.second, ep);
+                }).finally([this, key] {
+                    _building.erase(key);
+                });
+            });
+        }
+    }
+}
+
+// Each shard scans its part of the base table. Entries are written at
+// CL.ONE; the index is marked as built only if all of them were written.
+future<> index_builder::build_index(schema_ptr base, const column_definition& cdef, schema_ptr index_schema) {
+    return do_with(global_schema_ptr(base), global_schema_ptr(index_schema), [this, name = cdef.name()] (auto& gbase, auto& gindex) {
+        return _db.invoke_on_all([&gbase, &gindex, name] (database& db) {
+            schema_ptr base = gbase.get();
+            schema_ptr index_schema = gindex.get();
+            auto cf = db.get_column_families().at(base->id());
+            auto reader = cf->make_reader(base, query::full_partition_range, query::no_clustering_key_filtering,
+                    service::get_local_compaction_priority());
+            return do_with(std::move(reader), [cf, base, index_schema, name] (mutation_reader& reader) {
+                return consume(reader, [base, index_schema, name] (mutation&& m) {
+                    auto mutations = make_index_mutations(m, *base->get_column_definition(name), index_schema);
+                    if (mutations.empty()) {
+                        return make_ready_future<stop_iteration>(stop_iteration::no);
+                    }
+                    return service::get_local_storage_proxy().mutate(std::move(mutations), db::consistency_level::ONE).then([] {
+                        return stop_iteration::no;
+                    });
+                });
+            });
+        });
+    });
+}
+
+void index_builder::on_create_column_family(const sstring& ks_name, const sstring& cf_name) {
+    build_pending_indexes();
+}
+
+void index_builder::on_update_column_family(const sstring& ks_name, const sstring& cf_name, bool columns_changed) {
+    build_pending_indexes();
+}
+
+void index_builder::on_drop_column_family(const sstring& ks_name, const sstring& cf_name) {
+    auto index_name = index_name_of_table(cf_name);
+    if (!index_name || _stopped) {
+        return;
+    }
+    // Forget the build state, so that a new index of the same name is built.
+    with_gate(_gate, [ks_name, index_name] {
+        return db::system_keyspace::set_index_removed(ks_name, *index_name).handle_exception([ks_name, index_name] (auto ep) {
+            logger.warn("Failed to remove build state of index {}.{}: {}", ks_name, *index_name, ep);
+        });
+    });
+}
+
+}
+}
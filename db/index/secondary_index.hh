@@ -41,7 +41,19 @@
 
 #pragma once
 
+#include <unordered_set>
+#include <experimental/optional>
+
 #include "core/sstring.hh"
+#include "core/distributed.hh"
+#include "core/gate.hh"
+#include "core/timer.hh"
+#include "schema.hh"
+#include "mutation.hh"
+#include "service/migration_listener.hh"
+#include "utils/hash.hh"
+
+class database;
 
 namespace db {
 namespace index {
@@ -384,5 +396,106 @@ class secondary_index {
 
 };
 
+/*
+ * Secondary indexes on regular columns.
+ *
+ * The entries of an index are kept in a regular table of the base table's
+ * keyspace, see index_table_name(). It is partitioned by the indexed value
+ * and clustered by the serialized base partition key followed by the base
+ * clustering columns, so that each entry points at one base row. The row
+ * marker of an entry carries the timestamp and TTL of the indexed cell, and
+ * so does its only regular cell, which is empty and lets readers learn the
+ * entry's timestamp.
+ *
+ * Entries are written by the coordinator along with the base mutations.
+ * Overwriting or deleting the indexed cell, row or partition leaves the old
+ * entry in place; readers check every entry against the base row and delete
+ * the stale ones they come across, at the timestamp of the entry.
+ */
+
+sstring index_table_name(const sstring& index_name);
+
+// Returns the name of the index whose entries cf_name holds, provided
+// cf_name is named like an index table.
+std::experimental::optional<sstring> index_name_of_table(const sstring& cf_name);
+
+// Only regular, non-collection columns can be indexed.
+bool is_indexable(const column_definition& cdef);
+
+schema_ptr make_index_schema(const schema& base, const column_definition& cdef);
+
+// The empty cell written with every entry, timestamped like its row marker.
+const column_definition& index_timestamp_column(const schema& index_schema);
+
+// Returns the table holding the entries of the index on cdef, or nullptr
+// if it does not exist (yet).
+schema_ptr find_index_schema(const database& db, const schema& base, const column_definition& cdef);
+
+clustering_key make_index_clustering_key(const schema& index_schema, const schema& base,
+        const partition_key& pk, const clustering_key_prefix& ck);
+
+// The base row an index entry points at.
+std::pair<partition_key, clustering_key> base_key_of_index_entry(const schema& base, const schema& index_schema, const clustering_key& index_ck);
+
+// Index entries for the live cells of cdef written by m.
+std::vector<mutation> make_index_mutations(const mutation& m, const column_definition& cdef, schema_ptr index_schema);
+
+// Index entries for all indexed columns written by mutations.
+std::vector<mutation> make_index_mutations(const database& db, const std::vector<mutation>& mutations);
+
+// Removes the entry of value pointing at the base row, provided the entry
+// was written at or before timestamp.
+mutation make_index_entry_deletion(schema_ptr index_schema, const bytes& value,
+        const clustering_key& index_ck, api::timestamp_type timestamp);
+
+/*
+ * Builds the entries of newly created indexes from the data already stored
+ * on this node, and of indexes whose build was interrupted by a restart.
+ *
+ * Runs on shard 0, which scans the base table on every shard and writes the
+ * entries through the storage proxy. Once done, the index is recorded as
+ * built in system.IndexInfo.
+ */
+class index_builder : public service::migration_listener {
+    distributed<database>& _db;
+    // (keyspace, index name) of the builds in progress.
+    std::unordered_set<std::pair<sstring, sstring>, utils::tuple_hash> _building;
+    timer<> _retry_timer;
+    seastar::gate _gate;
+    bool _stopped = false;
+
+    void build_pending_indexes();
+    future<> build_index(schema_ptr base, const column_definition& cdef, schema_ptr index_schema);
+public:
+    explicit index_builder(distributed<database>& db);
+
+    future<> start();
+    future<> stop();
+
+    void on_create_keyspace(const sstring& ks_name) override {}
+    void on_create_column_family(const sstring& ks_name, const sstring& cf_name) override;
+    void on_create_user_type(const sstring& ks_name, const sstring& type_name) override {}
+    void on_create_function(const sstring& ks_name, const sstring& function_name) override {}
+    void on_create_aggregate(const sstring& ks_name, const sstring& aggregate_name) override {}
+
+    void on_update_keyspace(const sstring& ks_name) override {}
+    void on_update_column_family(const sstring& ks_name, const sstring& cf_name, bool columns_changed) override;
+    void on_update_user_type(const sstring& ks_name, const sstring& type_name) override {}
+    void on_update_function(const sstring& ks_name, const sstring& function_name) override {}
+    void on_update_aggregate(const sstring& ks_name, const sstring& aggregate_name) override {}
+
+    void on_drop_keyspace(const sstring& ks_name) override {}
+    void on_drop_column_family(const sstring& ks_name, const sstring& cf_name) override;
+    void on_drop_user_type(const sstring& ks_name, const sstring& type_name) override {}
+    void on_drop_function(const sstring& ks_name, const sstring& function_name) override {}
+    void on_drop_aggregate(const sstring& ks_name, const sstring& aggregate_name) override {}
+};
+
+extern distributed<index_builder> _the_index_builder;
+
+inline distributed<index_builder>& get_index_builder() {
+    return _the_index_builder;
+}
+
 }
 }
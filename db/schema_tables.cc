@@ -1573,11 +1573,16 @@ void add_column_to_schema_mutation(schema_ptr table,
     if (!column.is_on_all_components()) {
         m.set_clustered_cell(ckey, "component_index", int32_t(table->position(column)), timestamp);
     }
-#if 0
-    adder.add("index_name", column.getIndexName());
-    adder.add("index_type", column.getIndexType() == null ? null : column.getIndexType().toString());
-    adder.add("index_options", json(column.getIndexOptions()));
-#endif
+    if (column.idx_info.index_name) {
+        m.set_clustered_cell(ckey, "index_name", *column.idx_info.index_name, timestamp);
+    }
+    if (column.idx_info.index_type != index_type::none) {
+        m.set_clustered_cell(ckey, "index_type", to_sstring(column.idx_info.index_type), timestamp);
+    }
+    if (column.idx_info.index_options) {
+        auto& options = *column.idx_info.index_options;
+        m.set_clustered_cell(ckey, "index_options", json::to_json(std::map<sstring, sstring>(options.begin(), options.end())), timestamp);
+    }
 }
 
 sstring serialize_kind(column_kind kind)
@@ -1608,6 +1613,18 @@ column_kind deserialize_kind(sstring kind) {
     }
 }
 
+static index_type deserialize_index_type(const sstring& type) {
+    if (type == "KEYS") {
+        return index_type::keys;
+    } else if (type == "CUSTOM") {
+        return index_type::custom;
+    } else if (type == "COMPOSITES") {
+        return index_type::composites;
+    } else {
+        throw std::invalid_argument("unknown index type: " + type);
+    }
+}
+
 void drop_column_from_schema_mutation(schema_ptr table, const column_definition& column, long timestamp, std::vector<mutation>& mutations)
 {
     schema_ptr s = columns();
@@ -1662,20 +1679,18 @@ column_definition create_column_from_column_row(const query::result_set_row& row
 
     auto validator = parse_type(row.get_nonnull<sstring>("validator"));
 
-#if 0
-    IndexType indexType = null;
-    if (row.has("index_type"))
-        indexType = IndexType.valueOf(row.getString("index_type"));
-
-    Map<String, String> indexOptions = null;
-    if (row.has("index_options"))
-        indexOptions = fromJsonMap(row.getString("index_options"));
-
-    String indexName = null;
-    if (row.has("index_name"))
-        indexName = row.getString("index_name");
-#endif
-    auto c = column_definition{utf8_type->decompose(name), validator, kind, component_index};
+    index_info idx_info;
+    if (row.has("index_type")) {
+        idx_info.index_type = deserialize_index_type(row.get_nonnull<sstring>("index_type"));
+    }
+    if (row.has("index_options")) {
+        auto options = json::to_map(row.get_nonnull<sstring>("index_options"));
+        idx_info.index_options = index_options_map(options.begin(), options.end());
+    }
+    if (row.has("index_name")) {
+        idx_info.index_name = row.get_nonnull<sstring>("index_name");
+    }
+    auto c = column_definition{utf8_type->decompose(name), validator, kind, component_index, idx_info};
     return c;
 }
 
@@ -1001,6 +1001,28 @@ future<> set_bootstrap_state(bootstrap_state state) {
     });
 }
 
+// Like Origin, the table_name column holds the keyspace name.
+future<bool> is_index_built(const sstring& ks_name, const sstring& index_name) {
+    sstring req = "SELECT index_name FROM system.\"%s\" WHERE table_name = ? AND index_name = ?";
+    return execute_cql(req, BUILT_INDEXES, ks_name, index_name).then([] (::shared_ptr<cql3::untyped_result_set> msg) {
+        return !msg->empty();
+    });
+}
+
+future<> set_index_built(const sstring& ks_name, const sstring& index_name) {
+    sstring req = "INSERT INTO system.\"%s\" (table_name, index_name) VALUES (?, ?)";
+    return execute_cql(req, BUILT_INDEXES, ks_name, index_name).discard_result().then([] {
+        return force_blocking_flush(BUILT_INDEXES);
+    });
+}
+
+future<> set_index_removed(const sstring& ks_name, const sstring& index_name) {
+    sstring req = "DELETE FROM system.\"%s\" WHERE table_name = ? AND index_name = ?";
+    return execute_cql(req, BUILT_INDEXES, ks_name, index_name).discard_result().then([] {
+        return force_blocking_flush(BUILT_INDEXES);
+    });
+}
+
 std::vector<schema_ptr> all_tables() {
     std::vector<schema_ptr> r;
     auto legacy_tables = db::schema_tables::all_tables();
@@ -412,31 +412,13 @@ bootstrap_state get_bootstrap_state();
 bool was_decommissioned();
 future<> set_bootstrap_state(bootstrap_state state);
 
-#if 0
-    public static boolean isIndexBuilt(String keyspaceName, String indexName)
-    {
-        ColumnFamilyStore cfs = Keyspace.open(NAME).getColumnFamilyStore(BUILT_INDEXES);
-        QueryFilter filter = QueryFilter.getNamesFilter(decorate(ByteBufferUtil.bytes(keyspaceName)),
-                                                        BUILT_INDEXES,
-                                                        FBUtilities.singleton(cfs.getComparator().makeCellName(indexName), cfs.getComparator()),
-                                                        System.currentTimeMillis());
-        return ColumnFamilyStore.removeDeleted(cfs.getColumnFamily(filter), Integer.MAX_VALUE) != null;
-    }
-
-    public static void setIndexBuilt(String keyspaceName, String indexName)
-    {
-        ColumnFamily cf = ArrayBackedSortedColumns.factory.create(NAME, BUILT_INDEXES);
-        cf.addColumn(new BufferCell(cf.getComparator().makeCellName(indexName), ByteBufferUtil.EMPTY_BYTE_BUFFER, FBUtilities.timestampMicros()));
-        new Mutation(NAME, ByteBufferUtil.bytes(keyspaceName), cf).apply();
-    }
-
-    public static void setIndexRemoved(String keyspaceName, String indexName)
-    {
-        Mutation mutation = new Mutation(NAME, ByteBufferUtil.bytes(keyspaceName));
-        mutation.delete(BUILT_INDEXES, BuiltIndexes.comparator.makeCellName(indexName), FBUtilities.timestampMicros());
-        mutation.apply();
-    }
-#endif
+/*
+ * Secondary index build state. The state is kept per node, as each node
+ * builds the index entries for the data it owns.
+ */
+future<bool> is_index_built(const sstring& ks_name, const sstring& index_name);
+future<> set_index_built(const sstring& ks_name, const sstring& index_name);
+future<> set_index_removed(const sstring& ks_name, const sstring& index_name);
 
     /**
      * Read the host ID from the system keyspace, creating (and storing) one if
@@ -185,7 +185,7 @@ frozen_mutation streamed_mutation_freezer::consume_end_of_stream() {
 
 future<frozen_mutation> freeze(streamed_mutation sm) {
     return do_with(streamed_mutation(std::move(sm)), [] (auto& sm) mutable {
-        return consume(sm, streamed_mutation_freezer(*sm.schema(), sm.key()));
+        return consume(sm, streamed_mutation_freezer(*sm.schema(), sm.key(), sm.is_reversed()));
     });
 }
 
@@ -22,4 +22,5 @@
 class commitlog_entry {
     std::experimental::optional<column_mapping> mapping();
     frozen_mutation mutation();
+    std::experimental::optional<gc_clock::time_point> written_at() [[version 1.3]];
 };
\ No newline at end of file
@@ -39,6 +39,29 @@ class dead_cell final stub [[writable]] {
     tombstone tomb;
 };
 
+class counter_id final {
+    utils::UUID to_uuid();
+};
+
+class counter_shard final {
+    counter_id id();
+    int64_t value();
+    int64_t logical_clock();
+};
+
+class counter_cell_full final stub [[writable]] {
+    std::vector<counter_shard> shards; // sorted by id
+};
+
+class counter_cell_update final stub [[writable]] {
+    int64_t delta;
+};
+
+class counter_cell stub [[writable]] {
+    api::timestamp_type created_at;
+    boost::variant<counter_cell_full, counter_cell_update> value;
+};
+
 class collection_element stub [[writable]] {
     // key's format depends on its CQL type as defined in the schema and is specified in CQL binary protocol.
     bytes key;
@@ -52,7 +75,7 @@ class collection_cell stub [[writable]] {
 
 class column stub [[writable]] {
     uint32_t id;
-    boost::variant<boost::variant<live_cell, expiring_cell, dead_cell>, collection_cell> c;
+    boost::variant<boost::variant<live_cell, expiring_cell, dead_cell, counter_cell>, collection_cell> c;
 };
 
 class row stub [[writable]] {
@@ -19,6 +19,23 @@
  * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+enum class repair_checksum : uint8_t {
+    legacy = 0,
+    streamed = 1,
+};
+
 class partition_checksum {
   std::array<uint8_t, 32> digest();
 };
+
+class repair_row_hash {
+    std::array<uint64_t, 2> id;
+    std::array<uint64_t, 2> hash;
+};
+
+class repair_row_hashes_page {
+    std::vector<repair_row_hash> hashes;
+    std::experimental::optional<dht::token> last_token;
+    bool complete;
+    bool overflow;
+};
@@ -40,6 +40,11 @@ class partition_slice {
     uint32_t partition_row_limit() [[version 1.3]] = std::numeric_limits<uint32_t>::max();
 };
 
+enum class digest_algorithm : uint8_t {
+    MD5 = 0,
+    murmur3 = 1,
+};
+
 class read_command {
     utils::UUID cf_id;
     utils::UUID schema_version;
@@ -48,6 +53,7 @@ class read_command {
     std::chrono::time_point<gc_clock, gc_clock::duration> timestamp;
     std::experimental::optional<tracing::trace_info> trace_info [[version 1.3]];
     uint32_t partition_limit [[version 1.3]] = std::numeric_limits<uint32_t>::max();
+    query::digest_algorithm digest_algo [[version 1.4]] = query::digest_algorithm::MD5;
 };
 
 }
@@ -31,6 +31,7 @@ void init_ms_fd_gossiper(sstring listen_address
                 , uint16_t storage_port
                 , uint16_t ssl_storage_port
                 , sstring ms_encrypt_what
+                , sstring ms_compress_what
                 , sstring ms_trust_store
                 , sstring ms_cert
                 , sstring ms_key
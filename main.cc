@@ -34,6 +34,8 @@
 #include "streaming/stream_session.hh"
 #include "db/system_keyspace.hh"
 #include "db/batchlog_manager.hh"
+#include "db/hints_manager.hh"
+#include "db/index/secondary_index.hh"
 #include "db/commitlog/commitlog.hh"
 #include "db/commitlog/commitlog_replayer.hh"
 #include "utils/runtime.hh"
@@ -44,6 +46,7 @@
 #include "init.hh"
 #include "release.hh"
 #include "repair/repair.hh"
+#include "service/priority_manager.hh"
 #include <cstdio>
 #include <core/file.hh>
 #include <sys/time.h>
@@ -418,6 +421,27 @@ int main(int ac, char** av) {
             print("Scylla API server listening on %s:%s ...\n", api_address, api_port);
             supervisor_notify("initializing storage service");
             init_storage_service(db);
+            for (auto&& opt : std::initializer_list<std::pair<const char*, uint32_t>>{
+                    { "sstable_query_read_buffer_size_in_kb", cfg->sstable_query_read_buffer_size_in_kb() },
+                    { "sstable_query_read_ahead", cfg->sstable_query_read_ahead() },
+                    { "compaction_read_buffer_size_in_kb", cfg->compaction_read_buffer_size_in_kb() },
+                    { "compaction_read_ahead", cfg->compaction_read_ahead() },
+                    { "streaming_read_buffer_size_in_kb", cfg->streaming_read_buffer_size_in_kb() },
+                    { "streaming_read_ahead", cfg->streaming_read_ahead() }}) {
+                if (opt.second == 0) {
+                    startlog.error("Bad configuration: '{}' must be greater than 0", opt.first);
+                    throw bad_configuration_error();
+                }
+            }
+            smp::invoke_on_all([&cfg] {
+                auto kb = [] (uint32_t size_in_kb) { return size_t(size_in_kb) << 10; };
+                sstables::set_read_ahead(service::get_local_sstable_query_read_priority(),
+                        { kb(cfg->sstable_query_read_buffer_size_in_kb()), cfg->sstable_query_read_ahead() });
+                sstables::set_read_ahead(service::get_local_compaction_priority(),
+                        { kb(cfg->compaction_read_buffer_size_in_kb()), cfg->compaction_read_ahead() });
+                sstables::set_read_ahead(service::get_local_streaming_read_priority(),
+                        { kb(cfg->streaming_read_buffer_size_in_kb()), cfg->streaming_read_ahead() });
+            }).get();
             supervisor_notify("starting per-shard database core");
             // Note: changed from using a move here, because we want the config object intact.
             db.start(std::ref(*cfg)).get();
@@ -442,6 +466,10 @@ int main(int ac, char** av) {
             dirs.touch_and_lock(db.local().get_config().data_file_directories()).get();
             supervisor_notify("creating commitlog directory");
             dirs.touch_and_lock(db.local().get_config().commitlog_directory()).get();
+            if (db.local().get_config().hinted_handoff_enabled()) {
+                supervisor_notify("creating hints directory");
+                dirs.touch_and_lock(db.local().get_config().hints_directory()).get();
+            }
             supervisor_notify("verifying data and commitlog directories");
             std::unordered_set<sstring> directories;
             directories.insert(db.local().get_config().data_file_directories().cbegin(),
@@ -481,11 +509,13 @@ int main(int ac, char** av) {
             auto trust_store = get_or_default(ssl_opts, "truststore");
             auto cert = get_or_default(ssl_opts, "certificate", relative_conf_dir("scylla.crt").string());
             auto key = get_or_default(ssl_opts, "keyfile", relative_conf_dir("scylla.key").string());
+            auto compress_what = cfg->internode_compression();
 
             init_ms_fd_gossiper(listen_address
                     , storage_port
                     , ssl_storage_port
                     , encrypt_what
+                    , compress_what
                     , trust_store
                     , cert
                     , key
@@ -509,6 +539,8 @@ int main(int ac, char** av) {
             db::get_batchlog_manager().start(std::ref(qp)).get();
             // #293 - do not stop anything
             // engine().at_exit([] { return db::get_batchlog_manager().stop(); });
+            supervisor_notify("initializing hints manager");
+            db::get_hints_manager().start(std::ref(db), std::ref(proxy)).get();
             supervisor_notify("loading sstables");
             auto& ks = db.local().find_keyspace(db::system_keyspace::NAME);
             parallel_for_each(ks.metadata()->cf_meta_data(), [&ks] (auto& pair) {
@@ -575,14 +607,29 @@ int main(int ac, char** av) {
             supervisor_notify("starting streaming service");
             streaming::stream_session::init_streaming_service(db).get();
             api::set_server_stream_manager(ctx).get();
-            // Start handling REPAIR_CHECKSUM_RANGE messages
+            // Start handling REPAIR_CHECKSUM_RANGE and row-level repair messages
             net::get_messaging_service().invoke_on_all([&db] (auto& ms) {
-                ms.register_repair_checksum_range([&db] (sstring keyspace, sstring cf, query::range<dht::token> range) {
+                ms.register_repair_checksum_range([&db] (sstring keyspace, sstring cf, query::range<dht::token> range, rpc::optional<repair_checksum> rt) {
                     return do_with(std::move(keyspace), std::move(cf), std::move(range),
-                            [&db] (auto& keyspace, auto& cf, auto& range) {
-                        return checksum_range(db, keyspace, cf, range);
+                            [&db, rt] (auto& keyspace, auto& cf, auto& range) {
+                        return checksum_range(db, keyspace, cf, range, rt ? *rt : repair_checksum::legacy);
                     });
                 });
+                ms.register_repair_row_hashes([&db] (sstring keyspace, sstring cf, query::range<dht::token> range, uint64_t max_rows) {
+                    return do_with(std::move(keyspace), std::move(cf), std::move(range),
+                            [&db, max_rows] (auto& keyspace, auto& cf, auto& range) {
+                        return repair_row_hashes(db, keyspace, cf, range, max_rows);
+                    });
+                });
+                ms.register_repair_get_rows([&db] (sstring keyspace, sstring cf, query::range<dht::token> range, std::vector<repair_row_id> ids) {
+                    return do_with(std::move(keyspace), std::move(cf), std::move(range), std::move(ids),
+                            [&db] (auto& keyspace, auto& cf, auto& range, auto& ids) {
+                        return repair_get_rows(db, keyspace, cf, range, ids);
+                    });
+                });
+                ms.register_repair_put_rows([] (const rpc::client_info& cinfo, std::vector<frozen_mutation> rows) {
+                    return repair_put_rows(std::move(rows), net::messaging_service::get_source(cinfo).addr);
+                });
             }).get();
             supervisor_notify("starting storage service", true);
             auto& ss = service::get_local_storage_service();
@@ -593,6 +640,15 @@ int main(int ac, char** av) {
             db::get_batchlog_manager().invoke_on_all([] (db::batchlog_manager& b) {
                 return b.start();
             }).get();
+            supervisor_notify("starting hints manager");
+            db::get_hints_manager().invoke_on_all([] (db::hints_manager& hm) {
+                return hm.start();
+            }).get();
+            supervisor_notify("starting secondary index builder");
+            db::index::get_index_builder().start(std::ref(db)).get();
+            db::index::get_index_builder().invoke_on_all([] (db::index::index_builder& ib) {
+                return ib.start();
+            }).get();
             supervisor_notify("starting load broadcaster");
             // should be unique_ptr, but then lambda passed to at_exit will be non copieable and
             // casting to std::function<> will fail to compile
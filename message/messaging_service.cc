@@ -32,6 +32,7 @@
 #include "query-request.hh"
 #include "query-result.hh"
 #include "rpc/rpc.hh"
+#include "rpc/lz4_compressor.hh"
 #include "db/config.hh"
 #include "dht/i_partitioner.hh"
 #include "range.hh"
@@ -51,6 +52,7 @@
 #include "idl/read_command.dist.hh"
 #include "idl/range.dist.hh"
 #include "idl/partition_checksum.dist.hh"
+#include "idl/consistency_level.dist.hh"
 #include "serializer_impl.hh"
 #include "serialization_visitors.hh"
 #include "idl/tracing.dist.impl.hh"
@@ -67,6 +69,7 @@
 #include "idl/read_command.dist.impl.hh"
 #include "idl/range.dist.impl.hh"
 #include "idl/partition_checksum.dist.impl.hh"
+#include "idl/consistency_level.dist.impl.hh"
 
 namespace net {
 
@@ -132,6 +135,48 @@ class messaging_service::rpc_protocol_client_wrapper {
 
 struct messaging_service::rpc_protocol_server_wrapper : public rpc_protocol::server { using rpc_protocol::server::server; };
 
+// Offers LZ4 compression to rpc connections. Which compressor is used is
+// negotiated by rpc when a connection is set up, so a connection is only
+// compressed if both sides offer it. The compressors account the traffic
+// they handle in the owning messaging_service's statistics.
+class messaging_service::compressor_factory_wrapper : public rpc::compressor::factory {
+    class counting_compressor : public rpc::compressor {
+        std::unique_ptr<rpc::compressor> _compressor;
+        compression_stats& _stats;
+    public:
+        counting_compressor(std::unique_ptr<rpc::compressor> compressor, compression_stats& stats)
+            : _compressor(std::move(compressor)), _stats(stats) {
+        }
+        virtual temporary_buffer<char> compress(size_t head_space, temporary_buffer<char> data) override {
+            _stats.sent_uncompressed_bytes += data.size();
+            auto compressed = _compressor->compress(head_space, std::move(data));
+            _stats.sent_compressed_bytes += compressed.size() - head_space;
+            return compressed;
+        }
+        virtual temporary_buffer<char> decompress(temporary_buffer<char> data) override {
+            _stats.received_compressed_bytes += data.size();
+            auto decompressed = _compressor->decompress(std::move(data));
+            _stats.received_uncompressed_bytes += decompressed.size();
+            return decompressed;
+        }
+    };
+
+    rpc::lz4_compressor::factory _lz4;
+    compression_stats& _stats;
+public:
+    explicit compressor_factory_wrapper(compression_stats& stats) : _stats(stats) { }
+    virtual const sstring& supported() const override {
+        return _lz4.supported();
+    }
+    virtual std::unique_ptr<rpc::compressor> negotiate(sstring feature, bool is_server) const override {
+        auto compressor = _lz4.negotiate(std::move(feature), is_server);
+        if (!compressor) {
+            return nullptr;
+        }
+        return std::make_unique<counting_compressor>(std::move(compressor), _stats);
+    }
+};
+
 constexpr int32_t messaging_service::current_version;
 
 distributed<messaging_service> _the_messaging_service;
@@ -212,7 +257,7 @@ void register_handler(messaging_service* ms, messaging_verb verb, Func&& func) {
 }
 
 messaging_service::messaging_service(gms::inet_address ip, uint16_t port, bool listen_now)
-    : messaging_service(std::move(ip), port, encrypt_what::none, 0, nullptr, listen_now)
+    : messaging_service(std::move(ip), port, encrypt_what::none, compress_what::none, 0, nullptr, listen_now)
 {}
 
 static
@@ -225,11 +270,21 @@ rpc_resource_limits() {
     return limits;
 }
 
+// Servers accept compression whenever we compress any traffic at all; the
+// connecting side decides whether it is actually used.
+rpc::server_options messaging_service::server_options() {
+    rpc::server_options so;
+    if (_compress_what != compress_what::none) {
+        so.compressor_factory = _compressor_factory.get();
+    }
+    return so;
+}
+
 void messaging_service::start_listen() {
     if (!_server) {
         auto addr = ipv4_addr{_listen_address.raw_addr(), _port};
         _server = std::unique_ptr<rpc_protocol_server_wrapper>(new rpc_protocol_server_wrapper(*_rpc,
-                addr, rpc_resource_limits()));
+                server_options(), addr, rpc_resource_limits()));
     }
 
     if (!_server_tls) {
@@ -242,7 +297,7 @@ void messaging_service::start_listen() {
                 lo.reuse_address = true;
                 auto addr = make_ipv4_address(ipv4_addr{_listen_address.raw_addr(), _ssl_port});
                 return std::make_unique<rpc_protocol_server_wrapper>(*_rpc,
-                        seastar::tls::listen(_credentials, addr, lo));
+                        server_options(), seastar::tls::listen(_credentials, addr, lo));
         }());
     }
 }
@@ -250,6 +305,7 @@ void messaging_service::start_listen() {
 messaging_service::messaging_service(gms::inet_address ip
         , uint16_t port
         , encrypt_what ew
+        , compress_what cw
         , uint16_t ssl_port
         , std::shared_ptr<seastar::tls::credentials_builder> credentials
         , bool listen_now
@@ -258,6 +314,8 @@ messaging_service::messaging_service(gms::inet_address ip
     , _port(port)
     , _ssl_port(ssl_port)
     , _encrypt_what(ew)
+    , _compress_what(cw)
+    , _compressor_factory(std::make_unique<compressor_factory_wrapper>(_compression_stats))
     , _rpc(new rpc_protocol_wrapper(serializer { }))
     , _credentials(credentials ? credentials->build_server_credentials() : nullptr)
 {
@@ -280,6 +338,9 @@ messaging_service::messaging_service(gms::inet_address ip
             logger.info("Starting Encrypted Messaging Service on SSL port {}", _ssl_port);
         }
         logger.info("Starting Messaging Service on port {}", _port);
+        if (_compress_what != compress_what::none) {
+            logger.info("Compressing {} internode traffic", _compress_what == compress_what::all ? "all" : "inter-dc");
+        }
     }
 }
 
@@ -347,7 +408,10 @@ static unsigned get_rpc_client_idx(messaging_verb verb) {
                verb == messaging_verb::PREPARE_DONE_MESSAGE ||
                verb == messaging_verb::STREAM_MUTATION ||
                verb == messaging_verb::STREAM_MUTATION_DONE ||
-               verb == messaging_verb::COMPLETE_MESSAGE) {
+               verb == messaging_verb::COMPLETE_MESSAGE ||
+               verb == messaging_verb::REPAIR_ROW_HASHES ||
+               verb == messaging_verb::REPAIR_GET_ROWS ||
+               verb == messaging_verb::REPAIR_PUT_ROWS) {
         idx = 2;
     }
     return idx;
@@ -431,12 +495,29 @@ shared_ptr<messaging_service::rpc_protocol_client_wrapper> messaging_service::ge
                         != snitch_ptr->get_rack(utils::fb_utilities::get_broadcast_address());
     }();
 
+    auto must_compress = [&id, this] {
+        if (_compress_what == compress_what::none) {
+            return false;
+        }
+        if (_compress_what == compress_what::all) {
+            return true;
+        }
+
+        auto& snitch_ptr = locator::i_endpoint_snitch::get_local_snitch_ptr();
+
+        return snitch_ptr->get_datacenter(id.addr)
+                        != snitch_ptr->get_datacenter(utils::fb_utilities::get_broadcast_address());
+    }();
+
     auto remote_addr = ipv4_addr(get_preferred_ip(id.addr).raw_addr(), must_encrypt ? _ssl_port : _port);
     auto local_addr = ipv4_addr{_listen_address.raw_addr(), 0};
 
     rpc::client_options opts;
     // send keepalive messages each minute if connection is idle, drop connection after 10 failures
     opts.keepalive = std::experimental::optional<net::tcp_keepalive_params>({60s, 60s, 10});
+    if (must_compress) {
+        opts.compressor_factory = _compressor_factory.get();
+    }
 
     auto client = must_encrypt ?
                     ::make_shared<rpc_protocol_client_wrapper>(*_rpc, std::move(opts),
@@ -770,6 +851,16 @@ future<> messaging_service::send_mutation_done(msg_addr id, unsigned shard, resp
     return send_message_oneway(this, messaging_verb::MUTATION_DONE, std::move(id), std::move(shard), std::move(response_id));
 }
 
+void messaging_service::register_counter_mutation(std::function<future<> (const rpc::client_info&, std::vector<frozen_mutation> fms, db::consistency_level cl)>&& func) {
+    register_handler(this, net::messaging_verb::COUNTER_MUTATION, std::move(func));
+}
+void messaging_service::unregister_counter_mutation() {
+    _rpc->unregister_handler(net::messaging_verb::COUNTER_MUTATION);
+}
+future<> messaging_service::send_counter_mutation(msg_addr id, clock_type::time_point timeout, std::vector<frozen_mutation> fms, db::consistency_level cl) {
+    return send_message_timeout<void>(this, messaging_verb::COUNTER_MUTATION, std::move(id), timeout, std::move(fms), cl);
+}
+
 void messaging_service::register_read_data(std::function<future<foreign_ptr<lw_shared_ptr<query::result>>> (const rpc::client_info&, query::read_command cmd, query::partition_range pr)>&& func) {
     register_handler(this, net::messaging_verb::READ_DATA, std::move(func));
 }
@@ -848,18 +939,64 @@ future<> messaging_service::send_replication_finished(msg_addr id, inet_address
 // Wrapper for REPAIR_CHECKSUM_RANGE
 void messaging_service::register_repair_checksum_range(
         std::function<future<partition_checksum> (sstring keyspace,
-                sstring cf, query::range<dht::token> range)>&& f) {
+                sstring cf, query::range<dht::token> range, rpc::optional<repair_checksum> rt)>&& f) {
     register_handler(this, messaging_verb::REPAIR_CHECKSUM_RANGE, std::move(f));
 }
 void messaging_service::unregister_repair_checksum_range() {
     _rpc->unregister_handler(messaging_verb::REPAIR_CHECKSUM_RANGE);
 }
 future<partition_checksum> messaging_service::send_repair_checksum_range(
-        msg_addr id, sstring keyspace, sstring cf, ::range<dht::token> range)
+        msg_addr id, sstring keyspace, sstring cf, ::range<dht::token> range, repair_checksum rt)
 {
     return send_message<partition_checksum>(this,
             messaging_verb::REPAIR_CHECKSUM_RANGE, std::move(id),
-            std::move(keyspace), std::move(cf), std::move(range));
+            std::move(keyspace), std::move(cf), std::move(range), rt);
+}
+
+// Wrapper for REPAIR_ROW_HASHES
+void messaging_service::register_repair_row_hashes(
+        std::function<future<repair_row_hashes_page> (sstring keyspace,
+                sstring cf, query::range<dht::token> range, uint64_t max_rows)>&& f) {
+    register_handler(this, messaging_verb::REPAIR_ROW_HASHES, std::move(f));
+}
+void messaging_service::unregister_repair_row_hashes() {
+    _rpc->unregister_handler(messaging_verb::REPAIR_ROW_HASHES);
+}
+future<repair_row_hashes_page> messaging_service::send_repair_row_hashes(
+        msg_addr id, sstring keyspace, sstring cf, ::range<dht::token> range, uint64_t max_rows)
+{
+    return send_message<repair_row_hashes_page>(this,
+            messaging_verb::REPAIR_ROW_HASHES, std::move(id),
+            std::move(keyspace), std::move(cf), std::move(range), max_rows);
+}
+
+// Wrapper for REPAIR_GET_ROWS
+void messaging_service::register_repair_get_rows(
+        std::function<future<std::vector<frozen_mutation>> (sstring keyspace,
+                sstring cf, query::range<dht::token> range, std::vector<repair_row_id> ids)>&& f) {
+    register_handler(this, messaging_verb::REPAIR_GET_ROWS, std::move(f));
+}
+void messaging_service::unregister_repair_get_rows() {
+    _rpc->unregister_handler(messaging_verb::REPAIR_GET_ROWS);
+}
+future<std::vector<frozen_mutation>> messaging_service::send_repair_get_rows(
+        msg_addr id, sstring keyspace, sstring cf, ::range<dht::token> range, std::vector<repair_row_id> ids)
+{
+    return send_message<std::vector<frozen_mutation>>(this,
+            messaging_verb::REPAIR_GET_ROWS, std::move(id),
+            std::move(keyspace), std::move(cf), std::move(range), std::move(ids));
+}
+
+// Wrapper for REPAIR_PUT_ROWS
+void messaging_service::register_repair_put_rows(
+        std::function<future<> (const rpc::client_info& cinfo, std::vector<frozen_mutation> rows)>&& f) {
+    register_handler(this, messaging_verb::REPAIR_PUT_ROWS, std::move(f));
+}
+void messaging_service::unregister_repair_put_rows() {
+    _rpc->unregister_handler(messaging_verb::REPAIR_PUT_ROWS);
+}
+future<> messaging_service::send_repair_put_rows(msg_addr id, std::vector<frozen_mutation> rows) {
+    return send_message<void>(this, messaging_verb::REPAIR_PUT_ROWS, std::move(id), std::move(rows));
 }
 
 } // namespace net
@@ -30,6 +30,7 @@
 #include "query-request.hh"
 #include "mutation_query.hh"
 #include "range.hh"
+#include "db/consistency_level_type.hh"
 
 #include <seastar/net/tls.hh>
 
@@ -55,6 +56,10 @@ class seed_provider_type;
 class frozen_mutation;
 class frozen_schema;
 class partition_checksum;
+enum class repair_checksum : uint8_t;
+struct repair_row_hash;
+struct repair_row_hashes_page;
+using repair_row_id = std::array<uint64_t, 2>;
 
 namespace dht {
     class token;
@@ -97,7 +102,11 @@ enum class messaging_verb : int32_t {
     REPAIR_CHECKSUM_RANGE = 20,
     GET_SCHEMA_VERSION = 21,
     SCHEMA_CHECK = 22,
-    LAST = 23,
+    COUNTER_MUTATION = 23,
+    REPAIR_ROW_HASHES = 24,
+    REPAIR_GET_ROWS = 25,
+    REPAIR_PUT_ROWS = 26,
+    LAST = 27,
 };
 
 } // namespace net
@@ -132,6 +141,7 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     struct rpc_protocol_wrapper;
     struct rpc_protocol_client_wrapper;
     struct rpc_protocol_server_wrapper;
+    class compressor_factory_wrapper;
     struct shard_info;
 
     using msg_addr = net::msg_addr;
@@ -167,11 +177,33 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
         all,
     };
 
+    enum class compress_what {
+        none,
+        dc,
+        all,
+    };
+
+    // Bytes handled by the compressors of this shard's connections, both
+    // the ones we opened and the ones we accepted.
+    struct compression_stats {
+        uint64_t sent_uncompressed_bytes = 0;
+        uint64_t sent_compressed_bytes = 0;
+        uint64_t received_compressed_bytes = 0;
+        uint64_t received_uncompressed_bytes = 0;
+    };
+
+    const compression_stats& get_compression_stats() const {
+        return _compression_stats;
+    }
+
 private:
     gms::inet_address _listen_address;
     uint16_t _port;
     uint16_t _ssl_port;
     encrypt_what _encrypt_what;
+    compress_what _compress_what;
+    compression_stats _compression_stats;
+    std::unique_ptr<compressor_factory_wrapper> _compressor_factory;
     // map: Node broadcast address -> Node internal IP for communication within the same data center
     std::unordered_map<gms::inet_address, gms::inet_address> _preferred_ip_cache;
     std::unique_ptr<rpc_protocol_wrapper> _rpc;
@@ -186,7 +218,7 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
 public:
     messaging_service(gms::inet_address ip = gms::inet_address("0.0.0.0"),
             uint16_t port = 7000, bool listen_now = true);
-    messaging_service(gms::inet_address ip, uint16_t port, encrypt_what,
+    messaging_service(gms::inet_address ip, uint16_t port, encrypt_what, compress_what,
             uint16_t ssl_port, std::shared_ptr<seastar::tls::credentials_builder>,
             bool listen_now = true);
     ~messaging_service();
@@ -200,6 +232,7 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     future<> stop();
     static rpc::no_wait_type no_wait();
     bool is_stopping() { return _stopping; }
+    rpc::server_options server_options();
 public:
     gms::inet_address get_preferred_ip(gms::inet_address ep);
     future<> init_local_preferred_ip_cache();
@@ -226,9 +259,25 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     future<> send_complete_message(msg_addr id, UUID plan_id, unsigned dst_cpu_id);
 
     // Wrapper for REPAIR_CHECKSUM_RANGE verb
-    void register_repair_checksum_range(std::function<future<partition_checksum> (sstring keyspace, sstring cf, range<dht::token> range)>&& func);
+    // Nodes which predate repair_checksum do not send it, and expect legacy checksums.
+    void register_repair_checksum_range(std::function<future<partition_checksum> (sstring keyspace, sstring cf, range<dht::token> range, rpc::optional<repair_checksum> rt)>&& func);
     void unregister_repair_checksum_range();
-    future<partition_checksum> send_repair_checksum_range(msg_addr id, sstring keyspace, sstring cf, range<dht::token> range);
+    future<partition_checksum> send_repair_checksum_range(msg_addr id, sstring keyspace, sstring cf, range<dht::token> range, repair_checksum rt);
+
+    // Wrapper for REPAIR_ROW_HASHES verb
+    void register_repair_row_hashes(std::function<future<repair_row_hashes_page> (sstring keyspace, sstring cf, range<dht::token> range, uint64_t max_rows)>&& func);
+    void unregister_repair_row_hashes();
+    future<repair_row_hashes_page> send_repair_row_hashes(msg_addr id, sstring keyspace, sstring cf, range<dht::token> range, uint64_t max_rows);
+
+    // Wrapper for REPAIR_GET_ROWS verb
+    void register_repair_get_rows(std::function<future<std::vector<frozen_mutation>> (sstring keyspace, sstring cf, range<dht::token> range, std::vector<repair_row_id> ids)>&& func);
+    void unregister_repair_get_rows();
+    future<std::vector<frozen_mutation>> send_repair_get_rows(msg_addr id, sstring keyspace, sstring cf, range<dht::token> range, std::vector<repair_row_id> ids);
+
+    // Wrapper for REPAIR_PUT_ROWS verb
+    void register_repair_put_rows(std::function<future<> (const rpc::client_info& cinfo, std::vector<frozen_mutation> rows)>&& func);
+    void unregister_repair_put_rows();
+    future<> send_repair_put_rows(msg_addr id, std::vector<frozen_mutation> rows);
 
     // Wrapper for GOSSIP_ECHO verb
     void register_gossip_echo(std::function<future<> ()>&& func);
@@ -274,6 +323,11 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     future<> send_mutation(msg_addr id, clock_type::time_point timeout, const frozen_mutation& fm, std::vector<inet_address> forward,
         inet_address reply_to, unsigned shard, response_id_type response_id);
 
+    // Wrapper for COUNTER_MUTATION
+    void register_counter_mutation(std::function<future<> (const rpc::client_info&, std::vector<frozen_mutation> fms, db::consistency_level cl)>&& func);
+    void unregister_counter_mutation();
+    future<> send_counter_mutation(msg_addr id, clock_type::time_point timeout, std::vector<frozen_mutation> fms, db::consistency_level cl);
+
     // Wrapper for MUTATION_DONE
     void register_mutation_done(std::function<future<rpc::no_wait_type> (const rpc::client_info& cinfo, unsigned shard, response_id_type response_id)>&& func);
     void unregister_mutation_done();
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <algorithm>
+
+#include "utils/murmur_hash.hh"
+#include "hashing.hh"
+
+// Incremental version of utils::murmur_hash::hash3_x64_128(), giving the same
+// result for the same input no matter how it is split into update() calls.
+//
+// It is much faster than the cryptographic hashers, but must only be used
+// where nobody gains from crafting collisions, e.g. to compare replicas.
+class murmur3_hasher {
+    static constexpr uint64_t c1 = 0x87c37b91114253d5L;
+    static constexpr uint64_t c2 = 0x4cf5ad432745937fL;
+
+    uint64_t _h1;
+    uint64_t _h2;
+    uint64_t _length = 0;
+    // Input which does not fill a whole block yet. Signed, like the bytes
+    // fed to hash3_x64_128(bytes_view, ...).
+    std::array<int8_t, 16> _buf;
+    size_t _buffered = 0;
+private:
+    void process_block(const int8_t* in) {
+        uint64_t k1 = utils::murmur_hash::read_block(in);
+        uint64_t k2 = utils::murmur_hash::read_block(in);
+
+        k1 *= c1; k1 = utils::murmur_hash::rotl64(k1, 31); k1 *= c2; _h1 ^= k1;
+        _h1 = utils::murmur_hash::rotl64(_h1, 27); _h1 += _h2; _h1 = _h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = utils::murmur_hash::rotl64(k2, 33); k2 *= c1; _h2 ^= k2;
+        _h2 = utils::murmur_hash::rotl64(_h2, 31); _h2 += _h1; _h2 = _h2 * 5 + 0x38495ab5;
+    }
+public:
+    explicit murmur3_hasher(uint64_t seed = 0) : _h1(seed), _h2(seed) { }
+
+    void update(const char* ptr, size_t length) {
+        auto in = reinterpret_cast<const int8_t*>(ptr);
+        _length += length;
+        if (_buffered) {
+            auto n = std::min(length, _buf.size() - _buffered);
+            std::copy_n(in, n, _buf.begin() + _buffered);
+            _buffered += n;
+            in += n;
+            length -= n;
+            if (_buffered < _buf.size()) {
+                return;
+            }
+            process_block(_buf.data());
+            _buffered = 0;
+        }
+        while (length >= _buf.size()) {
+            process_block(in);
+            in += _buf.size();
+            length -= _buf.size();
+        }
+        std::copy_n(in, length, _buf.begin());
+        _buffered = length;
+    }
+
+    std::array<uint64_t, 2> finalize() {
+        uint64_t k1 = 0;
+        uint64_t k2 = 0;
+        auto& tmp = _buf;
+        switch (_buffered) {
+            case 15: k2 ^= ((uint64_t) tmp[14]) << 48;
+            case 14: k2 ^= ((uint64_t) tmp[13]) << 40;
+            case 13: k2 ^= ((uint64_t) tmp[12]) << 32;
+            case 12: k2 ^= ((uint64_t) tmp[11]) << 24;
+            case 11: k2 ^= ((uint64_t) tmp[10]) << 16;
+            case 10: k2 ^= ((uint64_t) tmp[9]) << 8;
+            case  9: k2 ^= ((uint64_t) tmp[8]) << 0;
+                k2 *= c2; k2 = utils::murmur_hash::rotl64(k2, 33); k2 *= c1; _h2 ^= k2;
+            case  8: k1 ^= ((uint64_t) tmp[7]) << 56;
+            case  7: k1 ^= ((uint64_t) tmp[6]) << 48;
+            case  6: k1 ^= ((uint64_t) tmp[5]) << 40;
+            case  5: k1 ^= ((uint64_t) tmp[4]) << 32;
+            case  4: k1 ^= ((uint64_t) tmp[3]) << 24;
+            case  3: k1 ^= ((uint64_t) tmp[2]) << 16;
+            case  2: k1 ^= ((uint64_t) tmp[1]) << 8;
+            case  1: k1 ^= ((uint64_t) tmp[0]);
+                k1 *= c1; k1 = utils::murmur_hash::rotl64(k1, 31); k1 *= c2; _h1 ^= k1;
+        };
+
+        // hash3_x64_128() takes a 32-bit length.
+        _h1 ^= uint32_t(_length);
+        _h2 ^= uint32_t(_length);
+
+        _h1 += _h2;
+        _h2 += _h1;
+
+        _h1 = utils::murmur_hash::fmix(_h1);
+        _h2 = utils::murmur_hash::fmix(_h2);
+
+        _h1 += _h2;
+        _h2 += _h1;
+
+        return { _h1, _h2 };
+    }
+};
@@ -217,9 +217,10 @@ future<mutation_opt> mutation_from_streamed_mutation(streamed_mutation_opt sm)
 {
     class rebuilder {
         mutation& _m;
+        bool _reversed;
         stdx::optional<range_tombstone_begin> _rt_in_progress;
     public:
-        rebuilder(mutation& m) : _m(m) { }
+        rebuilder(mutation& m, bool reversed) : _m(m), _reversed(reversed) { }
 
         stop_iteration consume(tombstone t) {
             _m.partition().apply(t);
@@ -239,10 +240,17 @@ future<mutation_opt> mutation_from_streamed_mutation(streamed_mutation_opt sm)
 
         stop_iteration consume(range_tombstone_end&& rte) {
             assert(_rt_in_progress);
-            auto rt = range_tombstone(std::move(_rt_in_progress->key()), _rt_in_progress->kind(),
-                                      std::move(rte.key()), rte.kind(),
-                                      _rt_in_progress->tomb());
-            _m.partition().apply_row_tombstone(*_m.schema(), std::move(rt));
+            if (_reversed) {
+                auto rt = range_tombstone(std::move(rte.key()), flip_bound_kind(rte.kind()),
+                                          std::move(_rt_in_progress->key()), flip_bound_kind(_rt_in_progress->kind()),
+                                          _rt_in_progress->tomb());
+                _m.partition().apply_row_tombstone(*_m.schema(), std::move(rt));
+            } else {
+                auto rt = range_tombstone(std::move(_rt_in_progress->key()), _rt_in_progress->kind(),
+                                          std::move(rte.key()), rte.kind(),
+                                          _rt_in_progress->tomb());
+                _m.partition().apply_row_tombstone(*_m.schema(), std::move(rt));
+            }
             _rt_in_progress = { };
             return stop_iteration::no;
         }
@@ -270,7 +278,7 @@ future<mutation_opt> mutation_from_streamed_mutation(streamed_mutation_opt sm)
     }
     mutation m(sm->decorated_key(), sm->schema());
     return do_with(data { std::move(m), std::move(*sm) }, [] (auto& d) {
-        return consume(d.sm, rebuilder(d.m)).then([&d] {
+        return consume(d.sm, rebuilder(d.m, d.sm.is_reversed())).then([&d] {
             return mutation_opt(std::move(d.m));
         });
     });
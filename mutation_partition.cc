@@ -32,6 +32,7 @@
 #include "mutation_query.hh"
 #include "service/priority_manager.hh"
 #include "mutation_compactor.hh"
+#include "counters.hh"
 
 template<bool reversed>
 struct reversal_traits;
@@ -574,6 +575,21 @@ void write_cell(RowWriter& w, const query::partition_slice& slice, ::atomic_cell
        .end_qr_cell();
 }
 
+template<typename RowWriter>
+void write_counter_cell(RowWriter& w, const query::partition_slice& slice, ::atomic_cell_view c) {
+    assert(c.is_live());
+    ser::writer_of_qr_cell wr = w.add().write();
+    [&, wr = std::move(wr)] () mutable {
+        if (slice.options.contains<query::partition_slice::option::send_timestamp>()) {
+            return std::move(wr).write_timestamp(c.timestamp());
+        } else {
+            return std::move(wr).skip_timestamp();
+        }
+    }().skip_expiry()
+       .write_value(serialize_counter_value(counter_cell_view(c).total_value()))
+       .end_qr_cell();
+}
+
 template<typename RowWriter>
 void write_cell(RowWriter& w, const query::partition_slice& slice, const data_type& type, collection_mutation_view v) {
     auto ctype = static_pointer_cast<const collection_type_impl>(type);
@@ -587,7 +603,7 @@ void write_cell(RowWriter& w, const query::partition_slice& slice, const data_ty
 }
 
 // returns the timestamp of a latest update to the row
-static api::timestamp_type hash_row_slice(md5_hasher& hasher,
+static api::timestamp_type hash_row_slice(query::digester& hasher,
     const schema& s,
     column_kind kind,
     const row& cells,
@@ -632,6 +648,8 @@ static void get_compacted_row_slice(const schema& s,
                 auto c = cell->as_atomic_cell();
                 if (!c.is_live()) {
                     writer.add().skip();
+                } else if (def.is_counter()) {
+                    write_counter_cell(writer, slice, cell->as_atomic_cell());
                 } else {
                     write_cell(writer, slice, cell->as_atomic_cell());
                 }
@@ -891,6 +909,10 @@ apply_reversibly(const column_definition& def, atomic_cell_or_collection& dst,
     // Must be run via with_linearized_managed_bytes() context, but assume it is
     // provided via an upper layer
     if (def.is_atomic()) {
+        if (def.is_counter()) {
+            counter_cell_view::apply_reversibly(dst, src);
+            return;
+        }
         auto&& src_ac = src.as_atomic_cell_ref();
         if (compare_atomic_cell_for_merge(dst.as_atomic_cell(), src.as_atomic_cell()) < 0) {
             std::swap(dst, src);
@@ -971,19 +993,6 @@ void row::for_each_cell(Func&& func, Rollback&& rollback) {
     }
 }
 
-template<typename Func>
-void row::for_each_cell(Func&& func) {
-    if (_type == storage_type::vector) {
-        for (auto i : bitsets::for_each_set(_storage.vector.present)) {
-            func(i, _storage.vector.v[i]);
-        }
-    } else {
-        for (auto& cell : _storage.set) {
-            func(cell.id(), cell.cell());
-        }
-    }
-}
-
 void
 row::apply_reversibly(const column_definition& column, atomic_cell_or_collection& value) {
     static_assert(std::is_nothrow_move_constructible<atomic_cell_or_collection>::value
@@ -1239,6 +1248,20 @@ bool mutation_partition::empty() const
     return !_static_row.size() && _rows.empty() && _row_tombstones.empty();
 }
 
+size_t mutation_partition::remove_rows(const schema& s, bound_view start, bound_view end)
+{
+    auto cmp = rows_entry::key_comparator(bound_view::compare(s));
+    auto first = _rows.lower_bound(start, cmp);
+    auto last = _rows.upper_bound(end, cmp);
+    size_t count = 0;
+    auto deleter = current_deleter<rows_entry>();
+    _rows.erase_and_dispose(first, last, [&] (rows_entry* e) {
+        ++count;
+        deleter(e);
+    });
+    return count;
+}
+
 bool
 deletable_row::is_live(const schema& s, tombstone base_tombstone, gc_clock::time_point query_time) const {
     // _created_at corresponds to the row marker cell, present for rows
@@ -1544,6 +1567,11 @@ row row::difference(const schema& s, column_kind kind, const row& other) const
             }
             if (it == other_range.end() || it->first != c.first) {
                 r.append_cell(c.first, c.second);
+            } else if (s.column_at(kind, c.first).is_counter()) {
+                auto diff = counter_cell_view::difference(c.second.as_atomic_cell(), it->second.as_atomic_cell());
+                if (diff) {
+                    r.append_cell(c.first, std::move(*diff));
+                }
             } else if (s.column_at(kind, c.first).is_atomic()) {
                 if (compare_atomic_cell_for_merge(c.second.as_atomic_cell(), it->second.as_atomic_cell()) > 0) {
                     r.append_cell(c.first, c.second);
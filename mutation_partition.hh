@@ -192,7 +192,17 @@ class row {
     // Calls Func(column_id, atomic_cell_or_collection&) for each cell in this row.
     // noexcept if Func doesn't throw.
     template<typename Func>
-    void for_each_cell(Func&&);
+    void for_each_cell(Func&& func) {
+        if (_type == storage_type::vector) {
+            for (auto i : bitsets::for_each_set(_storage.vector.present)) {
+                func(i, _storage.vector.v[i]);
+            }
+        } else {
+            for (auto& cell : _storage.set) {
+                func(cell.id(), cell.cell());
+            }
+        }
+    }
 
     template<typename Func>
     void for_each_cell(Func&& func) const {
@@ -671,6 +681,11 @@ class mutation_partition final {
 
     // Returns true if there is no live data or tombstones.
     bool empty() const;
+
+    // Removes clustering rows which fall between given bounds.
+    // Range tombstones are left untouched.
+    // Returns the number of removed rows.
+    size_t remove_rows(const schema& s, bound_view start, bound_view end);
 public:
     deletable_row& clustered_row(const clustering_key& key);
     deletable_row& clustered_row(clustering_key&& key);
@@ -681,6 +696,7 @@ class mutation_partition final {
     const row& static_row() const { return _static_row; }
     // return a set of rows_entry where each entry represents a CQL row sharing the same clustering key.
     const rows_type& clustered_rows() const { return _rows; }
+    rows_type& clustered_rows() { return _rows; }
     const range_tombstone_list& row_tombstones() const { return _row_tombstones; }
     const row* find_row(const clustering_key& key) const;
     tombstone range_tombstone_for_row(const schema& schema, const clustering_key& key) const;
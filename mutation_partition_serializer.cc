@@ -22,6 +22,7 @@
 
 #include "mutation_partition_serializer.hh"
 #include "mutation_partition.hh"
+#include "counters.hh"
 
 #include "utils/UUID.hh"
 #include "serializer.hh"
@@ -70,6 +71,24 @@ auto write_dead_cell(Writer&& writer, const atomic_cell& c)
                         .end_dead_cell();
 }
 
+template<typename Writer>
+auto write_counter_cell(Writer&& writer, atomic_cell_view c)
+{
+    auto value = std::move(writer).write_created_at(c.timestamp());
+    if (c.is_counter_update()) {
+        return std::move(value).start_value_counter_cell_update()
+                                   .write_delta(c.counter_update_value())
+                               .end_counter_cell_update()
+                           .end_counter_cell();
+    } else {
+        auto shards_writer = std::move(value).start_value_counter_cell_full().start_shards();
+        for (auto&& csv : counter_cell_view(c).shards()) {
+            shards_writer.add_shards(counter_shard(csv));
+        }
+        return std::move(shards_writer).end_shards().end_counter_cell_full().end_counter_cell();
+    }
+}
+
 template<typename Writer>
 auto write_collection_cell(Writer&& collection_writer, collection_mutation_view cmv, const column_definition& def)
 {
@@ -101,6 +120,8 @@ auto write_row_cells(Writer&& writer, const row& r, const schema& s, column_kind
             auto cell_writer = std::move(cell_or_collection_writer).start_c_variant();
             if (!c.is_live()) {
                 write_dead_cell(std::move(cell_writer).start_variant_dead_cell(), c).end_variant().end_column();
+            } else if (def.is_counter()) {
+                write_counter_cell(std::move(cell_writer).start_variant_counter_cell(), c).end_variant().end_column();
             } else if (c.is_live_and_has_ttl()) {
                 write_expiring_cell(std::move(cell_writer).start_variant_expiring_cell(), c).end_variant().end_column();
             } else {
@@ -27,6 +27,7 @@
 #include "utils/data_input.hh"
 #include "mutation_partition_serializer.hh"
 #include "mutation_partition.hh"
+#include "counters.hh"
 
 #include "utils/UUID.hh"
 #include "serializer.hh"
@@ -43,22 +44,52 @@ using namespace db;
 
 namespace {
 
+struct atomic_cell_visitor : boost::static_visitor<atomic_cell> {
+    atomic_cell operator()(ser::live_cell_view& lcv) const {
+        return atomic_cell::make_live(lcv.created_at(), lcv.value());
+    }
+    atomic_cell operator()(ser::expiring_cell_view& ecv) const {
+        return atomic_cell::make_live(ecv.c().created_at(), ecv.c().value(), ecv.expiry(), ecv.ttl());
+    }
+    atomic_cell operator()(ser::dead_cell_view& dcv) const {
+        return atomic_cell::make_dead(dcv.tomb().timestamp(), dcv.tomb().deletion_time());
+    }
+    atomic_cell operator()(ser::counter_cell_view& ccv) const {
+        struct counter_cell_visitor : boost::static_visitor<atomic_cell> {
+            api::timestamp_type _created_at;
+
+            explicit counter_cell_visitor(api::timestamp_type ts) : _created_at(ts) { }
+
+            atomic_cell operator()(ser::counter_cell_full_view& ccv) const {
+                auto shards = ccv.shards();
+                counter_cell_builder ccb(shards.size());
+                for (auto&& cs : shards) {
+                    ccb.add_shard(cs);
+                }
+                return ccb.build(_created_at);
+            }
+            atomic_cell operator()(ser::counter_cell_update_view& ccv) const {
+                return atomic_cell::make_live_counter_update(_created_at, ccv.delta());
+            }
+            atomic_cell operator()(ser::unknown_variant_type&) const {
+                throw std::runtime_error("Trying to deserialize counter cell in unknown state");
+            }
+        };
+        auto v = ccv.value();
+        return boost::apply_visitor(counter_cell_visitor(ccv.created_at()), v);
+    }
+    atomic_cell operator()(ser::unknown_variant_type&) const {
+        throw std::runtime_error("Trying to deserialize cell in unknown state");
+    }
+};
+
+atomic_cell read_atomic_cell(boost::variant<ser::live_cell_view, ser::expiring_cell_view, ser::dead_cell_view, ser::counter_cell_view, ser::unknown_variant_type> cv)
+{
+    return boost::apply_visitor(atomic_cell_visitor(), cv);
+}
+
 atomic_cell read_atomic_cell(boost::variant<ser::live_cell_view, ser::expiring_cell_view, ser::dead_cell_view, ser::unknown_variant_type> cv)
 {
-    struct atomic_cell_visitor : boost::static_visitor<atomic_cell> {
-        atomic_cell operator()(ser::live_cell_view& lcv) const {
-            return atomic_cell::make_live(lcv.created_at(), lcv.value());
-        }
-        atomic_cell operator()(ser::expiring_cell_view& ecv) const {
-            return atomic_cell::make_live(ecv.c().created_at(), ecv.c().value(), ecv.expiry(), ecv.ttl());
-        }
-        atomic_cell operator()(ser::dead_cell_view& dcv) const {
-            return atomic_cell::make_dead(dcv.tomb().timestamp(), dcv.tomb().deletion_time());
-        }
-        atomic_cell operator()(ser::unknown_variant_type&) const {
-            throw std::runtime_error("Trying to deserialize cell in unknown state");
-        }
-    };
     return boost::apply_visitor(atomic_cell_visitor(), cv);
 }
 
@@ -89,7 +120,7 @@ void read_and_visit_row(ser::row_view rv, const column_mapping& cm, column_kind
             explicit atomic_cell_or_collection_visitor(Visitor& v, column_id id, const column_mapping_entry& col)
                 : _visitor(v), _id(id), _col(col) { }
 
-            void operator()(boost::variant<ser::live_cell_view, ser::expiring_cell_view, ser::dead_cell_view, ser::unknown_variant_type>& acv) const {
+            void operator()(boost::variant<ser::live_cell_view, ser::expiring_cell_view, ser::dead_cell_view, ser::counter_cell_view, ser::unknown_variant_type>& acv) const {
                 if (!_col.type()->is_atomic()) {
                     throw std::runtime_error("A collection expected, got an atomic cell");
                 }
@@ -259,7 +259,7 @@ auto consume_flattened(mutation_reader mr, Consumer c, bool reverse_mutations =
                 if (!smopt) {
                     return make_ready_future<stop_iteration>(stop_iteration::yes);
                 }
-                if (!reverse_mutations) {
+                if (!reverse_mutations || smopt->is_reversed()) {
                     sm.emplace(std::move(*smopt));
                 } else {
                     sm.emplace(reverse_streamed_mutation(std::move(*smopt)));
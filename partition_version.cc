@@ -256,6 +256,14 @@ mutation_partition partition_entry::squashed(schema_ptr from, schema_ptr to)
     return mp;
 }
 
+mutation_partition* partition_entry::exclusive_partition()
+{
+    if (_snapshot || _version->next()) {
+        return nullptr;
+    }
+    return &_version->partition();
+}
+
 void partition_entry::upgrade(schema_ptr from, schema_ptr to)
 {
     auto new_version = current_allocator().construct<partition_version>(mutation_partition(to));
@@ -288,7 +296,7 @@ partition_snapshot_reader::partition_snapshot_reader(schema_ptr s, dht::decorate
     lw_shared_ptr<partition_snapshot> snp, query::clustering_key_filtering_context fc,
     const query::clustering_row_ranges& crr, logalloc::region& region,
     logalloc::allocating_section& read_section, boost::any pointer_to_container)
-    : streamed_mutation::impl(s, std::move(dk), tomb(*snp))
+    : streamed_mutation::impl(s, std::move(dk), tomb(*snp), fc.is_reversed())
     , _container_guard(std::move(pointer_to_container))
     , _filtering_context(fc)
     , _current_ck_range(crr.begin())
@@ -296,7 +304,7 @@ partition_snapshot_reader::partition_snapshot_reader(schema_ptr s, dht::decorate
     , _cmp(*s)
     , _eq(*s)
     , _snapshot(snp)
-    , _range_tombstones(*s)
+    , _range_tombstones(*s, fc.is_reversed())
     , _lsa_region(region)
     , _read_section(read_section)
 {
@@ -348,12 +356,15 @@ void partition_snapshot_reader::refresh_iterators()
     }
 
     for (auto&& v : _snapshot->versions()) {
-        auto cr_end = v.partition().upper_bound(*_schema, *_current_ck_range);
+        const mutation_partition& p = v.partition();
+        auto cr_end = is_reversed() ? p.lower_bound(*_schema, *_current_ck_range) : p.upper_bound(*_schema, *_current_ck_range);
         auto cr = [&] () -> mutation_partition::rows_type::const_iterator {
             if (_in_ck_range) {
-                return v.partition().clustered_rows().upper_bound(*_last_entry, _cmp);
+                return is_reversed() ? p.clustered_rows().lower_bound(*_last_entry, _cmp)
+                                     : p.clustered_rows().upper_bound(*_last_entry, _cmp);
             } else {
-                return v.partition().lower_bound(*_schema, *_current_ck_range);
+                return is_reversed() ? p.upper_bound(*_schema, *_current_ck_range)
+                                     : p.lower_bound(*_schema, *_current_ck_range);
             }
         }();
 
@@ -363,35 +374,35 @@ void partition_snapshot_reader::refresh_iterators()
     }
 
     _in_ck_range = true;
-    boost::range::make_heap(_clustering_rows, heap_compare(_cmp));
+    boost::range::make_heap(_clustering_rows, make_heap_compare());
 }
 
 void partition_snapshot_reader::pop_clustering_row()
 {
     auto& current = _clustering_rows.back();
-    current._position = std::next(current._position);
+    current._position = is_reversed() ? std::prev(current._position) : std::next(current._position);
     if (current._position == current._end) {
         _clustering_rows.pop_back();
     } else {
-        boost::range::push_heap(_clustering_rows, heap_compare(_cmp));
+        boost::range::push_heap(_clustering_rows, make_heap_compare());
     }
 }
 
 mutation_fragment_opt partition_snapshot_reader::read_next()
 {
     if (!_clustering_rows.empty()) {
-        auto mf = _range_tombstones.get_next(*_clustering_rows.front()._position);
+        auto mf = _range_tombstones.get_next(_clustering_rows.front().current(is_reversed()));
         if (mf) {
             return mf;
         }
 
-        boost::range::pop_heap(_clustering_rows, heap_compare(_cmp));
-        clustering_row result = *_clustering_rows.back()._position;
+        boost::range::pop_heap(_clustering_rows, make_heap_compare());
+        clustering_row result = _clustering_rows.back().current(is_reversed());
         pop_clustering_row();
-        while (!_clustering_rows.empty() && _eq(*_clustering_rows.front()._position, result)) {
-            boost::range::pop_heap(_clustering_rows, heap_compare(_cmp));
+        while (!_clustering_rows.empty() && _eq(_clustering_rows.front().current(is_reversed()), result)) {
+            boost::range::pop_heap(_clustering_rows, make_heap_compare());
             auto& current = _clustering_rows.back();
-            result.apply(*_schema, *current._position);
+            result.apply(*_schema, current.current(is_reversed()));
             pop_clustering_row();
         }
         _last_entry = result.position();
@@ -251,6 +251,11 @@ class partition_entry {
 
     mutation_partition squashed(schema_ptr from, schema_ptr to);
 
+    // Returns the partition of the only version of this entry if there are
+    // no snapshots of it, nullptr otherwise. Such partition can be modified
+    // in place, e.g. have some of its rows evicted, without affecting readers.
+    mutation_partition* exclusive_partition();
+
     // needs to be called with reclaiming disabled
     void upgrade(schema_ptr from, schema_ptr to);
 
@@ -266,17 +271,29 @@ inline partition_version_ref& partition_snapshot::version()
     }
 }
 
+// Reads a partition snapshot, in the reverse order if the filtering context
+// asks for it.
 class partition_snapshot_reader : public streamed_mutation::impl {
+    // When reading in the reverse order _position points just past the
+    // current row and moves towards _end, which is the first row to read.
     struct rows_position {
         mutation_partition::rows_type::const_iterator _position;
         mutation_partition::rows_type::const_iterator _end;
+
+        const rows_entry& current(bool reversed) const {
+            return reversed ? *std::prev(_position) : *_position;
+        }
     };
 
     class heap_compare {
         position_in_partition::less_compare& _cmp;
+        bool _reversed;
     public:
-        explicit heap_compare(position_in_partition::less_compare cmp) : _cmp(cmp) { }
+        heap_compare(position_in_partition::less_compare& cmp, bool reversed) : _cmp(cmp), _reversed(reversed) { }
         bool operator()(const rows_position& a, const rows_position& b) {
+            if (_reversed) {
+                return _cmp(a.current(true), b.current(true));
+            }
             return _cmp(*b._position, *a._position);
         }
     };
@@ -309,6 +326,9 @@ class partition_snapshot_reader : public streamed_mutation::impl {
 private:
     void refresh_iterators();
     void pop_clustering_row();
+    heap_compare make_heap_compare() {
+        return heap_compare(_cmp, is_reversed());
+    }
 
     mutation_fragment_opt read_static_row();
     mutation_fragment_opt read_next();
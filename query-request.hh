@@ -161,6 +161,15 @@ constexpr auto max_partitions = std::numeric_limits<uint32_t>::max();
 // per-partition row limit. No options or columns are set.
 extern const query::partition_slice full_slice;
 
+// How result digests are calculated. Replicas can only compare digests which
+// were calculated the same way, so the coordinator picks an algorithm which
+// all of them support.
+enum class digest_algorithm : uint8_t {
+    MD5 = 0,
+    // 128-bit murmur3, much faster than MD5.
+    murmur3 = 1,
+};
+
 // Full specification of a query to the database.
 // Intended for passing across replicas.
 // Can be accessed across cores.
@@ -174,7 +183,27 @@ class read_command {
     std::experimental::optional<tracing::trace_info> trace_info;
     api::timestamp_type read_timestamp; // not serialized
     uint32_t partition_limit;
+    digest_algorithm digest_algo = digest_algorithm::MD5;
 public:
+    // Takes the serialized members, in the order of the IDL.
+    read_command(utils::UUID cf_id,
+                 table_schema_version schema_version,
+                 partition_slice slice,
+                 uint32_t row_limit,
+                 gc_clock::time_point now,
+                 std::experimental::optional<tracing::trace_info> ti,
+                 uint32_t partition_limit,
+                 digest_algorithm digest_algo)
+        : cf_id(std::move(cf_id))
+        , schema_version(std::move(schema_version))
+        , slice(std::move(slice))
+        , row_limit(row_limit)
+        , timestamp(now)
+        , trace_info(ti)
+        , read_timestamp(api::missing_timestamp)
+        , partition_limit(partition_limit)
+        , digest_algo(digest_algo)
+    { }
     read_command(utils::UUID cf_id,
                  table_schema_version schema_version,
                  partition_slice slice,
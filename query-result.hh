@@ -26,6 +26,7 @@
 #include "bytes_ostream.hh"
 #include "query-request.hh"
 #include "md5_hasher.hh"
+#include "murmur3_hasher.hh"
 #include <experimental/optional>
 
 namespace stdx = std::experimental;
@@ -56,6 +57,37 @@ class result_digest {
     }
 };
 
+// Calculates result digests with a given digest_algorithm.
+class digester {
+    stdx::optional<md5_hasher> _md5;
+    murmur3_hasher _murmur3;
+public:
+    explicit digester(digest_algorithm algo) {
+        if (algo == digest_algorithm::MD5) {
+            _md5.emplace();
+        }
+    }
+
+    void update(const char* ptr, size_t length) {
+        if (_md5) {
+            _md5->update(ptr, length);
+        } else {
+            _murmur3.update(ptr, length);
+        }
+    }
+
+    result_digest::type finalize_array() {
+        if (_md5) {
+            return _md5->finalize_array();
+        }
+        auto hash = _murmur3.finalize();
+        static_assert(sizeof(hash) == std::tuple_size<result_digest::type>::value, "digest size");
+        result_digest::type digest;
+        std::copy_n(reinterpret_cast<const uint8_t*>(hash.data()), sizeof(hash), digest.begin());
+        return digest;
+    }
+};
+
 //
 // The query results are stored in a serialized form. This is in order to
 // address the following problems, which a structured format has:
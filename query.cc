@@ -60,7 +60,8 @@ std::ostream& operator<<(std::ostream& out, const read_command& r) {
         << ", slice=" << r.slice << ""
         << ", limit=" << r.row_limit
         << ", timestamp=" << r.timestamp.time_since_epoch().count() << "}"
-        << ", partition_limit=" << r.partition_limit << "}";
+        << ", partition_limit=" << r.partition_limit
+        << ", digest_algo=" << unsigned(r.digest_algo) << "}";
 }
 
 std::ostream& operator<<(std::ostream& out, const specific_ranges& s) {
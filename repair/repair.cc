@@ -26,15 +26,24 @@
 #include "gms/inet_address.hh"
 #include "db/config.hh"
 #include "service/storage_service.hh"
+#include "service/storage_proxy.hh"
+#include "service/migration_manager.hh"
 #include "service/priority_manager.hh"
+#include "sstables/sstables.hh"
+#include "repair_concurrency.hh"
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
 
+#include <unordered_set>
+
 #include <cryptopp/sha.h>
 #include <seastar/core/gate.hh>
 
+#include "murmur3_hasher.hh"
+#include "atomic_cell_hash.hh"
+
 static logging::logger logger("repair");
 
 template <typename T1, typename T2>
@@ -270,6 +279,83 @@ partition_checksum::partition_checksum(const mutation& m) {
     h.finalize(_digest);
 }
 
+// Feeds the fragments of a partition to a hasher as they are read, so that
+// the partition never has to be in memory as a whole.
+template<typename Hasher>
+class fragment_hasher {
+    const schema& _s;
+    Hasher& _h;
+private:
+    void consume_cells(column_kind kind, const row& cells) {
+        cells.for_each_cell([&] (column_id id, const atomic_cell_or_collection& cell) {
+            auto&& col = _s.column_at(kind, id);
+            feed_hash(_h, col.name());
+            feed_hash(_h, col.type->name());
+            if (col.is_atomic()) {
+                feed_hash(_h, cell.as_atomic_cell());
+            } else {
+                feed_hash(_h, cell.as_collection_mutation());
+            }
+        });
+    }
+public:
+    fragment_hasher(const schema& s, Hasher& h) : _s(s), _h(h) { }
+
+    stop_iteration consume(tombstone t) {
+        feed_hash(_h, t);
+        return stop_iteration::no;
+    }
+    stop_iteration consume(static_row&& sr) {
+        feed_hash(_h, uint8_t(mutation_fragment::kind::static_row));
+        consume_cells(column_kind::static_column, sr.cells());
+        return stop_iteration::no;
+    }
+    stop_iteration consume(clustering_row&& cr) {
+        feed_hash(_h, uint8_t(mutation_fragment::kind::clustering_row));
+        cr.key().feed_hash(_h, _s);
+        feed_hash(_h, cr.tomb());
+        feed_hash(_h, cr.marker());
+        consume_cells(column_kind::regular_column, cr.cells());
+        return stop_iteration::no;
+    }
+    stop_iteration consume(range_tombstone_begin&& rtb) {
+        feed_hash(_h, uint8_t(mutation_fragment::kind::range_tombstone_begin));
+        rtb.key().feed_hash(_h, _s);
+        feed_hash(_h, rtb.kind());
+        feed_hash(_h, rtb.tomb());
+        return stop_iteration::no;
+    }
+    stop_iteration consume(range_tombstone_end&& rte) {
+        feed_hash(_h, uint8_t(mutation_fragment::kind::range_tombstone_end));
+        rte.key().feed_hash(_h, _s);
+        feed_hash(_h, rte.kind());
+        return stop_iteration::no;
+    }
+    void consume_end_of_stream() { }
+};
+
+future<partition_checksum> partition_checksum::compute(streamed_mutation m, repair_checksum rt) {
+    switch (rt) {
+    case repair_checksum::legacy:
+        return mutation_from_streamed_mutation(std::move(m)).then([] (auto mopt) {
+            assert(mopt);
+            return partition_checksum(*mopt);
+        });
+    case repair_checksum::streamed:
+        return do_with(std::move(m), murmur3_hasher(), [] (auto& m, auto& h) {
+            auto& s = *m.schema();
+            m.key().feed_hash(h, s);
+            return consume(m, fragment_hasher<murmur3_hasher>(s, h)).then([&h] {
+                auto hash = h.finalize();
+                std::array<uint8_t, 32> digest{};
+                std::copy_n(reinterpret_cast<const uint8_t*>(hash.data()), sizeof(hash), digest.begin());
+                return partition_checksum(digest);
+            });
+        });
+    }
+    throw std::runtime_error(sprint("unknown repair checksum type %d", int(rt)));
+}
+
 static inline unaligned<uint64_t>& qword(std::array<uint8_t, 32>& b, int n) {
     return *unaligned_cast<uint64_t>(b.data() + 8 * n);
 }
@@ -317,32 +403,27 @@ std::ostream& operator<<(std::ostream& out, const partition_checksum& c) {
 // so it would be useful to have this code cache its stopping point or have
 // some object live throughout the operation. Moreover, it makes sense to to
 // vary the collection of sstables used throught a long repair.
-// FIXME: cf.make_reader() puts all read partitions in the cache. This might
-// not be a good idea (see issue #382). Perhaps it is better to read the
-// sstables directly (as compaction does) - after flushing memtables first
-// (there might be old data in memtables which isn't flushed because no new
-// data is coming in).
+// The data is read bypassing the cache, so that repair does not evict the
+// working set of queries (see issue #382).
 static future<partition_checksum> checksum_range_shard(database &db,
         const sstring& keyspace_name, const sstring& cf_name,
-        const ::range<dht::token>& range) {
+        const ::range<dht::token>& range, repair_checksum rt) {
     auto& cf = db.find_column_family(keyspace_name, cf_name);
-    return do_with(query::to_partition_range(range), [&cf] (const auto& partition_range) {
-        auto reader = cf.make_reader(cf.schema(),
-                                     partition_range,
-                                     query::no_clustering_key_filtering,
-                                     service::get_local_streaming_read_priority());
+    return do_with(query::to_partition_range(range), [&cf, rt] (const auto& partition_range) {
+        auto reader = cf.make_streaming_reader(cf.schema(),
+                                               partition_range,
+                                               service::get_local_streaming_read_priority());
         return do_with(std::move(reader), partition_checksum(),
-            [] (auto& reader, auto& checksum) {
-            return repeat([&reader, &checksum] () {
-                return reader().then([] (auto sm) {
-                    return mutation_from_streamed_mutation(std::move(sm));
-                }).then([&checksum] (auto mopt) {
-                    if (mopt) {
-                        checksum.add(partition_checksum(*mopt));
-                        return stop_iteration::no;
-                    } else {
-                        return stop_iteration::yes;
+            [rt] (auto& reader, auto& checksum) {
+            return repeat([&reader, &checksum, rt] () {
+                return reader().then([&checksum, rt] (auto sm) {
+                    if (!sm) {
+                        return make_ready_future<stop_iteration>(stop_iteration::yes);
                     }
+                    return partition_checksum::compute(std::move(*sm), rt).then([&checksum] (partition_checksum pc) {
+                        checksum.add(pc);
+                        return stop_iteration::no;
+                    });
                 });
             }).then([&checksum] {
                 return checksum;
@@ -351,6 +432,15 @@ static future<partition_checksum> checksum_range_shard(database &db,
     });
 }
 
+// The shards [first, second) which hold data in the given token range.
+static std::pair<unsigned, unsigned> shards_of(const ::range<dht::token>& range) {
+    unsigned shard_begin = range.start() ?
+            dht::shard_of(range.start()->value()) : 0;
+    unsigned shard_end = range.end() ?
+            dht::shard_of(range.end()->value())+1 : smp::count;
+    return std::make_pair(shard_begin, shard_end);
+}
+
 // Calculate the checksum of the data held on all shards of a column family,
 // in the given token range.
 // In practice, we only need to consider one or two shards which intersect the
@@ -364,17 +454,15 @@ static future<partition_checksum> checksum_range_shard(database &db,
 // function is not resolved.
 future<partition_checksum> checksum_range(seastar::sharded<database> &db,
         const sstring& keyspace, const sstring& cf,
-        const ::range<dht::token>& range) {
-    unsigned shard_begin = range.start() ?
-            dht::shard_of(range.start()->value()) : 0;
-    unsigned shard_end = range.end() ?
-            dht::shard_of(range.end()->value())+1 : smp::count;
-    return do_with(partition_checksum(), [shard_begin, shard_end, &db, &keyspace, &cf, &range] (auto& result) {
+        const ::range<dht::token>& range, repair_checksum rt) {
+    unsigned shard_begin, shard_end;
+    std::tie(shard_begin, shard_end) = shards_of(range);
+    return do_with(partition_checksum(), [shard_begin, shard_end, &db, &keyspace, &cf, &range, rt] (auto& result) {
         return parallel_for_each(boost::counting_iterator<int>(shard_begin),
                 boost::counting_iterator<int>(shard_end),
-                [&db, &keyspace, &cf, &range, &result] (unsigned shard) {
-            return db.invoke_on(shard, [&keyspace, &cf, &range] (database& db) {
-                return checksum_range_shard(db, keyspace, cf, range);
+                [&db, &keyspace, &cf, &range, &result, rt] (unsigned shard) {
+            return db.invoke_on(shard, [&keyspace, &cf, &range, rt] (database& db) {
+                return checksum_range_shard(db, keyspace, cf, range, rt);
             }).then([&result] (partition_checksum sum) {
                 result.add(sum);
             });
@@ -384,6 +472,316 @@ future<partition_checksum> checksum_range(seastar::sharded<database> &db,
     });
 }
 
+enum class repair_row_kind : uint8_t {
+    // The partition tombstone and range tombstones.
+    partition = 0,
+    static_row = 1,
+    clustering_row = 2,
+};
+
+static repair_row_id row_id(const schema& s, const partition_key& pk,
+        repair_row_kind kind, const clustering_key* ck = nullptr) {
+    murmur3_hasher h;
+    pk.feed_hash(h, s);
+    feed_hash(h, uint8_t(kind));
+    if (ck) {
+        ck->feed_hash(h, s);
+    }
+    return h.finalize();
+}
+
+// Hashes every row of a partition separately, see repair_row_hash. Stops
+// once more than max_hashes hashes have been collected.
+class row_hasher {
+    const schema& _s;
+    const partition_key& _pk;
+    std::vector<repair_row_hash>& _hashes;
+    size_t _max_hashes;
+    // The partition-level data is spread over the partition, so it is hashed
+    // as it comes and added when the partition ends.
+    murmur3_hasher _partition;
+    bool _has_partition_data = false;
+private:
+    template<typename Fragment>
+    void add_row(repair_row_id id, Fragment&& f) {
+        murmur3_hasher h;
+        fragment_hasher<murmur3_hasher>(_s, h).consume(std::move(f));
+        _hashes.push_back(repair_row_hash{id, h.finalize()});
+    }
+public:
+    row_hasher(const schema& s, const partition_key& pk, std::vector<repair_row_hash>& hashes, size_t max_hashes)
+        : _s(s), _pk(pk), _hashes(hashes), _max_hashes(max_hashes) { }
+
+    stop_iteration consume(tombstone t) {
+        if (t) {
+            fragment_hasher<murmur3_hasher>(_s, _partition).consume(t);
+            _has_partition_data = true;
+        }
+        return stop_iteration::no;
+    }
+    stop_iteration consume(static_row&& sr) {
+        add_row(row_id(_s, _pk, repair_row_kind::static_row), std::move(sr));
+        return stop_iteration(_hashes.size() > _max_hashes);
+    }
+    stop_iteration consume(clustering_row&& cr) {
+        auto id = row_id(_s, _pk, repair_row_kind::clustering_row, &cr.key());
+        add_row(id, std::move(cr));
+        return stop_iteration(_hashes.size() > _max_hashes);
+    }
+    stop_iteration consume(range_tombstone_begin&& rtb) {
+        fragment_hasher<murmur3_hasher>(_s, _partition).consume(std::move(rtb));
+        _has_partition_data = true;
+        return stop_iteration::no;
+    }
+    stop_iteration consume(range_tombstone_end&& rte) {
+        fragment_hasher<murmur3_hasher>(_s, _partition).consume(std::move(rte));
+        return stop_iteration::no;
+    }
+    void consume_end_of_stream() {
+        if (_has_partition_data) {
+            _hashes.push_back(repair_row_hash{row_id(_s, _pk, repair_row_kind::partition), _partition.finalize()});
+        }
+    }
+};
+
+// Rebuilds the rows of a partition which have one of the given ids.
+class row_collector {
+    const schema& _s;
+    const std::unordered_set<repair_row_id, repair_row_id_hash>& _ids;
+    mutation& _m;
+    bool _partition_wanted;
+    stdx::optional<range_tombstone_begin> _rt_in_progress;
+private:
+    bool wanted(repair_row_kind kind, const clustering_key* ck = nullptr) const {
+        return _ids.count(row_id(_s, _m.key(), kind, ck));
+    }
+public:
+    row_collector(const schema& s, const std::unordered_set<repair_row_id, repair_row_id_hash>& ids, mutation& m)
+        : _s(s), _ids(ids), _m(m), _partition_wanted(wanted(repair_row_kind::partition)) { }
+
+    stop_iteration consume(tombstone t) {
+        if (_partition_wanted) {
+            _m.partition().apply(t);
+        }
+        return stop_iteration::no;
+    }
+    stop_iteration consume(static_row&& sr) {
+        if (wanted(repair_row_kind::static_row)) {
+            _m.partition().static_row().apply(_s, column_kind::static_column, std::move(sr.cells()));
+        }
+        return stop_iteration::no;
+    }
+    stop_iteration consume(clustering_row&& cr) {
+        if (wanted(repair_row_kind::clustering_row, &cr.key())) {
+            auto& dr = _m.partition().clustered_row(std::move(cr.key()));
+            dr.apply(cr.tomb());
+            dr.apply(cr.marker());
+            dr.cells().apply(_s, column_kind::regular_column, std::move(cr.cells()));
+        }
+        return stop_iteration::no;
+    }
+    stop_iteration consume(range_tombstone_begin&& rtb) {
+        if (_partition_wanted) {
+            _rt_in_progress = std::move(rtb);
+        }
+        return stop_iteration::no;
+    }
+    stop_iteration consume(range_tombstone_end&& rte) {
+        if (_partition_wanted) {
+            auto rt = range_tombstone(std::move(_rt_in_progress->key()), _rt_in_progress->kind(),
+                                      std::move(rte.key()), rte.kind(),
+                                      _rt_in_progress->tomb());
+            _m.partition().apply_row_tombstone(_s, std::move(rt));
+            _rt_in_progress = { };
+        }
+        return stop_iteration::no;
+    }
+    void consume_end_of_stream() { }
+};
+
+// Builds a repair_row_hashes_page. The page is checked against its size as
+// rows are hashed, so at most one row over it is held. When a token does
+// not fit, the page is cut back to the end of the previous one.
+class row_hashes_page_builder {
+    size_t _max_rows;
+    // Rows hashed on the shards before this one.
+    size_t _rows_before;
+    repair_row_hashes_page _page;
+    // The last token known to be complete, and the number of hashes up to
+    // its end.
+    stdx::optional<dht::token> _complete_token;
+    size_t _complete_rows = 0;
+public:
+    row_hashes_page_builder(size_t max_rows, size_t rows_before, stdx::optional<dht::token> last_token)
+        : _max_rows(max_rows), _rows_before(rows_before) {
+        _page.last_token = std::move(last_token);
+    }
+    // Returns false if the page is full and the partition is not part of it.
+    bool start_partition(const dht::token& t) {
+        if (!_page.last_token || *_page.last_token != t) {
+            if (_rows_before + _page.hashes.size() >= _max_rows) {
+                _page.complete = false;
+                return false;
+            }
+            _complete_token = _page.last_token;
+            _complete_rows = _page.hashes.size();
+            _page.last_token = t;
+        }
+        return true;
+    }
+    std::vector<repair_row_hash>& hashes() {
+        return _page.hashes;
+    }
+    size_t max_hashes() const {
+        return _max_rows - std::min(_max_rows, _rows_before);
+    }
+    bool over_limit() const {
+        return _rows_before + _page.hashes.size() > _max_rows;
+    }
+    // Ends the page before the current token, which does not fit in it.
+    void end_before_current_token() {
+        _page.complete = false;
+        if (_complete_token) {
+            _page.hashes.erase(_page.hashes.begin() + _complete_rows, _page.hashes.end());
+            _page.last_token = _complete_token;
+        } else {
+            _page.hashes.clear();
+            _page.overflow = true;
+        }
+    }
+    repair_row_hashes_page finish() {
+        return std::move(_page);
+    }
+};
+
+// Hashes the rows of this shard in the given range, into a page of which
+// rows_before rows, up to last_token, were hashed on other shards.
+static future<repair_row_hashes_page> repair_row_hashes_shard(database& db,
+        const sstring& keyspace_name, const sstring& cf_name,
+        const ::range<dht::token>& range, size_t max_rows,
+        size_t rows_before, stdx::optional<dht::token> last_token) {
+    auto& cf = db.find_column_family(keyspace_name, cf_name);
+    return do_with(query::to_partition_range(range), [&cf, max_rows, rows_before, last_token] (const auto& partition_range) {
+        auto reader = cf.make_streaming_reader(cf.schema(),
+                                               partition_range,
+                                               service::get_local_streaming_read_priority());
+        return do_with(std::move(reader), row_hashes_page_builder(max_rows, rows_before, last_token),
+            [] (auto& reader, auto& page) {
+            return repeat([&reader, &page] () {
+                return reader().then([&page] (auto sm) {
+                    if (!sm || !page.start_partition(sm->decorated_key().token())) {
+                        return make_ready_future<stop_iteration>(stop_iteration::yes);
+                    }
+                    return do_with(std::move(*sm), [&page] (auto& m) {
+                        return consume(m, row_hasher(*m.schema(), m.key(), page.hashes(), page.max_hashes()));
+                    }).then([&page] {
+                        if (page.over_limit()) {
+                            page.end_before_current_token();
+                            return stop_iteration::yes;
+                        }
+                        return stop_iteration::no;
+                    });
+                });
+            }).then([&page] {
+                return page.finish();
+            });
+        });
+    });
+}
+
+// Shards hold consecutive token ranges, so they are read one after another
+// until the page is full, which keeps the page in token order.
+future<repair_row_hashes_page> repair_row_hashes(seastar::sharded<database>& db,
+        const sstring& keyspace, const sstring& cf,
+        const ::range<dht::token>& range, size_t max_rows) {
+    unsigned shard_begin, shard_end;
+    std::tie(shard_begin, shard_end) = shards_of(range);
+    return do_with(repair_row_hashes_page(), shard_begin, [shard_end, &db, &keyspace, &cf, &range, max_rows] (auto& result, unsigned& shard) {
+        return repeat([shard_end, &db, &keyspace, &cf, &range, max_rows, &result, &shard] {
+            if (shard == shard_end) {
+                return make_ready_future<stop_iteration>(stop_iteration::yes);
+            }
+            auto rows_before = result.hashes.size();
+            auto last_token = result.last_token;
+            return db.invoke_on(shard++, [&keyspace, &cf, &range, max_rows, rows_before, last_token] (database& db) {
+                return repair_row_hashes_shard(db, keyspace, cf, range, max_rows, rows_before, last_token);
+            }).then([&result] (repair_row_hashes_page page) {
+                result.hashes.insert(result.hashes.end(), page.hashes.begin(), page.hashes.end());
+                result.last_token = std::move(page.last_token);
+                result.complete = page.complete;
+                result.overflow = page.overflow;
+                return stop_iteration(!result.complete);
+            });
+        }).then([&result] {
+            return std::move(result);
+        });
+    });
+}
+
+static future<std::vector<frozen_mutation>> repair_get_rows_shard(database& db,
+        const sstring& keyspace_name, const sstring& cf_name,
+        const ::range<dht::token>& range,
+        const std::unordered_set<repair_row_id, repair_row_id_hash>& ids) {
+    auto& cf = db.find_column_family(keyspace_name, cf_name);
+    return do_with(query::to_partition_range(range), [&cf, &ids] (const auto& partition_range) {
+        auto reader = cf.make_streaming_reader(cf.schema(),
+                                               partition_range,
+                                               service::get_local_streaming_read_priority());
+        return do_with(std::move(reader), std::vector<frozen_mutation>(),
+            [&ids] (auto& reader, auto& rows) {
+            return repeat([&reader, &rows, &ids] () {
+                return reader().then([&rows, &ids] (auto sm) {
+                    if (!sm) {
+                        return make_ready_future<stop_iteration>(stop_iteration::yes);
+                    }
+                    mutation m(sm->decorated_key(), sm->schema());
+                    return do_with(std::move(*sm), std::move(m), [&rows, &ids] (auto& sm, auto& m) {
+                        return consume(sm, row_collector(*m.schema(), ids, m)).then([&rows, &m] {
+                            if (!m.partition().empty()) {
+                                rows.push_back(freeze(m));
+                            }
+                            return stop_iteration::no;
+                        });
+                    });
+                });
+            }).then([&rows] {
+                return std::move(rows);
+            });
+        });
+    });
+}
+
+future<std::vector<frozen_mutation>> repair_get_rows(seastar::sharded<database>& db,
+        const sstring& keyspace, const sstring& cf,
+        const ::range<dht::token>& range, const std::vector<repair_row_id>& ids) {
+    unsigned shard_begin, shard_end;
+    std::tie(shard_begin, shard_end) = shards_of(range);
+    return do_with(std::unordered_set<repair_row_id, repair_row_id_hash>(ids.begin(), ids.end()), std::vector<frozen_mutation>(),
+            [shard_begin, shard_end, &db, &keyspace, &cf, &range] (const auto& wanted, auto& result) {
+        return parallel_for_each(boost::counting_iterator<int>(shard_begin),
+                boost::counting_iterator<int>(shard_end),
+                [&db, &keyspace, &cf, &range, &wanted, &result] (unsigned shard) {
+            return db.invoke_on(shard, [&keyspace, &cf, &range, &wanted] (database& db) {
+                return repair_get_rows_shard(db, keyspace, cf, range, wanted);
+            }).then([&result] (std::vector<frozen_mutation> rows) {
+                std::move(rows.begin(), rows.end(), std::back_inserter(result));
+            });
+        }).then([&result] {
+            return std::move(result);
+        });
+    });
+}
+
+future<> repair_put_rows(std::vector<frozen_mutation> rows, gms::inet_address from) {
+    return do_with(std::move(rows), [from] (const auto& rows) {
+        return parallel_for_each(rows, [from] (const frozen_mutation& fm) {
+            return service::get_schema_for_write(fm.schema_version(), net::msg_addr{from, 0}).then([&fm] (schema_ptr s) {
+                return service::get_local_storage_proxy().mutate_locally(s, fm);
+            });
+        });
+    });
+}
+
 static future<> sync_range(seastar::sharded<database>& db,
         const sstring& keyspace, const sstring& cf,
         const ::range<dht::token>& range,
@@ -404,6 +802,136 @@ static future<> sync_range(seastar::sharded<database>& db,
         });
     });
 }
+// Row hashes are exchanged a page at a time, so that neither the hashes nor
+// the differing rows of a range are ever all held in memory.
+constexpr size_t row_level_repair_page_rows = 10000;
+
+// Repair a page of a range row by row, given the hashes of its rows on this
+// node: the neighbors hash the rows in the page's range, and only the rows
+// whose hashes are missing or different on some node are transferred. Like
+// sync_range(), the rows are first collected from all neighbors, then the
+// merged rows are sent back to them.
+// Pages in which many rows differ, or which hold more rows than a page may
+// on some neighbor, are left to sync_range(), as streaming them is cheaper
+// than sending them row by row.
+static future<> repair_rows_page(seastar::sharded<database>& db,
+        const sstring& keyspace, const sstring& cf,
+        const ::range<dht::token>& range,
+        std::vector<gms::inet_address>& neighbors,
+        const std::vector<repair_row_hash>& local_hashes) {
+    // pages[i] are the hashes of neighbors[i].
+    return do_with(std::vector<repair_row_hashes_page>(neighbors.size()),
+            [&db, &keyspace, &cf, &range, &neighbors, &local_hashes] (auto& pages) {
+        return parallel_for_each(boost::counting_iterator<size_t>(0),
+                boost::counting_iterator<size_t>(neighbors.size()),
+                [&keyspace, &cf, &range, &neighbors, &pages] (size_t i) {
+            return net::get_local_messaging_service().send_repair_row_hashes(
+                    net::msg_addr{neighbors[i]}, keyspace, cf, range, row_level_repair_page_rows).then([&pages, i] (repair_row_hashes_page page) {
+                pages[i] = std::move(page);
+            });
+        }).then([&db, &keyspace, &cf, &range, &neighbors, &local_hashes, &pages] {
+            for (unsigned i = 0; i < neighbors.size(); i++) {
+                if (!pages[i].complete) {
+                    logger.debug("Range {} holds too many rows on {} to be repaired row by row", range, neighbors[i]);
+                    return sync_range(db, keyspace, cf, range, neighbors);
+                }
+            }
+            std::unordered_map<repair_row_id, std::array<uint64_t, 2>, repair_row_id_hash> local;
+            for (auto&& rh : local_hashes) {
+                local.emplace(rh.id, rh.hash);
+            }
+            size_t rows = local_hashes.size();
+            // The rows which are not the same on all nodes, and for each
+            // neighbor, the ones it has which are not the same here.
+            std::unordered_set<repair_row_id, repair_row_id_hash> differing;
+            std::vector<std::vector<repair_row_id>> to_fetch(neighbors.size());
+            for (unsigned i = 0; i < neighbors.size(); i++) {
+                std::unordered_set<repair_row_id, repair_row_id_hash> seen;
+                for (auto&& rh : pages[i].hashes) {
+                    seen.insert(rh.id);
+                    auto it = local.find(rh.id);
+                    if (it == local.end() || it->second != rh.hash) {
+                        to_fetch[i].push_back(rh.id);
+                        differing.insert(rh.id);
+                    }
+                }
+                for (auto&& e : local) {
+                    if (!seen.count(e.first)) {
+                        differing.insert(e.first);
+                    }
+                }
+                rows = std::max(rows, pages[i].hashes.size());
+            }
+            logger.debug("{} of {} rows of range {} differ", differing.size(), rows, range);
+            if (differing.empty()) {
+                return make_ready_future<>();
+            }
+            if (differing.size() * 2 > rows) {
+                return sync_range(db, keyspace, cf, range, neighbors);
+            }
+            std::vector<repair_row_id> to_send(differing.begin(), differing.end());
+            return do_with(std::move(to_fetch), std::move(to_send),
+                    [&db, &keyspace, &cf, &range, &neighbors] (auto& to_fetch, const auto& to_send) {
+                return parallel_for_each(boost::counting_iterator<size_t>(0),
+                        boost::counting_iterator<size_t>(neighbors.size()),
+                        [&keyspace, &cf, &range, &neighbors, &to_fetch] (size_t i) {
+                    if (to_fetch[i].empty()) {
+                        return make_ready_future<>();
+                    }
+                    auto neighbor = neighbors[i];
+                    return net::get_local_messaging_service().send_repair_get_rows(net::msg_addr{neighbor},
+                            keyspace, cf, range, std::move(to_fetch[i])).then([neighbor] (std::vector<frozen_mutation> rows) {
+                        return repair_put_rows(std::move(rows), neighbor);
+                    });
+                }).then([&db, &keyspace, &cf, &range, &to_send] {
+                    return repair_get_rows(db, keyspace, cf, range, to_send);
+                }).then([&neighbors] (std::vector<frozen_mutation> rows) {
+                    return do_with(std::move(rows), [&neighbors] (const auto& rows) {
+                        return parallel_for_each(neighbors, [&rows] (gms::inet_address neighbor) {
+                            return net::get_local_messaging_service().send_repair_put_rows(net::msg_addr{neighbor}, rows);
+                        });
+                    });
+                });
+            });
+        });
+    });
+}
+
+// Repair a range which replicas disagree on row by row, one page of row
+// hashes at a time. The pages are cut by this node's rows, and the
+// neighbors are asked for the same token ranges.
+static future<> repair_rows(seastar::sharded<database>& db,
+        const sstring& keyspace, const sstring& cf,
+        const ::range<dht::token>& range,
+        std::vector<gms::inet_address>& neighbors) {
+    using token_range = ::range<dht::token>;
+    return do_with(token_range(range), [&db, &keyspace, &cf, &neighbors] (auto& remaining) {
+        return repeat([&db, &keyspace, &cf, &neighbors, &remaining] {
+            return repair_row_hashes(db, keyspace, cf, remaining, row_level_repair_page_rows).then(
+                    [&db, &keyspace, &cf, &neighbors, &remaining] (repair_row_hashes_page page) {
+                auto more = !page.complete && !(remaining.end() && remaining.end()->value() == *page.last_token);
+                auto page_range = remaining;
+                auto next = remaining;
+                if (more) {
+                    page_range = token_range(remaining.start(), token_range::bound(*page.last_token, true));
+                    next = token_range(token_range::bound(*page.last_token, false), remaining.end());
+                }
+                return do_with(std::move(page_range), std::move(page.hashes),
+                        [&db, &keyspace, &cf, &neighbors, overflow = page.overflow] (const auto& page_range, const auto& hashes) {
+                    if (overflow) {
+                        logger.debug("Range {} holds too many rows to be repaired row by row", page_range);
+                        return sync_range(db, keyspace, cf, page_range, neighbors);
+                    }
+                    return repair_rows_page(db, keyspace, cf, page_range, neighbors, hashes);
+                }).then([&remaining, more, next = std::move(next)] {
+                    remaining = std::move(next);
+                    return stop_iteration(!more);
+                });
+            });
+        });
+    });
+}
+
 static void split_and_add(std::vector<::range<dht::token>>& ranges,
         const range<dht::token>& range,
         uint64_t estimated_partitions, uint64_t target_partitions) {
@@ -424,19 +952,23 @@ static void split_and_add(std::vector<::range<dht::token>>& ranges,
 }
 // We don't need to wait for one checksum to finish before we start the
 // next, but doing too many of these operations in parallel also doesn't
-// make sense, so we limit the number of concurrent ongoing checksum
-// requests with a semaphore.
-//
-// FIXME: We shouldn't use a magic number here, but rather bind it to
-// some resource. Otherwise we'll be doing too little in some machines,
-// and too much in others.
+// make sense, so we limit the number of ranges in flight, see
+// repair_concurrency_limiter.
 //
 // FIXME: This would be better of in a repair service, or even a per-shard
-// repair instance holding all repair state. However, since we are anyway
-// considering ditching those semaphores for a more fine grained resource-based
-// solution, let's do the simplest thing here and change it later
-constexpr int parallelism = 100;
-static thread_local semaphore parallelism_semaphore(parallelism);
+// repair instance holding all repair state.
+static thread_local repair_concurrency_limiter parallelism_limiter(memory::stats().total_memory() / repair_memory_share);
+
+// Each range reads the sstables which overlap it, with the read-ahead of the
+// streaming I/O class.
+static size_t range_read_memory(column_family& cf, const ::range<dht::token>& range) {
+    auto& pc = service::get_local_streaming_read_priority();
+    size_t memory = 0;
+    for (auto&& sst : cf.select_sstables(query::to_partition_range(range))) {
+        memory += sst->data_stream_memory(pc);
+    }
+    return memory;
+}
 
 // Repair a single cf in a single local range.
 // Comparable to RepairJob in Origin.
@@ -483,24 +1015,29 @@ static future<> repair_cf_range(seastar::sharded<database>& db,
         split_and_add(ranges, range, estimated_partitions, 100);
     }
 
+    // All replicas must calculate their checksums the same way.
+    auto rt = service::get_local_storage_service().cluster_supports_streamed_repair_checksum()
+            ? repair_checksum::streamed : repair_checksum::legacy;
+
     return do_with(seastar::gate(), true, std::move(keyspace), std::move(cf), std::move(ranges),
-        [&db, &neighbors] (auto& completion, auto& success, const auto& keyspace, const auto& cf, const auto& ranges) {
-        return do_for_each(ranges, [&completion, &success, &db, &neighbors, &keyspace, &cf]
+        [&db, &neighbors, rt] (auto& completion, auto& success, const auto& keyspace, const auto& cf, const auto& ranges) {
+        return do_for_each(ranges, [&completion, &success, &db, &neighbors, &keyspace, &cf, rt]
                            (const auto& range) {
 
             check_in_shutdown();
-            return parallelism_semaphore.wait(1).then([&completion, &success, &db, &neighbors, &keyspace, &cf, &range] {
+            auto range_memory = range_read_memory(db.local().find_column_family(keyspace, cf), range);
+            return parallelism_limiter.wait(range_memory).then([&completion, &success, &db, &neighbors, &keyspace, &cf, &range, rt, range_memory] {
 
                 // Ask this node, and all neighbors, to calculate checksums in
                 // this range. When all are done, compare the results, and if
                 // there are any differences, sync the content of this range.
                 std::vector<future<partition_checksum>> checksums;
                 checksums.reserve(1 + neighbors.size());
-                checksums.push_back(checksum_range(db, keyspace, cf, range));
+                checksums.push_back(checksum_range(db, keyspace, cf, range, rt));
                 for (auto&& neighbor : neighbors) {
                     checksums.push_back(
                             net::get_local_messaging_service().send_repair_checksum_range(
-                                    net::msg_addr{neighbor},keyspace, cf, range));
+                                    net::msg_addr{neighbor}, keyspace, cf, range, rt));
                 }
 
                 completion.enter();
@@ -536,6 +1073,9 @@ static future<> repair_cf_range(seastar::sharded<database>& db,
                         if (checksums[i].available() && checksum0 != checksums[i].get()) {
                             logger.info("Found differing range {} on nodes {}", range, live_neighbors);
                             return do_with(std::move(live_neighbors), [&db, &keyspace, &cf, &range] (auto& live_neighbors) {
+                                if (service::get_local_storage_service().cluster_supports_row_level_repair()) {
+                                    return repair_rows(db, keyspace, cf, range, live_neighbors);
+                                }
                                 return sync_range(db, keyspace, cf, range, live_neighbors);
                             });
                         }
@@ -549,8 +1089,8 @@ static future<> repair_cf_range(seastar::sharded<database>& db,
                     // tell the caller.
                     success = false;
                     logger.warn("Failed sync of range {}: {}", range, eptr);
-                }).finally([&completion] {
-                    parallelism_semaphore.signal(1);
+                }).finally([&completion, range_memory] {
+                    parallelism_limiter.signal(range_memory);
                     completion.leave(); // notify do_for_each that we're done
                 });
             });
@@ -905,6 +1445,12 @@ future<repair_status> repair_get_status(seastar::sharded<database>& db, int id)
     });
 }
 
+future<repair_concurrency> repair_get_concurrency(seastar::sharded<database>& db) {
+    return db.invoke_on(0, [] (database& localdb) {
+        return repair_concurrency{parallelism_limiter.limit(), parallelism_limiter.waiters()};
+    });
+}
+
 future<> repair_shutdown(seastar::sharded<database>& db) {
     logger.info("Starting shutdown of repair");
     return db.invoke_on(0, [] (database& localdb) {
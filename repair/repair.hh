@@ -29,6 +29,8 @@
 #include <seastar/core/future.hh>
 
 #include "database.hh"
+#include "frozen_mutation.hh"
+#include "gms/inet_address.hh"
 #include "utils/UUID.hh"
 
 
@@ -63,6 +65,16 @@ enum class repair_status { RUNNING, SUCCESSFUL, FAILED };
 // different CPU (cpu 0) and that might be a deferring operation.
 future<repair_status> repair_get_status(seastar::sharded<database>& db, int id);
 
+// How many ranges repair lets run in parallel at the moment, and how many
+// are waiting for their turn. The limit adapts to the resources available
+// to repair.
+struct repair_concurrency {
+    unsigned limit;
+    size_t queued;
+};
+
+future<repair_concurrency> repair_get_concurrency(seastar::sharded<database>& db);
+
 // repair_shutdown() stops all ongoing repairs started on this node (and
 // prevents any further repairs from being started). It returns a future
 // saying when all repairs have stopped, and attempts to stop them as
@@ -70,6 +82,17 @@ future<repair_status> repair_get_status(seastar::sharded<database>& db, int id);
 // stop them abruptly).
 future<> repair_shutdown(seastar::sharded<database>& db);
 
+// How partition checksums are calculated. Replicas can only compare their
+// checksums if they use the same algorithm, so the streamed one is only used
+// once the whole cluster supports it.
+enum class repair_checksum : uint8_t {
+    // SHA-256 of each partition, which is first read whole into memory.
+    legacy = 0,
+    // 128-bit murmur3 hash of each partition, calculated fragment by
+    // fragment as the partition is read.
+    streamed = 1,
+};
+
 // The class partition_checksum calculates a 256-bit cryptographically-secure
 // checksum of a set of partitions fed to it. The checksum of a partition set
 // is calculated by calculating a strong hash function (SHA-256) of each
@@ -78,6 +101,7 @@ future<> repair_shutdown(seastar::sharded<database>& db);
 // independently calculate the checksums of different subsets of the original
 // set, and then combine the results into one checksum with the add() method.
 // The hash of an individual partition uses both its key and value.
+// With repair_checksum::streamed, only the first 128 bits are used.
 class partition_checksum {
 private:
     std::array<uint8_t, 32> _digest; // 256 bits
@@ -85,6 +109,7 @@ class partition_checksum {
     constexpr partition_checksum() : _digest{} { }
     explicit partition_checksum(std::array<uint8_t, 32> digest) : _digest(std::move(digest)) { }
     partition_checksum(const mutation& m);
+    static future<partition_checksum> compute(streamed_mutation m, repair_checksum rt);
     void add(const partition_checksum& other);
     bool operator==(const partition_checksum& other) const;
     bool operator!=(const partition_checksum& other) const { return !operator==(other); }
@@ -99,4 +124,57 @@ class partition_checksum {
 // not resolved.
 future<partition_checksum> checksum_range(seastar::sharded<database> &db,
         const sstring& keyspace, const sstring& cf,
-        const ::range<dht::token>& range);
+        const ::range<dht::token>& range, repair_checksum rt);
+
+// Row-level repair: replicas which disagree on a range find the rows they
+// differ on by exchanging a hash of every row in it, and then transfer only
+// those rows instead of streaming the whole range.
+using repair_row_id = std::array<uint64_t, 2>;
+
+struct repair_row_id_hash {
+    size_t operator()(const repair_row_id& id) const {
+        return id[0];
+    }
+};
+
+// Identifies a row of a partition, and hashes its contents. The partition
+// tombstone and the range tombstones of a partition are hashed together as
+// one more row of it.
+struct repair_row_hash {
+    // Hash of the partition key and the position of the row.
+    repair_row_id id;
+    // Hash of the contents of the row.
+    std::array<uint64_t, 2> hash;
+};
+
+// The hashes of the rows of a prefix of a token range. Replicas compare
+// their rows a page at a time, so that the hashes of a range full of wide
+// partitions are never all held in memory. A page only ends between tokens,
+// so that the same page of another replica can be asked for by token range.
+struct repair_row_hashes_page {
+    std::vector<repair_row_hash> hashes;
+    // The last token whose rows are in the page, if any.
+    std::experimental::optional<dht::token> last_token;
+    // Whether the page reaches the end of the range. Otherwise it ends
+    // after last_token.
+    bool complete = true;
+    // The partitions of last_token alone hold more rows than a page may,
+    // so the page holds no hashes. Such a page is repaired by streaming.
+    bool overflow = false;
+};
+
+// Calculate the hashes of the rows held on all shards of a column family,
+// in the given token range, up to a page of max_rows rows.
+future<repair_row_hashes_page> repair_row_hashes(seastar::sharded<database>& db,
+        const sstring& keyspace, const sstring& cf,
+        const ::range<dht::token>& range, size_t max_rows);
+
+// Read the rows with the given ids in the given token range. The rows of
+// each partition are returned as one mutation.
+future<std::vector<frozen_mutation>> repair_get_rows(seastar::sharded<database>& db,
+        const sstring& keyspace, const sstring& cf,
+        const ::range<dht::token>& range, const std::vector<repair_row_id>& ids);
+
+// Apply rows received from another node, which is asked for their schema
+// if it is not known here.
+future<> repair_put_rows(std::vector<frozen_mutation> rows, gms::inet_address from);
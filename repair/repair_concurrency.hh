@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+#include <seastar/core/future.hh>
+
+constexpr unsigned min_repair_parallelism = 1;
+constexpr unsigned max_repair_parallelism = 1000;
+// The fixed limit repair used before it adapted.
+constexpr unsigned initial_repair_parallelism = 100;
+// Share of the shard's memory which the ranges in flight may use.
+constexpr size_t repair_memory_share = 10;
+// Changes in throughput smaller than this are considered noise.
+constexpr double repair_throughput_tolerance = 0.05;
+
+// Limits the number of repair ranges in flight. Doing too few at a time
+// leaves the disks idle while too many starve queries, and the right number
+// depends on the machine and on its load, so the limit adapts:
+//
+//  - Each range in flight is charged for the buffers its readers use, and
+//    together they may not use more than the memory budget.
+//
+//  - Within that, the limit follows the throughput of repair, which is
+//    bound by the streaming I/O class. Once per round of as many ranges as
+//    the limit, the rate at which ranges completed is compared to that of
+//    the previous round. The limit keeps moving in the same direction while
+//    that increases the throughput, and turns back when it decreases it.
+//    If it makes no difference the limit goes down, as ranges in flight
+//    which do not add to the throughput only take resources from queries.
+class repair_concurrency_limiter {
+public:
+    using clock_type = std::chrono::steady_clock;
+private:
+    struct waiter {
+        promise<> pr;
+        size_t memory;
+    };
+    size_t _memory_budget;
+    size_t _memory = 0;
+    unsigned _limit = initial_repair_parallelism;
+    unsigned _active = 0;
+    std::deque<waiter> _waiters;
+    // The current round, see above.
+    clock_type::time_point _round_start = clock_type::now();
+    unsigned _round_completed = 0;
+    double _last_throughput = 0;
+    int _direction = 1;
+private:
+    bool can_admit(size_t memory) const {
+        // A range is always let through when none is in flight, so that
+        // repair makes progress even if one range exceeds the budget.
+        return _active == 0 || (_active < _limit && _memory + memory <= _memory_budget);
+    }
+    void admit(size_t memory) {
+        ++_active;
+        _memory += memory;
+    }
+    void wake() {
+        while (!_waiters.empty() && can_admit(_waiters.front().memory)) {
+            auto& w = _waiters.front();
+            admit(w.memory);
+            w.pr.set_value();
+            _waiters.pop_front();
+        }
+    }
+    void update_limit(clock_type::time_point now) {
+        auto elapsed = std::chrono::duration<double>(now - _round_start).count();
+        auto throughput = _round_completed / std::max(elapsed, 1e-6);
+        if (throughput < _last_throughput * (1 - repair_throughput_tolerance)) {
+            _direction = -_direction;
+        } else if (throughput <= _last_throughput * (1 + repair_throughput_tolerance)) {
+            _direction = -1;
+        }
+        _last_throughput = throughput;
+        auto step = std::max(1u, _limit / 8);
+        auto limit = _direction > 0 ? _limit + step : _limit - std::min(step, _limit);
+        _limit = std::max(min_repair_parallelism, std::min(max_repair_parallelism, limit));
+        _round_start = now;
+        _round_completed = 0;
+    }
+public:
+    explicit repair_concurrency_limiter(size_t memory_budget) : _memory_budget(memory_budget) { }
+
+    // Waits until a range which uses the given amount of memory may proceed.
+    future<> wait(size_t memory, clock_type::time_point now = clock_type::now()) {
+        if (_active == 0 && _waiters.empty()) {
+            // Idle time does not count towards the throughput.
+            _round_start = now;
+            _round_completed = 0;
+        }
+        if (_waiters.empty() && can_admit(memory)) {
+            admit(memory);
+            return make_ready_future<>();
+        }
+        _waiters.push_back(waiter{promise<>(), memory});
+        return _waiters.back().pr.get_future();
+    }
+    // Releases the resources of a range which wait() let through.
+    void signal(size_t memory, clock_type::time_point now = clock_type::now()) {
+        --_active;
+        _memory -= memory;
+        if (++_round_completed >= _limit) {
+            update_limit(now);
+        }
+        wake();
+    }
+    unsigned limit() const {
+        return _limit;
+    }
+    unsigned active() const {
+        return _active;
+    }
+    size_t waiters() const {
+        return _waiters.size();
+    }
+};
@@ -56,14 +56,7 @@ cache_tracker::cache_tracker() {
             if (_lru.empty()) {
                 return memory::reclaiming_result::reclaimed_nothing;
             }
-            cache_entry& ce = _lru.back();
-            auto it = row_cache::partitions_type::s_iterator_to(ce);
-            --it;
-            it->set_continuous(false);
-            _lru.pop_back_and_dispose(current_deleter<cache_entry>());
-            --_partitions;
-            ++_evictions;
-            ++_modification_count;
+            _lru.back().evict(*this);
             return memory::reclaiming_result::reclaimed_something;
            } catch (std::bad_alloc&) {
             // Bad luck, linearization during partition removal caused us to
@@ -128,14 +121,58 @@ cache_tracker::setup_collectd() {
                 , "objects", "partitions")
                 , scollectd::make_typed(scollectd::data_type::GAUGE, _partitions)
         ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "row_hits")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _row_hits)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "row_misses")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _row_misses)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "row_evictions")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _row_evictions)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "index_page_hits")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _index_page_hits)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "index_page_misses")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _index_page_misses)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "index_page_insertions")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _index_page_insertions)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "index_page_evictions")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _index_page_evictions)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "objects", "index_pages")
+                , scollectd::make_typed(scollectd::data_type::GAUGE, _index_pages)
+        ),
     }));
 }
 
 void cache_tracker::clear() {
     with_allocator(_region.allocator(), [this] {
         while (!_lru.empty()) {
-            cache_entry& ce = _lru.back();
-            auto it = row_cache::partitions_type::s_iterator_to(ce);
+            cache_entry* ce = _lru.back().entry();
+            if (!ce) {
+                _lru.back().evict(*this);
+                continue;
+            }
+            auto it = row_cache::partitions_type::s_iterator_to(*ce);
             while (it->is_evictable()) {
                 cache_entry& to_remove = *it;
                 --it;
@@ -150,7 +187,7 @@ void cache_tracker::clear() {
     ++_modification_count;
 }
 
-void cache_tracker::touch(cache_entry& e) {
+void cache_tracker::touch(lru_entry& e) {
     _lru.erase(_lru.iterator_to(e));
     _lru.push_front(e);
 }
@@ -162,6 +199,33 @@ void cache_tracker::insert(cache_entry& entry) {
     _lru.push_front(entry);
 }
 
+void cache_tracker::insert(cached_range& r) {
+    _lru.push_front(r);
+}
+
+void cache_tracker::insert_index_page(lru_entry& page) {
+    ++_index_page_insertions;
+    ++_index_pages;
+    _lru.push_front(page);
+}
+
+void cache_tracker::on_index_page_hit() {
+    ++_index_page_hits;
+}
+
+void cache_tracker::on_index_page_miss() {
+    ++_index_page_misses;
+}
+
+void cache_tracker::on_index_page_removal() {
+    --_index_pages;
+}
+
+void cache_tracker::on_index_page_eviction() {
+    --_index_pages;
+    ++_index_page_evictions;
+}
+
 void cache_tracker::on_erase() {
     --_partitions;
     ++_removals;
@@ -180,6 +244,24 @@ void cache_tracker::on_miss() {
     ++_misses;
 }
 
+void cache_tracker::on_eviction() {
+    --_partitions;
+    ++_evictions;
+    ++_modification_count;
+}
+
+void cache_tracker::on_row_hits(uint64_t rows) {
+    _row_hits += rows;
+}
+
+void cache_tracker::on_row_misses(uint64_t rows) {
+    _row_misses += rows;
+}
+
+void cache_tracker::on_row_eviction(uint64_t rows) {
+    _row_evictions += rows;
+}
+
 allocation_strategy& cache_tracker::allocator() {
     return _region.allocator();
 }
@@ -192,24 +274,118 @@ const logalloc::region& cache_tracker::region() const {
     return _region;
 }
 
+static bound_view start_bound(const query::clustering_range& r) {
+    if (!r.start()) {
+        return bound_view::bottom();
+    }
+    return bound_view(r.start()->value(), r.start()->is_inclusive() ? bound_kind::incl_start : bound_kind::excl_start);
+}
+
+static bound_view end_bound(const query::clustering_range& r) {
+    if (!r.end()) {
+        return bound_view::top();
+    }
+    return bound_view(r.end()->value(), r.end()->is_inclusive() ? bound_kind::incl_end : bound_kind::excl_end);
+}
+
+static query::clustering_range make_clustering_range(const schema& s, bound_view start, bound_view end) {
+    auto make_bound = [&s] (bound_view b, bool inclusive) -> stdx::optional<query::clustering_range::bound> {
+        if (b.prefix.size(s) == 0) {
+            return { };
+        }
+        return query::clustering_range::bound(b.prefix, inclusive);
+    };
+    return query::clustering_range(make_bound(start, start.kind == bound_kind::incl_start),
+                                   make_bound(end, end.kind == bound_kind::incl_end));
+}
+
+static void sort_clustering_ranges(const schema& s, query::clustering_row_ranges& ranges) {
+    bound_view::compare less(s);
+    std::sort(ranges.begin(), ranges.end(), [&less] (const query::clustering_range& a, const query::clustering_range& b) {
+        return less(start_bound(a), start_bound(b));
+    });
+}
+
+static bool is_full_clustering_range(const query::clustering_row_ranges& ranges) {
+    return ranges.size() == 1 && ranges.front().is_full();
+}
+
+// Wraps a streamed_mutation read from cache and accounts clustering rows
+// it returns as row hits.
+class row_counting_streamed_mutation final : public streamed_mutation::impl {
+    streamed_mutation _sm;
+    cache_tracker& _tracker;
+public:
+    row_counting_streamed_mutation(streamed_mutation sm, cache_tracker& tracker)
+        : streamed_mutation::impl(sm.schema(), sm.decorated_key(), sm.partition_tombstone(), sm.is_reversed())
+        , _sm(std::move(sm))
+        , _tracker(tracker)
+    { }
+
+    virtual future<> fill_buffer() override {
+        return _sm.fill_buffer().then([this] {
+            uint64_t rows = 0;
+            while (!_sm.is_buffer_empty()) {
+                auto mf = _sm.pop_mutation_fragment();
+                rows += mf.is_clustering_row();
+                push_mutation_fragment(std::move(mf));
+            }
+            _tracker.on_row_hits(rows);
+            _end_of_stream = _sm.is_end_of_stream();
+        });
+    }
+};
+
+// Returns a streamed_mutation which becomes available when the future does.
+class partially_cached_partition_reader final : public mutation_reader::impl {
+    stdx::optional<future<streamed_mutation>> _sm;
+public:
+    explicit partially_cached_partition_reader(future<streamed_mutation> sm)
+        : _sm(std::move(sm))
+    { }
+
+    virtual future<streamed_mutation_opt> operator()() override {
+        if (!_sm) {
+            return make_ready_future<streamed_mutation_opt>();
+        }
+        auto f = std::move(*_sm);
+        _sm = stdx::nullopt;
+        return f.then([] (streamed_mutation sm) {
+            return streamed_mutation_opt(std::move(sm));
+        });
+    }
+};
+
 // Reader which populates the cache using data from the delegate.
+//
+// When the delegate is restricted to some clustering ranges, only those
+// ranges are populated and the cache entry is marked as partial.
 class single_partition_populating_reader final : public mutation_reader::impl {
     schema_ptr _schema;
     row_cache& _cache;
     mutation_reader _delegate;
     query::clustering_key_filtering_context _ck_filtering;
+    bool _partial;
 public:
-    single_partition_populating_reader(schema_ptr s, row_cache& cache, mutation_reader delegate, query::clustering_key_filtering_context ck_filtering)
+    single_partition_populating_reader(schema_ptr s, row_cache& cache, mutation_reader delegate,
+                                       query::clustering_key_filtering_context ck_filtering, bool partial = false)
         : _schema(std::move(s))
         , _cache(cache)
         , _delegate(std::move(delegate))
         , _ck_filtering(ck_filtering)
+        , _partial(partial)
     { }
 
     virtual future<streamed_mutation_opt> operator()() override {
         return _delegate().then([] (auto sm) {
             return mutation_from_streamed_mutation(std::move(sm));
         }).then([this, op = _cache._populate_phaser.start()] (mutation_opt&& mo) -> streamed_mutation_opt {
+            if (mo && _partial) {
+                // The delegate has already dropped rows outside of the requested ranges.
+                _cache.populate(*mo, _ck_filtering.get_ranges(mo->key()));
+                mo->upgrade(_schema);
+                return streamed_mutation_from_mutation(std::move(*mo));
+            }
             if (mo) {
                 _cache.populate(*mo);
                 mo->upgrade(_schema);
@@ -243,6 +419,7 @@ class just_cache_scanning_reader final {
     uint64_t _last_reclaim_count;
     size_t _last_modification_count;
     query::clustering_key_filtering_context _ck_filtering;
+    const io_priority_class& _pc;
 private:
     void update_iterators() {
         auto cmp = cache_entry::compare(_cache._schema);
@@ -287,8 +464,9 @@ class just_cache_scanning_reader final {
         streamed_mutation_opt mut;
         bool continuous;
     };
-    just_cache_scanning_reader(schema_ptr s, row_cache& cache, const query::partition_range& range, query::clustering_key_filtering_context ck_filtering)
-        : _schema(std::move(s)), _cache(cache), _range(range), _ck_filtering(ck_filtering)
+    just_cache_scanning_reader(schema_ptr s, row_cache& cache, const query::partition_range& range,
+                               query::clustering_key_filtering_context ck_filtering, const io_priority_class& pc)
+        : _schema(std::move(s)), _cache(cache), _range(range), _ck_filtering(ck_filtering), _pc(pc)
     { }
     future<cache_data> operator()() {
         return _cache._read_section(_cache._tracker.region(), [this] {
@@ -300,8 +478,13 @@ class just_cache_scanning_reader final {
             auto& ce = *_it;
             ++_it;
             _last = ce.key();
-            _cache.upgrade_entry(ce);
-            cache_data data{std::move(ce.read(_cache, _schema, _ck_filtering)), ce.continuous()};
+            bool continuous = ce.continuous();
+            if (!ce.covers(_ck_filtering.get_ranges(ce.key().as_decorated_key().key()))) {
+                return _cache.read_entry_with_missing_ranges(ce, _schema, _ck_filtering, _pc).then([continuous] (streamed_mutation sm) {
+                    return cache_data{std::move(sm), continuous};
+                });
+            }
+            cache_data data{_cache.read_entry(ce, _schema, _ck_filtering), continuous};
             return make_ready_future<cache_data>(std::move(data));
           });
         });
@@ -523,7 +706,7 @@ class scanning_and_populating_reader final : public mutation_reader::impl{
             , _schema(std::move(s))
             , _range(range)
             , _pc(pc)
-            , _primary(_schema, _cache, _range, ck_filtering)
+            , _primary(_schema, _cache, _range, ck_filtering, pc)
             , _ck_filtering(ck_filtering)
             , _state(start_state{}) {}
         future<streamed_mutation_opt> operator()(const end_state& state) {
@@ -651,14 +834,25 @@ row_cache::make_reader(schema_ptr s,
             if (i != _partitions.end() && i != _partitions.begin()) {
                 cache_entry& e = *i;
                 _tracker.touch(e);
-                on_hit();
-                upgrade_entry(e);
-                return make_reader_returning(e.read(*this, s, ck_filtering));
+                if (e.covers(ck_filtering.get_ranges(dk.key()))) {
+                    on_hit();
+                    return make_reader_returning(read_entry(e, s, ck_filtering));
+                }
+                on_miss();
+                return make_mutation_reader<partially_cached_partition_reader>(
+                    read_entry_with_missing_ranges(e, s, ck_filtering, pc));
             } else {
                 on_miss();
+                if (is_full_clustering_range(ck_filtering.get_ranges(dk.key()))) {
+                    return make_mutation_reader<single_partition_populating_reader>(s, *this,
+                        _underlying(_schema, range, query::no_clustering_key_filtering, pc),
+                        ck_filtering);
+                }
+                // Only the queried clustering ranges are read and populated,
+                // so that a slice of a wide partition doesn't pull in the whole partition.
                 return make_mutation_reader<single_partition_populating_reader>(s, *this,
-                    _underlying(_schema, range, query::no_clustering_key_filtering, pc),
-                    ck_filtering);
+                    _underlying(_schema, range, ck_filtering, pc),
+                    ck_filtering, true);
             }
           });
         });
@@ -702,13 +896,83 @@ void row_cache::populate(const mutation& m) {
                 _tracker.insert(*entry);
                 _partitions.insert(i, *entry);
             } else {
-                _tracker.touch(*i);
-                // We cache whole partitions right now, so if cache already has this partition,
-                // it must be complete, so do nothing.
+                cache_entry& entry = *i;
+                _tracker.touch(entry);
+                if (!entry.is_complete()) {
+                    upgrade_entry(entry);
+                    entry.partition().apply(*_schema, m.partition(), *m.schema());
+                    entry.set_complete();
+                }
             }
           });
         });
     });
+    _tracker.on_row_misses(m.partition().clustered_rows().size());
+}
+
+void row_cache::populate(const mutation& m, const query::clustering_row_ranges& ranges) {
+    with_allocator(_tracker.allocator(), [this, &m, &ranges] {
+        _populate_section(_tracker.region(), [&] {
+          with_linearized_managed_bytes([&] {
+            auto i = _partitions.lower_bound(m.decorated_key(), cache_entry::compare(_schema));
+            if (i == _partitions.end() || !i->key().equal(*_schema, m.decorated_key())) {
+                cache_entry* entry = current_allocator().construct<cache_entry>(
+                        m.schema(), m.decorated_key(), m.partition(), cache_entry::incomplete_tag());
+                upgrade_entry(*entry);
+                _tracker.insert(*entry);
+                _partitions.insert(i, *entry);
+                entry->add_continuity(_tracker, ranges, *m.schema(), m.partition());
+                _tracker.touch(*entry);
+            } else {
+                cache_entry& entry = *i;
+                if (!entry.is_complete()) {
+                    upgrade_entry(entry);
+                    // Applying is idempotent, so it's fine if the section is retried.
+                    entry.partition().apply(*_schema, m.partition(), *m.schema());
+                    entry.add_continuity(_tracker, ranges, *m.schema(), m.partition());
+                }
+                _tracker.touch(entry);
+            }
+          });
+        });
+    });
+    _tracker.on_row_misses(m.partition().clustered_rows().size());
+}
+
+streamed_mutation row_cache::read_entry(cache_entry& e, const schema_ptr& s, query::clustering_key_filtering_context ck_filtering) {
+    upgrade_entry(e);
+    if (!e.is_complete()) {
+        e.touch(_tracker, ck_filtering.get_ranges(e.key().as_decorated_key().key()));
+        // Keep the entry in front of its ranges, so that it's evicted only after all of them.
+        _tracker.touch(e);
+    }
+    return make_streamed_mutation<row_counting_streamed_mutation>(e.read(*this, s, ck_filtering), _tracker);
+}
+
+future<streamed_mutation> row_cache::read_entry_with_missing_ranges(cache_entry& e, const schema_ptr& s,
+        query::clustering_key_filtering_context ck_filtering, const io_priority_class& pc) {
+    auto dk = e.key().as_decorated_key();
+    auto ck_ranges = ck_filtering.get_ranges(dk.key());
+    auto missing = e.missing_ranges(ck_ranges);
+    // The cached and the missing parts are merged, which requires both to be in clustering order.
+    sort_clustering_ranges(*_schema, ck_ranges);
+    auto cached = read_entry(e, s, query::clustering_key_filtering_context::create_for_ranges(s, std::move(ck_ranges)));
+    auto missing_filtering = query::clustering_key_filtering_context::create_for_ranges(_schema, std::move(missing));
+    auto range = make_lw_shared<query::partition_range>(query::partition_range::make_singular(dk));
+    auto reader = make_lw_shared<mutation_reader>(_underlying(_schema, *range, missing_filtering, pc));
+    return (*reader)().then([] (auto sm) {
+        return mutation_from_streamed_mutation(std::move(sm));
+    }).then([this, s, dk = std::move(dk), range, reader, missing_filtering, cached = std::move(cached),
+             op = _populate_phaser.start()] (mutation_opt&& mo) mutable {
+        mutation m = mo ? std::move(*mo) : mutation(std::move(dk), _schema);
+        populate(m, missing_filtering.get_ranges(m.key()));
+        m.upgrade(s);
+        std::vector<streamed_mutation> parts;
+        parts.reserve(2);
+        parts.emplace_back(std::move(cached));
+        parts.emplace_back(streamed_mutation_from_mutation(std::move(m)));
+        return merge_mutations(std::move(parts));
+    });
 }
 
 future<> row_cache::clear() {
@@ -903,18 +1167,47 @@ row_cache::row_cache(schema_ptr s, mutation_source fallback_factory, key_source
     });
 }
 
+lru_entry::lru_entry(lru_entry&& o) noexcept
+    : _lru_link()
+{
+    if (o._lru_link.is_linked()) {
+        auto prev = o._lru_link.prev_;
+        o._lru_link.unlink();
+        cache_tracker::lru_type::node_algorithms::link_after(prev, _lru_link.this_ptr());
+    }
+}
+
+cached_range::cached_range(cached_range&& o) noexcept
+    : lru_entry(std::move(o))
+    , _link()
+    , _owner(o._owner)
+    , _start(std::move(o._start))
+    , _start_kind(o._start_kind)
+    , _end(std::move(o._end))
+    , _end_kind(o._end_kind)
+{
+    if (o._link.is_linked()) {
+        container_type::node_algorithms::replace_node(o._link.this_ptr(), _link.this_ptr());
+        container_type::node_algorithms::init(o._link.this_ptr());
+    }
+}
+
+void cached_range::evict(cache_tracker& tracker) {
+    _owner->evict_range(*this, tracker);
+}
+
 cache_entry::cache_entry(cache_entry&& o) noexcept
-    : _schema(std::move(o._schema))
+    : lru_entry(std::move(o))
+    , _schema(std::move(o._schema))
     , _key(std::move(o._key))
     , _pe(std::move(o._pe))
     , _continuous(o._continuous)
-    , _lru_link()
+    , _complete(o._complete)
+    , _ranges(std::move(o._ranges))
     , _cache_link()
 {
-    if (o._lru_link.is_linked()) {
-        auto prev = o._lru_link.prev_;
-        o._lru_link.unlink();
-        cache_tracker::lru_type::node_algorithms::link_after(prev, _lru_link.this_ptr());
+    for (auto&& r : _ranges) {
+        r._owner = this;
     }
 
     {
@@ -924,6 +1217,162 @@ cache_entry::cache_entry(cache_entry&& o) noexcept
     }
 }
 
+cache_entry::~cache_entry() {
+    _ranges.clear_and_dispose(current_deleter<cached_range>());
+}
+
+void cache_entry::evict(cache_tracker& tracker) {
+    auto it = row_cache::partitions_type::s_iterator_to(*this);
+    --it;
+    it->set_continuous(false);
+    current_deleter<cache_entry>()(this);
+    tracker.on_eviction();
+}
+
+void cache_entry::evict_range(cached_range& r, cache_tracker& tracker) {
+    auto p = _pe.exclusive_partition();
+    if (!p) {
+        // Rows can't be removed from under a snapshot, evict the whole partition instead.
+        evict(tracker);
+        return;
+    }
+    auto rows = p->remove_rows(*_schema, r.start_bound(), r.end_bound());
+    current_deleter<cached_range>()(&r);
+    tracker.on_row_eviction(rows);
+}
+
+void cache_entry::set_complete() {
+    _ranges.clear_and_dispose(current_deleter<cached_range>());
+    _complete = true;
+}
+
+void cache_entry::insert_range(cache_tracker& tracker, bound_view start, bound_view end) {
+    auto r = current_allocator().construct<cached_range>(*this, start, end);
+    _ranges.insert(*r);
+    tracker.insert(*r);
+}
+
+bool cache_entry::covers_range(const query::clustering_range& r) const {
+    bound_view::compare less(*_schema);
+    auto start = start_bound(r);
+    auto end = end_bound(r);
+    auto it = _ranges.upper_bound(start, cached_range::compare(_schema));
+    if (it == _ranges.begin()) {
+        return false;
+    }
+    --it;
+    if (less(it->end_bound(), start)) {
+        return false;
+    }
+    while (less(it->end_bound(), end)) {
+        auto next = std::next(it);
+        if (next == _ranges.end() || !it->end_bound().adjacent(*_schema, next->start_bound())) {
+            return false;
+        }
+        it = next;
+    }
+    return true;
+}
+
+bool cache_entry::covers(const query::clustering_row_ranges& ranges) const {
+    return _complete || std::all_of(ranges.begin(), ranges.end(), [this] (const query::clustering_range& r) {
+        return covers_range(r);
+    });
+}
+
+void cache_entry::add_missing_ranges(const query::clustering_range& r, query::clustering_row_ranges& out) const {
+    bound_view::compare less(*_schema);
+    auto start = start_bound(r);
+    auto end = end_bound(r);
+    // Position from which the range is not yet known to be covered.
+    stdx::optional<bound_view> pos;
+    pos.emplace(start);
+    auto it = _ranges.upper_bound(start, cached_range::compare(_schema));
+    if (it != _ranges.begin()) {
+        --it;
+    }
+    for (; it != _ranges.end() && !less(end, it->start_bound()); ++it) {
+        if (less(it->end_bound(), *pos)) {
+            continue;
+        }
+        if (less(*pos, it->start_bound())) {
+            auto gap_end = it->start_bound();
+            out.emplace_back(make_clustering_range(*_schema, *pos, bound_view(gap_end.prefix, invert_kind(gap_end.kind))));
+        }
+        if (!less(it->end_bound(), end)) {
+            return;
+        }
+        auto next_start = it->end_bound();
+        pos.emplace(next_start.prefix, invert_kind(next_start.kind));
+    }
+    out.emplace_back(make_clustering_range(*_schema, *pos, end));
+}
+
+query::clustering_row_ranges cache_entry::missing_ranges(const query::clustering_row_ranges& ranges) const {
+    query::clustering_row_ranges result;
+    if (_complete) {
+        return result;
+    }
+    for (auto&& r : ranges) {
+        add_missing_ranges(r, result);
+    }
+    sort_clustering_ranges(*_schema, result);
+    return result;
+}
+
+void cache_entry::add_continuity(cache_tracker& tracker, const query::clustering_row_ranges& ranges,
+                                 const schema& p_schema, const mutation_partition& p) {
+    if (_complete) {
+        return;
+    }
+    for (auto&& r : ranges) {
+        query::clustering_row_ranges missing;
+        add_missing_ranges(r, missing);
+        for (auto&& m : missing) {
+            // Split the range so that each chunk holds at most max_rows_per_range rows.
+            // A chunk ends at a row, inclusive, and the next one starts right after it.
+            auto chunk_start = start_bound(m);
+            const clustering_key_prefix* start_key = &chunk_start.prefix;
+            bound_kind start_kind = chunk_start.kind;
+            auto rows = p.range(p_schema, m);
+            size_t n = 0;
+            for (auto i = rows.begin(); i != rows.end(); ++i) {
+                if (++n < max_rows_per_range || std::next(i) == rows.end()) {
+                    continue;
+                }
+                insert_range(tracker, bound_view(*start_key, start_kind), bound_view(i->key(), bound_kind::incl_end));
+                start_key = &i->key();
+                start_kind = bound_kind::excl_start;
+                n = 0;
+            }
+            insert_range(tracker, bound_view(*start_key, start_kind), end_bound(m));
+        }
+    }
+    if (covers_range(query::clustering_range::make_open_ended_both_sides())) {
+        set_complete();
+    }
+}
+
+void cache_entry::touch(cache_tracker& tracker, const query::clustering_row_ranges& ranges) {
+    if (_complete) {
+        return;
+    }
+    bound_view::compare less(*_schema);
+    for (auto&& r : ranges) {
+        auto start = start_bound(r);
+        auto end = end_bound(r);
+        auto it = _ranges.upper_bound(start, cached_range::compare(_schema));
+        if (it != _ranges.begin()) {
+            --it;
+        }
+        for (; it != _ranges.end() && !less(end, it->start_bound()); ++it) {
+            if (!less(it->end_bound(), start)) {
+                tracker.touch(*it);
+            }
+        }
+    }
+}
+
 void row_cache::set_schema(schema_ptr new_schema) noexcept {
     _schema = std::move(new_schema);
 }
@@ -44,18 +44,111 @@ struct registrations;
 namespace bi = boost::intrusive;
 
 class row_cache;
+class cache_tracker;
+class cache_entry;
+
+// Base class for objects which are subject to eviction by cache_tracker.
+//
+// Whole partitions (cache_entry) and clustering ranges of partially cached
+// partitions (cached_range) share a single LRU, so that cold slices of a wide
+// partition can be evicted independently of its hot slices. Parsed sstable
+// index pages (sstables::cached_index_page) live in the same LRU, so that
+// they compete with partitions for cache memory.
+class lru_entry {
+public:
+    using lru_link_type = bi::list_member_hook<bi::link_mode<bi::auto_unlink>>;
+protected:
+    lru_link_type _lru_link;
+    friend class cache_tracker;
+public:
+    lru_entry() = default;
+    lru_entry(lru_entry&&) noexcept;
+    virtual ~lru_entry() { }
+
+    bool is_evictable() const { return _lru_link.is_linked(); }
+
+    // Returns the partition entry this object belongs to, or nullptr if it
+    // does not belong to a partition.
+    virtual cache_entry* entry() = 0;
+
+    // Removes this object from cache.
+    // Must be called with the cache region's allocator.
+    virtual void evict(cache_tracker&) = 0;
+};
+
+// A clustering range of a partially cached partition for which the owning
+// cache_entry is known to contain all the data the underlying data source has.
+//
+// The range is kept as a pair of bounds, the same way range_tombstone does,
+// so that adjacency between ranges can be established.
+class cached_range final : public lru_entry {
+    using link_type = bi::set_member_hook<bi::link_mode<bi::auto_unlink>>;
+
+    link_type _link;
+    cache_entry* _owner;
+    clustering_key_prefix _start;
+    bound_kind _start_kind;
+    clustering_key_prefix _end;
+    bound_kind _end_kind;
+
+    friend class cache_entry;
+public:
+    cached_range(cache_entry& owner, bound_view start, bound_view end)
+        : _owner(&owner)
+        , _start(start.prefix)
+        , _start_kind(start.kind)
+        , _end(end.prefix)
+        , _end_kind(end.kind)
+    { }
+    cached_range(cached_range&&) noexcept;
+
+    bound_view start_bound() const { return bound_view(_start, _start_kind); }
+    bound_view end_bound() const { return bound_view(_end, _end_kind); }
+
+    virtual cache_entry* entry() override { return _owner; }
+    virtual void evict(cache_tracker&) override;
+
+    // Orders ranges by their start bounds.
+    struct compare {
+        // Holds a schema_ptr rather than a reference because the owning
+        // entry may be upgraded to a new schema while the set is alive.
+        schema_ptr _s;
+
+        compare(schema_ptr s) : _s(std::move(s)) { }
+
+        bool operator()(const cached_range& r1, const cached_range& r2) const {
+            return bound_view::compare(*_s)(r1.start_bound(), r2.start_bound());
+        }
+        bool operator()(const bound_view& b, const cached_range& r) const {
+            return bound_view::compare(*_s)(b, r.start_bound());
+        }
+        bool operator()(const cached_range& r, const bound_view& b) const {
+            return bound_view::compare(*_s)(r.start_bound(), b);
+        }
+    };
+
+    using container_type = bi::set<cached_range,
+        bi::member_hook<cached_range, link_type, &cached_range::_link>,
+        bi::compare<compare>,
+        bi::constant_time_size<false>>;
+};
 
 // Intrusive set entry which holds partition data.
 //
+// An entry is either complete, in which case it holds all the data of the
+// partition, or partial. A partial entry always holds the complete static row
+// and partition tombstone, but clustering rows are complete only within
+// the ranges tracked by _ranges. Rows outside of these ranges may be present
+// (e.g. merged from a memtable), but can't be used to answer queries.
+//
 // TODO: Make memtables use this format too.
-class cache_entry {
+class cache_entry final : public lru_entry {
     // We need auto_unlink<> option on the _cache_link because when entry is
     // evicted from cache via LRU we don't have a reference to the container
     // and don't want to store it with each entry. As for the _lru_link, we
     // have a global LRU, so technically we could not use auto_unlink<> on
     // _lru_link, but it's convenient to do so too. We may also want to have
     // multiple eviction spaces in the future and thus multiple LRUs.
-    using lru_link_type = bi::list_member_hook<bi::link_mode<bi::auto_unlink>>;
     using cache_link_type = bi::set_member_hook<bi::link_mode<bi::auto_unlink>>;
 
     schema_ptr _schema;
@@ -63,18 +156,34 @@ class cache_entry {
     partition_entry _pe;
     // True when we know that there is nothing between this entry and the next one in cache
     bool _continuous;
-    lru_link_type _lru_link;
+    // True when the entry holds all clustering rows of the partition
+    bool _complete;
+    cached_range::container_type _ranges;
     cache_link_type _cache_link;
     friend class size_calculator;
+private:
+    void insert_range(cache_tracker&, bound_view start, bound_view end);
+    void add_missing_ranges(const query::clustering_range&, query::clustering_row_ranges& out) const;
+    bool covers_range(const query::clustering_range&) const;
+    void evict_range(cached_range&, cache_tracker&);
 public:
     friend class row_cache;
     friend class cache_tracker;
+    friend class cached_range;
+
+    struct incomplete_tag { };
+
+    // Maximum number of clustering rows tracked by a single cached_range.
+    // Bounds the granularity of eviction of wide partitions.
+    static constexpr size_t max_rows_per_range = 128;
 
     cache_entry(schema_ptr s)
         : _schema(std::move(s))
         , _key(dht::ring_position::starting_at(dht::minimum_token()))
         , _pe(_schema)
         , _continuous(false)
+        , _complete(true)
+        , _ranges(cached_range::compare(_schema))
     { }
 
     cache_entry(schema_ptr s, const dht::decorated_key& key, const mutation_partition& p, bool continuous = false)
@@ -82,6 +191,19 @@ class cache_entry {
         , _key(key)
         , _pe(p)
         , _continuous(continuous)
+        , _complete(true)
+        , _ranges(cached_range::compare(_schema))
+    { }
+
+    // Creates a partial entry. Continuity of clustering ranges needs to be
+    // added with add_continuity().
+    cache_entry(schema_ptr s, const dht::decorated_key& key, const mutation_partition& p, incomplete_tag)
+        : _schema(std::move(s))
+        , _key(key)
+        , _pe(p)
+        , _continuous(false)
+        , _complete(false)
+        , _ranges(cached_range::compare(_schema))
     { }
 
     cache_entry(schema_ptr s, dht::decorated_key&& key, mutation_partition&& p, bool continuous = false) noexcept
@@ -89,6 +211,8 @@ class cache_entry {
         , _key(std::move(key))
         , _pe(std::move(p))
         , _continuous(continuous)
+        , _complete(true)
+        , _ranges(cached_range::compare(_schema))
     { }
 
     cache_entry(schema_ptr s, dht::decorated_key&& key, partition_entry&& pe, bool continuous = false) noexcept
@@ -96,11 +220,13 @@ class cache_entry {
         , _key(std::move(key))
         , _pe(std::move(pe))
         , _continuous(continuous)
+        , _complete(true)
+        , _ranges(cached_range::compare(_schema))
     { }
 
     cache_entry(cache_entry&&) noexcept;
+    ~cache_entry();
 
-    bool is_evictable() { return _lru_link.is_linked(); }
     const dht::ring_position& key() const { return _key; }
     const partition_entry& partition() const { return _pe; }
     partition_entry& partition() { return _pe; }
@@ -111,6 +237,29 @@ class cache_entry {
     bool continuous() const { return _continuous; }
     void set_continuous(bool value) { _continuous = value; }
 
+    bool is_complete() const { return _complete; }
+    // Marks the entry as holding the whole partition.
+    void set_complete();
+
+    // Returns true iff all given clustering ranges can be served from this entry.
+    bool covers(const query::clustering_row_ranges&) const;
+
+    // Returns the parts of given clustering ranges which are not covered by
+    // this entry, in clustering order.
+    query::clustering_row_ranges missing_ranges(const query::clustering_row_ranges&) const;
+
+    // Marks given clustering ranges as complete. The data for those ranges,
+    // given by p, must have already been applied to the entry. p is only used
+    // to split the ranges into LRU-tracked chunks of at most max_rows_per_range rows.
+    void add_continuity(cache_tracker&, const query::clustering_row_ranges&, const schema& p_schema, const mutation_partition& p);
+
+    // Moves the parts of this entry used by a query for given ranges to the
+    // front of the LRU.
+    void touch(cache_tracker&, const query::clustering_row_ranges&);
+
+    virtual cache_entry* entry() override { return this; }
+    virtual void evict(cache_tracker&) override;
+
     struct compare {
         dht::ring_position_less_comparator _c;
 
@@ -143,8 +292,8 @@ class cache_entry {
 // Tracks accesses and performs eviction of cache entries.
 class cache_tracker final {
 public:
-    using lru_type = bi::list<cache_entry,
-        bi::member_hook<cache_entry, cache_entry::lru_link_type, &cache_entry::_lru_link>,
+    using lru_type = bi::list<lru_entry,
+        bi::member_hook<lru_entry, lru_entry::lru_link_type, &lru_entry::_lru_link>,
         bi::constant_time_size<false>>; // we need this to have bi::auto_unlink on hooks.
 private:
     uint64_t _hits = 0;
@@ -155,6 +304,14 @@ class cache_tracker final {
     uint64_t _removals = 0;
     uint64_t _partitions = 0;
     uint64_t _modification_count = 0;
+    uint64_t _row_hits = 0;
+    uint64_t _row_misses = 0;
+    uint64_t _row_evictions = 0;
+    uint64_t _index_page_hits = 0;
+    uint64_t _index_page_misses = 0;
+    uint64_t _index_page_insertions = 0;
+    uint64_t _index_page_evictions = 0;
+    uint64_t _index_pages = 0;
     std::unique_ptr<scollectd::registrations> _collectd_registrations;
     logalloc::region _region;
     lru_type _lru;
@@ -164,17 +321,34 @@ class cache_tracker final {
     cache_tracker();
     ~cache_tracker();
     void clear();
-    void touch(cache_entry&);
+    void touch(lru_entry&);
     void insert(cache_entry&);
+    void insert(cached_range&);
     void on_erase();
     void on_merge();
     void on_hit();
     void on_miss();
+    void on_eviction();
+    void on_row_hits(uint64_t rows);
+    void on_row_misses(uint64_t rows);
+    void on_row_eviction(uint64_t rows);
+    // For sstables::cached_index_page.
+    void insert_index_page(lru_entry&);
+    void on_index_page_hit();
+    void on_index_page_miss();
+    void on_index_page_removal();
+    void on_index_page_eviction();
     allocation_strategy& allocator();
     logalloc::region& region();
     const logalloc::region& region() const;
     uint64_t modification_count() const { return _modification_count; }
     uint64_t partitions() const { return _partitions; }
+    uint64_t row_hits() const { return _row_hits; }
+    uint64_t row_misses() const { return _row_misses; }
+    uint64_t row_evictions() const { return _row_evictions; }
+    uint64_t index_pages() const { return _index_pages; }
+    uint64_t index_page_hits() const { return _index_page_hits; }
+    uint64_t index_page_misses() const { return _index_page_misses; }
 };
 
 // Returns a reference to shard-wide cache_tracker.
@@ -208,7 +382,7 @@ class row_cache final {
     cache_tracker& _tracker;
     stats _stats{};
     schema_ptr _schema;
-    partitions_type _partitions; // Cached partitions are complete.
+    partitions_type _partitions; // Cached partitions are complete, or partial with known continuity.
     mutation_source _underlying;
     key_source _underlying_keys;
 
@@ -231,6 +405,10 @@ class row_cache final {
                                          query::clustering_key_filtering_context ck_filtering);
     void on_hit();
     void on_miss();
+    streamed_mutation read_entry(cache_entry&, const schema_ptr&, query::clustering_key_filtering_context);
+    future<streamed_mutation> read_entry_with_missing_ranges(cache_entry&, const schema_ptr&,
+                                                              query::clustering_key_filtering_context,
+                                                              const io_priority_class&);
     void upgrade_entry(cache_entry&);
     void invalidate_locked(const dht::decorated_key&);
     void invalidate_unwrapped(const query::partition_range&);
@@ -258,6 +436,11 @@ class row_cache final {
     // information there is for its partition in the underlying data sources.
     void populate(const mutation& m);
 
+    // Populate cache from given mutation, which contains all information there
+    // is in the underlying data sources for the given clustering ranges of its
+    // partition. Other clustering ranges of the partition are left untouched.
+    void populate(const mutation& m, const query::clustering_row_ranges&);
+
     // Clears the cache.
     // Guarantees that cache will not be populated using readers created
     // before this method was invoked.
@@ -324,6 +324,12 @@ index_info::index_info(::index_type idx_type,
     : index_type(idx_type), index_name(idx_name), index_options(idx_options)
 {}
 
+bool operator==(const index_info& x, const index_info& y) {
+    return x.index_type == y.index_type
+        && x.index_name == y.index_name
+        && x.index_options == y.index_options;
+}
+
 column_definition::column_definition(bytes name, data_type type, column_kind kind, column_id component_index, index_info idx, api::timestamp_type dropped_at)
         : _name(std::move(name)), _dropped_at(dropped_at), _is_atomic(type->is_atomic()), type(std::move(type)), id(component_index), kind(kind), idx_info(std::move(idx))
 {}
@@ -451,6 +457,7 @@ bool operator==(const column_definition& x, const column_definition& y)
         && x.type->equals(y.type)
         && x.id == y.id
         && x.kind == y.kind
+        && x.idx_info == y.idx_info
         && x._dropped_at == y._dropped_at;
 }
 
@@ -526,10 +533,10 @@ void schema_builder::add_default_index_names(database& db) {
 
     auto existing_names = db.existing_index_names();
     for (auto& sc : _raw._columns) {
-        if (sc.idx_info.index_type != index_type::none && sc.idx_info.index_name) {
-            sstring base_name = cf_name() + "_" + *sc.idx_info.index_name + "_idx";
+        if (sc.idx_info.index_type != index_type::none && !sc.idx_info.index_name) {
+            sstring base_name = cf_name() + "_" + sc.name_as_text() + "_idx";
             auto i = std::remove_if(base_name.begin(), base_name.end(), [](char c) {
-               return ::isspace(c);
+               return !::isalnum(c) && c != '_';
             });
             base_name.erase(i, base_name.end());
             auto index_name = base_name;
@@ -538,6 +545,7 @@ void schema_builder::add_default_index_names(database& db) {
                 index_name = base_name + "_" + to_sstring(++n);
             }
             sc.idx_info.index_name = index_name;
+            existing_names.emplace(index_name);
         }
     }
 }
@@ -186,6 +186,8 @@ struct index_info {
     std::experimental::optional<index_options_map> index_options;
 };
 
+bool operator==(const index_info&, const index_info&);
+
 class column_definition final {
 public:
     struct name_comparator {
@@ -230,6 +232,7 @@ class column_definition final {
     bool is_clustering_key() const { return kind == column_kind::clustering_key; }
     bool is_primary_key() const { return kind == column_kind::partition_key || kind == column_kind::clustering_key; }
     bool is_atomic() const { return _is_atomic; }
+    bool is_counter() const { return type->is_counter(); }
     bool is_compact_value() const { return kind == column_kind::compact_column; }
     const sstring& name_as_text() const;
     const bytes& name() const;
@@ -456,7 +459,7 @@ class schema final : public enable_lw_shared_from_this<schema> {
         return _raw._comment;
     }
     bool is_counter() const {
-        return false;
+        return _raw._default_validator->is_counter();
     }
 
     const cf_type type() const {
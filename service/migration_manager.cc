@@ -46,6 +46,7 @@
 #include "message/messaging_service.hh"
 #include "service/storage_service.hh"
 #include "service/migration_task.hh"
+#include "db/index/secondary_index.hh"
 #include "utils/runtime.hh"
 #include "gms/gossiper.hh"
 
@@ -467,6 +468,35 @@ future<> migration_manager::announce_column_family_update(schema_ptr cfm, bool f
     }
 }
 
+future<> migration_manager::announce_index_update(schema_ptr cfm, std::vector<schema_ptr> created_index_tables,
+        std::vector<schema_ptr> dropped_index_tables, bool announce_locally) {
+    try {
+        auto& db = get_local_storage_proxy().get_db().local();
+        auto&& old_schema = db.find_column_family(cfm->ks_name(), cfm->cf_name()).schema();
+        auto&& keyspace = db.find_keyspace(cfm->ks_name());
+        auto timestamp = api::new_timestamp();
+        logger.info("Update table '{}.{}' From {} To {}", cfm->ks_name(), cfm->cf_name(), *old_schema, *cfm);
+        auto mutations = db::schema_tables::make_update_table_mutations(keyspace.metadata(), old_schema, cfm, timestamp, false);
+        for (auto&& s : created_index_tables) {
+            if (db.has_schema(s->ks_name(), s->cf_name())) {
+                throw exceptions::already_exists_exception(s->ks_name(), s->cf_name());
+            }
+            logger.info("Create index table: {}", s);
+            auto m = db::schema_tables::make_create_table_mutations(keyspace.metadata(), s, timestamp);
+            std::move(m.begin(), m.end(), std::back_inserter(mutations));
+        }
+        for (auto&& s : dropped_index_tables) {
+            logger.info("Drop index table '{}.{}'", s->ks_name(), s->cf_name());
+            auto m = db::schema_tables::make_drop_table_mutations(keyspace.metadata(), s, timestamp);
+            std::move(m.begin(), m.end(), std::back_inserter(mutations));
+        }
+        return announce(std::move(mutations), announce_locally);
+    } catch (const no_such_column_family& e) {
+        throw exceptions::configuration_exception(sprint("Cannot update non existing table '%s' in keyspace '%s'.",
+                                                         cfm->cf_name(), cfm->ks_name()));
+    }
+}
+
 static future<> do_announce_new_type(user_type new_type, bool announce_locally) {
     auto& db = get_local_storage_proxy().get_db().local();
     auto&& keyspace = db.find_keyspace(new_type->_keyspace);
@@ -560,7 +590,18 @@ future<> migration_manager::announce_column_family_drop(const sstring& ks_name,
         auto&& old_cfm = db.find_schema(ks_name, cf_name);
         auto&& keyspace = db.find_keyspace(ks_name);
         logger.info("Drop table '{}.{}'", old_cfm->ks_name(), old_cfm->cf_name());
-        auto mutations = db::schema_tables::make_drop_table_mutations(keyspace.metadata(), old_cfm, api::new_timestamp());
+        auto timestamp = api::new_timestamp();
+        auto mutations = db::schema_tables::make_drop_table_mutations(keyspace.metadata(), old_cfm, timestamp);
+        // Secondary indexes go away with their table.
+        for (auto&& cdef : old_cfm->regular_columns()) {
+            auto index_schema = db::index::find_index_schema(db, *old_cfm, cdef);
+            if (!cdef.is_indexed() || !index_schema) {
+                continue;
+            }
+            logger.info("Drop index table '{}.{}'", index_schema->ks_name(), index_schema->cf_name());
+            auto m = db::schema_tables::make_drop_table_mutations(keyspace.metadata(), index_schema, timestamp);
+            std::move(m.begin(), m.end(), std::back_inserter(mutations));
+        }
         return announce(std::move(mutations), announce_locally);
     } catch (const no_such_column_family& e) {
         throw exceptions::configuration_exception(sprint("Cannot drop non existing table '%s' in keyspace '%s'.", cf_name, ks_name));
@@ -103,6 +103,11 @@ class migration_manager : public seastar::async_sharded_service<migration_manage
 
     future<> announce_new_column_family(schema_ptr cfm, bool announce_locally = false);
 
+    // Updates cfm and creates or drops the tables of its secondary indexes
+    // in a single schema change.
+    future<> announce_index_update(schema_ptr cfm, std::vector<schema_ptr> created_index_tables,
+            std::vector<schema_ptr> dropped_index_tables, bool announce_locally = false);
+
     future<> announce_new_type(user_type new_type, bool announce_locally = false);
 
     future<> announce_type_update(user_type updated_type, bool announce_locally = false);
@@ -50,10 +50,12 @@
 #include "gms/failure_detector.hh"
 #include "gms/gossiper.hh"
 #include "storage_service.hh"
+#include "migration_manager.hh"
 #include "core/future-util.hh"
 #include "db/read_repair_decision.hh"
 #include "db/config.hh"
 #include "db/batchlog_manager.hh"
+#include "db/hints_manager.hh"
 #include "exceptions/exceptions.hh"
 #include <boost/range/algorithm_ext/push_back.hpp>
 #include <boost/iterator/counting_iterator.hpp>
@@ -70,6 +72,7 @@
 #include "schema.hh"
 #include "schema_registry.hh"
 #include "utils/joinpoint.hh"
+#include "db/index/secondary_index.hh"
 
 namespace service {
 
@@ -117,6 +120,11 @@ class mutation_holder {
     virtual ~mutation_holder() {}
     virtual lw_shared_ptr<const frozen_mutation> get_mutation_for(gms::inet_address ep) = 0;
     virtual bool is_shared() = 0;
+    // Whether a copy of the mutation should be stored as a hint for
+    // replicas which fail to acknowledge it.
+    virtual bool is_hintable() const {
+        return true;
+    }
     size_t size() const {
         return _size;
     }
@@ -169,6 +177,16 @@ class shared_mutation : public mutation_holder {
     }
 };
 
+// a hint replayed to the replica it was stored for; if the replica fails
+// to acknowledge it, it stays in the hints log and must not be hinted again
+class hinted_mutation : public shared_mutation {
+public:
+    using shared_mutation::shared_mutation;
+    virtual bool is_hintable() const override {
+        return false;
+    }
+};
+
 class abstract_write_response_handler {
 protected:
     storage_proxy::response_id_type _id;
@@ -487,6 +505,16 @@ storage_proxy::storage_proxy(distributed<database>& db) : _db(db) {
                 , "total_operations", "read retries")
                 , scollectd::make_typed(scollectd::data_type::DERIVE, _stats.read_retries)
         ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("storage_proxy"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "speculative retries")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _stats.speculative_retries)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("storage_proxy"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "speculative retries won")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _stats.speculative_retries_won)
+        ),
         scollectd::add_polled_metric(scollectd::type_instance_id("storage_proxy"
                 , scollectd::per_cpu_plugin_instance
                 , "total_operations", "global_read_repairs_canceled_due_to_concurrent_write")
@@ -1148,6 +1176,25 @@ storage_proxy::mutate_internal(Range mutations, db::consistency_level cl) {
     });
 }
 
+future<>
+storage_proxy::send_hint_to_endpoint(mutation m, gms::inet_address target) {
+    logger.trace("send hint to {}", target);
+    utils::latency_counter lc;
+    lc.start();
+
+    auto cl = db::consistency_level::ONE;
+    auto& ks = _db.local().find_keyspace(m.schema()->ks_name());
+    return mutate_prepare(std::array<mutation, 1>{{std::move(m)}}, cl, db::write_type::SIMPLE,
+            [this, &ks, target] (const mutation& m, db::consistency_level cl, db::write_type type) {
+        return create_write_response_handler(ks, cl, type, std::make_unique<hinted_mutation>(m), {target},
+                std::vector<gms::inet_address>(), std::vector<gms::inet_address>());
+    }).then([this, cl] (std::vector<storage_proxy::unique_response_handler> ids) {
+        return mutate_begin(std::move(ids), cl);
+    }).then_wrapped([p = shared_from_this(), lc] (future<> f) {
+        return p->mutate_end(std::move(f), lc);
+    });
+}
+
 future<>
 storage_proxy::mutate_with_triggers(std::vector<mutation> mutations, db::consistency_level cl,
         bool should_mutate_atomically) {
@@ -1158,6 +1205,14 @@ storage_proxy::mutate_with_triggers(std::vector<mutation> mutations, db::consist
             return mutate_atomically(augmented, consistencyLevel);
         } else {
 #endif
+    if (!mutations.empty() && mutations.front().schema()->is_counter()) {
+        return mutate_counters(std::move(mutations), cl);
+    }
+    // Secondary index entries are written along with the base mutations, at
+    // the same consistency level. Entries made stale by the write are left
+    // for the readers to clean up.
+    auto index_mutations = db::index::make_index_mutations(_db.local(), mutations);
+    std::move(index_mutations.begin(), index_mutations.end(), std::back_inserter(mutations));
     if (should_mutate_atomically) {
         return mutate_atomically(std::move(mutations), cl);
     }
@@ -1167,6 +1222,65 @@ storage_proxy::mutate_with_triggers(std::vector<mutation> mutations, db::consist
 #endif
 }
 
+/*
+ * Counter updates are sent to a single live replica, the leader, which turns
+ * them into shards of its own and replicates the result like any other
+ * mutation. We pick the closest replica, which is this node if it is one.
+ */
+future<>
+storage_proxy::mutate_counters(std::vector<mutation> mutations, db::consistency_level cl) {
+    std::vector<mutation> local_mutations;
+    std::unordered_map<gms::inet_address, std::vector<frozen_mutation>> remote_mutations;
+    auto my_address = utils::fb_utilities::get_broadcast_address();
+    for (auto&& m : mutations) {
+        db::validate_counter_for_write(m.schema(), cl);
+        auto& ks = _db.local().find_keyspace(m.schema()->ks_name());
+        auto live_endpoints = get_live_sorted_endpoints(ks, m.token());
+        if (live_endpoints.empty()) {
+            throw exceptions::unavailable_exception(cl, db::block_for(ks, cl), 0);
+        }
+        auto leader = live_endpoints.front();
+        if (leader == my_address) {
+            local_mutations.emplace_back(std::move(m));
+        } else {
+            remote_mutations[leader].emplace_back(freeze(m));
+        }
+    }
+
+    auto timeout = clock_type::now() + std::chrono::milliseconds(_db.local().get_config().write_request_timeout_in_ms());
+    return do_with(std::move(local_mutations), std::move(remote_mutations), [this, cl, timeout] (auto& local_mutations, auto& remote_mutations) {
+        auto local = parallel_for_each(local_mutations, [this, cl] (const mutation& m) {
+            return mutate_counter_on_leader_and_replicate(m.schema(), freeze(m), cl);
+        });
+        auto remote = parallel_for_each(remote_mutations, [cl, timeout] (auto& leader_and_mutations) {
+            auto& ms = net::get_local_messaging_service();
+            auto leader = net::messaging_service::msg_addr{leader_and_mutations.first, 0};
+            return ms.send_counter_mutation(leader, timeout, std::move(leader_and_mutations.second), cl);
+        });
+        return when_all(std::move(local), std::move(remote)).then([] (auto&& results) {
+            // Both futures have to be consumed even if the first one failed.
+            auto& local = std::get<0>(results);
+            auto& remote = std::get<1>(results);
+            if (local.failed()) {
+                remote.ignore_ready_future();
+                return std::move(local);
+            }
+            return std::move(remote);
+        });
+    });
+}
+
+future<>
+storage_proxy::mutate_counter_on_leader_and_replicate(const schema_ptr& s, frozen_mutation fm, db::consistency_level cl) {
+    auto shard = _db.local().shard_of(fm);
+    return _db.invoke_on(shard, [gs = global_schema_ptr(s), fm = std::move(fm), cl] (database& db) {
+        auto local_id = counter_id(get_local_storage_service().get_local_id());
+        return db.apply_counter_update(gs, fm, local_id).then([cl] (mutation m) {
+            return get_local_storage_proxy().mutate_internal(std::vector<mutation>{std::move(m)}, cl);
+        });
+    });
+}
+
 /**
  * See mutate. Adds additional steps before and after writing a batch.
  * Before writing the batch (but after doing availability check against the FD for the row replicas):
@@ -1370,6 +1484,9 @@ void storage_proxy::send_to_live_endpoints(storage_proxy::response_id_type respo
 template<typename Range>
 size_t storage_proxy::hint_to_dead_endpoints(std::unique_ptr<mutation_holder>& mh, const Range& targets) noexcept
 {
+    if (!mh->is_hintable()) {
+        return 0;
+    }
     return boost::count_if(targets | boost::adaptors::filtered(std::bind1st(std::mem_fn(&storage_proxy::should_hint), this)),
             std::bind(std::mem_fn(&storage_proxy::submit_hint), this, std::ref(mh), std::placeholders::_1));
 }
@@ -1386,32 +1503,24 @@ size_t storage_proxy::get_hints_in_progress_for(gms::inet_address target) {
 
 bool storage_proxy::submit_hint(std::unique_ptr<mutation_holder>& mh, gms::inet_address target)
 {
-    warn(unimplemented::cause::HINT);
-    // local write that time out should be handled by LocalMutationRunnable
-    assert(is_me(target));
-    return false;
-#if 0
-    HintRunnable runnable = new HintRunnable(target)
-    {
-        public void runMayThrow()
-        {
-            int ttl = HintedHandOffManager.calculateHintTTL(mutation);
-            if (ttl > 0)
-            {
-                logger.debug("Adding hint for {}", target);
-                writeHintForMutation(mutation, System.currentTimeMillis(), ttl, target);
-                // Notify the handler only for CL == ANY
-                if (responseHandler != null && responseHandler.consistencyLevel == ConsistencyLevel.ANY)
-                    responseHandler.response(null);
-            } else
-            {
-                logger.debug("Skipped writing hint for {} (ttl {})", target, ttl);
-            }
+    auto fm = mh->get_mutation_for(target);
+    if (!fm) {
+        return false;
+    }
+    logger.debug("Adding hint for {}", target);
+    ++_total_hints_in_progress;
+    ++_hints_in_progress[target];
+    // The hint is appended to the hints log in the background; the write
+    // only has to wait for it being accepted. Failures to store it are
+    // accounted for by the hints manager.
+    db::get_local_hints_manager().store_hint(target, mh->schema(), std::move(fm)).finally([p = shared_from_this(), target] {
+        --p->_total_hints_in_progress;
+        auto it = p->_hints_in_progress.find(target);
+        if (--it->second == 0) {
+            p->_hints_in_progress.erase(it);
         }
-    };
-
-    return submitHint(runnable);
-#endif
+    });
+    return true;
 }
 
 #if 0
@@ -1629,6 +1738,8 @@ class digest_read_resolver : public abstract_read_resolver {
     foreign_ptr<lw_shared_ptr<query::result>> _data_result;
     std::vector<query::result_digest> _digest_results;
     api::timestamp_type _last_modified = api::missing_timestamp;
+    stdx::optional<gms::inet_address> _speculative_target;
+    bool _speculative_target_counted = false;
 
     virtual void on_timeout() override {
         if (!_cl_reported) {
@@ -1676,6 +1787,9 @@ class digest_read_resolver : public abstract_read_resolver {
         if (!_cl_reported) {
             if (waiting_for(ep)) {
                 _cl_responses++;
+                if (_speculative_target && *_speculative_target == ep) {
+                    _speculative_target_counted = true;
+                }
             }
             if (_cl_responses >= _block_for && _data_result) {
                 _cl_reported = true;
@@ -1696,6 +1810,14 @@ class digest_read_resolver : public abstract_read_resolver {
     void add_wait_targets(size_t targets_count) {
         _targets_count += targets_count;
     }
+    // Marks ep as the extra replica queried by speculative retry.
+    void add_speculative_target(gms::inet_address ep) {
+        _speculative_target = ep;
+    }
+    // True if CL was reached with the help of the speculative replica.
+    bool speculation_won() const {
+        return _cl_reported && _speculative_target_counted;
+    }
     bool is_completed() {
         return response_count() == _targets_count;
     }
@@ -2078,6 +2200,7 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     size_t _block_for;
     std::vector<gms::inet_address> _targets;
     promise<foreign_ptr<lw_shared_ptr<query::result>>> _result_promise;
+    clock_type::time_point _start = clock_type::now();
 
 public:
     abstract_read_executor(schema_ptr s, shared_ptr<storage_proxy> proxy, lw_shared_ptr<query::read_command> cmd, query::partition_range pr, db::consistency_level cl, size_t block_for,
@@ -2090,6 +2213,24 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     };
 
 protected:
+    void mark_replica_latency(gms::inet_address ep, clock_type::time_point start) {
+        _proxy->_replica_read_latency[ep].mark(clock_type::now() - start);
+    }
+    void mark_read_latency() {
+        _proxy->_cf_read_stats[_schema->id()].latency.mark(clock_type::now() - _start);
+    }
+    void mark_speculative_retry() {
+        _proxy->_stats.speculative_retries++;
+        _proxy->_cf_read_stats[_schema->id()].speculative_retries++;
+    }
+    void mark_speculative_retry_won() {
+        _proxy->_stats.speculative_retries_won++;
+        _proxy->_cf_read_stats[_schema->id()].speculative_retries_won++;
+    }
+    // Replicas other than the last one are queried up front.
+    clock_type::duration speculative_retry_delay() {
+        return _proxy->speculative_retry_delay(*_schema, _targets, _targets.size() - 1);
+    }
     future<foreign_ptr<lw_shared_ptr<reconcilable_result>>> make_mutation_data_request(lw_shared_ptr<query::read_command> cmd, gms::inet_address ep, clock_type::time_point timeout) {
         ++_proxy->_stats.mutation_data_read_attempts.get_ep_stat(ep);
         if (is_me(ep)) {
@@ -2138,9 +2279,12 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     }
     future<> make_data_requests(digest_resolver_ptr resolver, targets_iterator begin, targets_iterator end, clock_type::time_point timeout) {
         return parallel_for_each(begin, end, [this, resolver = std::move(resolver), timeout] (gms::inet_address ep) {
-            return make_data_request(ep, timeout).then_wrapped([this, resolver, ep] (future<foreign_ptr<lw_shared_ptr<query::result>>> f) {
+            auto start = clock_type::now();
+            return make_data_request(ep, timeout).then_wrapped([this, resolver, ep, start] (future<foreign_ptr<lw_shared_ptr<query::result>>> f) {
                 try {
-                    resolver->add_data(ep, f.get0());
+                    auto result = f.get0();
+                    mark_replica_latency(ep, start);
+                    resolver->add_data(ep, std::move(result));
                     ++_proxy->_stats.data_read_completed.get_ep_stat(ep);
                 } catch(...) {
                     ++_proxy->_stats.data_read_errors.get_ep_stat(ep);
@@ -2151,9 +2295,11 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     }
     future<> make_digest_requests(digest_resolver_ptr resolver, targets_iterator begin, targets_iterator end, clock_type::time_point timeout) {
         return parallel_for_each(begin, end, [this, resolver = std::move(resolver), timeout] (gms::inet_address ep) {
-            return make_digest_request(ep, timeout).then_wrapped([this, resolver, ep] (future<query::result_digest, api::timestamp_type> f) {
+            auto start = clock_type::now();
+            return make_digest_request(ep, timeout).then_wrapped([this, resolver, ep, start] (future<query::result_digest, api::timestamp_type> f) {
                 try {
                     auto v = f.get();
+                    mark_replica_latency(ep, start);
                     resolver->add_digest(ep, std::get<0>(v), std::get<1>(v));
                     ++_proxy->_stats.digest_read_completed.get_ep_stat(ep);
                 } catch(...) {
@@ -2256,6 +2402,7 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
                 foreign_ptr<lw_shared_ptr<query::result>> result;
                 bool digests_match;
                 std::tie(result, digests_match) = f.get(); // can throw
+                exec->mark_read_latency();
 
                 if (digests_match) {
                     exec->_result_promise.set_value(std::move(result));
@@ -2320,11 +2467,15 @@ class always_speculating_read_executor : public abstract_read_executor {
 // this executor sends request to an additional replica after some time below timeout
 class speculating_read_executor : public abstract_read_executor {
     timer<> _speculate_timer;
+    digest_resolver_ptr _speculation_resolver;
 public:
     using abstract_read_executor::abstract_read_executor;
     virtual future<> make_requests(digest_resolver_ptr resolver, std::chrono::steady_clock::time_point timeout) {
         _speculate_timer.set_callback([this, resolver, timeout] {
             if (!resolver->is_completed()) { // at the time the callback runs request may be completed already
+                mark_speculative_retry();
+                _speculation_resolver = resolver;
+                resolver->add_speculative_target(_targets.back());
                 resolver->add_wait_targets(1); // we send one more request so wait for it too
                 future<> f = resolver->has_data() ?
                         make_digest_requests(resolver, _targets.end() - 1, _targets.end(), timeout) :
@@ -2332,12 +2483,7 @@ class speculating_read_executor : public abstract_read_executor {
                 f.finally([exec = shared_from_this()]{});
             }
         });
-        auto& sr = _schema->speculative_retry();
-        auto t = (sr.get_type() == speculative_retry::type::PERCENTILE) ?
-            // FIXME: the timeout should come from previous latency statistics for a partition
-            std::chrono::milliseconds(_proxy->get_db().local().get_config().read_request_timeout_in_ms()/2) :
-            std::chrono::milliseconds(unsigned(sr.get_value()));
-        _speculate_timer.arm(t);
+        _speculate_timer.arm(speculative_retry_delay());
 
         // if CL + RR result in covering all replicas, getReadExecutor forces AlwaysSpeculating.  So we know
         // that the last replica in our list is "extra."
@@ -2357,6 +2503,9 @@ class speculating_read_executor : public abstract_read_executor {
     }
     virtual void got_cl() override {
         _speculate_timer.cancel();
+        if (_speculation_resolver && _speculation_resolver->speculation_won()) {
+            mark_speculative_retry_won();
+        }
     }
 };
 
@@ -2370,6 +2519,99 @@ class range_slice_read_executor : public abstract_read_executor {
     }
 };
 
+// Returns how long a read waits for the replicas it queried before it asks an
+// extra one. For PERCENTILE, this is the percentile of the recent coordinator
+// read latencies of the column family. Until there are enough of those, the
+// slowest percentile of the queried replicas is used instead, and half the
+// read timeout if the replicas were not seen often enough either. Only the
+// first count targets were queried.
+storage_proxy::clock_type::duration storage_proxy::speculative_retry_delay(const schema& s, const std::vector<gms::inet_address>& targets, size_t count) {
+    static constexpr double min_samples = 100;
+    auto& sr = s.speculative_retry();
+    if (sr.get_type() != speculative_retry::type::PERCENTILE) {
+        return std::chrono::milliseconds(unsigned(sr.get_value()));
+    }
+    auto p = sr.get_value();
+    auto i = _cf_read_stats.find(s.id());
+    if (i != _cf_read_stats.end() && i->second.latency.count() >= min_samples) {
+        return i->second.latency.percentile(p);
+    }
+    auto fallback = std::chrono::milliseconds(_db.local().get_config().read_request_timeout_in_ms() / 2);
+    if (count == 0) {
+        return fallback;
+    }
+    clock_type::duration delay = clock_type::duration::zero();
+    for (auto&& ep : boost::make_iterator_range(targets.begin(), targets.begin() + count)) {
+        auto j = _replica_read_latency.find(ep);
+        if (j == _replica_read_latency.end() || j->second.count() < min_samples) {
+            return fallback;
+        }
+        delay = std::max(delay, j->second.percentile(p));
+    }
+    return delay;
+}
+
+uint64_t storage_proxy::get_speculative_retries(const utils::UUID& cf_id) const {
+    auto i = _cf_read_stats.find(cf_id);
+    return i == _cf_read_stats.end() ? 0 : i->second.speculative_retries;
+}
+
+uint64_t storage_proxy::get_speculative_retries_won(const utils::UUID& cf_id) const {
+    auto i = _cf_read_stats.find(cf_id);
+    return i == _cf_read_stats.end() ? 0 : i->second.speculative_retries_won;
+}
+
+class storage_proxy::read_stats_pruner : public migration_listener, public endpoint_lifecycle_subscriber {
+    storage_proxy& _proxy;
+public:
+    explicit read_stats_pruner(storage_proxy& proxy) : _proxy(proxy) { }
+
+    virtual void on_create_keyspace(const sstring& ks_name) override { }
+    virtual void on_create_column_family(const sstring& ks_name, const sstring& cf_name) override { }
+    virtual void on_create_user_type(const sstring& ks_name, const sstring& type_name) override { }
+    virtual void on_create_function(const sstring& ks_name, const sstring& function_name) override { }
+    virtual void on_create_aggregate(const sstring& ks_name, const sstring& aggregate_name) override { }
+
+    virtual void on_update_keyspace(const sstring& ks_name) override { }
+    virtual void on_update_column_family(const sstring& ks_name, const sstring& cf_name, bool columns_changed) override { }
+    virtual void on_update_user_type(const sstring& ks_name, const sstring& type_name) override { }
+    virtual void on_update_function(const sstring& ks_name, const sstring& function_name) override { }
+    virtual void on_update_aggregate(const sstring& ks_name, const sstring& aggregate_name) override { }
+
+    // The notifications only carry names, and come after the column family
+    // is gone, so the stats of every column family which no longer exists
+    // are dropped.
+    virtual void on_drop_keyspace(const sstring& ks_name) override {
+        prune_dropped_column_families();
+    }
+    virtual void on_drop_column_family(const sstring& ks_name, const sstring& cf_name) override {
+        prune_dropped_column_families();
+    }
+    virtual void on_drop_user_type(const sstring& ks_name, const sstring& type_name) override { }
+    virtual void on_drop_function(const sstring& ks_name, const sstring& function_name) override { }
+    virtual void on_drop_aggregate(const sstring& ks_name, const sstring& aggregate_name) override { }
+
+    virtual void on_join_cluster(const gms::inet_address& endpoint) override { }
+    virtual void on_leave_cluster(const gms::inet_address& endpoint) override {
+        _proxy._replica_read_latency.erase(endpoint);
+    }
+    virtual void on_up(const gms::inet_address& endpoint) override { }
+    virtual void on_down(const gms::inet_address& endpoint) override { }
+    virtual void on_move(const gms::inet_address& endpoint) override { }
+private:
+    void prune_dropped_column_families() {
+        auto& db = _proxy._db.local();
+        auto& stats = _proxy._cf_read_stats;
+        for (auto it = stats.begin(); it != stats.end();) {
+            if (db.column_family_exists(it->first)) {
+                ++it;
+            } else {
+                it = stats.erase(it);
+            }
+        }
+    }
+};
+
 db::read_repair_decision storage_proxy::new_read_repair_decision(const schema& s) {
     double chance = _read_repair_chance(_urandom);
     if (s.read_repair_chance() > chance) {
@@ -2475,6 +2717,10 @@ storage_proxy::query_singular(lw_shared_ptr<query::read_command> cmd, std::vecto
     exec.reserve(partition_ranges.size());
     auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(_db.local().get_config().read_request_timeout_in_ms());
 
+    // All replicas must calculate their digests the same way.
+    cmd->digest_algo = get_local_storage_service().cluster_supports_murmur3_digest()
+            ? query::digest_algorithm::murmur3 : query::digest_algorithm::MD5;
+
     for (auto&& pr: partition_ranges) {
         if (!pr.is_singular()) {
             throw std::runtime_error("mixed singular and non singular range are not supported");
@@ -2924,32 +3170,19 @@ bool storage_proxy::should_hint(gms::inet_address ep) noexcept {
         return false;
     }
 
-    return false;
-#if 0
-    if (DatabaseDescriptor.shouldHintByDC())
-    {
-        final String dc = DatabaseDescriptor.getEndpointSnitch().getDatacenter(ep);
-        //Disable DC specific hints
-        if(!DatabaseDescriptor.hintedHandoffEnabled(dc))
-        {
-            HintedHandOffManager.instance.metrics.incrPastWindow(ep);
-            return false;
-        }
-    }
-    else if (!DatabaseDescriptor.hintedHandoffEnabled())
-    {
-        HintedHandOffManager.instance.metrics.incrPastWindow(ep);
+    auto& cfg = _db.local().get_config();
+    if (!cfg.hinted_handoff_enabled() || !db::get_hints_manager().local_is_initialized()) {
         return false;
     }
 
-    boolean hintWindowExpired = Gossiper.instance.getEndpointDowntime(ep) > DatabaseDescriptor.getMaxHintWindow();
-    if (hintWindowExpired)
-    {
-        HintedHandOffManager.instance.metrics.incrPastWindow(ep);
-        Tracing.trace("Not hinting {} which has been down {}ms", ep, Gossiper.instance.getEndpointDowntime(ep));
+    auto& hm = db::get_local_hints_manager();
+    auto downtime = std::chrono::microseconds(gms::get_local_gossiper().get_endpoint_downtime(ep));
+    if (downtime > std::chrono::milliseconds(cfg.max_hint_window_in_ms())) {
+        hm.note_hint_past_window(ep);
+        logger.trace("Not hinting {} which has been down {}ms", ep, std::chrono::duration_cast<std::chrono::milliseconds>(downtime).count());
+        return false;
     }
-    return !hintWindowExpired;
-#endif
+    return true;
 }
 
 future<> storage_proxy::truncate_blocking(sstring keyspace, sstring cfname) {
@@ -3164,7 +3397,23 @@ future<> storage_proxy::truncate_blocking(sstring keyspace, sstring cfname) {
 #endif
 
 void storage_proxy::init_messaging_service() {
+    // The migration manager is started after the proxy, so the pruner is
+    // registered along with the verbs rather than on construction.
+    _read_stats_pruner = std::make_unique<read_stats_pruner>(*this);
+    get_local_migration_manager().register_listener(_read_stats_pruner.get());
+    get_local_storage_service().register_subscriber(_read_stats_pruner.get());
+
     auto& ms = net::get_local_messaging_service();
+    ms.register_counter_mutation([] (const rpc::client_info& cinfo, std::vector<frozen_mutation> fms, db::consistency_level cl) {
+        auto src_addr = net::messaging_service::get_source(cinfo);
+        return do_with(std::move(fms), get_local_shared_storage_proxy(), [src_addr, cl] (const std::vector<frozen_mutation>& mutations, shared_ptr<storage_proxy>& p) {
+            return parallel_for_each(mutations, [src_addr, cl, &p] (const frozen_mutation& fm) {
+                return get_schema_for_write(fm.schema_version(), src_addr).then([&p, &fm, cl] (schema_ptr s) {
+                    return p->mutate_counter_on_leader_and_replicate(s, fm, cl);
+                });
+            });
+        });
+    });
     ms.register_mutation([] (const rpc::client_info& cinfo, frozen_mutation in, std::vector<gms::inet_address> forward, gms::inet_address reply_to, unsigned shard, storage_proxy::response_id_type response_id) {
         return do_with(std::move(in), get_local_shared_storage_proxy(), [&cinfo, forward = std::move(forward), reply_to, shard, response_id] (const frozen_mutation& m, shared_ptr<storage_proxy>& p) {
             ++p->_stats.received_mutations;
@@ -3278,7 +3527,14 @@ void storage_proxy::init_messaging_service() {
 }
 
 void storage_proxy::uninit_messaging_service() {
+    if (_read_stats_pruner) {
+        get_local_storage_service().unregister_subscriber(_read_stats_pruner.get());
+        get_local_migration_manager().unregister_listener(_read_stats_pruner.get());
+        _read_stats_pruner = {};
+    }
+
     auto& ms = net::get_local_messaging_service();
+    ms.unregister_counter_mutation();
     ms.unregister_mutation();
     ms.unregister_mutation_done();
     ms.unregister_read_data();
@@ -150,6 +150,8 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
         uint64_t reads = 0;
         uint64_t background_reads = 0; // client no longer waits for the read
         uint64_t read_retries = 0; // read is retried with new limit
+        uint64_t speculative_retries = 0; // extra replica queried because the read was slow
+        uint64_t speculative_retries_won = 0; // ... and its reply counted towards the CL
 
         // Data read attempts
         split_stats data_read_attempts;
@@ -190,6 +192,20 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     std::default_random_engine _urandom;
     std::uniform_real_distribution<> _read_repair_chance = std::uniform_real_distribution<>(0,1);
     std::unique_ptr<scollectd::registrations> _collectd_registrations;
+    // Coordinator read statistics of each column family. The decaying
+    // latencies are used to arm the speculative retry timer.
+    struct cf_read_stats {
+        utils::decaying_latency_histogram latency;
+        uint64_t speculative_retries = 0;
+        uint64_t speculative_retries_won = 0;
+    };
+    std::unordered_map<utils::UUID, cf_read_stats> _cf_read_stats;
+    // Recent read response latencies of each replica.
+    std::unordered_map<gms::inet_address, utils::decaying_latency_histogram> _replica_read_latency;
+    // Drops the read statistics of dropped column families and of nodes
+    // which left the cluster.
+    class read_stats_pruner;
+    std::unique_ptr<read_stats_pruner> _read_stats_pruner;
 private:
     void uninit_messaging_service();
     future<foreign_ptr<lw_shared_ptr<query::result>>> query_singular(lw_shared_ptr<query::read_command> cmd, std::vector<query::partition_range>&& partition_ranges, db::consistency_level cl);
@@ -212,6 +228,7 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     bool submit_hint(std::unique_ptr<mutation_holder>& mh, gms::inet_address target);
     std::vector<gms::inet_address> get_live_sorted_endpoints(keyspace& ks, const dht::token& token);
     db::read_repair_decision new_read_repair_decision(const schema& s);
+    clock_type::duration speculative_retry_delay(const schema& s, const std::vector<gms::inet_address>& targets, size_t count);
     ::shared_ptr<abstract_read_executor> get_read_executor(lw_shared_ptr<query::read_command> cmd, query::partition_range pr, db::consistency_level cl);
     future<foreign_ptr<lw_shared_ptr<query::result>>> query_singular_local(schema_ptr, lw_shared_ptr<query::read_command> cmd, const query::partition_range& pr,
                                                                            query::result_request request = query::result_request::result_and_digest);
@@ -240,6 +257,8 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     void handle_read_error(std::exception_ptr eptr);
     template<typename Range>
     future<> mutate_internal(Range mutations, db::consistency_level cl);
+    future<> mutate_counters(std::vector<mutation> mutations, db::consistency_level cl);
+    future<> mutate_counter_on_leader_and_replicate(const schema_ptr& s, frozen_mutation m, db::consistency_level cl);
 
 public:
     storage_proxy(distributed<database>& db);
@@ -248,6 +267,9 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
         return _db;
     }
 
+    uint64_t get_speculative_retries(const utils::UUID& cf_id) const;
+    uint64_t get_speculative_retries_won(const utils::UUID& cf_id) const;
+
     void init_messaging_service();
 
     future<> mutate_locally(const mutation& m);
@@ -270,6 +292,13 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     future<> mutate_with_triggers(std::vector<mutation> mutations, db::consistency_level cl,
         bool should_mutate_atomically);
 
+    /**
+     * Delivers a hint replayed from the hints log to the replica it was
+     * stored for. The returned future fails if the replica does not
+     * acknowledge the write; the hint is not stored again in that case.
+     */
+    future<> send_hint_to_endpoint(mutation m, gms::inet_address target);
+
     /**
     * See mutate. Adds additional steps before and after writing a batch.
     * Before writing the batch (but after doing availability check against the FD for the row replicas):
@@ -309,6 +338,10 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
         return _stats;
     }
 
+    size_t get_total_hints_in_progress() const {
+        return _total_hints_in_progress;
+    }
+
     friend class abstract_read_executor;
     friend class abstract_write_response_handler;
 };
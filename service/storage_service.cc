@@ -79,6 +79,9 @@ namespace service {
 static logging::logger logger("storage_service");
 
 static const sstring RANGE_TOMBSTONES_FEATURE = "RANGE_TOMBSTONES";
+static const sstring STREAMED_REPAIR_CHECKSUM_FEATURE = "STREAMED_REPAIR_CHECKSUM";
+static const sstring ROW_LEVEL_REPAIR_FEATURE = "ROW_LEVEL_REPAIR";
+static const sstring MURMUR3_DIGEST_FEATURE = "MURMUR3_DIGEST";
 
 distributed<storage_service> _the_storage_service;
 
@@ -97,7 +100,8 @@ sstring storage_service::get_config_supported_features() {
     // Add features supported by this local node. When a new feature is
     // introduced in scylla, update it here, e.g.,
     // return sstring("FEATURE1,FEATURE2")
-    return RANGE_TOMBSTONES_FEATURE;
+    return RANGE_TOMBSTONES_FEATURE + "," + STREAMED_REPAIR_CHECKSUM_FEATURE + "," + ROW_LEVEL_REPAIR_FEATURE
+            + "," + MURMUR3_DIGEST_FEATURE;
 }
 
 std::set<inet_address> get_seeds() {
@@ -1213,12 +1217,11 @@ future<> storage_service::init_server(int delay) {
         }
 
         prepare_to_join(std::move(loaded_endpoints));
-#if 0
-        // Has to be called after the host id has potentially changed in prepareToJoin().
-        for (ColumnFamilyStore cfs : ColumnFamilyStore.all())
-            if (cfs.metadata.isCounter())
-                cfs.initCounterCache();
-#endif
+        // Has to be called after the host id has potentially changed in prepare_to_join().
+        auto local_host_id = db::system_keyspace::get_local_host_id().get0();
+        get_storage_service().invoke_on_all([local_host_id] (auto& ss) {
+            ss._local_host_id = local_host_id;
+        }).get();
 
         if (get_property_join_ring()) {
             join_token_ring(delay);
@@ -1235,6 +1238,9 @@ future<> storage_service::init_server(int delay) {
 
         get_storage_service().invoke_on_all([] (auto& ss) {
             ss._range_tombstones_feature = gms::feature(RANGE_TOMBSTONES_FEATURE);
+            ss._streamed_repair_checksum_feature = gms::feature(STREAMED_REPAIR_CHECKSUM_FEATURE);
+            ss._row_level_repair_feature = gms::feature(ROW_LEVEL_REPAIR_FEATURE);
+            ss._murmur3_digest_feature = gms::feature(MURMUR3_DIGEST_FEATURE);
         }).get();
     });
 }
@@ -268,8 +268,18 @@ class storage_service : public service::migration_listener, public gms::i_endpoi
     std::unordered_set<token> _bootstrap_tokens;
 
     gms::feature _range_tombstones_feature;
+    gms::feature _streamed_repair_checksum_feature;
+    gms::feature _row_level_repair_feature;
+    gms::feature _murmur3_digest_feature;
+
+    // Identifies the counter shards owned by this node.
+    utils::UUID _local_host_id;
 
 public:
+    utils::UUID get_local_id() const {
+        return _local_host_id;
+    }
+
     void finish_bootstrapping() {
         _is_bootstrap_mode = false;
     }
@@ -2365,6 +2375,18 @@ class storage_service : public service::migration_listener, public gms::i_endpoi
     bool cluster_supports_range_tombstones() {
         return bool(_range_tombstones_feature);
     }
+
+    bool cluster_supports_streamed_repair_checksum() {
+        return bool(_streamed_repair_checksum_feature);
+    }
+
+    bool cluster_supports_row_level_repair() {
+        return bool(_row_level_repair_feature);
+    }
+
+    bool cluster_supports_murmur3_digest() {
+        return bool(_murmur3_digest_feature);
+    }
 };
 
 inline future<> init_storage_service(distributed<database>& db) {
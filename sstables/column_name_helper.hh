@@ -40,66 +40,43 @@
 #pragma once
 
 #include "core/sstring.hh"
+#include "schema.hh"
+#include "keys.hh"
 #include <cmath>
 #include <algorithm>
 #include <vector>
 
+// Tracks the per-component bounds of the clustering prefixes written to an
+// sstable, which are stored as min_column_names and max_column_names in its
+// statistics.
 class column_name_helper {
-private:
-    static void may_grow(std::vector<bytes>& v, size_t target_size) {
-        if (target_size > v.size()) {
-            v.resize(target_size);
-        }
-    }
 public:
-    static void min_max_components(std::vector<bytes>& min_seen, std::vector<bytes>& max_seen, const std::vector<bytes_view>& column_names) {
-        may_grow(min_seen, column_names.size());
-        may_grow(max_seen, column_names.size());
-
-        for (auto i = 0U; i < column_names.size(); i++) {
-            auto& name = column_names[i];
-            if (max_seen[i].size() == 0 || name > bytes_view(max_seen[i])) {
-                max_seen[i] = bytes(name.data(), name.size());
+    // Components are compared by the types of their clustering columns. A
+    // prefix shorter than the ones seen so far leaves the remaining
+    // components unbounded, so the bounds are cut to its length. first is
+    // true if no prefix was seen before.
+    static void min_max_components(const schema& s, std::vector<bytes>& min_seen, std::vector<bytes>& max_seen,
+            bool first, const clustering_key_prefix& prefix) {
+        auto& types = s.clustering_key_type()->types();
+        auto size = prefix.size(s);
+        if (first) {
+            for (auto i = 0U; i < size; i++) {
+                auto component = prefix.get_component(s, i);
+                min_seen.emplace_back(to_bytes(component));
+                max_seen.emplace_back(to_bytes(component));
             }
-            if (min_seen[i].size() == 0 || name < bytes_view(min_seen[i])) {
-                min_seen[i] = bytes(name.data(), name.size());
-            }
-        }
-    }
-
-    static void merge_max_components(std::vector<bytes>& to, std::vector<bytes>&& from) {
-        if (to.empty()) {
-            to = std::move(from);
-            return;
-        }
-
-        if (from.empty()) {
             return;
         }
 
-        may_grow(to, from.size());
-
-        for (auto i = 0U; i < from.size(); i++) {
-            if (to[i].size() == 0 || bytes_view(from[i]) > bytes_view(to[i])) {
-                to[i] = std::move(from[i]);
+        min_seen.resize(std::min(min_seen.size(), size));
+        max_seen.resize(min_seen.size());
+        for (auto i = 0U; i < min_seen.size(); i++) {
+            auto component = prefix.get_component(s, i);
+            if (types[i]->compare(component, min_seen[i]) < 0) {
+                min_seen[i] = to_bytes(component);
             }
-        }
-    }
-
-    static void merge_min_components(std::vector<bytes>& to, std::vector<bytes>&& from) {
-        if (to.empty()) {
-            to = std::move(from);
-        }
-
-        if (from.empty()) {
-            return;
-        }
-
-        may_grow(to, from.size());
-
-        for (auto i = 0U; i < from.size(); i++) {
-            if (to[i].size() == 0 || bytes_view(from[i]) < bytes_view(to[i])) {
-                to[i] = std::move(from[i]);
+            if (types[i]->compare(component, max_seen[i]) > 0) {
+                max_seen[i] = to_bytes(component);
             }
         }
     }
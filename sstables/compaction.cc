@@ -39,6 +39,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_set>
 #include <functional>
 #include <utility>
 #include <assert.h>
@@ -96,6 +97,80 @@ static api::timestamp_type get_max_purgeable_timestamp(schema_ptr schema,
     return timestamp;
 }
 
+// When inputs are replaced incrementally, the sstable a tombstone came from
+// may be deleted while another input, still holding data the tombstone
+// shadows, stays around until compaction finishes. So tombstones of keys
+// which more than one input may contain are treated as if the other inputs
+// weren't being compacted.
+static api::timestamp_type get_max_purgeable_timestamp_for_incremental(schema_ptr schema,
+    const std::vector<shared_sstable>& not_compacted_sstables, const std::vector<shared_sstable>& compacting,
+    const dht::decorated_key& dk)
+{
+    auto timestamp = get_max_purgeable_timestamp(schema, not_compacted_sstables, dk);
+    auto compacting_timestamp = api::max_timestamp;
+    unsigned holders = 0;
+    for (auto&& sst : compacting) {
+        if (sst->filter_has_key(*schema, dk.key())) {
+            compacting_timestamp = std::min(compacting_timestamp, sst->get_stats_metadata().min_timestamp);
+            holders++;
+        }
+    }
+    return holders > 1 ? std::min(timestamp, compacting_timestamp) : timestamp;
+}
+
+// Replaces the input sstables of a compaction by its output as the output
+// sstables are sealed. Since partitions are written in order, an input is
+// exhausted once its last key is not greater than the last key of a sealed
+// output sstable.
+class incremental_replacer {
+    const schema& _schema;
+    replacer_fn _replace;
+    // Inputs which weren't replaced yet.
+    std::vector<shared_sstable> _inputs;
+    // Sealed outputs which weren't handed over yet.
+    std::vector<shared_sstable> _sealed;
+    std::unordered_set<shared_sstable> _handed_over;
+private:
+    void replace(std::vector<shared_sstable> removed) {
+        auto added = std::exchange(_sealed, {});
+        _replace(removed, added);
+        _handed_over.insert(added.begin(), added.end());
+    }
+public:
+    incremental_replacer(const schema& s, replacer_fn replace, std::vector<shared_sstable> inputs)
+        : _schema(s)
+        , _replace(std::move(replace))
+        , _inputs(std::move(inputs))
+    { }
+
+    void on_sealed(shared_sstable sst) {
+        auto last = sst->get_last_decorated_key(_schema);
+        _sealed.push_back(std::move(sst));
+        auto it = std::partition(_inputs.begin(), _inputs.end(), [&] (const shared_sstable& input) {
+            return input->get_last_decorated_key(_schema).tri_compare(_schema, last) > 0;
+        });
+        if (it == _inputs.end()) {
+            return;
+        }
+        std::vector<shared_sstable> exhausted(it, _inputs.end());
+        _inputs.erase(it, _inputs.end());
+        logger.debug("Replacing {} exhausted sstable(s) by {} new sstable(s)", exhausted.size(), _sealed.size());
+        replace(std::move(exhausted));
+    }
+
+    void finish() {
+        if (!_inputs.empty() || !_sealed.empty()) {
+            replace(std::exchange(_inputs, {}));
+        }
+    }
+
+    // New sstables which are already part of the column family and mustn't
+    // be deleted if the compaction fails.
+    bool handed_over(const shared_sstable& sst) const {
+        return _handed_over.count(sst);
+    }
+};
+
 static bool belongs_to_current_node(const dht::token& t, const std::vector<range<dht::token>>& sorted_owned_ranges) {
     auto low = std::lower_bound(sorted_owned_ranges.begin(), sorted_owned_ranges.end(), t,
             [] (const range<dht::token>& a, const dht::token& b) {
@@ -111,11 +186,15 @@ static bool belongs_to_current_node(const dht::token& t, const std::vector<range
     return false;
 }
 
-static void delete_sstables_for_interrupted_compaction(std::vector<shared_sstable>& new_sstables, sstring& ks, sstring& cf) {
+static void delete_sstables_for_interrupted_compaction(std::vector<shared_sstable>& new_sstables, sstring& ks, sstring& cf,
+        const incremental_replacer* replacer) {
     // Delete either partially or fully written sstables of a compaction that
     // was either stopped abruptly (e.g. out of disk space) or deliberately
     // (e.g. nodetool stop COMPACTION).
     for (auto& sst : new_sstables) {
+        if (replacer && replacer->handed_over(sst)) {
+            continue;
+        }
         logger.debug("Deleting sstable {} of interrupted compaction for {}.{}", sst->get_filename(), ks, cf);
         sst->mark_for_deletion();
     }
@@ -146,6 +225,7 @@ class compacting_sstable_writer {
     db::replay_position _rp;
     std::vector<unsigned long> _ancestors;
     compaction_info& _info;
+    incremental_replacer* _replacer;
     shared_sstable _sst;
     stdx::optional<sstable_writer> _writer;
 private:
@@ -155,11 +235,14 @@ class compacting_sstable_writer {
 
         _sst->open_data().get0();
         _info.end_size += _sst->data_size();
+        if (_replacer) {
+            _replacer->on_sealed(_sst);
+        }
     }
 public:
     compacting_sstable_writer(const schema& s, std::function<shared_sstable()> creator, uint64_t partitions_per_sstable,
                               uint64_t max_sstable_size, uint32_t sstable_level, db::replay_position rp,
-                              std::vector<unsigned long> ancestors, compaction_info& info)
+                              std::vector<unsigned long> ancestors, compaction_info& info, incremental_replacer* replacer)
         : _schema(s)
         , _creator(creator)
         , _partitions_per_sstable(partitions_per_sstable)
@@ -168,6 +251,7 @@ class compacting_sstable_writer {
         , _rp(rp)
         , _ancestors(std::move(ancestors))
         , _info(info)
+        , _replacer(replacer)
     { }
 
     void consume_new_partition(const dht::decorated_key& dk) {
@@ -217,8 +301,9 @@ class compacting_sstable_writer {
 // are created using the "sstable_creator" object passed by the caller.
 future<std::vector<shared_sstable>>
 compact_sstables(std::vector<shared_sstable> sstables, column_family& cf, std::function<shared_sstable()> creator,
-                 uint64_t max_sstable_size, uint32_t sstable_level, bool cleanup) {
-    return seastar::async([sstables = std::move(sstables), &cf, creator = std::move(creator), max_sstable_size, sstable_level, cleanup] () mutable {
+                 uint64_t max_sstable_size, uint32_t sstable_level, bool cleanup, replacer_fn replace) {
+    return seastar::async([sstables = std::move(sstables), &cf, creator = std::move(creator), max_sstable_size, sstable_level, cleanup,
+            replace = std::move(replace)] () mutable {
         std::vector<::mutation_reader> readers;
         uint64_t estimated_partitions = 0;
         std::vector<unsigned long> ancestors;
@@ -277,10 +362,21 @@ compact_sstables(std::vector<shared_sstable> sstables, column_family& cf, std::f
 
         auto start_time = db_clock::now();
 
-        auto get_max_purgeable = [schema, not_compacted_sstables] (const dht::decorated_key& dk) {
-            return get_max_purgeable_timestamp(schema, not_compacted_sstables, dk);
-        };
-        auto cr = compacting_sstable_writer(*schema, creator, partitions_per_sstable, max_sstable_size, sstable_level, rp, std::move(ancestors), *info);
+        stdx::optional<incremental_replacer> replacer;
+        std::function<api::timestamp_type(const dht::decorated_key&)> get_max_purgeable;
+        if (replace) {
+            replacer.emplace(*schema, std::move(replace), sstables);
+            get_max_purgeable = [schema, not_compacted_sstables, sstables] (const dht::decorated_key& dk) {
+                return get_max_purgeable_timestamp_for_incremental(schema, not_compacted_sstables, sstables, dk);
+            };
+        } else {
+            get_max_purgeable = [schema, not_compacted_sstables] (const dht::decorated_key& dk) {
+                return get_max_purgeable_timestamp(schema, not_compacted_sstables, dk);
+            };
+        }
+        auto replacer_ptr = replacer ? &*replacer : nullptr;
+        auto cr = compacting_sstable_writer(*schema, creator, partitions_per_sstable, max_sstable_size, sstable_level, rp, std::move(ancestors), *info,
+                replacer_ptr);
         auto cfc = compact_for_compaction<compacting_sstable_writer>(*schema, gc_clock::now(), std::move(cr), get_max_purgeable);
 
         auto filter = [cleanup, sorted_owned_ranges = std::move(owned_ranges)] (const streamed_mutation& sm) {
@@ -295,9 +391,12 @@ compact_sstables(std::vector<shared_sstable> sstables, column_family& cf, std::f
 
         try {
             consume_flattened_in_thread(reader, cfc, filter);
+            if (replacer) {
+                replacer->finish();
+            }
         } catch (...) {
             cm.deregister_compaction(info);
-            delete_sstables_for_interrupted_compaction(info->new_sstables, info->ks, info->cf);
+            delete_sstables_for_interrupted_compaction(info->new_sstables, info->ks, info->cf, replacer_ptr);
             throw;
         }
 
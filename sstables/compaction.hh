@@ -89,6 +89,10 @@ namespace sstables {
         }
     };
 
+    // Replaces sstables of a column family: called with the sstables to be
+    // removed and the ones to be added in their place.
+    using replacer_fn = std::function<void(const std::vector<shared_sstable>& removed, const std::vector<shared_sstable>& added)>;
+
     // Compact a list of N sstables into M sstables.
     // Returns a vector with newly created sstables(s).
     //
@@ -100,9 +104,14 @@ namespace sstables {
     // If cleanup is true, mutation that doesn't belong to current node will be
     // cleaned up, log messages will inform the user that compact_sstables runs for
     // cleaning operation, and compaction history will not be updated.
+    // If replacer is given, compaction replaces the input sstables by the new
+    // ones through it, step by step as new sstables are sealed, so that
+    // exhausted inputs don't use disk space until the compaction finishes.
+    // The caller must not replace them again.
     future<std::vector<shared_sstable>> compact_sstables(std::vector<shared_sstable> sstables,
             column_family& cf, std::function<shared_sstable()> creator,
-            uint64_t max_sstable_size, uint32_t sstable_level, bool cleanup = false);
+            uint64_t max_sstable_size, uint32_t sstable_level, bool cleanup = false,
+            replacer_fn replacer = {});
 
     // Return the most interesting bucket applying the size-tiered strategy.
     std::vector<sstables::shared_sstable>
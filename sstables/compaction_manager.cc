@@ -35,6 +35,23 @@ static inline uint64_t get_total_size(const std::vector<sstables::shared_sstable
     return total_size;
 }
 
+// Returns the candidates holding nothing but data which expired more than
+// gc_grace_seconds ago, and which don't shadow data in other sstables.
+// They can be deleted without being rewritten.
+static std::vector<sstables::shared_sstable>
+get_expired_sstables(column_family& cf, const std::vector<sstables::shared_sstable>& candidates) {
+    auto gc_before = (gc_clock::now() - cf.schema()->gc_grace_seconds()).time_since_epoch().count();
+    // Looking for overlapping sstables is quadratic, so do it only for the
+    // sstables which may have expired.
+    std::vector<sstables::shared_sstable> maybe_expired;
+    for (auto& sst : candidates) {
+        if (sst->get_stats_metadata().max_local_deletion_time < gc_before) {
+            maybe_expired.push_back(sst);
+        }
+    }
+    return sstables::get_fully_expired_sstables(cf, maybe_expired, gc_before);
+}
+
 // Calculate weight of compaction job.
 static inline int calculate_weight(uint64_t total_size) {
     // At the moment, '4' is being used as log base for determining the weight
@@ -154,10 +171,27 @@ lw_shared_ptr<compaction_manager::task> compaction_manager::task_start(column_fa
             };
 
             future<> operation = make_ready_future<>();
+            auto expired = task->cleanup ? std::vector<sstables::shared_sstable>() : get_expired_sstables(cf, candidates);
             if (task->cleanup) {
                 descriptor = sstables::compaction_descriptor(std::move(candidates));
                 keep_track_of_compacting_sstables();
                 operation = cf.cleanup_sstables(std::move(descriptor));
+            } else if (!expired.empty()) {
+                // Sstables whose data all expired are deleted before the
+                // strategy gets to pick sstables to rewrite.
+                uint64_t reclaimed = 0;
+                for (auto& sst : expired) {
+                    reclaimed += sst->bytes_on_disk();
+                }
+                descriptor = sstables::compaction_descriptor(std::move(expired));
+                keep_track_of_compacting_sstables();
+                cmlog.debug("Dropping {} fully expired sstable(s) ({} bytes) of {}.{}",
+                    descriptor.sstables.size(), reclaimed, cf.schema()->ks_name(), cf.schema()->cf_name());
+                auto count = descriptor.sstables.size();
+                operation = cf.drop_expired_sstables(std::move(descriptor.sstables)).then([this, count, reclaimed] {
+                    _stats.expired_sstables += count;
+                    _stats.bytes_reclaimed_by_expiry += reclaimed;
+                });
             } else {
                 sstables::compaction_strategy cs = cf.get_compaction_strategy();
                 descriptor = cs.get_sstables_for_compaction(cf, std::move(candidates));
@@ -321,6 +355,8 @@ void compaction_manager::register_collectd_metrics() {
     };
 
     add("objects", "compactions", scollectd::data_type::GAUGE, [&] { return _stats.active_tasks; });
+    add("total_operations", "expired_sstables", scollectd::data_type::DERIVE, [&] { return _stats.expired_sstables; });
+    add("total_bytes", "reclaimed_by_expiry", scollectd::data_type::DERIVE, [&] { return _stats.bytes_reclaimed_by_expiry; });
 }
 
 void compaction_manager::start() {
@@ -44,6 +44,9 @@ class compaction_manager {
         int64_t completed_tasks = 0;
         uint64_t active_tasks = 0; // Number of compaction going on.
         int64_t errors = 0;
+        // Sstables deleted without being rewritten because all their data expired.
+        int64_t expired_sstables = 0;
+        int64_t bytes_reclaimed_by_expiry = 0;
     };
 private:
     struct task {
@@ -39,6 +39,7 @@
 
 #include <vector>
 #include <chrono>
+#include <algorithm>
 
 #include "sstables.hh"
 #include "compaction.hh"
@@ -50,6 +51,8 @@
 #include "sstable_set.hh"
 #include "compatible_ring_position.hh"
 #include <boost/range/algorithm/find.hpp>
+#include <boost/range/algorithm/find_if.hpp>
+#include <boost/range/algorithm/sort.hpp>
 #include <boost/icl/interval_map.hpp>
 #include "date_tiered_compaction_strategy.hh"
 
@@ -116,57 +119,139 @@ sstable_set::erase(shared_sstable sst) {
 
 sstable_set::~sstable_set() = default;
 
-// default sstable_set, not specialized for anything
-class bag_sstable_set : public sstable_set_impl {
-    // erasing is slow, but select() is fast
-    std::vector<shared_sstable> _sstables;
+// default sstable_set, indexes sstables by the token range they span so
+// that reads only look at the ones which may hold keys in the range. Each
+// sstable is stored once, sorted by the start of its range, together with
+// the largest end of the ranges up to it. A read skips the sstables which
+// start after it with a binary search on the former, and the leading ones
+// which all end before it with a binary search on the latter. Unlike
+// partitioned_sstable_set, this takes linear space when most sstables
+// overlap, as they do with size-tiered and date-tiered compaction.
+class interval_sstable_set : public sstable_set_impl {
+    struct entry {
+        dht::ring_position first;
+        dht::ring_position last;
+        // The largest last of this entry and of all entries before it.
+        dht::ring_position max_last;
+        shared_sstable sst;
+    };
+    using entries_type = std::vector<entry>;
+private:
+    schema_ptr _schema;
+    entries_type _entries;
+private:
+    entry make_entry(shared_sstable sst) const {
+        auto first = dht::ring_position::starting_at(sst->get_first_decorated_key(*_schema).token());
+        auto last = dht::ring_position::ending_at(sst->get_last_decorated_key(*_schema).token());
+        auto max_last = last;
+        return entry{std::move(first), std::move(last), std::move(max_last), std::move(sst)};
+    }
+    // Recomputes max_last from the given entry on.
+    void update_max_last(entries_type::iterator it) {
+        for (; it != _entries.end(); ++it) {
+            it->max_last = it->last;
+            if (it != _entries.begin()) {
+                auto& prev = std::prev(it)->max_last;
+                if (prev.tri_compare(*_schema, it->last) > 0) {
+                    it->max_last = prev;
+                }
+            }
+        }
+    }
+    void select(const query::partition_range& range, std::vector<shared_sstable>& result) const {
+        dht::ring_position_comparator cmp(*_schema);
+        auto end = std::partition_point(_entries.begin(), _entries.end(), [&] (const entry& e) {
+            return !range.after(e.first, cmp);
+        });
+        auto begin = std::partition_point(_entries.begin(), end, [&] (const entry& e) {
+            return range.before(e.max_last, cmp);
+        });
+        for (auto it = begin; it != end; ++it) {
+            if (!range.before(it->last, cmp)) {
+                result.push_back(it->sst);
+            }
+        }
+    }
 public:
+    explicit interval_sstable_set(schema_ptr schema)
+            : _schema(std::move(schema)) {
+    }
     virtual std::unique_ptr<sstable_set_impl> clone() const override {
-        return std::make_unique<bag_sstable_set>(*this);
+        return std::make_unique<interval_sstable_set>(*this);
     }
     virtual std::vector<shared_sstable> select(const query::partition_range& range) const override {
-        return _sstables;
+        std::vector<shared_sstable> result;
+        if (range.is_wrap_around(dht::ring_position_comparator(*_schema))) {
+            auto unwrapped = range.unwrap();
+            select(unwrapped.first, result);
+            select(unwrapped.second, result);
+            // An sstable may overlap both halves.
+            boost::sort(result, [] (const shared_sstable& x, const shared_sstable& y) {
+                return std::less<sstable*>()(x.get(), y.get());
+            });
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+        } else {
+            select(range, result);
+        }
+        return result;
     }
     virtual void insert(shared_sstable sst) override {
-        _sstables.push_back(std::move(sst));
+        auto e = make_entry(std::move(sst));
+        auto it = std::upper_bound(_entries.begin(), _entries.end(), e, [this] (const entry& e1, const entry& e2) {
+            return e1.first.less_compare(*_schema, e2.first);
+        });
+        update_max_last(_entries.insert(it, std::move(e)));
     }
     virtual void erase(shared_sstable sst) override {
-        _sstables.erase(boost::find(_sstables, sst));
+        auto it = _entries.erase(boost::find_if(_entries, [&sst] (const entry& e) { return e.sst == sst; }));
+        update_max_last(it);
     }
 };
 
-// specialized when sstables are partitioned in the token range space
-// e.g. leveled compaction strategy
+// Indexes sstables by the token range they span, so that reads only look at
+// the ones which may hold keys in the range. The ring is split into disjoint
+// intervals, each mapped to the sstables covering it, which takes space
+// quadratic in the number of overlapping sstables. Leveled compaction keeps
+// the sstables of each level disjoint, so there are few of them.
 class partitioned_sstable_set : public sstable_set_impl {
     using value_set = std::unordered_set<shared_sstable>;
     using interval_map_type = boost::icl::interval_map<compatible_ring_position, value_set>;
     using interval_type = interval_map_type::interval_type;
-    using map_iterator = interval_map_type::const_iterator;
 private:
     schema_ptr _schema;
     interval_map_type _sstables;
 private:
+    // Open ends are bounded by the ends of the ring, which span all keys.
     interval_type make_interval(const query::partition_range& range) const {
-        return interval_type::closed(
-                compatible_ring_position(*_schema, range.start()->value()),
-                compatible_ring_position(*_schema, range.end()->value()));
+        auto start = compatible_ring_position(*_schema,
+                range.start() ? range.start()->value() : dht::ring_position::starting_at(dht::minimum_token()));
+        auto end = compatible_ring_position(*_schema,
+                range.end() ? range.end()->value() : dht::ring_position::ending_at(dht::maximum_token()));
+        auto start_inclusive = !range.start() || range.start()->is_inclusive();
+        auto end_inclusive = !range.end() || range.end()->is_inclusive();
+        if (start_inclusive && end_inclusive) {
+            return interval_type::closed(std::move(start), std::move(end));
+        } else if (start_inclusive) {
+            return interval_type::right_open(std::move(start), std::move(end));
+        } else if (end_inclusive) {
+            return interval_type::left_open(std::move(start), std::move(end));
+        }
+        return interval_type::open(std::move(start), std::move(end));
     }
-    interval_type singular(const dht::ring_position& rp) const {
-        auto crp = compatible_ring_position(*_schema, rp);
-        return interval_type::closed(crp, crp);
+    interval_type make_interval(const shared_sstable& sst) const {
+        auto first = sst->get_first_decorated_key(*_schema).token();
+        auto last = sst->get_last_decorated_key(*_schema).token();
+        using bound = query::partition_range::bound;
+        return make_interval(query::partition_range(
+                bound(dht::ring_position::starting_at(first)),
+                bound(dht::ring_position::ending_at(last))));
     }
-    std::pair<map_iterator, map_iterator> query(const query::partition_range& range) const {
-        if (range.start() && range.end()) {
-            return _sstables.equal_range(make_interval(range));
-        }
-        else if (range.start() && !range.end()) {
-            auto start = singular(range.start()->value());
-            return { _sstables.lower_bound(start), _sstables.end() };
-        } else if (!range.start() && range.end()) {
-            auto end = singular(range.end()->value());
-            return { _sstables.begin(), _sstables.upper_bound(end) };
-        } else {
-            return { _sstables.begin(), _sstables.end() };
+    void select(const query::partition_range& range, value_set& result) const {
+        auto ipair = _sstables.equal_range(make_interval(range));
+        auto b = std::move(ipair.first);
+        auto e = std::move(ipair.second);
+        while (b != e) {
+            boost::copy(b++->second, std::inserter(result, result.end()));
         }
     }
 public:
@@ -177,36 +262,21 @@ class partitioned_sstable_set : public sstable_set_impl {
         return std::make_unique<partitioned_sstable_set>(*this);
     }
     virtual std::vector<shared_sstable> select(const query::partition_range& range) const override {
-        auto ipair = query(range);
-        auto b = std::move(ipair.first);
-        auto e = std::move(ipair.second);
         value_set result;
-        while (b != e) {
-            boost::copy(b++->second, std::inserter(result, result.end()));
+        if (range.is_wrap_around(dht::ring_position_comparator(*_schema))) {
+            auto unwrapped = range.unwrap();
+            select(unwrapped.first, result);
+            select(unwrapped.second, result);
+        } else {
+            select(range, result);
         }
         return std::vector<shared_sstable>(result.begin(), result.end());
     }
     virtual void insert(shared_sstable sst) override {
-        auto first = sst->get_first_decorated_key(*_schema).token();
-        auto last = sst->get_last_decorated_key(*_schema).token();
-        using bound = query::partition_range::bound;
-        _sstables.add({
-                make_interval(
-                        query::partition_range(
-                                bound(dht::ring_position::starting_at(first)),
-                                bound(dht::ring_position::ending_at(last)))),
-                value_set({sst})});
+        _sstables.add({make_interval(sst), value_set({sst})});
     }
     virtual void erase(shared_sstable sst) override {
-        auto first = sst->get_first_decorated_key(*_schema).token();
-        auto last = sst->get_last_decorated_key(*_schema).token();
-        using bound = query::partition_range::bound;
-        _sstables.subtract({
-                make_interval(
-                        query::partition_range(
-                                bound(dht::ring_position::starting_at(first)),
-                                bound(dht::ring_position::ending_at(last)))),
-                value_set({sst})});
+        _sstables.subtract({make_interval(sst), value_set({sst})});
     }
 };
 
@@ -220,7 +290,13 @@ class compaction_strategy_impl {
     }
     virtual int64_t estimated_pending_compactions(column_family& cf) const = 0;
     virtual std::unique_ptr<sstable_set_impl> make_sstable_set(schema_ptr schema) const {
-        return std::make_unique<bag_sstable_set>();
+        return std::make_unique<interval_sstable_set>(std::move(schema));
+    }
+    // Whether reads should skip sstables whose clustering key bounds don't
+    // intersect the queried slice. Worth it only when rows are laid out
+    // across sstables by their clustering keys, like time series are.
+    virtual bool use_clustering_key_filter() const {
+        return false;
     }
 };
 
@@ -604,6 +680,7 @@ class leveled_compaction_strategy : public compaction_strategy_impl {
     virtual compaction_strategy_type type() const {
         return compaction_strategy_type::leveled;
     }
+
     virtual std::unique_ptr<sstable_set_impl> make_sstable_set(schema_ptr schema) const override {
         return std::make_unique<partitioned_sstable_set>(std::move(schema));
     }
@@ -661,6 +738,167 @@ class date_tiered_compaction_strategy : public compaction_strategy_impl {
     virtual compaction_strategy_type type() const {
         return compaction_strategy_type::date_tiered;
     }
+
+    virtual bool use_clustering_key_filter() const override {
+        return true;
+    }
+};
+
+class time_window_compaction_strategy_options {
+    static constexpr int32_t DEFAULT_COMPACTION_WINDOW_SIZE = 1;
+    const sstring COMPACTION_WINDOW_UNIT_KEY = "compaction_window_unit";
+    const sstring COMPACTION_WINDOW_SIZE_KEY = "compaction_window_size";
+    const sstring TIMESTAMP_RESOLUTION_KEY = "timestamp_resolution";
+
+    // Width of a window, in units of the timestamps written by clients.
+    int64_t window_size;
+private:
+    static int64_t to_microseconds(const std::map<sstring, int64_t>& units, const sstring& key, const sstring& unit) {
+        auto it = units.find(unit);
+        if (it == units.end()) {
+            throw exceptions::configuration_exception(sprint("%s is not valid for %s", unit, key));
+        }
+        return it->second;
+    }
+public:
+    time_window_compaction_strategy_options(const std::map<sstring, sstring>& options) {
+        using namespace cql3::statements;
+        static const std::map<sstring, int64_t> window_units = {
+            { "MINUTES", 60L * 1000000L },
+            { "HOURS", 3600L * 1000000L },
+            { "DAYS", 86400L * 1000000L },
+        };
+        static const std::map<sstring, int64_t> timestamp_resolutions = {
+            { "MICROSECONDS", 1L },
+            { "MILLISECONDS", 1000L },
+            { "SECONDS", 1000000L },
+        };
+
+        auto tmp_value = size_tiered_compaction_strategy_options::get_value(options, COMPACTION_WINDOW_UNIT_KEY);
+        auto window_unit = to_microseconds(window_units, COMPACTION_WINDOW_UNIT_KEY, tmp_value.value_or("DAYS"));
+
+        tmp_value = size_tiered_compaction_strategy_options::get_value(options, COMPACTION_WINDOW_SIZE_KEY);
+        auto window_count = property_definitions::to_int(COMPACTION_WINDOW_SIZE_KEY, tmp_value, DEFAULT_COMPACTION_WINDOW_SIZE);
+        if (window_count < 1) {
+            throw exceptions::configuration_exception(sprint("%d must be greater than 0 for %s", window_count, COMPACTION_WINDOW_SIZE_KEY));
+        }
+
+        tmp_value = size_tiered_compaction_strategy_options::get_value(options, TIMESTAMP_RESOLUTION_KEY);
+        auto resolution = to_microseconds(timestamp_resolutions, TIMESTAMP_RESOLUTION_KEY, tmp_value.value_or("MICROSECONDS"));
+
+        window_size = window_unit * window_count / resolution;
+    }
+
+    friend class time_window_compaction_strategy;
+};
+
+//
+// Time window compaction strategy groups sstables into fixed windows of time
+// by their maximum timestamp. Sstables in the newest window are compacted
+// with size-tiered strategy, and once a window is left behind all of its
+// sstables are compacted into one, which isn't touched again. Sstables whose
+// data have all expired are dropped as a whole.
+//
+class time_window_compaction_strategy : public compaction_strategy_impl {
+    time_window_compaction_strategy_options _options;
+    size_tiered_compaction_strategy _stcs;
+public:
+    // Windows by their lower bound, newest first.
+    using bucket_map = std::map<int64_t, std::vector<shared_sstable>, std::greater<int64_t>>;
+
+    time_window_compaction_strategy(const std::map<sstring, sstring>& options)
+        : _options(options)
+        , _stcs(options)
+        {}
+
+    virtual compaction_descriptor get_sstables_for_compaction(column_family& cfs, std::vector<sstables::shared_sstable> candidates) override {
+        if (candidates.empty()) {
+            return sstables::compaction_descriptor();
+        }
+
+        auto gc_before = gc_clock::now() - cfs.schema()->gc_grace_seconds();
+        auto expired = get_fully_expired_sstables(cfs, candidates, gc_before.time_since_epoch().count());
+        if (!expired.empty()) {
+            logger.debug("timewindow: Dropping {} fully expired sstables", expired.size());
+            return sstables::compaction_descriptor(std::move(expired));
+        }
+
+        auto now = get_window_lower_bound(get_now(cfs));
+        auto max_threshold = cfs.schema()->max_compaction_threshold();
+        for (auto& bucket : get_buckets(candidates)) {
+            if (bucket.first >= now) {
+                auto desc = _stcs.get_sstables_for_compaction(cfs, std::move(bucket.second));
+                if (!desc.sstables.empty()) {
+                    logger.debug("timewindow: Compacting {} sstables of the current window", desc.sstables.size());
+                    return desc;
+                }
+            } else if (bucket.second.size() >= 2) {
+                auto& sstables = bucket.second;
+                trim_to_threshold(sstables, max_threshold);
+                logger.debug("timewindow: Compacting {} sstables of window {}", sstables.size(), bucket.first);
+                return sstables::compaction_descriptor(std::move(sstables));
+            }
+        }
+        return sstables::compaction_descriptor();
+    }
+
+    virtual int64_t estimated_pending_compactions(column_family& cf) const override {
+        int min_threshold = cf.schema()->min_compaction_threshold();
+        int max_threshold = cf.schema()->max_compaction_threshold();
+        std::vector<sstables::shared_sstable> sstables(cf.get_sstables()->begin(), cf.get_sstables()->end());
+        auto now = get_window_lower_bound(get_now(cf));
+        int64_t n = 0;
+
+        for (auto& bucket : get_buckets(sstables)) {
+            auto threshold = bucket.first >= now ? size_t(min_threshold) : size_t(2);
+            if (bucket.second.size() >= threshold) {
+                n += std::ceil(double(bucket.second.size()) / max_threshold);
+            }
+        }
+        return n;
+    }
+
+    virtual compaction_strategy_type type() const {
+        return compaction_strategy_type::time_window;
+    }
+
+    virtual bool use_clustering_key_filter() const override {
+        return true;
+    }
+
+    // Returns the lower bound of the window the timestamp falls into.
+    int64_t get_window_lower_bound(int64_t timestamp) const {
+        auto offset = timestamp % _options.window_size;
+        if (offset < 0) {
+            offset += _options.window_size;
+        }
+        return timestamp - offset;
+    }
+
+    bucket_map get_buckets(const std::vector<sstables::shared_sstable>& sstables) const {
+        bucket_map buckets;
+        for (auto& sst : sstables) {
+            buckets[get_window_lower_bound(sst->get_stats_metadata().max_timestamp)].push_back(sst);
+        }
+        return buckets;
+    }
+private:
+    static int64_t get_now(column_family& cf) {
+        int64_t max_timestamp = 0;
+        for (auto& sst : *cf.get_sstables()) {
+            max_timestamp = std::max(max_timestamp, sst->get_stats_metadata().max_timestamp);
+        }
+        return max_timestamp;
+    }
+
+    // Keeps the max_threshold smallest sstables, so that a window which fell
+    // behind is compacted in steps that finish quickly.
+    static void trim_to_threshold(std::vector<sstables::shared_sstable>& bucket, int max_threshold) {
+        std::sort(bucket.begin(), bucket.end(), [] (const shared_sstable& x, const shared_sstable& y) {
+            return x->data_size() < y->data_size();
+        });
+        bucket.resize(std::min(bucket.size(), size_t(max_threshold)));
+    }
 };
 
 compaction_strategy::compaction_strategy(::shared_ptr<compaction_strategy_impl> impl)
@@ -687,6 +925,10 @@ int64_t compaction_strategy::estimated_pending_compactions(column_family& cf) co
     return _compaction_strategy_impl->estimated_pending_compactions(cf);
 }
 
+bool compaction_strategy::use_clustering_key_filter() const {
+    return _compaction_strategy_impl->use_clustering_key_filter();
+}
+
 sstable_set
 compaction_strategy::make_sstable_set(schema_ptr schema) const {
     return sstable_set(
@@ -713,6 +955,9 @@ compaction_strategy make_compaction_strategy(compaction_strategy_type strategy,
     case compaction_strategy_type::date_tiered:
         impl = make_shared<date_tiered_compaction_strategy>(date_tiered_compaction_strategy(options));
         break;
+    case compaction_strategy_type::time_window:
+        impl = make_shared<time_window_compaction_strategy>(time_window_compaction_strategy(options));
+        break;
     default:
         throw std::runtime_error("strategy not supported");
     }
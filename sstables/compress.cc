@@ -21,16 +21,20 @@
 
 #include <stdexcept>
 #include <cstdlib>
+#include <thread>
 
 #include <seastar/core/align.hh>
 #include <seastar/core/unaligned.hh>
 #include <seastar/core/fstream.hh>
+#include <seastar/core/reactor.hh>
 
 #include "compress.hh"
 
 #include <lz4.h>
 #include <zlib.h>
 #include <snappy-c.h>
+#include <zstd.h>
+#include <zdict.h>
 
 #include "unimplemented.hh"
 
@@ -46,6 +50,11 @@ void compression::update(uint64_t compressed_file_length) {
          _uncompress = uncompress_snappy;
      } else if (name.value == "DeflateCompressor") {
          _uncompress = uncompress_deflate;
+     } else if (name.value == "ZstdCompressor") {
+         // The dictionary, if any, was already set by read_compression().
+         if (!_zstd) {
+             _zstd = make_lw_shared<zstd_compressor>(int(compression_parameters::DEFAULT_COMPRESSION_LEVEL));
+         }
      } else {
          throw std::runtime_error("unsupported compression type");
      }
@@ -53,7 +62,8 @@ void compression::update(uint64_t compressed_file_length) {
      _compressed_file_length = compressed_file_length;
 }
 
-void compression::set_compressor(compressor c) {
+void compression::set_compressor(const compression_parameters& cp) {
+     auto c = cp.get_compressor();
      if (c == compressor::lz4) {
          _compress = compress_lz4;
          _compress_max_size = compress_max_size_lz4;
@@ -66,11 +76,171 @@ void compression::set_compressor(compressor c) {
          _compress = compress_deflate;
          _compress_max_size = compress_max_size_deflate;
          name.value = "DeflateCompressor";
+     } else if (c == compressor::zstd) {
+         _zstd = make_lw_shared<zstd_compressor>(cp.compression_level());
+         _dictionary_size = cp.dictionary_size();
+         _dictionary_trained = false;
+         name.value = "ZstdCompressor";
      } else {
          throw std::runtime_error("unsupported compressor type");
      }
 }
 
+// zstd recommends training on about a hundred times the dictionary size;
+// the cap bounds the data a writer holds back before compressing it.
+static constexpr size_t max_dictionary_training_size = 8 << 20;
+
+size_t compression::dictionary_training_size() const {
+    return std::min(_dictionary_size * 100, max_dictionary_training_size);
+}
+
+future<> compression::train_dictionary(const std::vector<temporary_buffer<char>>& samples) {
+    return zstd_compressor::train_dictionary(samples, _dictionary_size).then([this] (bytes dictionary) {
+        _zstd->set_dictionary(std::move(dictionary));
+        _dictionary_trained = true;
+    });
+}
+
+void compression::set_dictionary(bytes dictionary) {
+    if (!_zstd) {
+        _zstd = make_lw_shared<zstd_compressor>(int(compression_parameters::DEFAULT_COMPRESSION_LEVEL));
+    }
+    _zstd->set_dictionary(std::move(dictionary));
+    _dictionary_trained = true;
+}
+
+const bytes& compression::dictionary() const {
+    static const bytes no_dictionary;
+    return _zstd ? _zstd->dictionary() : no_dictionary;
+}
+
+struct zstd_compressor::impl {
+    int level;
+    bytes dictionary;
+    // Created on first use, so that readers do not pay for compression
+    // state and writers do not pay for decompression state.
+    std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> cctx{nullptr, ZSTD_freeCCtx};
+    std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> dctx{nullptr, ZSTD_freeDCtx};
+    std::unique_ptr<ZSTD_CDict, size_t (*)(ZSTD_CDict*)> cdict{nullptr, ZSTD_freeCDict};
+    std::unique_ptr<ZSTD_DDict, size_t (*)(ZSTD_DDict*)> ddict{nullptr, ZSTD_freeDDict};
+
+    explicit impl(int l) : level(l) { }
+};
+
+zstd_compressor::zstd_compressor(int level)
+    : _impl(std::make_unique<impl>(level))
+{ }
+
+zstd_compressor::~zstd_compressor() = default;
+
+// Training takes from tens of milliseconds for small inputs to over a
+// second for a 1 MB dictionary trained on 8 MB of samples, so it must not
+// run on the reactor. It runs on a helper thread instead, which signals an
+// eventfd when it is done. Its buffers are allocated here, so that the
+// thread only copies the samples and calls zstd.
+future<bytes> zstd_compressor::train_dictionary(const std::vector<temporary_buffer<char>>& samples, size_t max_size) {
+    struct training {
+        readable_eventfd done;
+        std::vector<size_t> sizes;
+        std::unique_ptr<char[]> buffer;
+        bytes dictionary;
+        size_t result = 0;
+        std::thread thread;
+    };
+    try {
+        auto t = std::make_unique<training>();
+        t->sizes.reserve(samples.size());
+        size_t total = 0;
+        for (auto&& s : samples) {
+            t->sizes.push_back(s.size());
+            total += s.size();
+        }
+        t->buffer.reset(new char[total]);
+        t->dictionary = bytes(bytes::initialized_later(), max_size);
+        auto& tr = *t;
+        tr.thread = std::thread([&samples, &tr, notify = tr.done.write_side()] () mutable {
+            // ZDICT wants the samples back to back.
+            auto out = tr.buffer.get();
+            for (auto&& s : samples) {
+                out = std::copy_n(s.get(), s.size(), out);
+            }
+            tr.result = ZDICT_trainFromBuffer(tr.dictionary.begin(), tr.dictionary.size(),
+                    tr.buffer.get(), tr.sizes.data(), tr.sizes.size());
+            notify.signal(1);
+        });
+        auto f = tr.done.wait();
+        return f.then([t = std::move(t)] (size_t) {
+            t->thread.join();
+            if (ZDICT_isError(t->result)) {
+                return bytes();
+            }
+            return bytes(t->dictionary.begin(), t->result);
+        });
+    } catch (...) {
+        return make_exception_future<bytes>(std::current_exception());
+    }
+}
+
+void zstd_compressor::set_dictionary(bytes dictionary) {
+    _impl->dictionary = std::move(dictionary);
+    _impl->cdict.reset();
+    _impl->ddict.reset();
+}
+
+const bytes& zstd_compressor::dictionary() const {
+    return _impl->dictionary;
+}
+
+size_t zstd_compressor::uncompress(const char* input, size_t input_len,
+        char* output, size_t output_len) {
+    if (!_impl->dctx) {
+        _impl->dctx.reset(ZSTD_createDCtx());
+        if (!_impl->dctx) {
+            throw std::bad_alloc();
+        }
+    }
+    if (!_impl->dictionary.empty() && !_impl->ddict) {
+        _impl->ddict.reset(ZSTD_createDDict(_impl->dictionary.begin(), _impl->dictionary.size()));
+        if (!_impl->ddict) {
+            throw std::bad_alloc();
+        }
+    }
+    auto ret = _impl->ddict
+            ? ZSTD_decompress_usingDDict(_impl->dctx.get(), output, output_len, input, input_len, _impl->ddict.get())
+            : ZSTD_decompressDCtx(_impl->dctx.get(), output, output_len, input, input_len);
+    if (ZSTD_isError(ret)) {
+        throw std::runtime_error(sstring("zstd uncompression failure: ") + ZSTD_getErrorName(ret));
+    }
+    return ret;
+}
+
+size_t zstd_compressor::compress(const char* input, size_t input_len,
+        char* output, size_t output_len) {
+    if (!_impl->cctx) {
+        _impl->cctx.reset(ZSTD_createCCtx());
+        if (!_impl->cctx) {
+            throw std::bad_alloc();
+        }
+    }
+    if (!_impl->dictionary.empty() && !_impl->cdict) {
+        _impl->cdict.reset(ZSTD_createCDict(_impl->dictionary.begin(), _impl->dictionary.size(), _impl->level));
+        if (!_impl->cdict) {
+            throw std::bad_alloc();
+        }
+    }
+    auto ret = _impl->cdict
+            ? ZSTD_compress_usingCDict(_impl->cctx.get(), output, output_len, input, input_len, _impl->cdict.get())
+            : ZSTD_compressCCtx(_impl->cctx.get(), output, output_len, input, input_len, _impl->level);
+    if (ZSTD_isError(ret)) {
+        throw std::runtime_error(sstring("zstd compression failure: ") + ZSTD_getErrorName(ret));
+    }
+    return ret;
+}
+
+size_t zstd_compressor::compress_max_size(size_t input_len) const {
+    return ZSTD_compressBound(input_len);
+}
+
 compression::chunk_and_offset
 compression::locate(uint64_t position) const {
     auto ucl = uncompressed_chunk_length();
@@ -249,6 +419,11 @@ class compressed_file_data_source_impl : public data_source_impl {
         // and open a file_input_stream to read that range.
         auto start = _compression_metadata->locate(_beg_pos);
         auto end = _compression_metadata->locate(_end_pos - 1);
+        // Reads are not aligned to chunks, so reads smaller than a chunk
+        // would split most chunks over several I/Os. Larger reads coalesce
+        // adjacent chunks, and read-ahead keeps several of them in flight.
+        options.buffer_size = std::max(options.buffer_size,
+                align_up(size_t(_compression_metadata->uncompressed_chunk_length()), size_t(4096)));
         _input_stream = make_file_input_stream(std::move(f),
                 start.chunk_start,
                 end.chunk_start + end.chunk_len - start.chunk_start,
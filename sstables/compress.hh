@@ -37,6 +37,11 @@
 // LZ4, Snappy, and Deflate - the default (and therefore most important) is
 // LZ4. Each compressor is an implementation of the "compressor" class.
 //
+// We also support zstd, which Cassandra cannot read. Because small chunks
+// of small rows compress poorly on their own, a zstd sstable may carry a
+// dictionary trained from its first chunks in a CompressionDictionary
+// component; every chunk is then compressed with that dictionary.
+//
 // Each compressed chunk is followed by a 4-byte checksum of the compressed
 // data, using the Adler32 algorithm. In Cassandra, there is a parameter
 // "crc_check_chance" (defaulting to 1.0) which determines the probability
@@ -53,6 +58,7 @@
 #include "core/file.hh"
 #include "core/reactor.hh"
 #include "core/shared_ptr.hh"
+#include "core/temporary_buffer.hh"
 #include "types.hh"
 #include "../compress.hh"
 
@@ -104,6 +110,31 @@ inline uint32_t checksum_adler32_combine(uint32_t adler1, uint32_t adler2, size_
 
 namespace sstables {
 
+// Unlike the other compressors, zstd keeps state between chunks: reusable
+// compression contexts, and the digested dictionary if there is one. The
+// state is confined to the shard owning the sstable.
+class zstd_compressor {
+    struct impl;
+    std::unique_ptr<impl> _impl;
+public:
+    explicit zstd_compressor(int level);
+    ~zstd_compressor();
+
+    // Trains a dictionary of at most max_size bytes, using each of the
+    // samples as a training sample. Resolves to an empty dictionary if zstd
+    // could not train one, e.g. because there were too few samples. The
+    // samples must be kept alive until the returned future resolves.
+    static future<bytes> train_dictionary(const std::vector<temporary_buffer<char>>& samples, size_t max_size);
+
+    // An empty dictionary means chunks are compressed without one.
+    void set_dictionary(bytes dictionary);
+    const bytes& dictionary() const;
+
+    size_t uncompress(const char* input, size_t input_len, char* output, size_t output_len);
+    size_t compress(const char* input, size_t input_len, char* output, size_t output_len);
+    size_t compress_max_size(size_t input_len) const;
+};
+
 struct compression {
     disk_string<uint16_t> name;
     disk_array<uint32_t, option> options;
@@ -120,18 +151,36 @@ struct compression {
     compress_func *_compress = nullptr;
     // Return maximum length of data that compressor may output.
     compress_max_size_func *_compress_max_size = nullptr;
+    // Set for zstd instead of the function pointers above.
+    lw_shared_ptr<zstd_compressor> _zstd;
+    // Size of the dictionary to train when writing, 0 if none.
+    size_t _dictionary_size = 0;
+    bool _dictionary_trained = false;
     // Variables *not* found in the "Compression Info" file (added by update()):
     uint64_t _compressed_file_length = 0;
     uint32_t _full_checksum;
 public:
-    // Set the compressor algorithm, please check the definition of enum compressor.
-    void set_compressor(compressor c);
+    // Set the compressor algorithm and its parameters, please check the
+    // definition of enum compressor.
+    void set_compressor(const compression_parameters& cp);
     // After changing _compression, update() must be called to update
     // additional variables depending on it.
     void update(uint64_t compressed_file_length);
     operator bool() const {
-        return _uncompress != nullptr;
+        return _uncompress != nullptr || _zstd;
+    }
+
+    // While true, the writer holds back the chunks it is given, until
+    // dictionary_training_size() bytes are collected or the data ends, and
+    // then passes them to train_dictionary() before compressing them.
+    bool wants_dictionary() const {
+        return _dictionary_size && !_dictionary_trained;
     }
+    size_t dictionary_training_size() const;
+    future<> train_dictionary(const std::vector<temporary_buffer<char>>& samples);
+    // The dictionary stored in the CompressionDictionary component.
+    void set_dictionary(bytes dictionary);
+    const bytes& dictionary() const;
     // locate() locates in the compressed file the given byte position of
     // the uncompressed data:
     //   1. The byte range containing the appropriate compressed chunk, and
@@ -174,6 +223,9 @@ struct compression {
     size_t uncompress(
             const char* input, size_t input_len,
             char* output, size_t output_len) const {
+        if (_zstd) {
+            return _zstd->uncompress(input, input_len, output, output_len);
+        }
         if (!_uncompress) {
             throw std::runtime_error("uncompress is not supported");
         }
@@ -182,12 +234,18 @@ struct compression {
     size_t compress(
             const char* input, size_t input_len,
             char* output, size_t output_len) const {
+        if (_zstd) {
+            return _zstd->compress(input, input_len, output, output_len);
+        }
         if (!_compress) {
             throw std::runtime_error("compress is not supported");
         }
         return _compress(input, input_len, output, output_len);
     }
     size_t compress_max_size(size_t input_len) const {
+        if (_zstd) {
+            return _zstd->compress_max_size(input_len);
+        }
         return _compress_max_size(input_len);
     }
     friend class sstable;
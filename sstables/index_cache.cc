@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "index_cache.hh"
+
+namespace sstables {
+
+// Pages larger than this are not worth caching; they are rare and would push
+// out many partitions at once.
+static constexpr size_t max_cached_page_size = 1 << 20;
+
+cached_index_page::cached_index_page(cached_index_page&& o) noexcept
+    : lru_entry(std::move(o))
+    , _summary_idx(o._summary_idx)
+    , _entries(std::move(o._entries))
+{
+    if (o._link.is_linked()) {
+        container_type::node_algorithms::replace_node(o._link.this_ptr(), _link.this_ptr());
+        container_type::node_algorithms::init(o._link.this_ptr());
+    }
+}
+
+void cached_index_page::evict(cache_tracker& tracker) {
+    current_deleter<cached_index_page>()(this);
+    tracker.on_index_page_eviction();
+}
+
+// Each entry is serialized as: key size (uint32), key, position (uint64),
+// promoted index size (uint32), promoted index.
+static bytes serialize_index_page(const std::vector<index_entry>& entries) {
+    size_t size = 0;
+    for (auto&& e : entries) {
+        size += 2 * sizeof(uint32_t) + sizeof(uint64_t) + e.get_key_bytes().size() + e.get_promoted_index_bytes().size();
+    }
+    bytes b(bytes::initialized_later(), size);
+    auto out = b.begin();
+    auto write = [&out] (const void* p, size_t n) {
+        out = std::copy_n(reinterpret_cast<const bytes::value_type*>(p), n, out);
+    };
+    for (auto&& e : entries) {
+        auto key = e.get_key_bytes();
+        uint32_t key_size = key.size();
+        write(&key_size, sizeof(key_size));
+        write(key.data(), key.size());
+        uint64_t position = e.position();
+        write(&position, sizeof(position));
+        auto promoted_index = e.get_promoted_index_bytes();
+        uint32_t promoted_index_size = promoted_index.size();
+        write(&promoted_index_size, sizeof(promoted_index_size));
+        write(promoted_index.data(), promoted_index.size());
+    }
+    return b;
+}
+
+// The returned entries share buf.
+static std::vector<index_entry> deserialize_index_page(temporary_buffer<char> buf) {
+    std::vector<index_entry> entries;
+    size_t pos = 0;
+    auto read = [&buf, &pos] (void* p, size_t n) {
+        std::copy_n(buf.get() + pos, n, reinterpret_cast<char*>(p));
+        pos += n;
+    };
+    while (pos < buf.size()) {
+        uint32_t key_size;
+        read(&key_size, sizeof(key_size));
+        auto key = buf.share(pos, key_size);
+        pos += key_size;
+        uint64_t position;
+        read(&position, sizeof(position));
+        uint32_t promoted_index_size;
+        read(&promoted_index_size, sizeof(promoted_index_size));
+        auto promoted_index = buf.share(pos, promoted_index_size);
+        pos += promoted_index_size;
+        entries.emplace_back(std::move(key), position, std::move(promoted_index));
+    }
+    return entries;
+}
+
+index_cache::~index_cache() {
+    if (_pages.empty()) {
+        return;
+    }
+    with_allocator(_tracker.allocator(), [this] {
+        with_linearized_managed_bytes([this] {
+            _pages.clear_and_dispose([this] (cached_index_page* p) {
+                current_deleter<cached_index_page>()(p);
+                _tracker.on_index_page_removal();
+            });
+        });
+    });
+}
+
+std::experimental::optional<std::vector<index_entry>> index_cache::find(uint64_t summary_idx) {
+    temporary_buffer<char> buf;
+    {
+        // Pages must not move while we copy them out.
+        logalloc::reclaim_lock _(_tracker.region());
+        auto it = _pages.find(summary_idx, cached_index_page::compare());
+        if (it == _pages.end()) {
+            ++_misses;
+            if (_stats) {
+                ++_stats->misses;
+            }
+            _tracker.on_index_page_miss();
+            return { };
+        }
+        ++_hits;
+        if (_stats) {
+            ++_stats->hits;
+        }
+        _tracker.on_index_page_hit();
+        _tracker.touch(*it);
+        buf = temporary_buffer<char>(it->_entries.size());
+        with_linearized_managed_bytes([&] {
+            bytes_view v = it->_entries;
+            std::copy_n(reinterpret_cast<const char*>(v.data()), v.size(), buf.get_write());
+        });
+    }
+    return deserialize_index_page(std::move(buf));
+}
+
+void index_cache::insert(uint64_t summary_idx, const std::vector<index_entry>& entries) {
+    auto serialized = serialize_index_page(entries);
+    if (serialized.size() > max_cached_page_size) {
+        return;
+    }
+    _insert_section(_tracker.region(), [&] {
+        with_allocator(_tracker.allocator(), [&] {
+            if (_pages.find(summary_idx, cached_index_page::compare()) != _pages.end()) {
+                return;
+            }
+            auto page = current_allocator().construct<cached_index_page>(summary_idx, managed_bytes(bytes_view(serialized)));
+            _pages.insert(*page);
+            _tracker.insert_index_page(*page);
+        });
+    });
+}
+
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <experimental/optional>
+#include <boost/intrusive/set.hpp>
+#include "core/shared_ptr.hh"
+
+#include "row_cache.hh"
+#include "utils/managed_bytes.hh"
+#include "types.hh"
+
+namespace sstables {
+
+// The parsed entries of one index page, i.e. of the index entries covered by
+// one summary entry. Pages live in the row cache's region and are evicted
+// through its LRU.
+//
+// The entries are kept serialized back to back in a single buffer, so that a
+// hit copies the page out in one piece and the returned entries share the
+// copy instead of being allocated one by one.
+class cached_index_page final : public lru_entry {
+    using link_type = bi::set_member_hook<bi::link_mode<bi::auto_unlink>>;
+
+    link_type _link;
+    uint64_t _summary_idx;
+    managed_bytes _entries;
+
+    friend class index_cache;
+public:
+    cached_index_page(uint64_t summary_idx, managed_bytes entries)
+        : _summary_idx(summary_idx)
+        , _entries(std::move(entries))
+    { }
+    cached_index_page(cached_index_page&&) noexcept;
+
+    virtual cache_entry* entry() override { return nullptr; }
+    virtual void evict(cache_tracker&) override;
+
+    struct compare {
+        bool operator()(const cached_index_page& p1, const cached_index_page& p2) const {
+            return p1._summary_idx < p2._summary_idx;
+        }
+        bool operator()(uint64_t idx, const cached_index_page& p) const {
+            return idx < p._summary_idx;
+        }
+        bool operator()(const cached_index_page& p, uint64_t idx) const {
+            return p._summary_idx < idx;
+        }
+    };
+
+    using container_type = bi::set<cached_index_page,
+        bi::member_hook<cached_index_page, link_type, &cached_index_page::_link>,
+        bi::compare<compare>,
+        bi::constant_time_size<false>>;
+};
+
+// Hits and misses of the index caches of all sstables of a column family.
+// Shared with the sstables, so the counts outlive the sstables which
+// contributed to them.
+struct index_cache_stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// The cached index pages of a single sstable, keyed by summary index.
+// Pages are dropped along with the sstable.
+class index_cache {
+    cache_tracker& _tracker;
+    cached_index_page::container_type _pages;
+    logalloc::allocating_section _insert_section;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+    lw_shared_ptr<index_cache_stats> _stats;
+public:
+    explicit index_cache(cache_tracker& tracker) : _tracker(tracker) { }
+    index_cache(const index_cache&) = delete;
+    ~index_cache();
+
+    // Returns a disengaged optional if the page is not cached.
+    std::experimental::optional<std::vector<index_entry>> find(uint64_t summary_idx);
+    void insert(uint64_t summary_idx, const std::vector<index_entry>& entries);
+
+    // Also counts hits and misses into stats from now on.
+    void set_stats(lw_shared_ptr<index_cache_stats> stats) { _stats = std::move(stats); }
+
+    uint64_t hits() const { return _hits; }
+    uint64_t misses() const { return _misses; }
+};
+
+}
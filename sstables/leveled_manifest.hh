@@ -268,6 +268,19 @@ class leveled_manifest {
         return max_bytes_for_level(level, _max_sstable_size_in_bytes);
     }
 
+    // Returns the L0 sstables to size-tier if L0 has more sstables than can
+    // be compacted into L1 at once, or an empty descriptor otherwise.
+    sstables::compaction_descriptor get_stcs_candidates_in_L0() {
+        if (get_level_size(0) > MAX_COMPACTING_L0) {
+            auto most_interesting = size_tiered_most_interesting_bucket(get_level(0));
+            if (!most_interesting.empty()) {
+                logger.debug("L0 is too far behind, performing size-tiering there first");
+                return sstables::compaction_descriptor(std::move(most_interesting));
+            }
+        }
+        return sstables::compaction_descriptor();
+    }
+
     /**
      * @return highest-priority sstables to compact, and level to compact them to
      * If no compactions are necessary, will return null
@@ -331,12 +344,9 @@ class leveled_manifest {
             if (score > 1.001) {
                 // before proceeding with a higher level, let's see if L0 is far enough behind to warrant STCS
                 // TODO: we shouldn't proceed with size tiered strategy if cassandra.disable_stcs_in_l0 is true.
-                if (get_level_size(0) > MAX_COMPACTING_L0) {
-                    auto most_interesting = size_tiered_most_interesting_bucket(get_level(0));
-                    if (!most_interesting.empty()) {
-                        logger.debug("L0 is too far behind, performing size-tiering there first");
-                        return sstables::compaction_descriptor(std::move(most_interesting));
-                    }
+                auto l0_compaction = get_stcs_candidates_in_L0();
+                if (!l0_compaction.sstables.empty()) {
+                    return l0_compaction;
                 }
                 // L0 is fine, proceed with this level
                 auto candidates = get_candidates_for(i);
@@ -359,6 +369,13 @@ class leveled_manifest {
         if (get_level(0).empty()) {
             return sstables::compaction_descriptor();
         }
+        // Unless a write burst left L0 far behind. Compacting all of it into
+        // L1 would take long, and reads would go through every L0 sstable in
+        // the meantime, so size-tier it first to bring their number down.
+        auto l0_compaction = get_stcs_candidates_in_L0();
+        if (!l0_compaction.sstables.empty()) {
+            return l0_compaction;
+        }
         auto candidates = get_candidates_for(0);
         if (candidates.empty()) {
             return sstables::compaction_descriptor();
@@ -155,10 +155,6 @@ struct column_stats {
     /** histogram of tombstone drop time */
     streaming_histogram tombstone_histogram;
 
-    /** max and min column names according to comparator */
-    std::vector<bytes> min_column_names;
-    std::vector<bytes> max_column_names;
-
     bool has_legacy_counter_shards;
 
     column_stats() :
@@ -213,6 +209,7 @@ class metadata_collector {
     int _sstable_level = 0;
     std::vector<bytes> _min_column_names;
     std::vector<bytes> _max_column_names;
+    bool _has_min_max_components = false;
     bool _has_legacy_counter_shards = false;
 
     /**
@@ -286,16 +283,9 @@ class metadata_collector {
         _sstable_level = sstable_level;
     }
 
-    void update_min_column_names(std::vector<bytes>&& min_column_names) {
-        if (min_column_names.size() > 0) {
-            column_name_helper::merge_min_components(_min_column_names, std::move(min_column_names));
-        }
-    }
-
-    void update_max_column_names(std::vector<bytes>&& max_column_names) {
-        if (max_column_names.size() > 0) {
-            column_name_helper::merge_max_components(_max_column_names, std::move(max_column_names));
-        }
+    void update_min_max_components(const schema& s, const clustering_key_prefix& prefix) {
+        column_name_helper::min_max_components(s, _min_column_names, _max_column_names, !_has_min_max_components, prefix);
+        _has_min_max_components = true;
     }
 
     void update_has_legacy_counter_shards(bool has_legacy_counter_shards) {
@@ -309,8 +299,6 @@ class metadata_collector {
         add_row_size(stats.row_size);
         add_column_count(stats.column_count);
         merge_tombstone_histogram(stats.tombstone_histogram);
-        update_min_column_names(std::move(stats.min_column_names));
-        update_max_column_names(std::move(stats.max_column_names));
         update_has_legacy_counter_shards(stats.has_legacy_counter_shards);
     }
 
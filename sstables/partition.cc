@@ -20,6 +20,7 @@
  */
 #include "mutation.hh"
 #include "sstables.hh"
+#include "counters.hh"
 #include "types.hh"
 #include "core/future-util.hh"
 #include "key.hh"
@@ -27,6 +28,7 @@
 #include "core/do_with.hh"
 #include "unimplemented.hh"
 #include "utils/move.hh"
+#include "utils/data_input.hh"
 #include "dht/i_partitioner.hh"
 
 namespace sstables {
@@ -427,6 +429,73 @@ class mp_row_consumer : public row_consumer {
         return ret;
     }
 
+    // Counter contexts are written by Origin as:
+    //
+    //   <header_length:int16><header_elt:int16>*<shard>*
+    //   <shard> := <counter_id:16 bytes><clock:int64><count:int64>
+    //
+    // The header lists the global and local shards, the remaining ones are
+    // remote. Local shards, which are summed up instead of being merged by
+    // their clocks, only exist in sstables written before 2.1 and are not
+    // supported.
+    static atomic_cell make_counter_cell(int64_t timestamp, bytes_view value) {
+        static constexpr size_t shard_size = 32;
+
+        data_input in(value);
+        auto header_size = in.read<int16_t>();
+        for (auto i = 0; i < header_size; i++) {
+            auto idx = in.read<int16_t>();
+            if (idx >= 0) {
+                throw marshal_exception("encountered a local shard in a counter cell");
+            }
+        }
+        auto shards_size = in.avail();
+        if (shards_size % shard_size) {
+            throw marshal_exception("invalid counter context size");
+        }
+        auto shard_count = shards_size / shard_size;
+
+        counter_cell_builder ccb(shard_count);
+        for (auto i = 0u; i < shard_count; i++) {
+            auto id_hi = in.read<int64_t>();
+            auto id_lo = in.read<int64_t>();
+            auto clock = in.read<int64_t>();
+            auto count = in.read<int64_t>();
+            ccb.add_shard(counter_shard(counter_id(utils::UUID(id_hi, id_lo)), count, clock));
+        }
+        return ccb.build(timestamp);
+    }
+
+    virtual proceed consume_counter_cell(bytes_view col_name, bytes_view value, int64_t timestamp) override {
+        if (_skip_partition) {
+            return proceed::yes;
+        }
+
+        struct column col(*_schema, col_name);
+
+        auto clustering_prefix = exploded_clustering_prefix(std::move(col.clustering));
+        auto ret = flush_if_needed(col.is_static, clustering_prefix);
+        if (_skip_clustering_row) {
+            return ret;
+        }
+
+        if (!col.is_present(timestamp)) {
+            return ret;
+        }
+
+        if (col.collection_extra_data.size() || !col.cdef->is_counter()) {
+            throw malformed_sstable_exception(sprint("unexpected counter cell in column %s", col.cdef->name_as_text()));
+        }
+
+        auto ac = make_counter_cell(timestamp, value);
+        if (col.is_static) {
+            _in_progress->as_static_row().set_cell(*(col.cdef), std::move(ac));
+            return ret;
+        }
+        _in_progress->as_clustering_row().set_cell(*(col.cdef), atomic_cell_or_collection(std::move(ac)));
+        return ret;
+    }
+
     virtual proceed consume_deleted_cell(bytes_view col_name, sstables::deletion_time deltime) override {
         if (_skip_partition) {
             return proceed::yes;
@@ -645,15 +714,167 @@ class sstable_streamed_mutation : public streamed_mutation::impl {
     }
 };
 
+// Part of the data file to read for a single partition.
+struct partition_data_window {
+    uint64_t start;
+    uint64_t end;
+    // Engaged when the window starts past the partition header.
+    stdx::optional<deletion_time> header_deletion_time;
+    // True when the window ends before the end of the partition.
+    bool ends_inside_partition = false;
+};
+
+// Converts a column name from the promoted index to the clustering prefix of
+// the item it names. Returns a disengaged optional for static cells.
+static stdx::optional<clustering_key_prefix> index_name_to_prefix(const schema& s, bytes_view name) {
+    static const bytes static_marker(size_t(2), bytes::value_type(0xff));
+    if (name.empty()) {
+        return clustering_key_prefix::make_empty();
+    }
+    if (!s.is_compound()) {
+        return clustering_key_prefix::from_single_value(s, to_bytes(name));
+    }
+    if (name.compare(0, static_marker.size(), static_marker) == 0) {
+        return { };
+    }
+    auto components = composite_view(name).explode();
+    if (components.size() > s.clustering_key_size()) {
+        components.resize(s.clustering_key_size());
+    }
+    return clustering_key_prefix::from_exploded(std::move(components));
+}
+
+struct promoted_index_block {
+    bytes_view first_name;
+    bytes_view last_name;
+    uint64_t offset;
+    uint64_t width;
+};
+
+// Parsed promoted index of a partition. Refers to the serialized form, which
+// has to be kept alive.
+struct promoted_index {
+    deletion_time partition_deletion_time;
+    std::vector<promoted_index_block> blocks;
+};
+
+static promoted_index parse_promoted_index(bytes_view promoted_index_bytes) {
+    promoted_index pi;
+    if (promoted_index_bytes.empty()) {
+        return pi;
+    }
+    data_input in(promoted_index_bytes);
+    pi.partition_deletion_time.local_deletion_time = in.read<int32_t>();
+    pi.partition_deletion_time.marked_for_delete_at = in.read<int64_t>();
+    auto count = in.read<uint32_t>();
+    pi.blocks.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        auto first_name = in.read_view_to_blob<uint16_t>();
+        auto last_name = in.read_view_to_blob<uint16_t>();
+        auto offset = in.read<uint64_t>();
+        auto width = in.read<uint64_t>();
+        pi.blocks.push_back(promoted_index_block{first_name, last_name, offset, width});
+    }
+    return pi;
+}
+
+// Returns the first and the last of the promoted index blocks which may
+// contain data for given clustering ranges.
+//
+// The comparisons are conservative: a block is skipped only if its last item
+// is known to precede all ranges, or its first item is known to follow them.
+// Blocks are never skipped from the front if the schema has static columns,
+// because the static row is always at the beginning of the partition.
+static std::pair<size_t, size_t>
+promoted_index_blocks_for(const schema& s, const std::vector<promoted_index_block>& blocks,
+                          const query::clustering_row_ranges& ranges) {
+    assert(!blocks.empty());
+    bound_view::compare less(s);
+    stdx::optional<bound_view> min_start;
+    stdx::optional<bound_view> max_end;
+    bool open_start = false;
+    bool open_end = false;
+    for (auto&& r : ranges) {
+        if (!r.start()) {
+            open_start = true;
+        } else {
+            bound_view b(r.start()->value(), r.start()->is_inclusive() ? bound_kind::incl_start : bound_kind::excl_start);
+            if (!min_start || less(b, *min_start)) {
+                min_start.emplace(b);
+            }
+        }
+        if (!r.end()) {
+            open_end = true;
+        } else {
+            bound_view b(r.end()->value(), r.end()->is_inclusive() ? bound_kind::incl_end : bound_kind::excl_end);
+            if (!max_end || less(*max_end, b)) {
+                max_end.emplace(b);
+            }
+        }
+    }
+
+    size_t first = 0;
+    if (!open_start && !s.has_static_columns()) {
+        while (first + 1 < blocks.size()) {
+            auto last_key = index_name_to_prefix(s, blocks[first].last_name);
+            if (last_key && !less(bound_view(*last_key, bound_kind::incl_end), *min_start)) {
+                break;
+            }
+            ++first;
+        }
+    }
+    size_t last = blocks.size() - 1;
+    if (!open_end) {
+        while (last > first) {
+            auto first_key = index_name_to_prefix(s, blocks[last].first_name);
+            if (!first_key || !less(*max_end, bound_view(*first_key, bound_kind::incl_start))) {
+                break;
+            }
+            --last;
+        }
+    }
+    return { first, last };
+}
+
+// Returns the part of the data file which contains blocks [first, last] of
+// the promoted index.
+static partition_data_window
+promoted_index_blocks_window(const promoted_index& pi, size_t first, size_t last,
+                             uint64_t partition_start, uint64_t partition_end) {
+    partition_data_window w{partition_start, partition_end};
+    if (first > 0) {
+        w.start = partition_start + pi.blocks[first].offset;
+        w.header_deletion_time = pi.partition_deletion_time;
+    }
+    if (last + 1 < pi.blocks.size()) {
+        w.end = partition_start + pi.blocks[last].offset + pi.blocks[last].width;
+        w.ends_inside_partition = true;
+    }
+    return w;
+}
+
+// Uses the promoted index of a partition to narrow the part of the data file
+// which needs to be read in order to return given clustering ranges.
+static partition_data_window
+promoted_index_window(const schema& s, bytes_view promoted_index_bytes, const query::clustering_row_ranges& ranges,
+                      uint64_t partition_start, uint64_t partition_end) {
+    auto pi = parse_promoted_index(promoted_index_bytes);
+    if (pi.blocks.size() < 2 || ranges.empty()) {
+        return partition_data_window{partition_start, partition_end};
+    }
+    auto blocks = promoted_index_blocks_for(s, pi.blocks, ranges);
+    return promoted_index_blocks_window(pi, blocks.first, blocks.second, partition_start, partition_end);
+}
+
 class sstable_single_streamed_mutation final : public sstable_streamed_mutation {
     struct data_source {
         mp_row_consumer _consumer;
         data_consume_context _context;
 
         data_source(schema_ptr s, sstable& sst, const sstables::key& k, const io_priority_class& pc,
-                    query::clustering_key_filtering_context ck_filtering, uint64_t start, uint64_t end)
+                    query::clustering_key_filtering_context ck_filtering, const partition_data_window& w)
             : _consumer(k, s, ck_filtering, pc)
-            , _context(sst.data_consume_rows(_consumer, start, end))
+            , _context(sst.data_consume_single_partition(_consumer, k, w.header_deletion_time, w.ends_inside_partition, w.start, w.end))
         {
         }
     };
@@ -667,9 +888,9 @@ class sstable_single_streamed_mutation final : public sstable_streamed_mutation
 
     static future<streamed_mutation> create(schema_ptr s, sstable& sst, const sstables::key& k,
                                             query::clustering_key_filtering_context ck_filtering,
-                                            const io_priority_class& pc, uint64_t start, uint64_t end)
+                                            const io_priority_class& pc, const partition_data_window& w)
     {
-        auto ds = make_lw_shared<data_source>(s, sst, k, pc, ck_filtering, start, end);
+        auto ds = make_lw_shared<data_source>(s, sst, k, pc, ck_filtering, w);
         return ds->_context.read().then([s, ds] {
             auto mut = ds->_consumer.get_mutation();
             assert(mut);
@@ -679,6 +900,138 @@ class sstable_single_streamed_mutation final : public sstable_streamed_mutation
     }
 };
 
+// Reads a partition in the reverse order using its promoted index. Blocks
+// are read from the last one to the first one, each of them is parsed in the
+// forward direction and then emitted backwards, so that at most one block is
+// kept in memory at a time.
+//
+// This relies on range tombstones which are open at the beginning of a block
+// being repeated there by the writer, so that by the time a block is emitted
+// all tombstones covering it are known.
+class sstable_reversed_streamed_mutation final : public streamed_mutation::impl {
+    // Blocks are read lazily, long after read_row() returned.
+    shared_sstable _sst;
+    sstables::key _key;
+    query::clustering_key_filtering_context _ck_filtering;
+    const io_priority_class& _pc;
+    bytes _promoted_index_bytes;
+    promoted_index _promoted_index;
+    uint64_t _partition_start;
+    uint64_t _partition_end;
+    size_t _first_block;
+    // Blocks [_first_block, _first_block + _blocks_left) are yet to be emitted.
+    size_t _blocks_left;
+    // The static row has to be emitted before anything else, so the first
+    // block is read ahead and kept until it is its turn.
+    bool _read_static_row;
+    stdx::optional<std::vector<mutation_fragment>> _first_block_fragments;
+    range_tombstone_stream _range_tombstones;
+    // Clustering rows of the current block in the forward order.
+    std::vector<mutation_fragment> _rows;
+private:
+    future<std::vector<mutation_fragment>> read_block(size_t idx) {
+        auto w = promoted_index_blocks_window(_promoted_index, idx, idx, _partition_start, _partition_end);
+        return sstable_single_streamed_mutation::create(_schema, *_sst, _key, _ck_filtering, _pc, w).then([] (streamed_mutation sm) {
+            return do_with(std::move(sm), std::vector<mutation_fragment>(), [] (auto& sm, auto& mfs) {
+                return repeat([&sm, &mfs] {
+                    return sm().then([&mfs] (mutation_fragment_opt mf) {
+                        if (!mf) {
+                            return stop_iteration::yes;
+                        }
+                        mfs.emplace_back(std::move(*mf));
+                        return stop_iteration::no;
+                    });
+                }).then([&mfs] {
+                    return std::move(mfs);
+                });
+            });
+        });
+    }
+
+    void consume_block(std::vector<mutation_fragment> mfs) {
+        stdx::optional<range_tombstone_begin> rtb;
+        for (auto&& mf : mfs) {
+            if (mf.is_clustering_row()) {
+                _rows.emplace_back(std::move(mf));
+            } else if (mf.is_range_tombstone_begin()) {
+                rtb = std::move(mf.as_range_tombstone_begin());
+            } else if (mf.is_range_tombstone_end()) {
+                assert(rtb);
+                auto& rte = mf.as_range_tombstone_end();
+                _range_tombstones.apply(range_tombstone(std::move(rtb->key()), rtb->kind(),
+                                                        std::move(rte.key()), rte.kind(), rtb->tomb()));
+                rtb = { };
+            }
+        }
+    }
+
+    future<> read_next() {
+        if (!_rows.empty()) {
+            auto mf = _range_tombstones.get_next(_rows.back());
+            if (mf) {
+                push_mutation_fragment(std::move(*mf));
+            } else {
+                push_mutation_fragment(std::move(_rows.back()));
+                _rows.pop_back();
+            }
+            return make_ready_future<>();
+        }
+        if (_read_static_row) {
+            _read_static_row = false;
+            return read_block(_first_block).then([this] (std::vector<mutation_fragment> mfs) {
+                if (!mfs.empty() && mfs.front().is_static_row()) {
+                    push_mutation_fragment(std::move(mfs.front()));
+                }
+                _first_block_fragments = std::move(mfs);
+            });
+        }
+        if (_blocks_left) {
+            auto idx = _first_block + --_blocks_left;
+            if (idx == _first_block && _first_block_fragments) {
+                consume_block(std::move(*_first_block_fragments));
+                _first_block_fragments = { };
+                return make_ready_future<>();
+            }
+            return read_block(idx).then([this] (std::vector<mutation_fragment> mfs) {
+                consume_block(std::move(mfs));
+            });
+        }
+        auto mf = _range_tombstones.get_next();
+        if (mf) {
+            push_mutation_fragment(std::move(*mf));
+        } else {
+            _end_of_stream = true;
+        }
+        return make_ready_future<>();
+    }
+public:
+    sstable_reversed_streamed_mutation(schema_ptr s, dht::decorated_key dk, tombstone t, shared_sstable sst,
+                                       const sstables::key& k, query::clustering_key_filtering_context ck_filtering,
+                                       const io_priority_class& pc, bytes promoted_index_bytes,
+                                       size_t first_block, size_t last_block,
+                                       uint64_t partition_start, uint64_t partition_end)
+        : streamed_mutation::impl(s, std::move(dk), t, true)
+        , _sst(std::move(sst))
+        , _key(k)
+        , _ck_filtering(ck_filtering)
+        , _pc(pc)
+        , _promoted_index_bytes(std::move(promoted_index_bytes))
+        , _promoted_index(parse_promoted_index(_promoted_index_bytes))
+        , _partition_start(partition_start)
+        , _partition_end(partition_end)
+        , _first_block(first_block)
+        , _blocks_left(last_block - first_block + 1)
+        , _read_static_row(s->has_static_columns())
+        , _range_tombstones(*s, true)
+    { }
+
+    virtual future<> fill_buffer() override {
+        return do_until([this] { return is_end_of_stream() || is_buffer_full(); }, [this] {
+            return read_next();
+        });
+    }
+};
+
 static int adjust_binary_search_index(int idx) {
     if (idx < 0) {
         // binary search gives us the first index _greater_ than the key searched for,
@@ -749,8 +1102,26 @@ sstables::sstable::read_row(schema_ptr schema,
         _filter_tracker.add_true_positive();
 
         auto position = index_list[index_idx].position();
-        return this->data_end_position(summary_idx, index_idx, index_list, pc).then([&key, schema, ck_filtering, this, position, &pc] (uint64_t end) {
-            return sstable_single_streamed_mutation::create(schema, *this, key, ck_filtering, pc, position, end).then([] (auto sm) {
+        auto end_position = this->data_end_position(summary_idx, index_idx, index_list, pc);
+        return end_position.then([&key, schema, ck_filtering, this, position, &pc,
+                                  index_list = std::move(index_list), index_idx] (uint64_t end) {
+            auto pk = partition_key::from_exploded(*schema, key.explode(*schema));
+            auto& ck_ranges = ck_filtering.get_ranges(pk);
+            auto promoted_index_bytes = index_list[index_idx].get_promoted_index_bytes();
+            if (ck_filtering.is_reversed() && !ck_ranges.empty()) {
+                auto pi = parse_promoted_index(promoted_index_bytes);
+                // Partitions without the promoted index are small enough to be
+                // reversed by the consumer.
+                if (pi.blocks.size() >= 2) {
+                    auto blocks = promoted_index_blocks_for(*schema, pi.blocks, ck_ranges);
+                    auto dk = dht::global_partitioner().decorate_key(*schema, std::move(pk));
+                    return make_ready_future<streamed_mutation_opt>(make_streamed_mutation<sstable_reversed_streamed_mutation>(
+                        schema, std::move(dk), tombstone(pi.partition_deletion_time), shared_from_this(), key, ck_filtering, pc,
+                        to_bytes(promoted_index_bytes), blocks.first, blocks.second, position, end));
+                }
+            }
+            auto w = promoted_index_window(*schema, promoted_index_bytes, ck_ranges, position, end);
+            return sstable_single_streamed_mutation::create(schema, *this, key, ck_filtering, pc, w).then([] (auto sm) {
                 return streamed_mutation_opt(std::move(sm));
             });
         });
@@ -42,6 +42,8 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
         EXPIRING_CELL,
         EXPIRING_CELL_2,
         EXPIRING_CELL_3,
+        COUNTER_CELL,
+        COUNTER_CELL_2,
         CELL,
         CELL_2,
         CELL_VALUE_BYTES,
@@ -60,8 +62,12 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
 
     // state for reading a cell
     bool _deleted;
+    bool _counter;
     uint32_t _ttl, _expiration;
 
+    // True when the input ends inside a partition, before its end marker.
+    bool _ends_inside_partition = false;
+
     static inline bytes_view to_bytes_view(temporary_buffer<char>& b) {
         // The sstable code works with char, our "bytes_view" works with
         // byte_t. Rather than change all the code, let's do a cast...
@@ -75,7 +81,8 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
                 || (_state == state::CELL_VALUE_BYTES_2)
                 || (_state == state::ATOM_START_2)
                 || (_state == state::ATOM_MASK_2)
-                || (_state == state::EXPIRING_CELL_3)) && (_prestate == prestate::NONE));
+                || (_state == state::EXPIRING_CELL_3)
+                || (_state == state::COUNTER_CELL_2)) && (_prestate == prestate::NONE));
     }
 
     // process() feeds the given data into the state machine.
@@ -190,10 +197,12 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
             if (mask & RANGE_TOMBSTONE_MASK) {
                 _state = state::RANGE_TOMBSTONE;
             } else if (mask & COUNTER_MASK) {
-                // FIXME: see ColumnSerializer.java:deserializeColumnBody
-                throw malformed_sstable_exception("FIXME COUNTER_MASK");
+                _deleted = false;
+                _counter = true;
+                _state = state::COUNTER_CELL;
             } else if (mask & EXPIRATION_MASK) {
                 _deleted = false;
+                _counter = false;
                 _state = state::EXPIRING_CELL;
             } else {
                 // FIXME: see ColumnSerializer.java:deserializeColumnBody
@@ -202,10 +211,23 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
                 }
                 _ttl = _expiration = 0;
                 _deleted = mask & DELETION_MASK;
+                _counter = false;
                 _state = state::CELL;
             }
             break;
         }
+        case state::COUNTER_CELL:
+            // timestampOfLastDelete, unused since 2.1 (CASSANDRA-6506)
+            _ttl = _expiration = 0;
+            if (read_64(data) != read_status::ready) {
+                _state = state::COUNTER_CELL_2;
+            } else {
+                _state = state::CELL;
+            }
+            break;
+        case state::COUNTER_CELL_2:
+            _state = state::CELL;
+            break;
         case state::EXPIRING_CELL:
             if (read_32(data) != read_status::ready) {
                 _state = state::EXPIRING_CELL_2;
@@ -248,6 +270,9 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
                     del.local_deletion_time = consume_be<uint32_t>(_val);
                     del.marked_for_delete_at = _u64;
                     ret = _consumer.consume_deleted_cell(to_bytes_view(_key), del);
+                } else if (_counter) {
+                    ret = _consumer.consume_counter_cell(to_bytes_view(_key),
+                            to_bytes_view(_val), _u64);
                 } else {
                     ret = _consumer.consume_cell(to_bytes_view(_key),
                             to_bytes_view(_val), _u64, _ttl, _expiration);
@@ -275,6 +300,9 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
                 del.local_deletion_time = consume_be<uint32_t>(_val);
                 del.marked_for_delete_at = _u64;
                 ret = _consumer.consume_deleted_cell(to_bytes_view(_key), del);
+            } else if (_counter) {
+                ret = _consumer.consume_counter_cell(to_bytes_view(_key),
+                        to_bytes_view(_val), _u64);
             } else {
                 ret = _consumer.consume_cell(to_bytes_view(_key),
                         to_bytes_view(_val), _u64, _ttl, _expiration);
@@ -338,7 +366,30 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
             , _consumer(consumer) {
     }
 
+    // Creates a context for reading a part of a single partition. If the
+    // input starts past the partition header, the header is synthesized from
+    // the given key and deletion time. If the input ends before the end of
+    // the partition, the end of row is synthesized when the input ends.
+    data_consume_rows_context(row_consumer& consumer,
+            input_stream<char> && input, uint64_t maxlen,
+            bytes_view key, stdx::optional<deletion_time> header_deletion_time,
+            bool ends_inside_partition) :
+            continuous_data_consumer(std::move(input), maxlen)
+            , _consumer(consumer)
+            , _ends_inside_partition(ends_inside_partition) {
+        if (header_deletion_time) {
+            _key = temporary_buffer<char>(reinterpret_cast<const char*>(key.data()), key.size());
+            _u32 = header_deletion_time->local_deletion_time;
+            _u64 = header_deletion_time->marked_for_delete_at;
+            _state = state::DELETION_TIME_3;
+        }
+    }
+
     void verify_end_state() {
+        if (_ends_inside_partition && _state == state::ATOM_START && _prestate == prestate::NONE) {
+            _state = state::ROW_START;
+            _consumer.consume_row_end();
+        }
         if (_state != state::ROW_START || _prestate != prestate::NONE) {
             throw malformed_sstable_exception("end of input, but not end of row");
         }
@@ -357,6 +408,11 @@ class data_consume_context::impl {
     impl(row_consumer& consumer,
             input_stream<char>&& input, uint64_t maxlen) :
                 _ctx(new data_consume_rows_context(consumer, std::move(input), maxlen)) { }
+    impl(row_consumer& consumer,
+            input_stream<char>&& input, uint64_t maxlen,
+            bytes_view key, stdx::optional<deletion_time> header_deletion_time, bool ends_inside_partition) :
+                _ctx(new data_consume_rows_context(consumer, std::move(input), maxlen,
+                                                   key, header_deletion_time, ends_inside_partition)) { }
     ~impl() {
         if (_ctx) {
             auto f = _ctx->close();
@@ -392,6 +448,14 @@ data_consume_context sstable::data_consume_rows(
             consumer, data_stream(start, end - start, consumer.io_priority()), end - start);
 }
 
+data_consume_context sstable::data_consume_single_partition(row_consumer& consumer, const key& k,
+        stdx::optional<deletion_time> header_deletion_time, bool ends_inside_partition,
+        uint64_t start, uint64_t end) {
+    return std::make_unique<data_consume_context::impl>(
+            consumer, data_stream(start, end - start, consumer.io_priority()), end - start,
+            bytes_view(k), header_deletion_time, ends_inside_partition);
+}
+
 data_consume_context sstable::data_consume_rows(row_consumer& consumer) {
     return data_consume_rows(consumer, 0, data_size());
 }
@@ -66,6 +66,9 @@ class row_consumer {
             int64_t timestamp,
             int32_t ttl, int32_t expiration) = 0;
 
+    // Consume a live counter cell. The value is the counter context, in the
+    // format used by Origin (see CounterContext.java).
+    virtual proceed consume_counter_cell(bytes_view col_name, bytes_view value, int64_t timestamp) = 0;
 
     // Consume a deleted cell (i.e., a cell tombstone).
     virtual proceed consume_deleted_cell(bytes_view col_name, sstables::deletion_time deltime) = 0;
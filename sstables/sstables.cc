@@ -53,6 +53,7 @@
 #include <core/align.hh>
 #include "utils/phased_barrier.hh"
 #include "range_tombstone_list.hh"
+#include "counters.hh"
 
 #include "checked-file-impl.hh"
 #include "disk-error-handler.hh"
@@ -156,6 +157,7 @@ static const sstring TEMPORARY_TOC_SUFFIX = "TOC.txt.tmp";
 std::unordered_map<sstable::component_type, sstring, enum_hash<sstable::component_type>> sstable::_component_map = {
     { component_type::Index, "Index.db"},
     { component_type::CompressionInfo, "CompressionInfo.db" },
+    { component_type::CompressionDictionary, "CompressionDictionary.db" },
     { component_type::Data, "Data.db" },
     { component_type::TOC, TOC_SUFFIX },
     { component_type::Summary, "Summary.db" },
@@ -163,6 +165,7 @@ std::unordered_map<sstable::component_type, sstring, enum_hash<sstable::componen
     { component_type::CRC, "CRC.db" },
     { component_type::Filter, "Filter.db" },
     { component_type::Statistics, "Statistics.db" },
+    { component_type::Scylla, "Scylla.db" },
     { component_type::TemporaryTOC, TEMPORARY_TOC_SUFFIX },
     { component_type::TemporaryStatistics, "Statistics.db.tmp" },
 };
@@ -756,10 +759,11 @@ future<> sstable::read_toc() {
 
 }
 
-void sstable::generate_toc(compressor c, double filter_fp_chance) {
+void sstable::generate_toc(const compression_parameters& cp, double filter_fp_chance) {
     // Creating table of components.
     _components.insert(component_type::TOC);
     _components.insert(component_type::Statistics);
+    _components.insert(component_type::Scylla);
     _components.insert(component_type::Digest);
     _components.insert(component_type::Index);
     _components.insert(component_type::Summary);
@@ -767,11 +771,14 @@ void sstable::generate_toc(compressor c, double filter_fp_chance) {
     if (filter_fp_chance != 1.0) {
         _components.insert(component_type::Filter);
     }
-    if (c == compressor::none) {
+    if (cp.get_compressor() == compressor::none) {
         _components.insert(component_type::CRC);
     } else {
         _components.insert(component_type::CompressionInfo);
     }
+    if (cp.get_compressor() == compressor::zstd && cp.dictionary_size() > 0) {
+        _components.insert(component_type::CompressionDictionary);
+    }
 }
 
 void sstable::write_toc(const io_priority_class& pc) {
@@ -876,6 +883,12 @@ future<index_list> sstable::read_indexes(uint64_t summary_idx, const io_priority
         return make_ready_future<index_list>(index_list());
     }
 
+    auto cached = _index_cache.find(summary_idx);
+    if (cached) {
+        return make_ready_future<index_list>(std::move(*cached));
+    }
+
+    auto page_idx = summary_idx;
     uint64_t position = _summary.entries[summary_idx].position;
     uint64_t quantity = downsampling::get_effective_index_interval_after_index(summary_idx, _summary.header.sampling_level,
         _summary.header.min_index_interval);
@@ -887,7 +900,7 @@ future<index_list> sstable::read_indexes(uint64_t summary_idx, const io_priority
         end = _summary.entries[summary_idx].position;
     }
 
-    return do_with(index_consumer(quantity), [this, position, end, &pc] (index_consumer& ic) {
+    return do_with(index_consumer(quantity), [this, page_idx, position, end, &pc] (index_consumer& ic) {
         file_input_stream_options options;
         options.buffer_size = sstable_buffer_size;
         options.io_priority_class = pc;
@@ -897,7 +910,8 @@ future<index_list> sstable::read_indexes(uint64_t summary_idx, const io_priority
         auto ctx = make_lw_shared<index_consume_entry_context<index_consumer>>(ic, std::move(stream), this->index_size() - position);
         return ctx->consume_input(*ctx).finally([ctx] {
             return ctx->close();
-        }).then([ctx, &ic] {
+        }).then([this, page_idx, ctx, &ic] {
+            _index_cache.insert(page_idx, ic.indexes);
             return make_ready_future<index_list>(std::move(ic.indexes));
         });
     });
@@ -950,7 +964,36 @@ future<> sstable::read_compression(const io_priority_class& pc) {
         return make_ready_future<>();
     }
 
-    return read_simple<component_type::CompressionInfo>(_compression, pc);
+    return read_simple<component_type::CompressionInfo>(_compression, pc).then([this, &pc] {
+        return read_compression_dictionary(pc);
+    });
+}
+
+// The dictionary is stored raw, as produced by the trainer. The file is
+// empty if training failed, in which case chunks were compressed without it.
+future<> sstable::read_compression_dictionary(const io_priority_class& pc) {
+    if (!has_component(sstable::component_type::CompressionDictionary)) {
+        return make_ready_future<>();
+    }
+
+    auto file_path = filename(component_type::CompressionDictionary);
+    sstlog.debug("Reading CompressionDictionary file {} ", file_path);
+    return open_checked_file_dma(sstable_read_error, file_path, open_flags::ro).then([this, &pc] (file f) {
+        return f.size().then([this, f, &pc] (uint64_t size) mutable {
+            file_input_stream_options options;
+            options.buffer_size = sstable_buffer_size;
+            options.io_priority_class = pc;
+            auto r = make_lw_shared<input_stream<char>>(make_file_input_stream(std::move(f), std::move(options)));
+            return r->read_exactly(size).then([this, size] (temporary_buffer<char> buf) {
+                if (buf.size() != size) {
+                    throw malformed_sstable_exception("Short read of compression dictionary", this->filename(component_type::CompressionDictionary));
+                }
+                _compression.set_dictionary(bytes(reinterpret_cast<const int8_t*>(buf.get()), buf.size()));
+            }).finally([r] {
+                return r->close();
+            });
+        });
+    });
 }
 
 void sstable::write_compression(const io_priority_class& pc) {
@@ -959,6 +1002,31 @@ void sstable::write_compression(const io_priority_class& pc) {
     }
 
     write_simple<component_type::CompressionInfo>(_compression, pc);
+
+    if (has_component(sstable::component_type::CompressionDictionary)) {
+        auto file_path = filename(component_type::CompressionDictionary);
+        sstlog.debug("Writing CompressionDictionary file {} ", file_path);
+        file f = new_sstable_component_file(sstable_write_error, file_path, open_flags::wo | open_flags::create | open_flags::exclusive).get0();
+
+        file_output_stream_options options;
+        options.buffer_size = sstable_buffer_size;
+        options.io_priority_class = pc;
+        auto w = file_writer(std::move(f), std::move(options));
+        w.write(_compression.dictionary()).get();
+        w.flush().get();
+        w.close().get();
+    }
+}
+
+future<> sstable::read_scylla_metadata(const io_priority_class& pc) {
+    if (!has_component(component_type::Scylla)) {
+        return make_ready_future<>();
+    }
+    return read_simple<component_type::Scylla>(_scylla_metadata, pc);
+}
+
+void sstable::write_scylla_metadata(const io_priority_class& pc) {
+    write_simple<component_type::Scylla>(_scylla_metadata, pc);
 }
 
 future<> sstable::read_statistics(const io_priority_class& pc) {
@@ -1055,6 +1123,8 @@ future<> sstable::create_data() {
 future<> sstable::load() {
     return read_toc().then([this] {
         return read_statistics(default_priority_class());
+    }).then([this] {
+        return read_scylla_metadata(default_priority_class());
     }).then([this] {
         return read_compression(default_priority_class());
     }).then([this] {
@@ -1069,11 +1139,6 @@ future<> sstable::load() {
 // @clustering_key: it's expected that clustering key is already in its composite form.
 // NOTE: empty clustering key means that there is no clustering key.
 void sstable::write_column_name(file_writer& out, const composite& clustering_key, const std::vector<bytes_view>& column_names, composite_marker m) {
-    // FIXME: min_components and max_components also keep track of clustering
-    // prefix, so we must merge clustering_key and column_names somehow and
-    // pass the result to the functions below.
-    column_name_helper::min_max_components(_c_stats.min_column_names, _c_stats.max_column_names, column_names);
-
     // was defined in the schema, for example.
     auto c= composite::from_exploded(column_names, m);
     auto ck_bview = bytes_view(clustering_key);
@@ -1095,8 +1160,6 @@ void sstable::write_column_name(file_writer& out, const composite& clustering_ke
 }
 
 void sstable::write_column_name(file_writer& out, bytes_view column_names) {
-    column_name_helper::min_max_components(_c_stats.min_column_names, _c_stats.max_column_names, { column_names });
-
     size_t sz = column_names.size();
     if (sz > std::numeric_limits<uint16_t>::max()) {
         throw std::runtime_error(sprint("Column name too large (%d > %d)", sz, std::numeric_limits<uint16_t>::max()));
@@ -1112,10 +1175,32 @@ static inline void update_cell_stats(column_stats& c_stats, uint64_t timestamp)
     c_stats.column_count++;
 }
 
-// Intended to write all cell components that follow column name.
-void sstable::write_cell(file_writer& out, atomic_cell_view cell) {
-    // FIXME: counter cell isn't supported yet.
+// Serializes a counter cell as a context in the format used by Origin (see
+// CounterContext.java). All shards are written as global ones.
+static bytes make_counter_context(counter_cell_view ccv) {
+    auto shard_count = ccv.shard_count();
+    auto header_size = sizeof(int16_t) + shard_count * sizeof(int16_t);
+    bytes b(bytes::initialized_later(), header_size + shard_count * counter_shard::serialized_size);
+    auto out = b.begin();
+    auto write = [&out] (auto value) {
+        auto v = net::hton(value);
+        out = std::copy_n(reinterpret_cast<const bytes::value_type*>(&v), sizeof(v), out);
+    };
+    write(int16_t(shard_count));
+    for (auto i = 0u; i < shard_count; i++) {
+        write(int16_t(std::numeric_limits<int16_t>::min() + i));
+    }
+    for (auto&& csv : ccv.shards()) {
+        write(csv.id().to_uuid().get_most_significant_bits());
+        write(csv.id().to_uuid().get_least_significant_bits());
+        write(csv.logical_clock());
+        write(csv.value());
+    }
+    return b;
+}
 
+// Intended to write all cell components that follow column name.
+void sstable::write_cell(file_writer& out, atomic_cell_view cell, const column_definition& cdef) {
     uint64_t timestamp = cell.timestamp();
 
     update_cell_stats(_c_stats, timestamp);
@@ -1131,6 +1216,18 @@ void sstable::write_cell(file_writer& out, atomic_cell_view cell) {
         _c_stats.tombstone_histogram.update(deletion_time);
 
         write(out, mask, timestamp, deletion_time_size, deletion_time);
+    } else if (cdef.is_counter()) {
+        // counter cell
+
+        column_mask mask = column_mask::counter;
+        // Unused since 2.1 (CASSANDRA-6506), kept for compatibility.
+        int64_t timestamp_of_last_delete = std::numeric_limits<int64_t>::min();
+        auto context = make_counter_context(counter_cell_view(cell));
+        disk_string_view<uint32_t> cell_value { bytes_view(context) };
+
+        _c_stats.update_max_local_deletion_time(std::numeric_limits<int>::max());
+
+        write(out, mask, timestamp_of_last_delete, timestamp, cell_value);
     } else if (cell.is_live_and_has_ttl()) {
         // expiring cell
 
@@ -1224,7 +1321,7 @@ void sstable::write_collection(file_writer& out, const composite& clustering_key
     write_range_tombstone(out, clustering_key, clustering_key, { bytes_view(column_name) }, mview.tomb);
     for (auto& cp: mview.cells) {
         write_column_name(out, clustering_key, { column_name, cp.first });
-        write_cell(out, cp.second);
+        write_cell(out, cp.second, cdef);
     }
 }
 
@@ -1232,6 +1329,7 @@ void sstable::write_collection(file_writer& out, const composite& clustering_key
 // clustered_row contains a set of cells sharing the same clustering key.
 void sstable::write_clustered_row(file_writer& out, const schema& schema, const clustering_row& clustered_row) {
     auto clustering_key = composite::from_clustering_element(schema, clustered_row.key());
+    _collector.update_min_max_components(schema, clustered_row.key());
 
     if (schema.is_compound() && !schema.is_dense()) {
         write_row_marker(out, clustered_row.marker(), clustering_key);
@@ -1267,7 +1365,7 @@ void sstable::write_clustered_row(file_writer& out, const schema& schema, const
                 write_column_name(out, bytes_view(column_name));
             }
         }
-        write_cell(out, cell);
+        write_cell(out, cell, column_definition);
     });
 }
 
@@ -1283,17 +1381,10 @@ void sstable::write_static_row(file_writer& out, const schema& schema, const row
         atomic_cell_view cell = c.as_atomic_cell();
         auto sp = composite::static_prefix(schema);
         write_column_name(out, sp, { bytes_view(column_definition.name()) });
-        write_cell(out, cell);
+        write_cell(out, cell, column_definition);
     });
 }
 
-static void write_index_entry(file_writer& out, disk_string_view<uint16_t>& key, uint64_t pos) {
-    // FIXME: support promoted indexes.
-    uint32_t promoted_index_size = 0;
-
-    write(out, key, pos, promoted_index_size);
-}
-
 static void prepare_summary(summary& s, uint64_t expected_partition_count, uint32_t min_index_interval) {
     assert(expected_partition_count >= 1);
 
@@ -1335,7 +1426,7 @@ static void seal_summary(summary& s,
 
 static void prepare_compression(compression& c, const schema& schema) {
     const auto& cp = schema.get_compressor_params();
-    c.set_compressor(cp.get_compressor());
+    c.set_compressor(cp);
     c.chunk_len = cp.chunk_length();
     c.data_len = 0;
     // FIXME: crc_check_chance can be configured by the user.
@@ -1407,11 +1498,99 @@ file_writer components_writer::index_file_writer(sstable& sst, const io_priority
 
 void components_writer::flush_deferred_rows() {
     while (!_deferred_rows.empty()) {
-        _sst.write_clustered_row(_out, _schema, _deferred_rows.front());
+        write_clustered_row(std::move(_deferred_rows.front()));
         _deferred_rows.pop_front();
     }
 }
 
+void components_writer::write_clustered_row(clustering_row&& cr) {
+    maybe_start_block([&] { return index_name(cr.key(), composite_marker::start_range); });
+    _sst.write_clustered_row(_out, _schema, cr);
+    _last_item_key = std::move(cr.key());
+    if (_open_rt) {
+        _open_rt->rows_written = true;
+    }
+}
+
+// Returns a column name which sorts before (start_range) or after (end_range)
+// all the cells of given clustering prefix.
+bytes components_writer::index_name(const clustering_key_prefix& ck, composite_marker m) const {
+    if (ck.size(_schema) == 0) {
+        return bytes();
+    }
+    if (!_schema.is_compound()) {
+        return to_bytes(ck.get_component(_schema, 0));
+    }
+    auto c = composite::from_clustering_element(_schema, ck);
+    auto name = to_bytes(bytes_view(c));
+    name.back() = bytes::value_type(m);
+    return name;
+}
+
+bytes components_writer::last_item_name() const {
+    if (!_last_item_key) {
+        return to_bytes(bytes_view(composite::static_prefix(_schema)));
+    }
+    return index_name(*_last_item_key, composite_marker::end_range);
+}
+
+template <typename FirstName>
+void components_writer::maybe_start_block(FirstName&& first_name) {
+    if (!_index_clustering) {
+        return;
+    }
+    if (_block_start) {
+        if (_out.offset() - *_block_start < promoted_index_block_size) {
+            return;
+        }
+        close_block();
+    }
+    _block_start = _out.offset();
+    _block_first_name = first_name();
+    if (_open_rt) {
+        if (_open_rt->rows_written) {
+            // Start the repeated tombstone right after the last row, so that
+            // it doesn't precede fragments which readers have already seen.
+            auto start = composite::from_clustering_element(_schema, *_last_item_key);
+            _sst.write_range_tombstone(_out, start, bound_kind::excl_start, _open_rt->end, _open_rt->end_kind, {}, _open_rt->tomb);
+        } else {
+            _sst.write_range_tombstone(_out, _open_rt->start, _open_rt->start_kind, _open_rt->end, _open_rt->end_kind, {}, _open_rt->tomb);
+        }
+    }
+}
+
+void components_writer::close_block() {
+    _promoted_index.push_back(promoted_index_block{std::move(_block_first_name), last_item_name(),
+                                                   *_block_start - _partition_start, _out.offset() - *_block_start});
+    _block_start = { };
+}
+
+void components_writer::write_index_entry() {
+    auto p_key = disk_string_view<uint16_t>();
+    p_key.value = bytes_view(*_partition_key);
+
+    // Like Origin, we index only partitions which span more than one block.
+    if (_promoted_index.size() < 2) {
+        uint32_t promoted_index_size = 0;
+        write(_index, p_key, _partition_start, promoted_index_size);
+        return;
+    }
+
+    uint32_t promoted_index_size = sizeof(int32_t) + sizeof(int64_t) + sizeof(uint32_t);
+    for (auto& b : _promoted_index) {
+        promoted_index_size += 2 * sizeof(uint16_t) + b.first_name.size() + b.last_name.size() + 2 * sizeof(uint64_t);
+    }
+    uint32_t blocks = _promoted_index.size();
+    write(_index, p_key, _partition_start, promoted_index_size, _partition_deletion_time, blocks);
+    for (auto& b : _promoted_index) {
+        auto first_name = disk_string_view<uint16_t>();
+        first_name.value = b.first_name;
+        auto last_name = disk_string_view<uint16_t>();
+        last_name.value = b.last_name;
+        write(_index, first_name, last_name, b.offset, b.width);
+    }
+}
+
 components_writer::components_writer(sstable& sst, const schema& s, file_writer& out,
                                      uint64_t estimated_partitions, uint64_t max_sstable_size,
                                      const io_priority_class& pc)
@@ -1420,6 +1599,7 @@ components_writer::components_writer(sstable& sst, const schema& s, file_writer&
     , _out(out)
     , _index(index_file_writer(sst, pc))
     , _max_sstable_size(max_sstable_size)
+    , _index_clustering(s.clustering_key_size() > 0)
 {
     _sst._filter = utils::i_filter::get_filter(estimated_partitions, _schema.bloom_filter_fp_chance());
 
@@ -1431,6 +1611,10 @@ components_writer::components_writer(sstable& sst, const schema& s, file_writer&
 void components_writer::consume_new_partition(const dht::decorated_key& dk) {
     // Set current index of data to later compute row size.
     _sst._c_stats.start_offset = _out.offset();
+    _partition_start = _out.offset();
+    _promoted_index.clear();
+    _block_start = { };
+    _last_item_key = { };
 
     _partition_key = key::from_partition_key(_schema, dk.key());
 
@@ -1441,10 +1625,8 @@ void components_writer::consume_new_partition(const dht::decorated_key& dk) {
     auto p_key = disk_string_view<uint16_t>();
     p_key.value = bytes_view(*_partition_key);
 
-    // Write index file entry from partition key into index file.
-    write_index_entry(_index, p_key, _out.offset());
-
-    // Write partition key into data file.
+    // Write partition key into data file. The index entry is written once
+    // the partition is complete, together with its promoted index.
     write(_out, p_key);
 
     _tombstone_written = false;
@@ -1459,6 +1641,7 @@ void components_writer::consume(tombstone t) {
 
         _sst._c_stats.tombstone_histogram.update(d.local_deletion_time);
         _sst._c_stats.update_max_local_deletion_time(d.local_deletion_time);
+        _sst._scylla_metadata.has_partition_tombstones = true;
         _sst._c_stats.update_min_timestamp(d.marked_for_delete_at);
         _sst._c_stats.update_max_timestamp(d.marked_for_delete_at);
     } else {
@@ -1467,12 +1650,15 @@ void components_writer::consume(tombstone t) {
         d.marked_for_delete_at = std::numeric_limits<int64_t>::min();
     }
     write(_out, d);
+    _partition_deletion_time = d;
     _tombstone_written = true;
 }
 
 stop_iteration components_writer::consume(static_row&& sr) {
     ensure_tombstone_is_written();
+    maybe_start_block([&] { return to_bytes(bytes_view(composite::static_prefix(_schema))); });
     _sst.write_static_row(_out, _schema, sr.cells());
+    _last_item_key = { };
     return stop_iteration::no;
 }
 
@@ -1481,7 +1667,7 @@ stop_iteration components_writer::consume(clustering_row&& cr) {
     if (_rt_in_progress) {
         _deferred_rows.push_back(std::move(cr));
     } else {
-        _sst.write_clustered_row(_out, _schema, cr);
+        write_clustered_row(std::move(cr));
     }
     return stop_iteration::no;
 }
@@ -1494,20 +1680,33 @@ stop_iteration components_writer::consume(range_tombstone_begin&& rtb) {
 }
 
 stop_iteration components_writer::consume(range_tombstone_end&& rte) {
-    auto start = composite::from_clustering_element(_schema, std::move(_rt_in_progress->key()));
-    auto end = composite::from_clustering_element(_schema, std::move(rte.key()));
-    _sst.write_range_tombstone(_out, std::move(start), _rt_in_progress->kind(), std::move(end), rte.kind(), {}, _rt_in_progress->tomb());
+    auto start = composite::from_clustering_element(_schema, _rt_in_progress->key());
+    auto end = composite::from_clustering_element(_schema, rte.key());
+    _sst._collector.update_min_max_components(_schema, _rt_in_progress->key());
+    _sst._collector.update_min_max_components(_schema, rte.key());
+    maybe_start_block([&] { return index_name(_rt_in_progress->key(), composite_marker::start_range); });
+    _sst.write_range_tombstone(_out, start, _rt_in_progress->kind(), end, rte.kind(), {}, _rt_in_progress->tomb());
+    // The tombstone is positioned at its end, so that blocks which follow
+    // are not skipped by reads of the range it covers.
+    _last_item_key = std::move(rte.key());
+    _open_rt = open_range_tombstone{std::move(start), _rt_in_progress->kind(), std::move(end), rte.kind(), _rt_in_progress->tomb(), false};
     _rt_in_progress = { };
     flush_deferred_rows();
+    _open_rt = { };
     return stop_iteration::no;
 }
 
 stop_iteration components_writer::consume_end_of_partition() {
     assert(!_rt_in_progress);
     ensure_tombstone_is_written();
+    if (_block_start) {
+        close_block();
+    }
     int16_t end_of_row = 0;
     write(_out, end_of_row);
 
+    write_index_entry();
+
     // compute size of the current row.
     _sst._c_stats.row_size = _out.offset() - _sst._c_stats.start_offset;
     // update is about merging column_stats with the data being stored by collector.
@@ -1579,8 +1778,9 @@ sstable_writer::sstable_writer(sstable& sst, const schema& s, uint64_t estimated
     , _backup(backup)
     , _leave_unsealed(leave_unsealed)
 {
-    _sst.generate_toc(_schema.get_compressor_params().get_compressor(), _schema.bloom_filter_fp_chance());
+    _sst.generate_toc(_schema.get_compressor_params(), _schema.bloom_filter_fp_chance());
     _sst.write_toc(_pc);
+    _sst._scylla_metadata.features = scylla_metadata::clustering_bounds;
     _sst.create_data().get();
     _compression_enabled = !_sst.has_component(sstable::component_type::CRC);
     prepare_file_writer();
@@ -1595,6 +1795,7 @@ void sstable_writer::consume_end_of_stream()
     _sst.write_summary(_pc);
     _sst.write_filter(_pc);
     _sst.write_statistics(_pc);
+    _sst.write_scylla_metadata(_pc);
     // NOTE: write_compression means maybe_write_compression.
     _sst.write_compression(_pc);
 
@@ -1828,11 +2029,34 @@ sstable::component_type sstable::component_from_sstring(sstring &s) {
     return reverse_map(s, _component_map);
 }
 
+static thread_local std::unordered_map<unsigned, read_ahead_options> read_ahead_by_priority_class;
+
+void set_read_ahead(const io_priority_class& pc, read_ahead_options opts) {
+    read_ahead_by_priority_class[pc.id()] = opts;
+}
+
+stdx::optional<read_ahead_options> get_read_ahead(const io_priority_class& pc) {
+    auto it = read_ahead_by_priority_class.find(pc.id());
+    if (it == read_ahead_by_priority_class.end()) {
+        return { };
+    }
+    return it->second;
+}
+
+read_ahead_options sstable::data_stream_read_ahead(const io_priority_class& pc) const {
+    auto it = read_ahead_by_priority_class.find(pc.id());
+    if (it != read_ahead_by_priority_class.end()) {
+        return it->second;
+    }
+    return read_ahead_options{sstable_buffer_size, default_read_ahead};
+}
+
 input_stream<char> sstable::data_stream(uint64_t pos, size_t len, const io_priority_class& pc) {
+    auto ra = data_stream_read_ahead(pc);
     file_input_stream_options options;
-    options.buffer_size = sstable_buffer_size;
+    options.buffer_size = ra.buffer_size;
     options.io_priority_class = pc;
-    options.read_ahead = 4;
+    options.read_ahead = ra.read_ahead;
     if (_compression) {
         return make_compressed_file_input_stream(_data_file, &_compression,
                 pos, len, std::move(options));
@@ -1889,6 +2113,55 @@ double sstable::get_compression_ratio() const {
     }
 }
 
+// Checks whether a clustering range can intersect the box bounded by the
+// per-component minimums and maximums. Components after the first are only
+// looked at while the range is restricted to a single value of all the
+// preceding ones, since rows differing in a preceding component can hold
+// any value in the next one.
+static bool range_intersects_bounds(const schema& s, const query::clustering_range& range,
+        const std::deque<disk_string<uint16_t>>& min, const std::deque<disk_string<uint16_t>>& max) {
+    auto& types = s.clustering_key_type()->types();
+    auto start_size = range.start() ? range.start()->value().size(s) : 0;
+    auto end_size = range.end() ? range.end()->value().size(s) : 0;
+    for (auto i = 0U; i < min.size(); i++) {
+        std::experimental::optional<bytes_view> start;
+        std::experimental::optional<bytes_view> end;
+        if (i < start_size) {
+            start = range.start()->value().get_component(s, i);
+            if (types[i]->compare(*start, max[i].value) > 0) {
+                return false;
+            }
+        }
+        if (i < end_size) {
+            end = range.end()->value().get_component(s, i);
+            if (types[i]->compare(*end, min[i].value) < 0) {
+                return false;
+            }
+        }
+        if (!start || !end || types[i]->compare(*start, *end) != 0) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool sstable::may_contain_rows(const schema& s, const query::clustering_row_ranges& ranges) const {
+    // Bounds written by other implementations or older versions cannot be
+    // trusted to be clustering bounds.
+    if (!(_scylla_metadata.features & scylla_metadata::clustering_bounds) || _scylla_metadata.has_partition_tombstones) {
+        return true;
+    }
+    auto& stats = get_stats_metadata();
+    auto& min = stats.min_column_names.elements;
+    auto& max = stats.max_column_names.elements;
+    if (min.empty() || min.size() != max.size() || min.size() > s.clustering_key_size()) {
+        return true;
+    }
+    return std::any_of(ranges.begin(), ranges.end(), [&] (const query::clustering_range& r) {
+        return range_intersects_bounds(s, r, min, max);
+    });
+}
+
 void sstable::set_sstable_level(uint32_t new_level) {
     auto entry = _statistics.contents.find(metadata_type::Stats);
     if (entry == _statistics.contents.end()) {
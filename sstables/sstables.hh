@@ -47,6 +47,7 @@
 #include "mutation_reader.hh"
 #include "query-request.hh"
 #include "key_reader.hh"
+#include "index_cache.hh"
 
 namespace sstables {
 
@@ -112,11 +113,29 @@ class sstable_writer;
 
 using index_list = std::vector<index_entry>;
 
-class sstable {
+// Read-ahead of data file streams opened with a given I/O priority class.
+// Each read covers buffer_size bytes, rounded up to hold a whole compressed
+// chunk, and up to read_ahead reads are kept in flight. Streams of classes
+// without settings use the sstable's buffer size and default_read_ahead.
+// Applies to the current shard.
+struct read_ahead_options {
+    size_t buffer_size;
+    unsigned read_ahead;
+};
+
+constexpr size_t default_sstable_buffer_size = 128*1024;
+constexpr unsigned default_read_ahead = 4;
+
+void set_read_ahead(const io_priority_class& pc, read_ahead_options opts);
+// Disengaged if the class has no settings.
+stdx::optional<read_ahead_options> get_read_ahead(const io_priority_class& pc);
+
+class sstable : public enable_lw_shared_from_this<sstable> {
 public:
     enum class component_type {
         Index,
         CompressionInfo,
+        CompressionDictionary,
         Data,
         TOC,
         Summary,
@@ -124,6 +143,7 @@ class sstable {
         CRC,
         Filter,
         Statistics,
+        Scylla,
         TemporaryTOC,
         TemporaryStatistics,
     };
@@ -176,6 +196,15 @@ class sstable {
     // Like data_consume_rows() with bounds, but iterates over whole range
     data_consume_context data_consume_rows(row_consumer& consumer);
 
+    // Like data_consume_rows() with bounds, but the range [start, end) lies
+    // within a single partition with key k and may skip its beginning or end.
+    // When the partition header is skipped, header_deletion_time must hold
+    // the partition tombstone. When the range ends before the end of the
+    // partition, ends_inside_partition must be set.
+    data_consume_context data_consume_single_partition(row_consumer& consumer, const key& k,
+            stdx::optional<deletion_time> header_deletion_time, bool ends_inside_partition,
+            uint64_t start, uint64_t end);
+
     static component_type component_from_sstring(sstring& s);
     static version_types version_from_sstring(sstring& s);
     static format_types format_from_sstring(sstring& s);
@@ -195,6 +224,8 @@ class sstable {
         return _generation;
     }
 
+    // The sstable has to be owned by a shared_sstable, which a reversed
+    // streamed_mutation holds onto until it is done reading.
     future<streamed_mutation_opt> read_row(
         schema_ptr schema,
         const key& k,
@@ -245,6 +276,13 @@ class sstable {
 
     future<> seal_sstable(bool backup);
 
+    // Memory held by the buffers of a data stream opened with the given
+    // priority class.
+    size_t data_stream_memory(const io_priority_class& pc) const {
+        auto ra = data_stream_read_ahead(pc);
+        return ra.buffer_size * (ra.read_ahead + 1);
+    }
+
     uint64_t get_estimated_key_count() const {
         return ((uint64_t)_summary.header.size_at_full_sampling + 1) *
                 _summary.header.min_index_interval;
@@ -347,7 +385,7 @@ class sstable {
         , _now(now)
     { }
 
-    size_t sstable_buffer_size = 128*1024;
+    size_t sstable_buffer_size = default_sstable_buffer_size;
 
     static std::unordered_map<version_types, sstring, enum_hash<version_types>> _version_string;
     static std::unordered_map<format_types, sstring, enum_hash<format_types>> _format_string;
@@ -360,6 +398,7 @@ class sstable {
     utils::filter_ptr _filter;
     summary _summary;
     statistics _statistics;
+    scylla_metadata _scylla_metadata;
     // NOTE: _collector and _c_stats are used to generation of statistics file
     // when writing a new sstable.
     metadata_collector _collector;
@@ -379,6 +418,8 @@ class sstable {
     format_types _format;
 
     filter_tracker _filter_tracker;
+    // Parsed index pages, kept in the row cache's memory.
+    index_cache _index_cache{global_cache_tracker()};
 
     bool _marked_for_deletion = false;
 
@@ -394,13 +435,17 @@ class sstable {
     template <sstable::component_type Type, typename T>
     void write_simple(T& comp, const io_priority_class& pc);
 
-    void generate_toc(compressor c, double filter_fp_chance);
+    void generate_toc(const compression_parameters& cp, double filter_fp_chance);
     void write_toc(const io_priority_class& pc);
     future<> seal_sstable();
 
     future<> read_compression(const io_priority_class& pc);
+    future<> read_compression_dictionary(const io_priority_class& pc);
     void write_compression(const io_priority_class& pc);
 
+    future<> read_scylla_metadata(const io_priority_class& pc);
+    void write_scylla_metadata(const io_priority_class& pc);
+
     future<> read_filter(const io_priority_class& pc);
 
     void write_filter(const io_priority_class& pc);
@@ -435,6 +480,8 @@ class sstable {
     // (even when a large buffer size is used).
     input_stream<char> data_stream(uint64_t pos, size_t len, const io_priority_class& pc);
 
+    read_ahead_options data_stream_read_ahead(const io_priority_class& pc) const;
+
     // Read exactly the specific byte range from the data file (after
     // uncompression, if the file is compressed). This can be used to read
     // a specific row from the data file (its position and length can be
@@ -480,7 +527,7 @@ class sstable {
     void write_row_marker(file_writer& out, const row_marker& marker, const composite& clustering_key);
     void write_clustered_row(file_writer& out, const schema& schema, const clustering_row& clustered_row);
     void write_static_row(file_writer& out, const schema& schema, const row& static_row);
-    void write_cell(file_writer& out, atomic_cell_view cell);
+    void write_cell(file_writer& out, atomic_cell_view cell, const column_definition& cdef);
     void write_column_name(file_writer& out, const composite& clustering_key, const std::vector<bytes_view>& column_names, composite_marker m = composite_marker::none);
     void write_column_name(file_writer& out, bytes_view column_names);
     void write_range_tombstone(file_writer& out, const composite& start, bound_kind start_kind, const composite& end, bound_kind stop_kind, std::vector<bytes_view> suffix, const tombstone t);
@@ -512,6 +559,18 @@ class sstable {
         return t;
     }
 
+    uint64_t index_cache_hits() const {
+        return _index_cache.hits();
+    }
+    uint64_t index_cache_misses() const {
+        return _index_cache.misses();
+    }
+    // Makes the index cache also count its hits and misses into stats,
+    // which the column family owning this sstable keeps.
+    void set_index_cache_stats(lw_shared_ptr<index_cache_stats> stats) {
+        _index_cache.set_stats(std::move(stats));
+    }
+
     const stats_metadata& get_stats_metadata() const {
         auto entry = _statistics.contents.find(metadata_type::Stats);
         if (entry == _statistics.contents.end()) {
@@ -541,6 +600,13 @@ class sstable {
         return get_stats_metadata().sstable_level;
     }
 
+    // Returns false if the clustering bounds recorded in the statistics show
+    // that the sstable has no rows in any of the ranges. Partition tombstones
+    // are not bounded by clustering keys, so sstables which hold them are
+    // never ruled out, and neither are sstables whose bounds were written
+    // by other implementations or older versions.
+    bool may_contain_rows(const schema& s, const query::clustering_row_ranges& ranges) const;
+
     // This will change sstable level only in memory.
     void set_sstable_level(uint32_t);
 
@@ -660,10 +726,50 @@ class components_writer {
 
     stdx::optional<range_tombstone_begin> _rt_in_progress;
     circular_buffer<clustering_row> _deferred_rows;
+
+    // Promoted index of the partition being written. The clustering part of
+    // a partition is divided into blocks of about promoted_index_block_size
+    // bytes, and each block is described in the index entry of the partition
+    // by names of its first and last items, so that readers of a clustering
+    // slice can skip directly to the blocks holding it.
+    struct promoted_index_block {
+        bytes first_name;
+        bytes last_name;
+        uint64_t offset; // relative to the start of the partition
+        uint64_t width;
+    };
+    struct open_range_tombstone {
+        composite start;
+        bound_kind start_kind;
+        composite end;
+        bound_kind end_kind;
+        tombstone tomb;
+        bool rows_written = false;
+    };
+    bool _index_clustering;
+    uint64_t _partition_start;
+    deletion_time _partition_deletion_time;
+    std::vector<promoted_index_block> _promoted_index;
+    stdx::optional<uint64_t> _block_start;
+    bytes _block_first_name;
+    // Clustering position of the last item written, disengaged for the static row.
+    stdx::optional<clustering_key_prefix> _last_item_key;
+    // Range tombstone covering the rows being written. It is repeated at the
+    // beginning of each block, so that reads starting at that block see it.
+    stdx::optional<open_range_tombstone> _open_rt;
+public:
+    static constexpr uint64_t promoted_index_block_size = 64 * 1024;
 private:
     size_t get_offset();
     file_writer index_file_writer(sstable& sst, const io_priority_class& pc);
     void flush_deferred_rows();
+    void write_clustered_row(clustering_row&& cr);
+    bytes index_name(const clustering_key_prefix& ck, composite_marker m) const;
+    bytes last_item_name() const;
+    template <typename FirstName>
+    void maybe_start_block(FirstName&& first_name);
+    void close_block();
+    void write_index_entry();
     void ensure_tombstone_is_written() {
         if (!_tombstone_written) {
             consume(tombstone());
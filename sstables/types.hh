@@ -75,6 +75,11 @@ class index_entry {
         return _position;
     }
 
+    // Serialized promoted index, empty if the partition has none.
+    bytes_view get_promoted_index_bytes() const {
+        return bytes_view(reinterpret_cast<const bytes::value_type *>(_promoted_index.get()), _promoted_index.size());
+    }
+
     index_entry(temporary_buffer<char>&& key, uint64_t position, temporary_buffer<char>&& promoted_index)
         : _key(std::move(key)), _position(position), _promoted_index(std::move(promoted_index)) {}
 
@@ -216,6 +221,23 @@ struct ka_stats_metadata : public metadata {
 };
 using stats_metadata = ka_stats_metadata;
 
+// Metadata only Scylla writes, in a component of its own so that the
+// standard components stay readable by other implementations.
+struct scylla_metadata {
+    enum feature : uint64_t {
+        // min_column_names and max_column_names of the stats hold the bounds
+        // of each clustering component, compared by the column type. Older
+        // writers stored column names there.
+        clustering_bounds = 1,
+    };
+    uint64_t features = 0;
+    // Partition tombstones are not bounded by clustering keys.
+    bool has_partition_tombstones = false;
+
+    template <typename Describer>
+    auto describe_type(Describer f) { return f(features, has_partition_tombstones); }
+};
+
 // Numbers are found on disk, so they do matter. Also, setting their sizes of
 // that of an uint32_t is a bit wasteful, but it simplifies the code a lot
 // since we can now still use a strongly typed enum without introducing a
@@ -144,6 +144,9 @@ class compressed_file_data_sink_impl : public data_sink_impl {
     output_stream<char> _out;
     sstables::compression* _compression_metadata;
     size_t _pos = 0;
+    // Chunks held back until the compression dictionary is trained on them.
+    std::vector<temporary_buffer<char>> _training_chunks;
+    size_t _training_bytes = 0;
 public:
     compressed_file_data_sink_impl(file f, sstables::compression* cm, file_output_stream_options options)
             : _out(make_file_output_stream(std::move(f), options))
@@ -151,6 +154,36 @@ class compressed_file_data_sink_impl : public data_sink_impl {
 
     future<> put(net::packet data) { abort(); }
     virtual future<> put(temporary_buffer<char> buf) override {
+        if (_compression_metadata->wants_dictionary()) {
+            _training_bytes += buf.size();
+            _training_chunks.push_back(std::move(buf));
+            if (_training_bytes < _compression_metadata->dictionary_training_size()) {
+                return make_ready_future<>();
+            }
+            return train_and_put_held_back_chunks();
+        }
+        return compress_and_put(std::move(buf));
+    }
+    virtual future<> close() {
+        auto f = _training_chunks.empty() ? make_ready_future<>() : train_and_put_held_back_chunks();
+        return f.then([this] {
+            return _out.close();
+        });
+    }
+private:
+    future<> train_and_put_held_back_chunks() {
+        auto chunks = std::move(_training_chunks);
+        _training_chunks = {};
+        _training_bytes = 0;
+        return do_with(std::move(chunks), [this] (std::vector<temporary_buffer<char>>& chunks) {
+            return _compression_metadata->train_dictionary(chunks).then([this, &chunks] {
+                return do_for_each(chunks, [this] (temporary_buffer<char>& chunk) {
+                    return this->compress_and_put(std::move(chunk));
+                });
+            });
+        });
+    }
+    future<> compress_and_put(temporary_buffer<char> buf) {
         auto output_len = _compression_metadata->compress_max_size(buf.size());
         // account space for checksum that goes after compressed data.
         temporary_buffer<char> compressed(output_len + 4);
@@ -180,9 +213,6 @@ class compressed_file_data_sink_impl : public data_sink_impl {
         auto f = _out.write(compressed.get(), compressed.size());
         return f.then([compressed = std::move(compressed)] {});
     }
-    virtual future<> close() {
-        return _out.close();
-    }
 };
 
 class compressed_file_data_sink : public data_sink {
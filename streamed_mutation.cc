@@ -21,6 +21,7 @@
 
 #include <stack>
 #include <boost/range/algorithm/heap_algorithm.hpp>
+#include <boost/algorithm/cxx11/any_of.hpp>
 
 #include "mutation.hh"
 #include "streamed_mutation.hh"
@@ -217,7 +218,13 @@ class mutation_merger final : public streamed_mutation::impl {
     };
     std::vector<row_and_reader> _readers;
     tombstone _current_tombstone;
+    position_in_partition::less_compare _cmp;
+    position_in_partition::reversed_less_compare _reversed_cmp;
 private:
+    bool less(const mutation_fragment& a, const mutation_fragment& b) const {
+        return is_reversed() ? _reversed_cmp(a, b) : _cmp(a, b);
+    }
+
     static void update_current_tombstone(streamed_reader& sr, mutation_fragment& mf) {
         if (mf.is_range_tombstone_begin()) {
             assert(!sr.current_tombstone);
@@ -234,8 +241,7 @@ class mutation_merger final : public streamed_mutation::impl {
             return;
         }
 
-        position_in_partition::less_compare cmp(*_schema);
-        auto heap_compare = [&] (auto& a, auto& b) { return cmp(b.row, a.row); };
+        auto heap_compare = [this] (auto& a, auto& b) { return this->less(b.row, a.row); };
 
         boost::range::pop_heap(_readers, heap_compare);
         auto result = std::move(_readers.back().row);
@@ -244,7 +250,7 @@ class mutation_merger final : public streamed_mutation::impl {
         _readers.pop_back();
 
         while (!_readers.empty()) {
-            if (cmp(result, _readers.front().row)) {
+            if (less(result, _readers.front().row)) {
                 break;
             }
             boost::range::pop_heap(_readers, heap_compare);
@@ -293,8 +299,7 @@ class mutation_merger final : public streamed_mutation::impl {
     }
 
     void do_fill_buffer() {
-        position_in_partition::less_compare cmp(*_schema);
-        auto heap_compare = [&] (auto& a, auto& b) { return cmp(b.row, a.row); };
+        auto heap_compare = [this] (auto& a, auto& b) { return this->less(b.row, a.row); };
 
         for (auto& rd : _next_readers) {
             if (rd.reader->is_buffer_empty()) {
@@ -347,8 +352,10 @@ class mutation_merger final : public streamed_mutation::impl {
     }
 public:
     mutation_merger(schema_ptr s, dht::decorated_key dk, std::vector<streamed_mutation> readers)
-        : streamed_mutation::impl(std::move(s), std::move(dk), merge_partition_tombstones(readers))
+        : streamed_mutation::impl(s, std::move(dk), merge_partition_tombstones(readers), readers.front().is_reversed())
         , _original_readers(std::move(readers))
+        , _cmp(*s)
+        , _reversed_cmp(*s)
     {
         _next_readers.reserve(_original_readers.size());
         _readers.reserve(_original_readers.size());
@@ -362,11 +369,27 @@ class mutation_merger final : public streamed_mutation::impl {
 streamed_mutation merge_mutations(std::vector<streamed_mutation> ms)
 {
     assert(!ms.empty());
+    auto reversed = boost::algorithm::any_of(ms, [] (const streamed_mutation& sm) { return sm.is_reversed(); });
+    if (reversed) {
+        for (auto& sm : ms) {
+            if (!sm.is_reversed()) {
+                sm = reverse_streamed_mutation(std::move(sm));
+            }
+        }
+    }
     return make_streamed_mutation<mutation_merger>(ms.back().schema(), ms.back().decorated_key(), std::move(ms));
 }
 
 mutation_fragment_opt range_tombstone_stream::get_next_start()
 {
+    if (_reversed) {
+        auto& rt = *_list.tombstones().rbegin();
+        auto mf = mutation_fragment(range_tombstone_begin(std::move(rt.end), flip_bound_kind(rt.end_kind), rt.tomb));
+        rt.end = clustering_key::make_empty();
+        rt.end_kind = bound_kind::incl_end;
+        _inside_range_tombstone = true;
+        return mf;
+    }
     auto& rt = *_list.tombstones().begin();
     auto mf = mutation_fragment(range_tombstone_begin(std::move(rt.start), rt.start_kind, rt.tomb));
     rt.start = clustering_key::make_empty();
@@ -377,6 +400,15 @@ mutation_fragment_opt range_tombstone_stream::get_next_start()
 
 mutation_fragment_opt range_tombstone_stream::get_next_end()
 {
+    if (_reversed) {
+        auto it = std::prev(_list.tombstones().end());
+        auto& rt = *it;
+        auto mf = mutation_fragment(range_tombstone_end(std::move(rt.start), flip_bound_kind(rt.start_kind)));
+        _list.tombstones().erase(it);
+        current_deleter<range_tombstone>()(&rt);
+        _inside_range_tombstone = false;
+        return mf;
+    }
     auto& rt = *_list.tombstones().begin();
     auto mf = mutation_fragment(range_tombstone_end(std::move(rt.end), rt.end_kind));
     _list.tombstones().erase(_list.begin());
@@ -385,24 +417,33 @@ mutation_fragment_opt range_tombstone_stream::get_next_end()
     return mf;
 }
 
-mutation_fragment_opt range_tombstone_stream::get_next(const rows_entry& re)
+template<typename T>
+mutation_fragment_opt range_tombstone_stream::do_get_next(const T& next)
 {
+    if (_reversed) {
+        if (_inside_range_tombstone) {
+            return _cmp(next, _list.tombstones().rbegin()->start_bound()) ? get_next_end() : mutation_fragment_opt();
+        } else if (!_list.empty()) {
+            return _cmp(next, _list.tombstones().rbegin()->end_bound()) ? get_next_start() : mutation_fragment_opt();
+        }
+        return { };
+    }
     if (_inside_range_tombstone) {
-        return _cmp(_list.begin()->end_bound(), re) ? get_next_end() : mutation_fragment_opt();
+        return _cmp(_list.begin()->end_bound(), next) ? get_next_end() : mutation_fragment_opt();
     } else if (!_list.empty()) {
-        return _cmp(_list.begin()->start_bound(), re) ? get_next_start() : mutation_fragment_opt();
+        return _cmp(_list.begin()->start_bound(), next) ? get_next_start() : mutation_fragment_opt();
     }
     return { };
 }
 
+mutation_fragment_opt range_tombstone_stream::get_next(const rows_entry& re)
+{
+    return do_get_next(re);
+}
+
 mutation_fragment_opt range_tombstone_stream::get_next(const mutation_fragment& mf)
 {
-    if (_inside_range_tombstone) {
-        return _cmp(_list.begin()->end_bound(), mf) ? get_next_end() : mutation_fragment_opt();
-    } else if (!_list.empty()) {
-        return _cmp(_list.begin()->start_bound(), mf) ? get_next_start() : mutation_fragment_opt();
-    }
-    return { };
+    return do_get_next(mf);
 }
 
 mutation_fragment_opt range_tombstone_stream::get_next()
@@ -447,7 +488,7 @@ streamed_mutation reverse_streamed_mutation(streamed_mutation sm) {
         }
     public:
         explicit reversing_steamed_mutation(streamed_mutation sm)
-            : streamed_mutation::impl(sm.schema(), sm.decorated_key(), sm.partition_tombstone())
+            : streamed_mutation::impl(sm.schema(), sm.decorated_key(), sm.partition_tombstone(), !sm.is_reversed())
             , _source(std::move(sm))
         { }
 
@@ -381,6 +381,33 @@ class position_in_partition {
         bool operator()(const bound_view& a, const mutation_fragment& b) const {
             return b.row_type_weight() && _cmp(a.prefix, weight(a.kind), b.key(), b.bound_kind_weight());
         }
+        bool operator()(const rows_entry& a, const bound_view& b) const {
+            return _cmp(a.key(), 0, b.prefix, weight(b.kind));
+        }
+        bool operator()(const mutation_fragment& a, const bound_view& b) const {
+            return !a.row_type_weight() || _cmp(a.key(), a.bound_kind_weight(), b.prefix, weight(b.kind));
+        }
+    };
+    // Orders fragments of a reversed streamed_mutation. Bounds of range
+    // tombstones in such stream have flipped kinds (see flip_bound_kind()),
+    // so the weight of each bound is negated before comparing.
+    class reversed_less_compare {
+        bound_view::compare _cmp;
+    private:
+        template<typename T, typename U>
+        bool compare(const T& a, const U& b) const {
+            auto a_rt_weight = a.row_type_weight();
+            auto b_rt_weight = b.row_type_weight();
+            if (!a_rt_weight || !b_rt_weight) {
+                return a_rt_weight < b_rt_weight;
+            }
+            return _cmp(b.key(), -b.bound_kind_weight(), a.key(), -a.bound_kind_weight());
+        }
+    public:
+        reversed_less_compare(const schema& s) : _cmp(s) { }
+        bool operator()(const mutation_fragment& a, const mutation_fragment& b) const {
+            return compare(a, b);
+        }
     };
     class equal_compare {
         clustering_key_prefix::equality _equal;
@@ -458,6 +485,13 @@ using mutation_fragment_opt = optimized_optional<mutation_fragment>;
 //
 // Partition key and partition tombstone are not streamed and is part of the
 // streamed_mutation itself.
+//
+// A streamed_mutation may also be reversed, i.e. emit the static row first
+// and then clustering rows and range tombstones in the reverse order. In such
+// stream range_tombstone_begin is placed at the end bound of the tombstone and
+// range_tombstone_end at its start bound, both with flipped bound kinds (see
+// reverse_streamed_mutation()). Sources produce reversed streams only when
+// asked to by query::clustering_key_filtering_context::is_reversed().
 class streamed_mutation {
 public:
     // streamed_mutation uses batching. The mutation implementations are
@@ -471,6 +505,7 @@ class streamed_mutation {
         schema_ptr _schema;
         dht::decorated_key _key;
         tombstone _partition_tombstone;
+        bool _reversed;
 
         bool _end_of_stream = false;
         circular_buffer<mutation_fragment> _buffer;
@@ -482,8 +517,8 @@ class streamed_mutation {
             _buffer.emplace_back(std::forward<Args>(args)...);
         }
     public:
-        explicit impl(schema_ptr s, dht::decorated_key dk, tombstone pt)
-            : _schema(std::move(s)), _key(std::move(dk)), _partition_tombstone(pt)
+        explicit impl(schema_ptr s, dht::decorated_key dk, tombstone pt, bool reversed = false)
+            : _schema(std::move(s)), _key(std::move(dk)), _partition_tombstone(pt), _reversed(reversed)
         {
             _buffer.reserve(buffer_size);
         }
@@ -491,6 +526,7 @@ class streamed_mutation {
         virtual ~impl() { }
         virtual future<> fill_buffer() = 0;
 
+        bool is_reversed() const { return _reversed; }
         bool is_end_of_stream() const { return _end_of_stream; }
         bool is_buffer_empty() const { return _buffer.empty(); }
         bool is_buffer_full() const { return _buffer.size() >= buffer_size; }
@@ -528,6 +564,7 @@ class streamed_mutation {
 
     tombstone partition_tombstone() const { return _impl->_partition_tombstone; }
 
+    bool is_reversed() const { return _impl->is_reversed(); }
     bool is_end_of_stream() const { return _impl->is_end_of_stream(); }
     bool is_buffer_empty() const { return _impl->is_buffer_empty(); }
     bool is_buffer_full() const { return _impl->is_buffer_full(); }
@@ -590,7 +627,13 @@ class mutation;
 streamed_mutation streamed_mutation_from_mutation(mutation);
 
 //Requires all streamed_mutations to have the same schema.
+// If any of the streamed_mutations is reversed so is the result; the ones
+// which are not are reversed with reverse_streamed_mutation() first.
 streamed_mutation merge_mutations(std::vector<streamed_mutation>);
+
+// Changes the order in which fragments are emitted. The whole partition is
+// buffered in memory, sources which can produce reversed streams natively
+// should be preferred.
 streamed_mutation reverse_streamed_mutation(streamed_mutation);
 
 // range_tombstone_stream is a helper object that simplifies producing a stream
@@ -609,16 +652,24 @@ streamed_mutation reverse_streamed_mutation(streamed_mutation);
 // get_next() overload which doesn't take any arguments is used to return the
 // remaining tombstones. After it was called no new tombstones can be added
 // to the stream.
+//
+// A reversed range_tombstone_stream emits tombstones in the format of the
+// reversed streamed_mutation and has to be merged with clustering rows coming
+// in the reverse order. Tombstones added to it must not cover positions after
+// the last clustering row passed to get_next() which weren't covered before.
 class range_tombstone_stream {
     const schema& _schema;
     position_in_partition::less_compare _cmp;
     range_tombstone_list _list;
+    bool _reversed;
     bool _inside_range_tombstone = false;
 private:
     mutation_fragment_opt get_next_start();
     mutation_fragment_opt get_next_end();
+    template<typename T>
+    mutation_fragment_opt do_get_next(const T&);
 public:
-    range_tombstone_stream(const schema& s) : _schema(s), _cmp(s), _list(s) { }
+    range_tombstone_stream(const schema& s, bool reversed = false) : _schema(s), _cmp(s), _list(s), _reversed(reversed) { }
     mutation_fragment_opt get_next(const rows_entry&);
     mutation_fragment_opt get_next(const mutation_fragment&);
     mutation_fragment_opt get_next();
@@ -55,11 +55,15 @@ boost_tests = [
     'network_topology_strategy_test',
     'query_processor_test',
     'batchlog_manager_test',
+    'hints_manager_test',
+    'counter_test',
+    'secondary_index_test',
     'logalloc_test',
     'crc_test',
     'flush_queue_test',
     'config_test',
     'dynamic_bitset_test',
+    'histogram_test',
     'gossip_test',
     'key_reader_test',
     'managed_vector_test',
@@ -73,6 +77,8 @@ boost_tests = [
     'streamed_mutation_test',
     'anchorless_list_test',
     'database_test',
+    'repair_test',
+    'cql_transport_test',
 ]
 
 other_tests = [
@@ -278,3 +278,22 @@ BOOST_AUTO_TEST_CASE(test_append_big_and_small_chunks) {
     buf.append(big);
     buf.append(small);
 }
+
+BOOST_AUTO_TEST_CASE(test_chunks_grow_with_the_buffer) {
+    int count = 1024*1024;
+
+    bytes_ostream buf;
+    append_sequence(buf, count);
+
+    size_t fragments = 0;
+    size_t max_fragment_size = 0;
+    for (bytes_view frag : buf.fragments()) {
+        ++fragments;
+        max_fragment_size = std::max(max_fragment_size, frag.size());
+    }
+
+    // 4 MB of data is kept in few fragments of at most 128 KB.
+    BOOST_REQUIRE(fragments < 64);
+    BOOST_REQUIRE(max_fragment_size <= 128*1024);
+    assert_sequence(buf, count);
+}
@@ -28,6 +28,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <boost/range/irange.hpp>
 
 #include "tests/test-utils.hh"
 #include "core/future-util.hh"
@@ -35,9 +36,11 @@
 #include "core/scollectd_api.hh"
 #include "core/file.hh"
 #include "core/reactor.hh"
+#include "core/thread.hh"
 #include "utils/UUID_gen.hh"
 #include "tmpdir.hh"
 #include "db/commitlog/commitlog.hh"
+#include "db/config.hh"
 #include "log.hh"
 
 #include "disk-error-handler.hh"
@@ -102,6 +105,61 @@ SEASTAR_TEST_CASE(test_commitlog_written_to_disk_batch){
         });
 }
 
+// writes within the group commit window share a single flush
+SEASTAR_TEST_CASE(test_commitlog_batch_group_commit){
+    commitlog::config cfg;
+    cfg.mode = commitlog::sync_mode::BATCH;
+    cfg.commitlog_sync_batch_window_in_us = 100 * 1000;
+    return cl_test(cfg, [](commitlog& log) {
+        auto uuid = utils::UUID_gen::get_time_UUID();
+        auto rps = make_lw_shared<std::vector<replay_position>>();
+        return parallel_for_each(boost::irange(0, 10), [&log, uuid, rps] (int) {
+            sstring tmp = "hej bubba cow";
+            return log.add_mutation(uuid, tmp.size(), [tmp](db::commitlog::output& dst) {
+                        dst.write(tmp.begin(), tmp.end());
+                    }).then([rps](replay_position rp) {
+                        rps->push_back(rp);
+                    });
+        }).then([&log, rps] {
+            BOOST_REQUIRE_EQUAL(rps->size(), 10);
+            for (auto& rp : *rps) {
+                BOOST_CHECK_NE(rp, db::replay_position());
+            }
+            BOOST_REQUIRE_EQUAL(log.get_batch_commit_count(), 1);
+            BOOST_REQUIRE_EQUAL(log.get_flush_count(), 1);
+        });
+    });
+}
+
+// the deprecated millisecond window is used only when the microsecond one isn't set
+SEASTAR_TEST_CASE(test_commitlog_batch_window_legacy_option){
+    db::config dbcfg;
+    BOOST_REQUIRE_EQUAL(commitlog::config(dbcfg).commitlog_sync_batch_window_in_us, 500);
+    dbcfg.read_from_yaml("commitlog_sync_batch_window_in_ms: 2\n");
+    BOOST_REQUIRE_EQUAL(commitlog::config(dbcfg).commitlog_sync_batch_window_in_us, 2000);
+    dbcfg.read_from_yaml("commitlog_sync_batch_window_in_ms: 2\ncommitlog_sync_batch_window_in_us: 300\n");
+    BOOST_REQUIRE_EQUAL(commitlog::config(dbcfg).commitlog_sync_batch_window_in_us, 300);
+    return make_ready_future<>();
+}
+
+// a group is committed early once it reaches the byte threshold
+SEASTAR_TEST_CASE(test_commitlog_batch_group_commit_max_bytes){
+    commitlog::config cfg;
+    cfg.mode = commitlog::sync_mode::BATCH;
+    cfg.commitlog_sync_batch_window_in_us = 60 * 1000 * 1000;
+    cfg.commitlog_sync_batch_max_bytes = 1;
+    return cl_test(cfg, [](commitlog& log) {
+        sstring tmp = "hej bubba cow";
+        return log.add_mutation(utils::UUID_gen::get_time_UUID(), tmp.size(), [tmp](db::commitlog::output& dst) {
+                    dst.write(tmp.begin(), tmp.end());
+                }).then([&log](replay_position rp) {
+                    BOOST_CHECK_NE(rp, db::replay_position());
+                    BOOST_REQUIRE_EQUAL(log.get_batch_commit_count(), 1);
+                    BOOST_REQUIRE(log.get_flush_count() > 0);
+                });
+    });
+}
+
 SEASTAR_TEST_CASE(test_commitlog_written_to_disk_periodic){
     return cl_test([](commitlog& log) {
             auto state = make_lw_shared(false);
@@ -325,6 +383,62 @@ SEASTAR_TEST_CASE(test_commitlog_reader){
         });
 }
 
+// discarded segments are overwritten by new ones, and reading one back
+// stops at the end of the new data
+SEASTAR_TEST_CASE(test_commitlog_reuse_segments){
+    commitlog::config cfg;
+    cfg.commitlog_segment_size_in_mb = 1;
+    return cl_test(cfg, [](commitlog& log) {
+        return seastar::async([&log] {
+            auto uuid = utils::UUID_gen::get_time_UUID();
+            std::unordered_map<segment_id_type, size_t> counts;
+            replay_position last;
+            auto add = [&] {
+                sstring tmp = "hej bubba cow";
+                auto rp = log.add_mutation(uuid, tmp.size(), [tmp](db::commitlog::output& dst) {
+                    dst.write(tmp.begin(), tmp.end());
+                }).get0();
+                if (rp.id != last.id && last.id != 0) {
+                    // everything in the previous segments is flushed
+                    log.discard_completed_segments(uuid, last);
+                }
+                ++counts[rp.id];
+                last = rp;
+            };
+            while (log.get_num_segments_recycled() == 0 && counts.size() < 10) {
+                add();
+            }
+            BOOST_REQUIRE_GT(log.get_num_segments_recycled(), 0);
+            // fill a recycled segment up to its end
+            auto segments = counts.size();
+            while (counts.size() < segments + 2) {
+                add();
+            }
+            for (int i = 0; i < 10; ++i) {
+                add();
+            }
+            log.sync_all_segments().get();
+
+            // the terminator of the last write never grows a file
+            for (auto& name : log.get_active_segment_names()) {
+                BOOST_REQUIRE_EQUAL(file_size(name).get0(), 1024 * 1024);
+            }
+
+            for (auto& name : log.get_active_segment_names()) {
+                auto n = make_lw_shared<size_t>(0);
+                auto s = db::commitlog::read_log_file(name, [n](temporary_buffer<char> buf, db::replay_position rp) {
+                    sstring str(buf.get(), buf.size());
+                    BOOST_CHECK_EQUAL(str, "hej bubba cow");
+                    ++(*n);
+                    return make_ready_future<>();
+                }).get0();
+                s->done().get();
+                BOOST_REQUIRE_EQUAL(*n, counts[commitlog::descriptor(name).id]);
+            }
+        });
+    });
+}
+
 static future<> corrupt_segment(sstring seg, uint64_t off, uint32_t value) {
     return open_file_dma(seg, open_flags::rw).then([off, value](file f) {
         size_t size = align_up<size_t>(off, 4096);
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "tests/test-utils.hh"
+#include "tests/cql_test_env.hh"
+#include "tests/cql_assertions.hh"
+
+#include "core/thread.hh"
+#include "counters.hh"
+#include "mutation.hh"
+#include "schema_builder.hh"
+#include "frozen_mutation.hh"
+
+#include "disk-error-handler.hh"
+
+thread_local disk_error_signal_type commit_error;
+thread_local disk_error_signal_type general_disk_error;
+
+static schema_ptr get_schema() {
+    return schema_builder("ks", "cf")
+            .with_column("pk", int32_type, column_kind::partition_key)
+            .with_column("ck", int32_type, column_kind::clustering_key)
+            .with_column("c1", counter_type)
+            .with_column("c2", counter_type)
+            .set_default_validator(counter_type)
+            .build();
+}
+
+static counter_id make_id(int64_t n) {
+    return counter_id(utils::UUID(0, n));
+}
+
+static atomic_cell make_counter_cell(api::timestamp_type ts, std::vector<counter_shard> shards) {
+    counter_cell_builder ccb(shards.size());
+    for (auto&& cs : shards) {
+        ccb.add_shard(cs);
+    }
+    return ccb.build(ts);
+}
+
+static mutation make_mutation(schema_ptr s, atomic_cell ac) {
+    auto& cdef = *s->get_column_definition("c1");
+    mutation m(partition_key::from_single_value(*s, int32_type->decompose(0)), s);
+    m.set_clustered_cell(clustering_key::from_single_value(*s, int32_type->decompose(0)), cdef, std::move(ac));
+    return m;
+}
+
+static atomic_cell_view get_counter_cell(const mutation& m) {
+    auto& s = *m.schema();
+    auto& cdef = *s.get_column_definition("c1");
+    auto& cr = m.partition().clustered_rows().begin()->row();
+    return cr.cells().cell_at(cdef.id).as_atomic_cell();
+}
+
+SEASTAR_TEST_CASE(test_counter_cell) {
+    return seastar::async([] {
+        auto id1 = make_id(1);
+        auto id2 = make_id(2);
+        auto id3 = make_id(3);
+
+        auto c = make_counter_cell(1, { counter_shard(id1, 5, 1), counter_shard(id2, -2, 3), counter_shard(id3, 4, 2) });
+        counter_cell_view ccv(c);
+        BOOST_REQUIRE_EQUAL(ccv.shard_count(), 3);
+        BOOST_REQUIRE_EQUAL(ccv.total_value(), 7);
+        BOOST_REQUIRE_EQUAL(ccv.timestamp(), 1);
+
+        auto cs = ccv.get_shard(id2);
+        BOOST_REQUIRE(cs);
+        BOOST_REQUIRE(cs->id() == id2);
+        BOOST_REQUIRE_EQUAL(cs->value(), -2);
+        BOOST_REQUIRE_EQUAL(cs->logical_clock(), 3);
+        BOOST_REQUIRE(!ccv.get_shard(make_id(4)));
+    });
+}
+
+SEASTAR_TEST_CASE(test_apply) {
+    return seastar::async([] {
+        auto s = get_schema();
+        auto id1 = make_id(1);
+        auto id2 = make_id(2);
+        auto id3 = make_id(3);
+
+        // Shards with higher logical clocks win.
+        auto m = make_mutation(s, make_counter_cell(1, { counter_shard(id1, 1, 1), counter_shard(id2, 2, 5) }));
+        m.apply(make_mutation(s, make_counter_cell(2, { counter_shard(id1, 3, 2), counter_shard(id2, 1, 4), counter_shard(id3, 8, 1) })));
+        {
+            counter_cell_view ccv(get_counter_cell(m));
+            BOOST_REQUIRE_EQUAL(ccv.shard_count(), 3);
+            BOOST_REQUIRE_EQUAL(ccv.total_value(), 13);
+            BOOST_REQUIRE_EQUAL(ccv.timestamp(), 2);
+        }
+
+        // Applying the same cell again changes nothing.
+        m.apply(make_mutation(s, make_counter_cell(2, { counter_shard(id1, 3, 2), counter_shard(id2, 1, 4), counter_shard(id3, 8, 1) })));
+        BOOST_REQUIRE_EQUAL(counter_cell_view(get_counter_cell(m)).total_value(), 13);
+
+        // Deleted counters stay deleted.
+        m.apply(make_mutation(s, atomic_cell::make_dead(0, gc_clock::now())));
+        BOOST_REQUIRE(!get_counter_cell(m).is_live());
+        m.apply(make_mutation(s, make_counter_cell(10, { counter_shard(id1, 4, 10) })));
+        BOOST_REQUIRE(!get_counter_cell(m).is_live());
+
+        // Counter updates add up.
+        auto u = make_mutation(s, atomic_cell::make_live_counter_update(1, 5));
+        u.apply(make_mutation(s, atomic_cell::make_live_counter_update(2, -2)));
+        BOOST_REQUIRE(get_counter_cell(u).is_counter_update());
+        BOOST_REQUIRE_EQUAL(get_counter_cell(u).counter_update_value(), 3);
+    });
+}
+
+SEASTAR_TEST_CASE(test_difference) {
+    return seastar::async([] {
+        auto id1 = make_id(1);
+        auto id2 = make_id(2);
+        auto id3 = make_id(3);
+
+        auto a = make_counter_cell(1, { counter_shard(id1, 1, 2), counter_shard(id2, 2, 5), counter_shard(id3, 3, 1) });
+        auto b = make_counter_cell(1, { counter_shard(id1, 1, 2), counter_shard(id2, 1, 4) });
+
+        auto diff = counter_cell_view::difference(a, b);
+        BOOST_REQUIRE(diff);
+        counter_cell_view ccv(*diff);
+        BOOST_REQUIRE_EQUAL(ccv.shard_count(), 2);
+        BOOST_REQUIRE(!ccv.get_shard(id1));
+        BOOST_REQUIRE_EQUAL(ccv.get_shard(id2)->value(), 2);
+        BOOST_REQUIRE_EQUAL(ccv.get_shard(id3)->value(), 3);
+
+        BOOST_REQUIRE(!counter_cell_view::difference(b, a));
+        BOOST_REQUIRE(!counter_cell_view::difference(a, a));
+    });
+}
+
+SEASTAR_TEST_CASE(test_transform_counter_updates_to_shards) {
+    return seastar::async([] {
+        auto s = get_schema();
+        auto local_id = make_id(1);
+        auto other_id = make_id(2);
+
+        // No current state: a new local shard is created.
+        auto m = make_mutation(s, atomic_cell::make_live_counter_update(1, 5));
+        transform_counter_updates_to_shards(m, nullptr, local_id);
+        {
+            counter_cell_view ccv(get_counter_cell(m));
+            BOOST_REQUIRE_EQUAL(ccv.shard_count(), 1);
+            BOOST_REQUIRE_EQUAL(ccv.get_shard(local_id)->value(), 5);
+            BOOST_REQUIRE_EQUAL(ccv.get_shard(local_id)->logical_clock(), 1);
+        }
+
+        // The local shard of the current state is updated, other shards are
+        // left out.
+        auto current = make_mutation(s, make_counter_cell(1, { counter_shard(local_id, 5, 1), counter_shard(other_id, 10, 3) }));
+        m = make_mutation(s, atomic_cell::make_live_counter_update(2, -2));
+        transform_counter_updates_to_shards(m, &current, local_id);
+        {
+            counter_cell_view ccv(get_counter_cell(m));
+            BOOST_REQUIRE_EQUAL(ccv.shard_count(), 1);
+            BOOST_REQUIRE_EQUAL(ccv.get_shard(local_id)->value(), 3);
+            BOOST_REQUIRE_EQUAL(ccv.get_shard(local_id)->logical_clock(), 2);
+        }
+
+        current.apply(m);
+        BOOST_REQUIRE_EQUAL(counter_cell_view(get_counter_cell(current)).total_value(), 13);
+    });
+}
+
+SEASTAR_TEST_CASE(test_counter_serialization) {
+    return seastar::async([] {
+        auto s = get_schema();
+        auto m = make_mutation(s, make_counter_cell(1, { counter_shard(make_id(1), 1, 2), counter_shard(make_id(2), -5, 4) }));
+        auto m2 = freeze(m).unfreeze(s);
+        BOOST_REQUIRE_EQUAL(m, m2);
+
+        auto u = make_mutation(s, atomic_cell::make_live_counter_update(1, 7));
+        auto u2 = freeze(u).unfreeze(s);
+        BOOST_REQUIRE(get_counter_cell(u2).is_counter_update());
+        BOOST_REQUIRE_EQUAL(get_counter_cell(u2).counter_update_value(), 7);
+    });
+}
+
+SEASTAR_TEST_CASE(test_counter_cql) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            e.execute_cql("create table cf (p int, c int, v counter, primary key (p, c));").get();
+            e.execute_cql("update cf set v = v + 5 where p = 0 and c = 0;").get();
+            e.execute_cql("update cf set v = v - 2 where p = 0 and c = 0;").get();
+            auto msg = e.execute_cql("select v from cf where p = 0 and c = 0;").get0();
+            assert_that(msg).is_rows().with_rows({{long_type->decompose(int64_t(3))}});
+
+            e.execute_cql("delete v from cf where p = 0 and c = 0;").get();
+            msg = e.execute_cql("select v from cf where p = 0 and c = 0;").get0();
+            assert_that(msg).is_rows().is_empty();
+
+            BOOST_REQUIRE_THROW(e.execute_cql("create table cf2 (p int primary key, v counter, w int);").get(),
+                                exceptions::invalid_request_exception);
+            BOOST_REQUIRE_THROW(e.execute_cql("update cf set v = 1 where p = 0 and c = 0;").get(),
+                                exceptions::invalid_request_exception);
+        });
+    });
+}
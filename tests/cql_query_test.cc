@@ -1210,6 +1210,33 @@ SEASTAR_TEST_CASE(test_table_compression) {
             assert(!f.failed());
             e.require_table_exists("ks", "tb4");
             BOOST_REQUIRE(e.local_db().find_schema("ks", "tb4")->get_compressor_params().get_compressor() == compressor::deflate);
+            return e.execute_cql("create table tb6 (foo text PRIMARY KEY, bar text) with compression = { 'sstable_compression' : 'LZ4Compressor', 'dictionary_size_kb' : 16 };");
+        }).then_wrapped([&e] (auto f) {
+            assert_that_failed(f);
+            return e.execute_cql("create table tb6 (foo text PRIMARY KEY, bar text) with compression = { 'sstable_compression' : 'ZstdCompressor', 'compression_level' : 23 };");
+        }).then_wrapped([&e] (auto f) {
+            assert_that_failed(f);
+            return e.execute_cql("create table tb6 (foo text PRIMARY KEY, bar text) with compression = { 'sstable_compression' : 'ZstdCompressor', 'compression_level' : 9, 'dictionary_size_kb' : 16 };");
+        }).then_wrapped([&e] (auto f) {
+            assert(!f.failed());
+            e.require_table_exists("ks", "tb6");
+            auto& cp = e.local_db().find_schema("ks", "tb6")->get_compressor_params();
+            BOOST_REQUIRE(cp.get_compressor() == compressor::zstd);
+            BOOST_REQUIRE_EQUAL(cp.compression_level(), 9);
+            BOOST_REQUIRE_EQUAL(cp.dictionary_size(), 16 * 1024);
+            return e.execute_cql("create table tb7 (foo text PRIMARY KEY, bar text) with compression = { 'sstable_compression' : 'LZ4Compressor', 'chunk_length_kb' : 4194304 };");
+        }).then_wrapped([&e] (auto f) {
+            assert_that_failed(f);
+            return e.execute_cql("create table tb7 (foo text PRIMARY KEY, bar text) with compression = { 'sstable_compression' : 'LZ4Compressor', 'chunk_length_kb' : '4k' };");
+        }).then_wrapped([&e] (auto f) {
+            assert_that_failed(f);
+            return e.execute_cql("create table tb7 (foo text PRIMARY KEY, bar text) with compression = { 'sstable_compression' : 'ZstdCompressor', 'dictionary_size_kb' : 99999999999 };");
+        }).then_wrapped([&e] (auto f) {
+            assert_that_failed(f);
+            BOOST_REQUIRE_THROW(compression_parameters({
+                { sstring(compression_parameters::SSTABLE_COMPRESSION), "ZstdCompressor" },
+                { sstring(compression_parameters::COMPRESSION_LEVEL), "x" },
+            }), exceptions::configuration_exception);
         });
     });
 }
@@ -33,6 +33,7 @@
 #include "service/storage_service.hh"
 #include "db/config.hh"
 #include "db/batchlog_manager.hh"
+#include "db/index/secondary_index.hh"
 #include "schema_builder.hh"
 #include "tmpdir.hh"
 #include "db/query_context.hh"
@@ -333,6 +334,11 @@ class single_node_cql_env : public cql_test_env {
                 auth::auth::shutdown().get();
             });
 
+            auto& ib = db::index::get_index_builder();
+            ib.start(std::ref(*db)).get();
+            ib.invoke_on_all(&db::index::index_builder::start).get();
+            auto stop_ib = defer([&ib] { ib.stop().get(); });
+
             single_node_cql_env env(db);
             env.start().get();
             auto stop_env = defer([&env] { env.stop().get(); });
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <snappy-c.h>
+
+#include <seastar/core/reactor.hh>
+#include <seastar/core/thread.hh>
+#include <seastar/tests/test-utils.hh>
+
+#include "tests/cql_test_env.hh"
+
+#include "cql3/query_processor.hh"
+#include "service/storage_proxy.hh"
+#include "transport/server.hh"
+
+#include "disk-error-handler.hh"
+
+thread_local disk_error_signal_type commit_error;
+thread_local disk_error_signal_type general_disk_error;
+
+// A minimal native protocol v4 client, just enough to negotiate
+// compression and run a query.
+
+static constexpr uint8_t startup_opcode = 0x01;
+static constexpr uint8_t ready_opcode = 0x02;
+static constexpr uint8_t query_opcode = 0x07;
+static constexpr uint8_t result_opcode = 0x08;
+
+struct frame {
+    uint8_t flags;
+    uint8_t opcode;
+    sstring body;
+};
+
+static sstring cql_short(uint16_t n) {
+    sstring s(sstring::initialized_later(), 2);
+    s[0] = char(n >> 8);
+    s[1] = char(n);
+    return s;
+}
+
+static sstring cql_int(uint32_t n) {
+    return cql_short(n >> 16) + cql_short(n & 0xffff);
+}
+
+static sstring cql_string(const sstring& s) {
+    return cql_short(s.size()) + s;
+}
+
+static sstring compress(const sstring& in) {
+    size_t len = snappy_max_compressed_length(in.size());
+    sstring out(sstring::initialized_later(), len);
+    BOOST_REQUIRE(snappy_compress(in.c_str(), in.size(), out.begin(), &len) == SNAPPY_OK);
+    out.resize(len);
+    return out;
+}
+
+static sstring uncompress(const sstring& in) {
+    size_t len;
+    BOOST_REQUIRE(snappy_uncompressed_length(in.c_str(), in.size(), &len) == SNAPPY_OK);
+    sstring out(sstring::initialized_later(), len);
+    BOOST_REQUIRE(snappy_uncompress(in.c_str(), in.size(), out.begin(), &len) == SNAPPY_OK);
+    out.resize(len);
+    return out;
+}
+
+static void write_frame(output_stream<char>& out, uint8_t flags, uint8_t opcode, const sstring& body) {
+    sstring header(sstring::initialized_later(), 5);
+    header[0] = 0x04;
+    header[1] = char(flags);
+    header[2] = 0;
+    header[3] = 1;
+    header[4] = char(opcode);
+    out.write(header + cql_int(body.size()) + body).get();
+    out.flush().get();
+}
+
+static frame read_frame(input_stream<char>& in) {
+    auto header = in.read_exactly(9).get0();
+    BOOST_REQUIRE_EQUAL(header.size(), 9);
+    auto p = reinterpret_cast<const uint8_t*>(header.get());
+    BOOST_REQUIRE_EQUAL(p[0], 0x84);
+    auto length = (uint32_t(p[5]) << 24) | (uint32_t(p[6]) << 16) | (uint32_t(p[7]) << 8) | uint32_t(p[8]);
+    auto body = in.read_exactly(length).get0();
+    BOOST_REQUIRE_EQUAL(body.size(), length);
+    return frame{p[1], p[4], sstring(body.get(), body.size())};
+}
+
+// A client negotiating Snappy gets compressed responses, and its
+// compressed requests are understood. Requests are spread over shards,
+// while the connection, which switches to Snappy, stays on its own.
+SEASTAR_TEST_CASE(test_snappy_frame_compression) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            sstring value(1000, 'x');
+            e.execute_cql("create table t (p int primary key, v text);").get();
+            e.execute_cql(sprint("insert into t (p, v) values (1, '%s');", value)).get();
+
+            distributed<transport::cql_server> server;
+            server.start(std::ref(service::get_storage_proxy()), std::ref(cql3::get_query_processor()),
+                    transport::cql_load_balance::round_robin).get();
+            auto addr = ipv4_addr("127.0.0.1", 19042);
+            server.invoke_on_all(&transport::cql_server::listen, addr, std::shared_ptr<seastar::tls::credentials_builder>(), false).get();
+
+            auto socket = engine().net().connect(make_ipv4_address(addr)).get0();
+            auto in = socket.input();
+            auto out = socket.output();
+
+            write_frame(out, 0, startup_opcode,
+                    cql_short(2) + cql_string("CQL_VERSION") + cql_string("3.0.0")
+                                 + cql_string("COMPRESSION") + cql_string("snappy"));
+            auto ready = read_frame(in);
+            BOOST_REQUIRE_EQUAL(ready.opcode, ready_opcode);
+            BOOST_REQUIRE(ready.flags & transport::cql_frame_flags::compression);
+            BOOST_REQUIRE(uncompress(ready.body).empty());
+
+            // Several queries, so that they run on every shard.
+            for (unsigned i = 0; i < smp::count + 1; ++i) {
+                sstring text = "select v from ks.t where p = 1;";
+                // The query, consistency ONE and no flags
+                auto query = cql_int(text.size()) + text + cql_short(0x0001) + sstring(1, '\0');
+                write_frame(out, transport::cql_frame_flags::compression, query_opcode, compress(query));
+                auto result = read_frame(in);
+                BOOST_REQUIRE_EQUAL(result.opcode, result_opcode);
+                BOOST_REQUIRE(result.flags & transport::cql_frame_flags::compression);
+                auto body = uncompress(result.body);
+                BOOST_REQUIRE(body.find(value) != sstring::npos);
+                BOOST_REQUIRE_LT(result.body.size(), body.size());
+            }
+
+            out.close().get();
+            in.close().get();
+            server.stop().get();
+        });
+    });
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "tests/test-utils.hh"
+#include "tests/cql_test_env.hh"
+#include "tests/cql_assertions.hh"
+
+#include "core/future-util.hh"
+#include "core/shared_ptr.hh"
+#include "core/thread.hh"
+#include "service/storage_proxy.hh"
+#include "db/config.hh"
+#include "db/hints_manager.hh"
+#include "utils/fb_utilities.hh"
+#include "tmpdir.hh"
+
+#include "disk-error-handler.hh"
+
+thread_local disk_error_signal_type commit_error;
+thread_local disk_error_signal_type general_disk_error;
+
+static mutation make_mutation(schema_ptr s, sstring key, int32_t value) {
+    mutation m(partition_key::from_exploded(*s, {to_bytes(key)}), s);
+    auto c_key = clustering_key::from_exploded(*s, {int32_type->decompose(1)});
+    m.set_clustered_cell(c_key, *s->get_column_definition("r1"), atomic_cell::make_live(0, int32_type->decompose(value)));
+    return m;
+}
+
+static future<> with_hints_env(std::function<void(cql_test_env&)> func, uint32_t max_hints_disk_space_in_mb = 10) {
+    auto hints_dir = make_lw_shared<tmpdir>();
+    db::config cfg;
+    cfg.hints_directory() = hints_dir->path;
+    cfg.max_hints_disk_space_in_mb() = max_hints_disk_space_in_mb;
+    cfg.max_hints_file_size_in_mb() = 1;
+    return do_with_cql_env([func = std::move(func)] (cql_test_env& e) {
+        return seastar::async([&e, func] {
+            e.execute_cql("create table cf (p1 varchar, c1 int, r1 int, PRIMARY KEY (p1, c1));").get();
+            func(e);
+        });
+    }, cfg).finally([hints_dir] {});
+}
+
+SEASTAR_TEST_CASE(test_hints_are_stored_and_delivered) {
+    return with_hints_env([] (cql_test_env& e) {
+        auto s = e.local_db().find_schema("ks", "cf");
+        // The local node is always alive, so hints for it can be delivered.
+        auto ep = utils::fb_utilities::get_broadcast_address();
+        auto hm = make_shared<db::hints_manager>(e.db(), service::get_storage_proxy());
+
+        hm->store_hint(ep, s, make_lw_shared<const frozen_mutation>(freeze(make_mutation(s, "key1", 100)))).get();
+        hm->store_hint(ep, s, make_lw_shared<const frozen_mutation>(freeze(make_mutation(s, "key2", 200)))).get();
+        BOOST_REQUIRE_EQUAL(hm->get_stats().written, 2);
+        BOOST_REQUIRE_EQUAL(hm->get_endpoint_stats(ep).written, 2);
+        BOOST_REQUIRE(hm->endpoints_pending_hints() == std::vector<gms::inet_address>({ep}));
+
+        hm->send_hints(ep).get();
+        BOOST_REQUIRE_EQUAL(hm->get_stats().sent, 2);
+        BOOST_REQUIRE(hm->endpoints_pending_hints().empty());
+        hm->stop().get();
+
+        auto msg = e.execute_cql("select r1 from cf where p1 = 'key1' and c1 = 1;").get0();
+        assert_that(msg).is_rows().with_rows({{int32_type->decompose(100)}});
+        msg = e.execute_cql("select r1 from cf where p1 = 'key2' and c1 = 1;").get0();
+        assert_that(msg).is_rows().with_rows({{int32_type->decompose(200)}});
+    });
+}
+
+SEASTAR_TEST_CASE(test_hints_survive_restart_and_truncate) {
+    return with_hints_env([] (cql_test_env& e) {
+        auto s = e.local_db().find_schema("ks", "cf");
+        auto ep = gms::inet_address("127.0.0.2");
+
+        auto hm = make_shared<db::hints_manager>(e.db(), service::get_storage_proxy());
+        hm->store_hint(ep, s, make_lw_shared<const frozen_mutation>(freeze(make_mutation(s, "key1", 100)))).get();
+        hm->stop().get();
+
+        hm = make_shared<db::hints_manager>(e.db(), service::get_storage_proxy());
+        hm->start().get();
+        BOOST_REQUIRE(hm->endpoints_pending_hints() == std::vector<gms::inet_address>({ep}));
+
+        // The endpoint is unknown to gossip, nothing gets delivered.
+        hm->send_hints(ep).get();
+        BOOST_REQUIRE_EQUAL(hm->get_stats().sent, 0);
+        BOOST_REQUIRE(hm->endpoints_pending_hints() == std::vector<gms::inet_address>({ep}));
+
+        hm->truncate_all_hints().get();
+        BOOST_REQUIRE(hm->endpoints_pending_hints().empty());
+        hm->stop().get();
+    });
+}
+
+SEASTAR_TEST_CASE(test_hints_disk_space_is_bounded) {
+    return with_hints_env([] (cql_test_env& e) {
+        auto s = e.local_db().find_schema("ks", "cf");
+        auto ep = gms::inet_address("127.0.0.2");
+        auto hm = make_shared<db::hints_manager>(e.db(), service::get_storage_proxy());
+
+        hm->store_hint(ep, s, make_lw_shared<const frozen_mutation>(freeze(make_mutation(s, "key1", 100)))).get();
+        BOOST_REQUIRE_EQUAL(hm->get_stats().written, 0);
+        BOOST_REQUIRE_EQUAL(hm->get_stats().dropped, 1);
+        BOOST_REQUIRE_EQUAL(hm->get_endpoint_stats(ep).dropped, 1);
+        BOOST_REQUIRE(hm->endpoints_pending_hints().empty());
+        hm->stop().get();
+    }, 0);
+}
+
+SEASTAR_TEST_CASE(test_hints_disk_space_is_freed_by_delivery) {
+    return with_hints_env([] (cql_test_env& e) {
+        e.execute_cql("create table big (p1 varchar, c1 int, r1 blob, PRIMARY KEY (p1, c1));").get();
+        auto s = e.local_db().find_schema("ks", "big");
+        auto ep = utils::fb_utilities::get_broadcast_address();
+        auto hm = make_shared<db::hints_manager>(e.db(), service::get_storage_proxy());
+
+        auto make_big_hint = [s] (int i) {
+            mutation m(partition_key::from_exploded(*s, {to_bytes(sprint("key%d", i))}), s);
+            auto c_key = clustering_key::from_exploded(*s, {int32_type->decompose(1)});
+            m.set_clustered_cell(c_key, *s->get_column_definition("r1"), atomic_cell::make_live(0, bytes(16 * 1024, 'x')));
+            return make_lw_shared<const frozen_mutation>(freeze(m));
+        };
+
+        // Fill the shard's share of the 1MB limit until a hint is dropped.
+        int i = 0;
+        while (hm->get_stats().dropped == 0) {
+            BOOST_REQUIRE_LT(i, 1000);
+            hm->store_hint(ep, s, make_big_hint(i++)).get();
+        }
+        auto written = hm->get_stats().written;
+        BOOST_REQUIRE_GT(written, 0);
+        BOOST_REQUIRE_EQUAL(hm->get_endpoint_stats(ep).dropped, 1);
+
+        hm->send_hints(ep).get();
+        BOOST_REQUIRE_EQUAL(hm->get_stats().sent, written);
+        BOOST_REQUIRE(hm->endpoints_pending_hints().empty());
+
+        // Delivery released the space, new hints are accepted again.
+        hm->store_hint(ep, s, make_big_hint(i++)).get();
+        BOOST_REQUIRE_EQUAL(hm->get_stats().written, written + 1);
+        BOOST_REQUIRE_EQUAL(hm->get_stats().dropped, 1);
+        hm->stop().get();
+    }, 1);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE core
+
+#include <boost/test/unit_test.hpp>
+#include "utils/histogram.hh"
+
+#include "disk-error-handler.hh"
+
+thread_local disk_error_signal_type commit_error;
+thread_local disk_error_signal_type general_disk_error;
+
+using namespace std::chrono_literals;
+
+BOOST_AUTO_TEST_CASE(test_decaying_latency_histogram_percentiles) {
+    utils::decaying_latency_histogram h(10s);
+    auto now = utils::decaying_latency_histogram::clock::now();
+    for (int i = 0; i < 99; ++i) {
+        h.mark(1ms, now);
+    }
+    h.mark(1s, now);
+    BOOST_REQUIRE_EQUAL(h.count(now), 100);
+
+    // Percentiles are rounded up to bucket limits, which are 20% apart.
+    auto p50 = h.percentile(0.5, now);
+    BOOST_REQUIRE(p50 >= 1ms && p50 < 1200us);
+    auto p99 = h.percentile(0.99, now);
+    BOOST_REQUIRE(p99 >= 1ms && p99 < 1200us);
+    auto max = h.percentile(1, now);
+    BOOST_REQUIRE(max >= 1s && max < 1200ms);
+}
+
+BOOST_AUTO_TEST_CASE(test_decaying_latency_histogram_decay) {
+    utils::decaying_latency_histogram h(10s);
+    auto now = utils::decaying_latency_histogram::clock::now();
+    for (int i = 0; i < 100; ++i) {
+        h.mark(100ms, now);
+    }
+    now += 10s;
+    BOOST_REQUIRE_EQUAL(h.count(now), 50);
+
+    // Old samples lose weight, so the percentiles follow recent latencies.
+    now += 30s;
+    for (int i = 0; i < 100; ++i) {
+        h.mark(1ms, now);
+    }
+    auto p90 = h.percentile(0.9, now);
+    BOOST_REQUIRE(p90 >= 1ms && p90 < 1200us);
+}
+
+BOOST_AUTO_TEST_CASE(test_decaying_latency_histogram_empty) {
+    utils::decaying_latency_histogram h;
+    BOOST_REQUIRE_EQUAL(h.count(), 0);
+    // Out of range latencies go to the last bucket.
+    h.mark(1h);
+    BOOST_REQUIRE(h.percentile(0.5) >= 10s);
+}
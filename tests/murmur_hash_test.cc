@@ -25,6 +25,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include "utils/murmur_hash.hh"
+#include "murmur3_hasher.hh"
 #include "bytes.hh"
 #include "core/print.hh"
 
@@ -121,5 +122,32 @@ BOOST_AUTO_TEST_CASE(test_hash_output) {
             utils::murmur_hash::hash3_x64_128(prefix.begin(), prefix.size(), seed, dst);
             assert_hashes_equal(prefix, dst, expected);
         }
+
+        // Test the incremental version, fed byte by byte
+        {
+            murmur3_hasher h(seed);
+            for (auto b : prefix) {
+                h.update(reinterpret_cast<const char*>(&b), 1);
+            }
+            assert_hashes_equal(prefix, h.finalize(), expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_incremental_hash_splits) {
+    bytes data(bytes::initialized_later(), 100);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = int8_t(i * 37 + 200);
+    }
+    for (size_t len = 0; len <= data.size(); ++len) {
+        auto input = bytes_view(data.begin(), len);
+        std::array<uint64_t, 2> expected;
+        utils::murmur_hash::hash3_x64_128(input, seed, expected);
+        for (size_t split = 0; split <= len; split += 7) {
+            murmur3_hasher h(seed);
+            h.update(reinterpret_cast<const char*>(input.data()), split);
+            h.update(reinterpret_cast<const char*>(input.data() + split), len - split);
+            BOOST_REQUIRE(h.finalize() == expected);
+        }
     }
 }
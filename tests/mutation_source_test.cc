@@ -22,6 +22,7 @@
 #include "schema_builder.hh"
 #include "mutation_reader_assertions.hh"
 #include "mutation_source_test.hh"
+#include "partition_slice_builder.hh"
 
 // partitions must be sorted by decorated key
 static void require_no_token_duplicates(const std::vector<mutation>& partitions) {
@@ -165,8 +166,82 @@ static void test_range_queries(populate_fn populate) {
     test_slice(inclusive_token_range(128, partitions.size() - 1));
 }
 
+static void test_reversed_reads(populate_fn populate) {
+    BOOST_TEST_MESSAGE("Testing reversed reads");
+
+    auto s = schema_builder("ks", "cf")
+        .with_column("pk", bytes_type, column_kind::partition_key)
+        .with_column("ck", int32_type, column_kind::clustering_key)
+        .with_column("s", bytes_type, column_kind::static_column)
+        .with_column("v", bytes_type)
+        .build();
+
+    auto make_ck = [&] (int v) {
+        return clustering_key::from_single_value(*s, int32_type->decompose(v));
+    };
+
+    mutation m(partition_key::from_single_value(*s, to_bytes("key1")), s);
+    m.set_static_cell("s", data_value(bytes("static")), 1);
+    const int nr_rows = 300;
+    for (int i = 0; i < nr_rows; ++i) {
+        m.set_clustered_cell(make_ck(i), "v", data_value(bytes(1024, int8_t(i))), 1);
+    }
+    m.partition().apply_delete(*s, range_tombstone(make_ck(50), bound_kind::incl_start,
+            make_ck(250), bound_kind::excl_end, tombstone(2, gc_clock::now())));
+
+    auto ds = populate(s, {m});
+    auto pr = query::partition_range::make_singular(m.decorated_key());
+
+    // Ranges are given in the reverse order, as in reversed queries.
+    auto check = [&] (std::vector<query::clustering_range> ranges) {
+        auto builder = partition_slice_builder(*s);
+        for (auto&& r : ranges) {
+            builder.with_range(r);
+        }
+        auto slice = builder.reversed().build();
+        auto ck_filtering = query::clustering_key_filtering_context::create(s, slice);
+
+        auto rd = ds(s, pr, ck_filtering);
+        auto sm = rd().get0();
+        BOOST_REQUIRE(sm);
+        position_in_partition::less_compare cmp(*s);
+        position_in_partition::reversed_less_compare reversed_cmp(*s);
+        stdx::optional<mutation_fragment> previous;
+        auto mf = (*sm)().get0();
+        while (mf) {
+            if (previous) {
+                BOOST_REQUIRE(sm->is_reversed() ? reversed_cmp(*previous, *mf) : cmp(*previous, *mf));
+            }
+            previous = std::move(mf);
+            mf = (*sm)().get0();
+        }
+
+        std::reverse(ranges.begin(), ranges.end());
+        auto expected = mutation_partition(m.partition(), *s, ranges);
+        rd = ds(s, pr, ck_filtering);
+        auto result = mutation_from_streamed_mutation(rd().get0()).get0();
+        BOOST_REQUIRE(result);
+        auto& p = result->partition();
+        BOOST_REQUIRE(p.static_row().equal(column_kind::static_column, *s, m.partition().static_row(), *s));
+        BOOST_REQUIRE_EQUAL(p.clustered_rows().size(), expected.clustered_rows().size());
+        auto it = p.clustered_rows().begin();
+        for (auto&& e : expected.clustered_rows()) {
+            BOOST_REQUIRE(it->equal(*s, e));
+            BOOST_REQUIRE(p.tombstone_for_row(*s, e.key()) == m.partition().tombstone_for_row(*s, e.key()));
+            ++it;
+        }
+    };
+
+    check({ query::clustering_range::make_open_ended_both_sides() });
+    check({ query::clustering_range::make({make_ck(100)}, {make_ck(120)}) });
+    check({ query::clustering_range::make({make_ck(280)}, {make_ck(290)}),
+            query::clustering_range::make({make_ck(10)}, {make_ck(60)}) });
+    check({ query::clustering_range::make_starting_with({make_ck(240)}) });
+}
+
 void run_mutation_source_tests(populate_fn populate) {
     test_range_queries(populate);
+    test_reversed_reads(populate);
 }
 
 struct mutation_sets {
@@ -1092,6 +1092,51 @@ SEASTAR_TEST_CASE(test_query_digest) {
     });
 }
 
+static query::result_digest digest_of(const mutation& m, query::digest_algorithm algo) {
+    auto slice = partition_slice_builder(*m.schema()).build();
+    query::result::builder builder(slice, query::result_request::only_digest, algo);
+    mutation(m).query(builder, slice);
+    return *builder.build().digest();
+}
+
+SEASTAR_TEST_CASE(test_query_digest_murmur3) {
+    return seastar::async([] {
+        auto murmur3 = query::digest_algorithm::murmur3;
+
+        for_each_mutation_pair([&] (const mutation& m1, const mutation& m2, are_equal eq) {
+            if (eq && m1.schema()->version() == m2.schema()->version()) {
+                BOOST_REQUIRE(digest_of(compacted(m1), murmur3) == digest_of(m2, murmur3));
+            }
+        });
+
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", bytes_type, column_kind::partition_key)
+            .with_column("ck", bytes_type, column_kind::clustering_key)
+            .with_column("v", bytes_type)
+            .build();
+        auto key = dht::global_partitioner().decorate_key(*s, partition_key::from_single_value(*s, to_bytes("key")));
+        // Three rows, of which the middle one has the given value.
+        auto make_mutation = [&] (sstring value) {
+            mutation m(key, s);
+            auto set = [&] (sstring ck, sstring v) {
+                m.set_clustered_cell(clustering_key::from_single_value(*s, to_bytes(ck)), "v", data_value(to_bytes(v)), 1);
+            };
+            set("a", "value");
+            set("b", value);
+            set("c", "value");
+            return m;
+        };
+        auto m1 = make_mutation("value");
+        auto m2 = make_mutation("value");
+        auto m3 = make_mutation("other");
+
+        BOOST_REQUIRE(digest_of(m1, murmur3) == digest_of(m2, murmur3));
+        BOOST_REQUIRE(digest_of(m1, murmur3) != digest_of(m3, murmur3));
+        // Replicas asked for different algorithms never agree.
+        BOOST_REQUIRE(digest_of(m1, murmur3) != digest_of(m1, query::digest_algorithm::MD5));
+    });
+}
+
 SEASTAR_TEST_CASE(test_mutation_upgrade_of_equal_mutations) {
     return seastar::async([] {
         for_each_mutation_pair([](auto&& m1, auto&& m2, are_equal eq) {
@@ -20,6 +20,7 @@
  */
 
 #include "utils/murmur_hash.hh"
+#include "query-result.hh"
 #include "tests/perf/perf.hh"
 
 #include "disk-error-handler.hh"
@@ -53,5 +54,47 @@ int main(int argc, char* argv[]) {
         sink += dst[1];
     });
 
+    // Result digests are fed cell by cell: the column id, the cell's
+    // metadata and its value, see hash_row_slice().
+    struct digest_case {
+        const char* name;
+        unsigned rows;
+        unsigned cells_per_row;
+        size_t value_size;
+    };
+    const digest_case cases[] = {
+        { "single small row", 1, 5, 16 },
+        { "100 rows of small cells", 100, 5, 16 },
+        { "100 rows of 1KB cells", 100, 5, 1024 },
+        { "10 rows of 64KB blobs", 10, 1, 64 * 1024 },
+    };
+    auto algorithms = {
+        std::make_pair("MD5", query::digest_algorithm::MD5),
+        std::make_pair("murmur3", query::digest_algorithm::murmur3),
+    };
+
+    for (auto&& c : cases) {
+        auto key = bytes("partition key 0001");
+        auto value = bytes(bytes::initialized_later(), c.value_size);
+        std::fill(value.begin(), value.end(), 'v');
+        for (auto&& algo : algorithms) {
+            std::cout << "Timing " << algo.first << " result digest, " << c.name << "...\n";
+            time_it([&] {
+                query::digester d(algo.second);
+                feed_hash(d, key);
+                for (unsigned r = 0; r < c.rows; r++) {
+                    feed_hash(d, r);
+                    for (uint32_t id = 0; id < c.cells_per_row; id++) {
+                        feed_hash(d, id);
+                        feed_hash(d, api::timestamp_type(1));
+                        feed_hash(d, value);
+                    }
+                }
+                auto digest = d.finalize_array();
+                sink += digest[0];
+            }, 5, 100);
+        }
+    }
+
     black_hole = sink;
 }
@@ -23,8 +23,10 @@
 #include <core/distributed.hh>
 #include <core/app-template.hh>
 #include <core/sstring.hh>
+#include <core/thread.hh>
 #include <random>
 #include "perf_sstable.hh"
+#include "sstables/compress.hh"
 
 #include "disk-error-handler.hh"
 
@@ -52,11 +54,95 @@ future<> test_sequential_read(distributed<test_env>& dt) {
     return time_runs(iterations, parallelism, dt, &test_env::read_sequential_partitions);
 }
 
+// Small JSON-like rows, with values drawn from a small vocabulary like the
+// fields of real documents are.
+static sstring make_json_row(std::default_random_engine& gen, unsigned id) {
+    static const std::vector<sstring> words = {
+        "active", "pending", "disabled", "admin", "user", "guest", "red", "green",
+        "blue", "mobile", "desktop", "tablet", "en-US", "fr-FR", "de-DE", "ja-JP",
+    };
+    std::uniform_int_distribution<unsigned> word(0, words.size() - 1);
+    std::uniform_int_distribution<unsigned> number(0, 99999);
+    return sprint("{\"id\":%d,\"user\":\"user%05d\",\"status\":\"%s\",\"role\":\"%s\",\"tags\":[\"%s\",\"%s\"],"
+                  "\"device\":\"%s\",\"locale\":\"%s\",\"score\":%d}",
+                  id, number(gen), words[word(gen)], words[word(gen)], words[word(gen)], words[word(gen)],
+                  words[word(gen)], words[word(gen)], number(gen));
+}
+
+// Compresses data_size bytes of rows in chunks of chunk_length with each
+// compressor, and reports the compression ratio (the dictionary counts as
+// compressed data) and the decompression throughput.
+static void test_compression(size_t data_size, size_t chunk_length, unsigned dictionary_size_kb, unsigned iterations) {
+    std::default_random_engine gen;
+    std::vector<temporary_buffer<char>> chunks;
+    sstring data;
+    unsigned id = 0;
+    size_t total = 0;
+    while (total < data_size) {
+        while (data.size() < chunk_length) {
+            data += make_json_row(gen, id++);
+        }
+        temporary_buffer<char> chunk(data.begin(), chunk_length);
+        data = sstring(data.begin() + chunk_length, data.size() - chunk_length);
+        total += chunk.size();
+        chunks.push_back(std::move(chunk));
+    }
+
+    auto compressor_options = [] (sstring name, std::map<sstring, sstring> extra) {
+        extra.emplace(sstring(compression_parameters::SSTABLE_COMPRESSION), std::move(name));
+        return extra;
+    };
+    std::vector<std::pair<sstring, std::map<sstring, sstring>>> candidates = {
+        { "lz4", compressor_options("LZ4Compressor", {}) },
+        { "zstd", compressor_options("ZstdCompressor", {}) },
+        { "zstd+dictionary", compressor_options("ZstdCompressor",
+                { { sstring(compression_parameters::DICTIONARY_SIZE_KB), to_sstring(dictionary_size_kb) } }) },
+    };
+
+    std::cout << sprint("%d chunks of %d bytes\n", chunks.size(), chunk_length);
+    for (auto&& candidate : candidates) {
+        compression c;
+        c.set_compressor(compression_parameters(candidate.second));
+        if (c.wants_dictionary()) {
+            std::vector<temporary_buffer<char>> samples;
+            size_t sampled = 0;
+            for (auto it = chunks.begin(); it != chunks.end() && sampled < c.dictionary_training_size(); ++it) {
+                samples.push_back(it->share());
+                sampled += it->size();
+            }
+            c.train_dictionary(samples).get();
+        }
+
+        std::vector<temporary_buffer<char>> compressed;
+        size_t compressed_size = c.dictionary().size();
+        for (auto&& chunk : chunks) {
+            temporary_buffer<char> out(c.compress_max_size(chunk.size()));
+            out.trim(c.compress(chunk.get(), chunk.size(), out.get_write(), out.size()));
+            compressed_size += out.size();
+            compressed.push_back(std::move(out));
+        }
+
+        temporary_buffer<char> out(chunk_length);
+        auto start = test_env::now();
+        for (unsigned i = 0; i < iterations; ++i) {
+            for (auto&& chunk : compressed) {
+                c.uncompress(chunk.get(), chunk.size(), out.get_write(), out.size());
+            }
+        }
+        auto duration = std::chrono::duration<double>(test_env::now() - start).count();
+
+        std::cout << sprint("%-16s ratio %.3f (dictionary %d bytes), decompression %.2f MB/s\n",
+                            candidate.first, double(compressed_size) / total, c.dictionary().size(),
+                            double(total) * iterations / duration / (1 << 20));
+    }
+}
+
 enum class test_modes {
     sequential_read,
     index_read,
     write,
     index_write,
+    compression,
 };
 
 static std::unordered_map<sstring, test_modes> test_mode = {
@@ -64,6 +150,7 @@ static std::unordered_map<sstring, test_modes> test_mode = {
     {"index_read", test_modes::index_read },
     {"write", test_modes::write },
     {"index_write", test_modes::index_write },
+    {"compression", test_modes::compression },
 };
 
 int main(int argc, char** argv) {
@@ -77,10 +164,26 @@ int main(int argc, char** argv) {
         ("key_size", bpo::value<unsigned>()->default_value(128), "size of partition key")
         ("num_columns", bpo::value<unsigned>()->default_value(5), "number of columns per row")
         ("column_size", bpo::value<unsigned>()->default_value(64), "size in bytes for each column")
-        ("mode", bpo::value<sstring>()->default_value("index_write"), "one of: random_read, sequential_read, index_read, write, index_write (default)")
+        ("chunk_length_kb", bpo::value<unsigned>()->default_value(4), "compression chunk length, in KB (compression mode)")
+        ("dictionary_size_kb", bpo::value<unsigned>()->default_value(64), "zstd dictionary size, in KB (compression mode)")
+        ("data_size_mb", bpo::value<unsigned>()->default_value(64), "amount of data to compress, in MB (compression mode)")
+        ("mode", bpo::value<sstring>()->default_value("index_write"), "one of: random_read, sequential_read, index_read, write, index_write (default), compression")
         ("testdir", bpo::value<sstring>()->default_value("/var/lib/scylla/perf-tests"), "directory in which to store the sstables");
 
     return app.run_deprecated(argc, argv, [&app] {
+        if (test_mode[app.configuration()["mode"].as<sstring>()] == test_modes::compression) {
+            auto data_size = size_t(app.configuration()["data_size_mb"].as<unsigned>()) << 20;
+            auto chunk_length = size_t(app.configuration()["chunk_length_kb"].as<unsigned>()) << 10;
+            auto dictionary_size_kb = app.configuration()["dictionary_size_kb"].as<unsigned>();
+            auto iterations = app.configuration()["iterations"].as<unsigned>();
+            seastar::async([=] {
+                test_compression(data_size, chunk_length, dictionary_size_kb, iterations);
+            }).then([] {
+                return engine().exit(0);
+            }).or_terminate();
+            return;
+        }
+
         auto test = make_lw_shared<distributed<test_env>>();
 
         auto cfg = test_env::conf();
@@ -32,6 +32,7 @@
 #include "tests/cql_assertions.hh"
 
 #include "core/future-util.hh"
+#include "core/thread.hh"
 #include "transport/messages/result_message.hh"
 #include "cql3/query_processor.hh"
 
@@ -117,3 +118,42 @@ SEASTAR_TEST_CASE(test_execute_internal_update) {
         });
     });
 }
+
+SEASTAR_TEST_CASE(test_prepared_statements_cache_eviction) {
+    return do_with_cql_env([] (auto& e) {
+        return seastar::async([&e] {
+            auto& qp = e.local_qp();
+            auto p1 = qp.prepare_internal("select * from system.local;");
+            auto p2 = qp.prepare_internal("select * from system.peers;");
+            auto p3 = qp.prepare_internal("select * from system.size_estimates;");
+
+            cql3::prepared_statements_cache<int32_t> cache(250);
+            cache.insert(1, p1, 100);
+            cache.insert(2, p2, 100);
+            BOOST_REQUIRE_EQUAL(cache.size(), 2);
+            BOOST_REQUIRE_EQUAL(cache.memory_usage(), 200);
+
+            // Using 1 makes 2 the least recently used statement.
+            BOOST_REQUIRE(cache.get(1) == p1);
+            cache.insert(3, p3, 100);
+            BOOST_REQUIRE_EQUAL(cache.size(), 2);
+            BOOST_REQUIRE(!cache.get(2));
+            BOOST_REQUIRE(cache.get(1) == p1);
+            BOOST_REQUIRE(cache.get(3) == p3);
+            BOOST_REQUIRE_EQUAL(cache.get_stats().evictions, 1);
+            BOOST_REQUIRE_EQUAL(cache.get_stats().hits, 3);
+            BOOST_REQUIRE_EQUAL(cache.get_stats().misses, 1);
+
+            // Lookups on the prepare path are not counted.
+            BOOST_REQUIRE(cache.find(3) == p3);
+            BOOST_REQUIRE(!cache.find(2));
+            BOOST_REQUIRE_EQUAL(cache.get_stats().hits, 3);
+            BOOST_REQUIRE_EQUAL(cache.get_stats().misses, 1);
+
+            cache.remove_if([&p1] (auto& p) { return p == p1; });
+            BOOST_REQUIRE(!cache.get(1));
+            BOOST_REQUIRE_EQUAL(cache.size(), 1);
+            BOOST_REQUIRE_EQUAL(cache.memory_usage(), 100);
+        });
+    });
+}
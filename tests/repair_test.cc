@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <limits>
+
+#include <seastar/core/thread.hh>
+#include <seastar/tests/test-utils.hh>
+
+#include "tests/cql_test_env.hh"
+
+#include "database.hh"
+#include "frozen_mutation.hh"
+#include "repair/repair.hh"
+#include "repair/repair_concurrency.hh"
+#include "service/storage_proxy.hh"
+
+#include "disk-error-handler.hh"
+
+thread_local disk_error_signal_type commit_error;
+thread_local disk_error_signal_type general_disk_error;
+
+static const repair_checksum checksum_types[] = { repair_checksum::legacy, repair_checksum::streamed };
+
+static partition_checksum checksum_of(cql_test_env& e, const sstring& cf, repair_checksum rt) {
+    sstring ks = "ks";
+    auto range = ::range<dht::token>::make_open_ended_both_sides();
+    return checksum_range(e.db(), ks, cf, range, rt).get0();
+}
+
+static void flush(cql_test_env& e, const sstring& cf) {
+    e.db().invoke_on_all([cf] (database& db) {
+        return db.find_column_family("ks", cf).flush();
+    }).get();
+}
+
+static void require_same_checksums(cql_test_env& e, bool same) {
+    for (auto rt : checksum_types) {
+        BOOST_REQUIRE_EQUAL(checksum_of(e, "t1", rt) == checksum_of(e, "t2", rt), same);
+    }
+}
+
+// Checksums depend on the data only, not on how it is split between
+// memtables and sstables.
+SEASTAR_TEST_CASE(test_checksum_range) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            e.execute_cql("create table t1 (p int, c int, v int, primary key (p, c));").get();
+            e.execute_cql("create table t2 (p int, c int, v int, primary key (p, c));").get();
+            auto insert = [&e] (const sstring& cf, int p, int c) {
+                e.execute_cql(sprint("insert into %s (p, c, v) values (%d, %d, %d) using timestamp 1;", cf, p, c, p * c)).get();
+            };
+            for (int p = 0; p < 4; ++p) {
+                for (int c = 0; c < 4; ++c) {
+                    insert("t1", p, c);
+                }
+            }
+            // The same partitions spread over two sstables and the memtable,
+            // with some rows in more than one of them.
+            for (int p = 0; p < 4; ++p) {
+                insert("t2", p, 0);
+                insert("t2", p, 1);
+            }
+            flush(e, "t2");
+            for (int p = 0; p < 4; ++p) {
+                insert("t2", p, 1);
+                insert("t2", p, 2);
+            }
+            flush(e, "t2");
+            for (int p = 0; p < 4; ++p) {
+                insert("t2", p, 3);
+            }
+            for (auto rt : checksum_types) {
+                BOOST_REQUIRE(checksum_of(e, "t1", rt) != partition_checksum());
+            }
+            require_same_checksums(e, true);
+
+            // The algorithms disagree on the same data, which is why the
+            // streamed one is only used once the whole cluster supports it.
+            BOOST_REQUIRE(checksum_of(e, "t1", repair_checksum::legacy) != checksum_of(e, "t1", repair_checksum::streamed));
+
+            // One cell
+            e.execute_cql("update t2 using timestamp 2 set v = 100 where p = 1 and c = 1;").get();
+            require_same_checksums(e, false);
+            e.execute_cql("update t1 using timestamp 2 set v = 100 where p = 1 and c = 1;").get();
+            require_same_checksums(e, true);
+
+            // One row tombstone
+            e.execute_cql("delete from t1 using timestamp 3 where p = 2 and c = 2;").get();
+            require_same_checksums(e, false);
+            e.execute_cql("delete from t2 using timestamp 3 where p = 2 and c = 2;").get();
+            require_same_checksums(e, true);
+
+            // The timestamp of one tombstone
+            e.execute_cql("delete from t1 using timestamp 4 where p = 3 and c = 0;").get();
+            e.execute_cql("delete from t2 using timestamp 5 where p = 3 and c = 0;").get();
+            require_same_checksums(e, false);
+        });
+    });
+}
+
+static std::vector<repair_row_hash> row_hashes_of(cql_test_env& e, const sstring& cf) {
+    sstring ks = "ks";
+    auto range = ::range<dht::token>::make_open_ended_both_sides();
+    auto page = repair_row_hashes(e.db(), ks, cf, range, 1000).get0();
+    BOOST_REQUIRE(page.complete);
+    return std::move(page.hashes);
+}
+
+static std::vector<mutation> rows_of(cql_test_env& e, const sstring& cf, const std::vector<repair_row_id>& ids) {
+    sstring ks = "ks";
+    auto range = ::range<dht::token>::make_open_ended_both_sides();
+    auto s = e.local_db().find_schema("ks", cf);
+    std::vector<mutation> result;
+    for (auto&& fm : repair_get_rows(e.db(), ks, cf, range, ids).get0()) {
+        result.push_back(fm.unfreeze(s));
+    }
+    return result;
+}
+
+// Applies rows read from one table to another one with the same columns.
+static void apply_rows(cql_test_env& e, const sstring& cf, const std::vector<mutation>& rows) {
+    auto s = e.local_db().find_schema("ks", cf);
+    for (auto&& m : rows) {
+        mutation target(m.decorated_key(), s);
+        target.partition().apply(*s, m.partition(), *m.schema());
+        service::get_local_storage_proxy().mutate_locally(target).get();
+    }
+}
+
+// Only the rows which differ between replicas are transferred.
+SEASTAR_TEST_CASE(test_row_level_repair) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            for (auto cf : { "t1", "t2" }) {
+                e.execute_cql(sprint("create table %s (p int, c1 int, c2 int, v int, primary key (p, c1, c2));", cf)).get();
+                for (int p = 0; p < 4; ++p) {
+                    for (int c = 0; c < 4; ++c) {
+                        e.execute_cql(sprint("insert into %s (p, c1, c2, v) values (%d, %d, %d, %d) using timestamp 1;",
+                                cf, p, c / 2, c % 2, p * c)).get();
+                    }
+                }
+            }
+            flush(e, "t2");
+            require_same_checksums(e, true);
+            BOOST_REQUIRE_EQUAL(row_hashes_of(e, "t1").size(), 16);
+
+            // One row, one deleted cell and one range tombstone.
+            e.execute_cql("insert into t1 (p, c1, c2, v) values (0, 5, 5, 1) using timestamp 1;").get();
+            e.execute_cql("delete v from t2 using timestamp 2 where p = 1 and c1 = 0 and c2 = 0;").get();
+            e.execute_cql("delete from t1 using timestamp 2 where p = 2 and c1 = 1;").get();
+            require_same_checksums(e, false);
+
+            auto h1 = row_hashes_of(e, "t1");
+            auto h2 = row_hashes_of(e, "t2");
+            std::unordered_map<repair_row_id, std::array<uint64_t, 2>, repair_row_id_hash> hashes2;
+            for (auto&& rh : h2) {
+                hashes2.emplace(rh.id, rh.hash);
+            }
+            std::vector<repair_row_id> differing;
+            for (auto&& rh : h1) {
+                auto it = hashes2.find(rh.id);
+                if (it == hashes2.end() || it->second != rh.hash) {
+                    differing.push_back(rh.id);
+                }
+            }
+            // The rows of t1, the row with the deleted cell and the range
+            // tombstone of partition 2, hashed as a row of it.
+            BOOST_REQUIRE_EQUAL(differing.size(), 3);
+
+            auto rows1 = rows_of(e, "t1", differing);
+            auto rows2 = rows_of(e, "t2", differing);
+            size_t clustering_rows = 0;
+            size_t range_tombstones = 0;
+            for (auto&& m : rows1) {
+                clustering_rows += m.partition().clustered_rows().calculate_size();
+                range_tombstones += m.partition().row_tombstones().size();
+            }
+            BOOST_REQUIRE_EQUAL(clustering_rows, 2);
+            BOOST_REQUIRE_EQUAL(range_tombstones, 1);
+            // t2 has no partition-level data in partition 2.
+            BOOST_REQUIRE_EQUAL(rows2.size(), 1);
+            BOOST_REQUIRE_EQUAL(rows2[0].partition().clustered_rows().calculate_size(), 1);
+
+            apply_rows(e, "t2", rows1);
+            apply_rows(e, "t1", rows2);
+            require_same_checksums(e, true);
+        });
+    });
+}
+
+// Row hashes are paged at token boundaries, and a token whose rows do not
+// fit in a page is reported on its own.
+SEASTAR_TEST_CASE(test_row_hashes_paging) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            e.execute_cql("create table t1 (p int, c int, v int, primary key (p, c));").get();
+            for (int p = 0; p < 20; ++p) {
+                e.execute_cql(sprint("insert into t1 (p, c, v) values (%d, 0, 0);", p)).get();
+            }
+            for (int c = 0; c < 10; ++c) {
+                e.execute_cql(sprint("insert into t1 (p, c, v) values (100, %d, 0);", c)).get();
+            }
+            auto all = row_hashes_of(e, "t1");
+            BOOST_REQUIRE_EQUAL(all.size(), 30);
+
+            auto s = e.local_db().find_schema("ks", "t1");
+            auto wide = dht::global_partitioner().decorate_key(*s,
+                    partition_key::from_single_value(*s, int32_type->decompose(100))).token();
+            using token_range = ::range<dht::token>;
+            sstring ks = "ks";
+            sstring cf = "t1";
+            auto remaining = token_range::make_open_ended_both_sides();
+            size_t hashes = 0;
+            size_t overflows = 0;
+            for (;;) {
+                auto page = repair_row_hashes(e.db(), ks, cf, remaining, 5).get0();
+                BOOST_REQUIRE_LE(page.hashes.size(), 5);
+                hashes += page.hashes.size();
+                if (page.overflow) {
+                    BOOST_REQUIRE(page.hashes.empty());
+                    BOOST_REQUIRE(*page.last_token == wide);
+                    ++overflows;
+                }
+                if (page.complete) {
+                    break;
+                }
+                BOOST_REQUIRE(page.last_token);
+                remaining = token_range(token_range::bound(*page.last_token, false), remaining.end());
+            }
+            BOOST_REQUIRE_EQUAL(overflows, 1);
+            BOOST_REQUIRE_EQUAL(hashes, 20);
+        });
+    });
+}
+
+// Ranges wait while those in flight use up the memory budget, except that
+// one is always let through.
+SEASTAR_TEST_CASE(test_repair_concurrency_memory) {
+    return seastar::async([] {
+        repair_concurrency_limiter limiter(1000);
+        auto f1 = limiter.wait(400);
+        auto f2 = limiter.wait(400);
+        auto f3 = limiter.wait(400);
+        BOOST_REQUIRE(f1.available() && f2.available());
+        BOOST_REQUIRE(!f3.available());
+        BOOST_REQUIRE_EQUAL(limiter.waiters(), 1);
+        limiter.signal(400);
+        BOOST_REQUIRE(f3.available());
+        BOOST_REQUIRE_EQUAL(limiter.waiters(), 0);
+        limiter.signal(400);
+        limiter.signal(400);
+        BOOST_REQUIRE_EQUAL(limiter.active(), 0);
+
+        auto large = limiter.wait(5000);
+        BOOST_REQUIRE(large.available());
+        auto small = limiter.wait(1);
+        BOOST_REQUIRE(!small.available());
+        limiter.signal(5000);
+        BOOST_REQUIRE(small.available());
+        limiter.signal(1);
+    });
+}
+
+// Runs a round of as many ranges as the limit, which all complete after
+// the given time, and returns the new limit.
+static unsigned run_round(repair_concurrency_limiter& limiter,
+        repair_concurrency_limiter::clock_type::time_point& now,
+        std::chrono::milliseconds duration) {
+    auto ranges = limiter.limit();
+    for (unsigned i = 0; i < ranges; ++i) {
+        BOOST_REQUIRE(limiter.wait(0, now).available());
+    }
+    now += duration;
+    for (unsigned i = 0; i < ranges; ++i) {
+        limiter.signal(0, now);
+    }
+    BOOST_REQUIRE_EQUAL(limiter.active(), 0);
+    return limiter.limit();
+}
+
+// The limit moves while that increases the throughput, turns back when it
+// decreases it and goes down when it makes no difference.
+SEASTAR_TEST_CASE(test_repair_concurrency_throughput) {
+    return seastar::async([] {
+        using namespace std::chrono_literals;
+        auto now = repair_concurrency_limiter::clock_type::now();
+        {
+            repair_concurrency_limiter limiter(std::numeric_limits<size_t>::max());
+            BOOST_REQUIRE_EQUAL(limiter.limit(), initial_repair_parallelism);
+            // 100 ranges per second, then 112, then 63
+            BOOST_REQUIRE_EQUAL(run_round(limiter, now, 1s), 112);
+            BOOST_REQUIRE_EQUAL(run_round(limiter, now, 1s), 126);
+            BOOST_REQUIRE_EQUAL(run_round(limiter, now, 2s), 111);
+            // Going down helped, so it keeps going down.
+            BOOST_REQUIRE_EQUAL(run_round(limiter, now, 1s), 98);
+        }
+        {
+            repair_concurrency_limiter limiter(std::numeric_limits<size_t>::max());
+            BOOST_REQUIRE_EQUAL(run_round(limiter, now, 1s), 112);
+            // Still 100 ranges per second
+            BOOST_REQUIRE_EQUAL(run_round(limiter, now, 1120ms), 98);
+        }
+    });
+}
@@ -1274,3 +1274,122 @@ SEASTAR_TEST_CASE(test_slicing_mutation_reader) {
         }
     });
 }
+
+SEASTAR_TEST_CASE(test_partial_population_of_wide_partition) {
+    return seastar::async([] {
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", int32_type, column_kind::partition_key)
+            .with_column("ck", int32_type, column_kind::clustering_key)
+            .with_column("v", int32_type)
+            .build();
+
+        auto pk = partition_key::from_exploded(*s, { int32_type->decompose(0) });
+        auto dk = dht::global_partitioner().decorate_key(*s, pk);
+        auto ck = [&] (int i) {
+            return clustering_key_prefix::from_single_value(*s, int32_type->decompose(i));
+        };
+        mutation m(pk, s);
+        constexpr auto row_count = 3 * cache_entry::max_rows_per_range;
+        for (auto i = 0; i < int(row_count); i++) {
+            m.set_clustered_cell(ck(i), to_bytes("v"), data_value(i), api::new_timestamp());
+        }
+
+        auto mt = make_lw_shared<memtable>(s);
+        mt->apply(m);
+
+        int secondary_calls_count = 0;
+        cache_tracker tracker;
+        row_cache cache(s, mutation_source([&] (schema_ptr s, const query::partition_range& range,
+                                                query::clustering_key_filtering_context ck_filtering) {
+            ++secondary_calls_count;
+            return mt->as_data_source()(s, range, ck_filtering, default_priority_class());
+        }), mt->as_key_source(), tracker);
+
+        auto pr = query::partition_range::make_singular(dk);
+        auto read = [&] (int start, int end) {
+            auto ps = partition_slice_builder(*s)
+                .with_range(query::clustering_range(query::clustering_range::bound(ck(start)), query::clustering_range::bound(ck(end))))
+                .build();
+            std::deque<int> expected;
+            for (auto i = start; i <= end; i++) {
+                expected.push_back(i);
+            }
+            auto ck_filtering = query::clustering_key_filtering_context::create(s, ps);
+            test_sliced_read_row_presence(cache.make_reader(s, pr, ck_filtering), s, ps, expected);
+        };
+
+        read(10, 20);
+        BOOST_REQUIRE_EQUAL(secondary_calls_count, 1);
+        BOOST_REQUIRE_EQUAL(tracker.row_misses(), 11u);
+        BOOST_REQUIRE_EQUAL(tracker.row_hits(), 0u);
+
+        read(12, 18);
+        BOOST_REQUIRE_EQUAL(secondary_calls_count, 1);
+        BOOST_REQUIRE_EQUAL(tracker.row_hits(), 7u);
+
+        // Only the part which is not cached yet goes to the underlying source.
+        read(15, 25);
+        BOOST_REQUIRE_EQUAL(secondary_calls_count, 2);
+        BOOST_REQUIRE_EQUAL(tracker.row_misses(), 16u);
+
+        read(10, 25);
+        BOOST_REQUIRE_EQUAL(secondary_calls_count, 2);
+
+        // Full partition read makes the entry complete.
+        assert_that(cache.make_reader(s, pr))
+            .produces(m)
+            .produces_end_of_stream();
+        BOOST_REQUIRE_EQUAL(secondary_calls_count, 3);
+        read(100, 300);
+        BOOST_REQUIRE_EQUAL(secondary_calls_count, 3);
+    });
+}
+
+SEASTAR_TEST_CASE(test_eviction_of_cached_ranges) {
+    return seastar::async([] {
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", int32_type, column_kind::partition_key)
+            .with_column("ck", int32_type, column_kind::clustering_key)
+            .with_column("v", int32_type)
+            .build();
+
+        auto pk = partition_key::from_exploded(*s, { int32_type->decompose(0) });
+        auto dk = dht::global_partitioner().decorate_key(*s, pk);
+        auto ck = [&] (int i) {
+            return clustering_key_prefix::from_single_value(*s, int32_type->decompose(i));
+        };
+        mutation m(pk, s);
+        constexpr auto row_count = 4 * cache_entry::max_rows_per_range;
+        for (auto i = 0; i < int(row_count); i++) {
+            m.set_clustered_cell(ck(i), to_bytes("v"), data_value(i), api::new_timestamp());
+        }
+
+        auto mt = make_lw_shared<memtable>(s);
+        mt->apply(m);
+
+        cache_tracker tracker;
+        row_cache cache(s, mt->as_data_source(), mt->as_key_source(), tracker);
+
+        auto pr = query::partition_range::make_singular(dk);
+        auto ps = partition_slice_builder(*s)
+            .with_range(query::clustering_range(query::clustering_range::bound(ck(0)), query::clustering_range::bound(ck(row_count - 1))))
+            .build();
+        auto ck_filtering = query::clustering_key_filtering_context::create(s, ps);
+        assert_that(cache.make_reader(s, pr, ck_filtering))
+            .produces(m)
+            .produces_end_of_stream();
+        BOOST_REQUIRE_EQUAL(tracker.partitions(), 1u);
+
+        while (tracker.partitions() > 0) {
+            logalloc::shard_tracker().reclaim(std::numeric_limits<size_t>::max());
+        }
+
+        // Ranges are evicted before the partition which owns them.
+        BOOST_REQUIRE_EQUAL(tracker.row_evictions(), row_count);
+        BOOST_REQUIRE_EQUAL(tracker.partitions(), 0u);
+
+        assert_that(cache.make_reader(s, pr, ck_filtering))
+            .produces(m)
+            .produces_end_of_stream();
+    });
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2016 ScyllaDB
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "tests/test-utils.hh"
+#include "tests/cql_test_env.hh"
+#include "tests/cql_assertions.hh"
+
+#include "core/sleep.hh"
+#include "core/thread.hh"
+#include "db/system_keyspace.hh"
+#include "db/index/secondary_index.hh"
+
+#include "disk-error-handler.hh"
+
+thread_local disk_error_signal_type commit_error;
+thread_local disk_error_signal_type general_disk_error;
+
+static void wait_for_index(const sstring& index_name) {
+    while (!db::system_keyspace::is_index_built("ks", index_name).get0()) {
+        sleep(std::chrono::milliseconds(10)).get();
+    }
+}
+
+SEASTAR_TEST_CASE(test_index_schema) {
+    return seastar::async([] {
+        auto base = schema_builder("ks", "cf")
+                .with_column("partition_key", int32_type, column_kind::partition_key)
+                .with_column("ck", utf8_type, column_kind::clustering_key)
+                .with_column("v", int32_type)
+                .build();
+        auto cdef = *base->get_column_definition("v");
+        cdef.idx_info.index_name = sstring("v_idx");
+        auto index_schema = db::index::make_index_schema(*base, cdef);
+        BOOST_REQUIRE_EQUAL(index_schema->cf_name(), "v_idx_index");
+        BOOST_REQUIRE_EQUAL(index_schema->partition_key_size(), 1);
+        BOOST_REQUIRE_EQUAL(index_schema->clustering_key_size(), 2);
+        // The base partition key column is renamed so as not to clash.
+        BOOST_REQUIRE(index_schema->get_column_definition("_partition_key"));
+        BOOST_REQUIRE_EQUAL(index_schema->regular_columns_count(), 1);
+        BOOST_REQUIRE(db::index::index_timestamp_column(*index_schema).name_as_text() == "timestamp");
+        BOOST_REQUIRE(*db::index::index_name_of_table("v_idx_index") == "v_idx");
+        BOOST_REQUIRE(!db::index::index_name_of_table("cf"));
+
+        auto pk = partition_key::from_single_value(*base, int32_type->decompose(7));
+        auto ck = clustering_key::from_single_value(*base, utf8_type->decompose(sstring("a")));
+        auto index_ck = db::index::make_index_clustering_key(*index_schema, *base, pk, ck);
+        auto keys = db::index::base_key_of_index_entry(*base, *index_schema, index_ck);
+        BOOST_REQUIRE(keys.first.equal(*base, pk));
+        BOOST_REQUIRE(keys.second.equal(*base, ck));
+    });
+}
+
+SEASTAR_TEST_CASE(test_index_build_and_query) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            e.execute_cql("create table cf (p int, c int, v int, w text, primary key (p, c));").get();
+            e.execute_cql("insert into cf (p, c, v, w) values (1, 1, 10, 'a');").get();
+            e.execute_cql("insert into cf (p, c, v, w) values (1, 2, 20, 'b');").get();
+            e.execute_cql("insert into cf (p, c, v, w) values (2, 1, 10, 'c');").get();
+
+            // Existing rows are picked up by the build.
+            e.execute_cql("create index v_idx on cf (v);").get();
+            wait_for_index("v_idx");
+            auto msg = e.execute_cql("select p, c, w from cf where v = 10;").get0();
+            assert_that(msg).is_rows().with_size(2);
+            msg = e.execute_cql("select w from cf where v = 20;").get0();
+            assert_that(msg).is_rows().with_rows({{utf8_type->decompose(sstring("b"))}});
+
+            // New writes are indexed as they happen.
+            e.execute_cql("insert into cf (p, c, v, w) values (3, 1, 20, 'd');").get();
+            msg = e.execute_cql("select w from cf where v = 20;").get0();
+            assert_that(msg).is_rows().with_size(2);
+            msg = e.execute_cql("select w from cf where v = 20 limit 1;").get0();
+            assert_that(msg).is_rows().with_size(1);
+
+            // Overwritten values are no longer found.
+            e.execute_cql("update cf set v = 30 where p = 1 and c = 2;").get();
+            msg = e.execute_cql("select w from cf where v = 20;").get0();
+            assert_that(msg).is_rows().with_rows({{utf8_type->decompose(sstring("d"))}});
+            msg = e.execute_cql("select w from cf where v = 30;").get0();
+            assert_that(msg).is_rows().with_rows({{utf8_type->decompose(sstring("b"))}});
+            // Reading again after the stale entry was removed.
+            msg = e.execute_cql("select w from cf where v = 20;").get0();
+            assert_that(msg).is_rows().with_size(1);
+
+            e.execute_cql("delete from cf where p = 2 and c = 1;").get();
+            msg = e.execute_cql("select w from cf where v = 10;").get0();
+            assert_that(msg).is_rows().with_rows({{utf8_type->decompose(sstring("a"))}});
+
+            msg = e.execute_cql("select w from cf where v = 40;").get0();
+            assert_that(msg).is_rows().is_empty();
+        });
+    });
+}
+
+SEASTAR_TEST_CASE(test_index_entries_of_deleted_rows_are_removed) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            e.execute_cql("create table cf (p int, c int, v int, primary key (p, c));").get();
+            e.execute_cql("create index v_idx on cf (v);").get();
+            wait_for_index("v_idx");
+            e.execute_cql("insert into cf (p, c, v) values (1, 1, 10);").get();
+            e.execute_cql("insert into cf (p, c, v) values (1, 2, 10);").get();
+            e.execute_cql("insert into cf (p, c, v) values (2, 1, 10);").get();
+            e.execute_cql("insert into cf (p, c, v) values (3, 1, 10);").get();
+
+            e.execute_cql("delete from cf where p = 1 and c = 1;").get();
+            e.execute_cql("delete v from cf where p = 1 and c = 2;").get();
+            e.execute_cql("delete from cf where p = 2;").get();
+            auto msg = e.execute_cql("select p from cf where v = 10;").get0();
+            assert_that(msg).is_rows().with_rows({{int32_type->decompose(3)}});
+
+            // The entries of the deleted row, cell and partition are gone.
+            msg = e.execute_cql("select * from v_idx_index where v = 10;").get0();
+            assert_that(msg).is_rows().with_size(1);
+
+            // A newer write of a deleted row is indexed again.
+            e.execute_cql("insert into cf (p, c, v) values (2, 1, 10);").get();
+            msg = e.execute_cql("select p from cf where v = 10;").get0();
+            assert_that(msg).is_rows().with_size(2);
+        });
+    });
+}
+
+SEASTAR_TEST_CASE(test_drop_index) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            e.execute_cql("create table cf (p int, c int, v int, primary key (p, c));").get();
+            e.execute_cql("create index v_idx on cf (v);").get();
+            wait_for_index("v_idx");
+            e.execute_cql("insert into cf (p, c, v) values (1, 1, 10);").get();
+
+            e.execute_cql("drop index v_idx;").get();
+            BOOST_REQUIRE(!e.local_db().has_schema("ks", "v_idx_index"));
+            BOOST_REQUIRE(!e.local_db().find_schema("ks", "cf")->get_column_definition("v")->is_indexed());
+            BOOST_REQUIRE_THROW(e.execute_cql("select p from cf where v = 10;").get(), exceptions::invalid_request_exception);
+            BOOST_REQUIRE_THROW(e.execute_cql("drop index v_idx;").get(), exceptions::invalid_request_exception);
+            e.execute_cql("drop index if exists v_idx;").get();
+            while (db::system_keyspace::is_index_built("ks", "v_idx").get0()) {
+                sleep(std::chrono::milliseconds(10)).get();
+            }
+
+            // A new index of the same name is built from scratch.
+            e.execute_cql("create index v_idx on cf (v);").get();
+            wait_for_index("v_idx");
+            auto msg = e.execute_cql("select p from cf where v = 10;").get0();
+            assert_that(msg).is_rows().with_rows({{int32_type->decompose(1)}});
+        });
+    });
+}
+
+SEASTAR_TEST_CASE(test_index_without_clustering_key) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            e.execute_cql("create table cf (p int primary key, v text);").get();
+            e.execute_cql("create index on cf (v);").get();
+            wait_for_index("cf_v_idx");
+            e.execute_cql("insert into cf (p, v) values (1, 'x');").get();
+            e.execute_cql("insert into cf (p, v) values (2, 'y');").get();
+            auto msg = e.execute_cql("select p from cf where v = 'x';").get0();
+            assert_that(msg).is_rows().with_rows({{int32_type->decompose(1)}});
+        });
+    });
+}
+
+SEASTAR_TEST_CASE(test_index_validation) {
+    return do_with_cql_env([] (cql_test_env& e) {
+        return seastar::async([&e] {
+            e.execute_cql("create table cf (p int, c int, v int, w int, s set<int>, primary key (p, c));").get();
+            BOOST_REQUIRE_THROW(e.execute_cql("create index on cf (s);").get(), exceptions::invalid_request_exception);
+            BOOST_REQUIRE_THROW(e.execute_cql("create index on cf (c);").get(), exceptions::invalid_request_exception);
+            e.execute_cql("create index v_idx on cf (v);").get();
+            BOOST_REQUIRE_THROW(e.execute_cql("create index v_idx on cf (w);").get(), exceptions::invalid_request_exception);
+            BOOST_REQUIRE_THROW(e.execute_cql("select * from cf where w = 1;").get(), exceptions::invalid_request_exception);
+            BOOST_REQUIRE_THROW(e.execute_cql("select * from cf where v = 1 and w = 1 allow filtering;").get(),
+                                exceptions::invalid_request_exception);
+
+            // Dropping the indexed column drops the index table.
+            e.execute_cql("alter table cf drop v;").get();
+            BOOST_REQUIRE(!e.local_db().has_schema("ks", "v_idx_index"));
+        });
+    });
+}
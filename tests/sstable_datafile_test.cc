@@ -31,6 +31,7 @@
 #include "schema_builder.hh"
 #include "database.hh"
 #include "sstables/leveled_manifest.hh"
+#include "sstables/sstable_set.hh"
 #include <memory>
 #include "sstable_test.hh"
 #include "core/seastar.hh"
@@ -869,7 +870,7 @@ SEASTAR_TEST_CASE(datafile_generation_12) {
     });
 }
 
-static future<> sstable_compression_test(compressor c, unsigned generation) {
+static future<> sstable_compression_test(compression_parameters c, unsigned generation) {
     return test_setup::do_with_test_directory([c, generation] {
         // NOTE: set a given compressor algorithm to schema.
         schema_builder builder(complex_schema());
@@ -918,6 +919,68 @@ SEASTAR_TEST_CASE(datafile_generation_15) {
     return sstable_compression_test(compressor::deflate, 15);
 }
 
+SEASTAR_TEST_CASE(datafile_generation_58) {
+    return sstable_compression_test(compression_parameters({
+        { sstring(compression_parameters::SSTABLE_COMPRESSION), "ZstdCompressor" },
+    }), 58);
+}
+
+SEASTAR_TEST_CASE(datafile_generation_59) {
+    // Too little data to train a dictionary from, so the sstable is written
+    // with an empty one.
+    return sstable_compression_test(compression_parameters({
+        { sstring(compression_parameters::SSTABLE_COMPRESSION), "ZstdCompressor" },
+        { sstring(compression_parameters::DICTIONARY_SIZE_KB), "4" },
+    }), 59);
+}
+
+SEASTAR_TEST_CASE(zstd_dictionary_compression) {
+    return test_setup::do_with_test_directory([] {
+        return seastar::async([] {
+            schema_builder builder(make_lw_shared(schema({}, some_keyspace, some_column_family,
+                {{"p1", utf8_type}}, {{"c1", utf8_type}}, {{"r1", utf8_type}}, {}, utf8_type)));
+            builder.set_compressor_params(compression_parameters({
+                { sstring(compression_parameters::SSTABLE_COMPRESSION), "ZstdCompressor" },
+                { sstring(compression_parameters::DICTIONARY_SIZE_KB), "4" },
+            }));
+            auto s = builder.build(schema_builder::compact_storage::no);
+            const column_definition& r1_col = *s->get_column_definition("r1");
+            auto c_key = clustering_key::from_exploded(*s, {to_bytes("c1")});
+            auto value_of = [] (const sstring& key) {
+                return to_bytes(sprint("{\"id\":\"%s\",\"name\":\"user-%s\",\"status\":\"active\",\"tags\":[\"a\",\"b\"]}", key, key));
+            };
+
+            // Enough data for the writer to train the dictionary on 100
+            // times its size before the sstable ends.
+            const unsigned partitions = 5000;
+            auto mt = make_lw_shared<memtable>(s);
+            for (unsigned i = 0; i < partitions; ++i) {
+                auto key = "key" + to_sstring(i);
+                mutation m(partition_key::from_exploded(*s, {to_bytes(key)}), s);
+                m.set_clustered_cell(c_key, r1_col, make_atomic_cell(value_of(key)));
+                mt->apply(std::move(m));
+            }
+
+            auto sst = make_lw_shared<sstable>("ks", "cf", "tests/sstables/tests-temporary", 60, la, big);
+            sst->write_components(*mt).get();
+            BOOST_REQUIRE(file_size("tests/sstables/tests-temporary/la-60-big-CompressionDictionary.db").get0() > 0);
+
+            auto sstp = reusable_sst("tests/sstables/tests-temporary", 60).get0();
+            auto reader = sstable_reader(sstp, s);
+            unsigned read = 0;
+            while (auto sm = reader().get0()) {
+                auto m = mutation_from_streamed_mutation(std::move(sm)).get0();
+                auto key = value_cast<sstring>(utf8_type->deserialize(m->key().explode(*s)[0]));
+                auto row = m->partition().find_row(c_key);
+                BOOST_REQUIRE(row);
+                BOOST_REQUIRE(bytes(row->cell_at(r1_col.id).as_atomic_cell().value()) == value_of(key));
+                ++read;
+            }
+            BOOST_REQUIRE_EQUAL(read, partitions);
+        });
+    });
+}
+
 SEASTAR_TEST_CASE(datafile_generation_16) {
     return test_setup::do_with_test_directory([] {
         auto s = uncompressed_schema();
@@ -1059,6 +1122,56 @@ SEASTAR_TEST_CASE(compaction_manager_test) {
     });
 }
 
+SEASTAR_TEST_CASE(compaction_manager_drops_expired_sstables) {
+    BOOST_REQUIRE(smp::count == 1);
+    return seastar::async([] {
+        auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+            {{"p1", utf8_type}}, {{"c1", utf8_type}}, {{"r1", int32_type}}, {}, utf8_type));
+
+        auto cm = make_lw_shared<compaction_manager>();
+        cm->start();
+        auto tmp = make_lw_shared<tmpdir>();
+        column_family::config cfg;
+        cfg.datadir = tmp->path;
+        cfg.enable_commitlog = false;
+        cfg.enable_incremental_backups = false;
+        auto cf = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), *cm);
+        cf->start();
+        cf->mark_ready_for_writes();
+        cf->set_compaction_strategy(sstables::compaction_strategy_type::size_tiered);
+
+        const column_definition& r1_col = *s->get_column_definition("r1");
+        auto add_sstable = [&] (unsigned long generation, sstring k, uint32_t ttl, uint32_t expiration) {
+            auto mt = make_lw_shared<memtable>(s);
+            mutation m(partition_key::from_exploded(*s, {to_bytes(k)}), s);
+            auto c_key = clustering_key::from_exploded(*s, {to_bytes("abc")});
+            m.set_clustered_cell(c_key, r1_col, make_atomic_cell(int32_type->decompose(1), ttl, expiration));
+            mt->apply(std::move(m));
+            auto sst = make_lw_shared<sstable>("ks", "cf", tmp->path, generation, la, big);
+            sst->write_components(*mt).get();
+            sst->load().get();
+            column_family_test(cf).add_sstable(std::move(*sst));
+        };
+        // Expired long before gc_grace_seconds ago.
+        add_sstable(1, "key1", 1, 1);
+        add_sstable(2, "key2", 0, 0);
+
+        cf->trigger_compaction();
+        do_until([cm] { return cm->get_stats().active_tasks == 0 && cm->get_stats().pending_tasks == 0; }, [] {
+            return sleep(std::chrono::milliseconds(100));
+        }).get();
+
+        BOOST_REQUIRE_EQUAL(cm->get_stats().expired_sstables, 1);
+        BOOST_REQUIRE(cm->get_stats().bytes_reclaimed_by_expiry > 0);
+        BOOST_REQUIRE_EQUAL(cm->get_stats().errors, 0);
+        BOOST_REQUIRE_EQUAL(cf->sstables_count(), 1);
+        BOOST_REQUIRE_EQUAL((*cf->get_sstables()->begin())->generation(), 2);
+
+        cf->stop().get();
+        cm->stop().get();
+    });
+}
+
 SEASTAR_TEST_CASE(compact) {
     BOOST_REQUIRE(smp::count == 1);
     constexpr int generation = 17;
@@ -2023,6 +2136,39 @@ SEASTAR_TEST_CASE(leveled_07) {
     return make_ready_future<>();
 }
 
+SEASTAR_TEST_CASE(leveled_08) {
+    // Check that L0 is size-tiered when it falls behind, even if higher levels are fine.
+    auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+        {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
+
+    column_family::config cfg;
+    compaction_manager cm;
+    cfg.enable_disk_writes = false;
+    cfg.enable_commitlog = false;
+    auto cf = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), cm);
+    cf->mark_ready_for_writes();
+
+    auto key_and_token_pair = token_generation_for_current_shard(2);
+    auto min_key = key_and_token_pair[0].first;
+    auto max_key = key_and_token_pair[key_and_token_pair.size()-1].first;
+
+    auto max_sstable_size_in_mb = 1;
+    for (auto gen = 1; gen <= 40; gen++) {
+        add_sstable_for_leveled_test(cf, gen, /*data_size*/1024*1024, /*level*/0, min_key, max_key);
+    }
+
+    auto candidates = get_candidates_for_leveled_strategy(*cf);
+    leveled_manifest manifest = leveled_manifest::create(*cf, candidates, max_sstable_size_in_mb);
+    BOOST_REQUIRE(manifest.get_level_size(0) == 40);
+    auto candidate = manifest.get_compaction_candidates();
+    BOOST_REQUIRE(candidate.sstables.size() >= size_t(DEFAULT_MIN_COMPACTION_THRESHOLD));
+    BOOST_REQUIRE(candidate.sstables.size() <= size_t(DEFAULT_MAX_COMPACTION_THRESHOLD));
+    BOOST_REQUIRE(candidate.level == 0);
+    BOOST_REQUIRE(candidate.max_sstable_bytes == std::numeric_limits<uint64_t>::max());
+
+    return make_ready_future<>();
+}
+
 SEASTAR_TEST_CASE(check_overlapping) {
     auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
         {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
@@ -2051,6 +2197,62 @@ SEASTAR_TEST_CASE(check_overlapping) {
     return make_ready_future<>();
 }
 
+SEASTAR_TEST_CASE(check_sstable_set_select) {
+    auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+        {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
+
+    auto key_and_token_pair = token_generation_for_current_shard(4);
+    auto make_sstable = [] (int64_t gen, sstring first_key, sstring last_key) {
+        auto sst = make_lw_shared<sstable>("ks", "cf", "", gen, la, big);
+        sstables::test(sst).set_values(std::move(first_key), std::move(last_key), {});
+        return sst;
+    };
+    auto sst1 = make_sstable(1, key_and_token_pair[0].first, key_and_token_pair[1].first);
+    auto sst2 = make_sstable(2, key_and_token_pair[2].first, key_and_token_pair[3].first);
+    auto sst3 = make_sstable(3, key_and_token_pair[0].first, key_and_token_pair[3].first);
+
+    // Size-tiered uses the default set, leveled its own.
+    for (auto type : { sstables::compaction_strategy_type::size_tiered, sstables::compaction_strategy_type::leveled }) {
+        auto cs = sstables::make_compaction_strategy(type, s->compaction_strategy_options());
+        auto set = cs.make_sstable_set(s);
+        set.insert(sst3);
+        set.insert(sst2);
+        set.insert(sst1);
+
+        auto select = [&] (const query::partition_range& range) {
+            std::set<int64_t> generations;
+            for (auto&& sst : set.select(range)) {
+                generations.insert(sst->generation());
+            }
+            return generations;
+        };
+        auto key = [&] (unsigned i) {
+            return dht::global_partitioner().decorate_key(*s, partition_key::from_exploded(*s, {to_bytes(key_and_token_pair[i].first)}));
+        };
+
+        BOOST_REQUIRE(select(query::partition_range::make_singular(key(0))) == std::set<int64_t>({1, 3}));
+        BOOST_REQUIRE(select(query::partition_range::make_singular(key(2))) == std::set<int64_t>({2, 3}));
+        // Sstables are indexed by the tokens they span.
+        BOOST_REQUIRE(select(query::partition_range::make({key(1), false}, {key(2), false})) == std::set<int64_t>({1, 2, 3}));
+        auto between = query::partition_range::make({dht::ring_position::ending_at(key(1).token()), false},
+                                                    {dht::ring_position::starting_at(key(2).token()), false});
+        BOOST_REQUIRE(select(between) == std::set<int64_t>({3}));
+        BOOST_REQUIRE(select(query::partition_range::make_starting_with({key(3), true})) == std::set<int64_t>({2, 3}));
+        BOOST_REQUIRE(select(query::partition_range::make_open_ended_both_sides()) == std::set<int64_t>({1, 2, 3}));
+
+        // An sstable overlapping both halves of a wrap-around range is
+        // selected once.
+        auto wrapping = query::partition_range::make({key(3), false}, {key(0), true});
+        BOOST_REQUIRE_EQUAL(set.select(wrapping).size(), 3);
+
+        set.erase(sst3);
+        BOOST_REQUIRE(select(query::partition_range::make_singular(key(0))) == std::set<int64_t>({1}));
+        BOOST_REQUIRE(select(query::partition_range::make_singular(key(2))) == std::set<int64_t>({2}));
+    }
+
+    return make_ready_future<>();
+}
+
 static lw_shared_ptr<key_reader> prepare_key_reader(schema_ptr s,
     const std::vector<shared_sstable>& ssts, const query::partition_range& range)
 {
@@ -2222,6 +2424,44 @@ SEASTAR_TEST_CASE(check_read_indexes) {
     });
 }
 
+SEASTAR_TEST_CASE(check_index_cache) {
+    return seastar::async([] {
+        auto sst = make_lw_shared<sstable>("test", "summary_test", "tests/sstables/summary_test", 1,
+            sstables::sstable::version_types::ka, big);
+        sst->load().get();
+
+        auto& tracker = global_cache_tracker();
+        auto pages = tracker.index_pages();
+        auto stats = make_lw_shared<sstables::index_cache_stats>();
+        sst->set_index_cache_stats(stats);
+        auto list = sstables::test(sst).read_indexes(0).get0();
+        BOOST_REQUIRE_EQUAL(sst->index_cache_misses(), 1);
+        BOOST_REQUIRE_EQUAL(sst->index_cache_hits(), 0);
+        BOOST_REQUIRE_EQUAL(tracker.index_pages(), pages + 1);
+
+        auto cached = sstables::test(sst).read_indexes(0).get0();
+        BOOST_REQUIRE_EQUAL(sst->index_cache_hits(), 1);
+        BOOST_REQUIRE_EQUAL(cached.size(), list.size());
+        for (size_t i = 0; i < list.size(); ++i) {
+            BOOST_REQUIRE(cached[i].get_key_bytes() == list[i].get_key_bytes());
+            BOOST_REQUIRE_EQUAL(cached[i].position(), list[i].position());
+            BOOST_REQUIRE(cached[i].get_promoted_index_bytes() == list[i].get_promoted_index_bytes());
+        }
+
+        // Pages are evicted along with the rest of the cache.
+        tracker.clear();
+        BOOST_REQUIRE_EQUAL(tracker.index_pages(), 0);
+        sstables::test(sst).read_indexes(0).get();
+        BOOST_REQUIRE_EQUAL(sst->index_cache_misses(), 2);
+
+        sst = {};
+        BOOST_REQUIRE_EQUAL(tracker.index_pages(), 0);
+        // The shared counts outlive the sstable.
+        BOOST_REQUIRE_EQUAL(stats->hits, 1);
+        BOOST_REQUIRE_EQUAL(stats->misses, 2);
+    });
+}
+
 SEASTAR_TEST_CASE(tombstone_purge_test) {
     BOOST_REQUIRE(smp::count == 1);
     // In a column family with gc_grace_seconds set to 0, check that a tombstone
@@ -2798,3 +3038,182 @@ SEASTAR_TEST_CASE(basic_date_tiered_strategy_test) {
 
     return make_ready_future<>();
 }
+
+SEASTAR_TEST_CASE(basic_time_window_strategy_test) {
+    auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+        {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
+    compaction_manager cm;
+    column_family::config cfg;
+    auto cf = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), cm);
+
+    int64_t hour = 3600L * 1000000L;
+    auto no_deletion = std::numeric_limits<int32_t>::max();
+    std::vector<sstables::shared_sstable> candidates;
+    auto add_sstable = [&] (int64_t gen, int64_t min_timestamp, int64_t max_timestamp, int32_t max_local_deletion_time) {
+        auto sst = add_sstable_for_overlapping_test(cf, gen, "a", "a", build_stats(min_timestamp, max_timestamp, max_local_deletion_time));
+        sstables::test(sst).set_data_file_size(1024);
+        candidates.push_back(sst);
+    };
+    // Current window, not enough sstables for size-tiered compaction.
+    add_sstable(1, 10 * hour + 1, 10 * hour + 2, no_deletion);
+    add_sstable(2, 10 * hour + 3, 10 * hour + 4, no_deletion);
+    // A closed window with a single sstable is left alone.
+    add_sstable(3, 9 * hour + 1, 9 * hour + 2, no_deletion);
+    // A closed window with several sstables is compacted into one.
+    add_sstable(4, 8 * hour + 1, 8 * hour + 2, no_deletion);
+    add_sstable(5, 7 * hour + 1, 8 * hour + 3, no_deletion);
+    add_sstable(6, 8 * hour + 4, 8 * hour + 5, no_deletion);
+
+    auto cs = make_compaction_strategy(compaction_strategy_type::time_window, {{"compaction_window_unit", "HOURS"}});
+    auto descriptor = cs.get_sstables_for_compaction(*cf, candidates);
+    std::set<int64_t> generations;
+    for (auto& sst : descriptor.sstables) {
+        generations.insert(sst->generation());
+    }
+    BOOST_REQUIRE(generations == std::set<int64_t>({4, 5, 6}));
+    BOOST_REQUIRE_EQUAL(cs.estimated_pending_compactions(*cf), 1);
+
+    // Expired sstables holding no data older than the rest are dropped first.
+    add_sstable(7, 1, 2, 10);
+    descriptor = cs.get_sstables_for_compaction(*cf, candidates);
+    BOOST_REQUIRE_EQUAL(descriptor.sstables.size(), 1);
+    BOOST_REQUIRE_EQUAL(descriptor.sstables.front()->generation(), 7);
+
+    BOOST_REQUIRE_THROW(make_compaction_strategy(compaction_strategy_type::time_window, {{"compaction_window_unit", "WEEKS"}}),
+                        exceptions::configuration_exception);
+    BOOST_REQUIRE_THROW(make_compaction_strategy(compaction_strategy_type::time_window, {{"compaction_window_size", "0"}}),
+                        exceptions::configuration_exception);
+    BOOST_REQUIRE(compaction_strategy::type("TimeWindowCompactionStrategy") == compaction_strategy_type::time_window);
+
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_sstable_clustering_bounds) {
+    return test_setup::do_with_test_directory([] {
+        return seastar::async([] {
+            auto s = schema_builder(some_keyspace, some_column_family)
+                    .with_column("p1", utf8_type, column_kind::partition_key)
+                    .with_column("c1", int32_type, column_kind::clustering_key)
+                    .with_column("c2", int32_type, column_kind::clustering_key)
+                    .with_column("r1", int32_type)
+                    .build();
+            auto mt = make_lw_shared<memtable>(s);
+            for (auto p : {"key1", "key2"}) {
+                mutation m(partition_key::from_exploded(*s, {to_bytes(p)}), s);
+                for (auto c : {std::make_pair(10, 5), std::make_pair(20, 1), std::make_pair(15, 9)}) {
+                    auto ck = clustering_key::from_exploded(*s, {int32_type->decompose(c.first), int32_type->decompose(c.second)});
+                    m.set_clustered_cell(ck, *s->get_column_definition("r1"), make_atomic_cell(int32_type->decompose(1)));
+                }
+                mt->apply(std::move(m));
+            }
+            auto sst = make_lw_shared<sstable>("ks", "cf", "tests/sstables/tests-temporary", 57, la, big);
+            sst->write_components(*mt).get();
+            sst = reusable_sst("tests/sstables/tests-temporary", 57).get0();
+
+            auto& stats = sst->get_stats_metadata();
+            BOOST_REQUIRE_EQUAL(stats.min_column_names.elements.size(), 2);
+            BOOST_REQUIRE(stats.min_column_names.elements[0].value == int32_type->decompose(10));
+            BOOST_REQUIRE(stats.min_column_names.elements[1].value == int32_type->decompose(1));
+            BOOST_REQUIRE(stats.max_column_names.elements[0].value == int32_type->decompose(20));
+            BOOST_REQUIRE(stats.max_column_names.elements[1].value == int32_type->decompose(9));
+
+            auto prefix = [&] (std::vector<int32_t> values) {
+                std::vector<bytes> components;
+                for (auto v : values) {
+                    components.push_back(int32_type->decompose(v));
+                }
+                return clustering_key_prefix::from_exploded(*s, std::move(components));
+            };
+            auto may_contain = [&] (query::clustering_range range) {
+                return sst->may_contain_rows(*s, {std::move(range)});
+            };
+            BOOST_REQUIRE(may_contain(query::clustering_range::make_open_ended_both_sides()));
+            BOOST_REQUIRE(may_contain(query::clustering_range::make_singular(prefix({15}))));
+            BOOST_REQUIRE(may_contain(query::clustering_range::make({prefix({0})}, {prefix({10})})));
+            BOOST_REQUIRE(!may_contain(query::clustering_range::make_singular(prefix({21}))));
+            BOOST_REQUIRE(!may_contain(query::clustering_range::make_starting_with({prefix({25})})));
+            BOOST_REQUIRE(!may_contain(query::clustering_range::make_ending_with({prefix({5})})));
+            // The second component is only looked at when the first is fixed.
+            BOOST_REQUIRE(!may_contain(query::clustering_range::make_singular(prefix({15, 10}))));
+            BOOST_REQUIRE(may_contain(query::clustering_range::make({prefix({10, 10})}, {prefix({15, 10})})));
+
+            // Sstables written before the bounds were marked as clustering
+            // bounds are never ruled out.
+            auto old_sst = reusable_sst("tests/sstables/uncompressed", 1).get0();
+            BOOST_REQUIRE(old_sst->may_contain_rows(*s, {query::clustering_range::make_singular(prefix({21}))}));
+
+            auto write_sstable = [&] (int64_t gen, std::function<void (mutation&)> fill) {
+                auto mt = make_lw_shared<memtable>(s);
+                mutation m(partition_key::from_exploded(*s, {to_bytes("key1")}), s);
+                fill(m);
+                mt->apply(std::move(m));
+                auto sst = make_lw_shared<sstable>("ks", "cf", "tests/sstables/tests-temporary", gen, la, big);
+                sst->write_components(*mt).get();
+                return reusable_sst("tests/sstables/tests-temporary", gen).get0();
+            };
+            auto ck = clustering_key::from_exploded(*s, {int32_type->decompose(10), int32_type->decompose(5)});
+            auto& r1 = *s->get_column_definition("r1");
+
+            // Expiring cells are bounded like any other.
+            auto ttl_sst = write_sstable(58, [&] (mutation& m) {
+                auto now = gc_clock::now().time_since_epoch().count();
+                m.set_clustered_cell(ck, r1, make_atomic_cell(int32_type->decompose(1), 3600, now + 3600));
+            });
+            BOOST_REQUIRE(!ttl_sst->may_contain_rows(*s, {query::clustering_range::make_singular(prefix({21}))}));
+
+            // Partition tombstones are not.
+            auto tombstone_sst = write_sstable(59, [&] (mutation& m) {
+                m.partition().apply(tombstone(api::new_timestamp(), gc_clock::now()));
+                m.set_clustered_cell(ck, r1, make_atomic_cell(int32_type->decompose(1)));
+            });
+            BOOST_REQUIRE(tombstone_sst->may_contain_rows(*s, {query::clustering_range::make_singular(prefix({21}))}));
+        });
+    });
+}
+
+SEASTAR_TEST_CASE(incremental_compaction_replaces_exhausted_sstables) {
+    return test_setup::do_with_test_directory([] {
+        return seastar::async([] {
+            auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+                {{"p1", utf8_type}}, {{"c1", utf8_type}}, {{"r1", int32_type}}, {}, utf8_type));
+            auto cm = make_lw_shared<compaction_manager>();
+            auto cf = make_lw_shared<column_family>(s, column_family::config(), column_family::no_commitlog(), *cm);
+            const column_definition& r1_col = *s->get_column_definition("r1");
+
+            auto keys = token_generation_for_current_shard(5);
+            auto write_sstable = [&] (int64_t gen, std::vector<sstring> partition_keys) {
+                auto mt = make_lw_shared<memtable>(s);
+                for (auto& k : partition_keys) {
+                    mutation m(partition_key::from_exploded(*s, {to_bytes(k)}), s);
+                    m.set_clustered_cell(clustering_key::from_exploded(*s, {to_bytes("c")}), r1_col, make_atomic_cell(int32_type->decompose(1)));
+                    mt->apply(std::move(m));
+                }
+                auto sst = make_lw_shared<sstable>("ks", "cf", "tests/sstables/tests-temporary", gen, la, big);
+                sst->write_components(*mt).get();
+                return reusable_sst("tests/sstables/tests-temporary", gen).get0();
+            };
+            // The first input holds only the smallest key, so it is exhausted
+            // as soon as the first output sstable is sealed.
+            auto sst1 = write_sstable(58, {keys[0].first});
+            auto sst2 = write_sstable(59, {keys[1].first, keys[2].first, keys[3].first, keys[4].first});
+
+            auto gen = make_lw_shared<unsigned>(60);
+            auto creator = [gen] {
+                return make_lw_shared<sstables::sstable>("ks", "cf", "tests/sstables/tests-temporary", (*gen)++, la, big);
+            };
+            std::vector<std::pair<std::vector<shared_sstable>, std::vector<shared_sstable>>> replacements;
+            auto replacer = [&] (const std::vector<shared_sstable>& removed, const std::vector<shared_sstable>& added) {
+                replacements.emplace_back(removed, added);
+            };
+            // A tiny size limit makes every partition go to a sstable of its own.
+            auto new_sstables = sstables::compact_sstables({ sst1, sst2 }, *cf, creator, 1, 1, false, replacer).get0();
+            BOOST_REQUIRE_EQUAL(new_sstables.size(), 5);
+
+            BOOST_REQUIRE_EQUAL(replacements.size(), 2);
+            BOOST_REQUIRE(replacements[0].first == std::vector<shared_sstable>({ sst1 }));
+            BOOST_REQUIRE(replacements[0].second == std::vector<shared_sstable>({ new_sstables[0] }));
+            BOOST_REQUIRE(replacements[1].first == std::vector<shared_sstable>({ sst2 }));
+            BOOST_REQUIRE_EQUAL(replacements[1].second.size(), 4);
+        });
+    });
+}
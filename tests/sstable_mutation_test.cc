@@ -33,6 +33,7 @@
 #include "mutation_reader.hh"
 #include "mutation_reader_assertions.hh"
 #include "mutation_source_test.hh"
+#include "partition_slice_builder.hh"
 #include "tmpdir.hh"
 
 #include "disk-error-handler.hh"
@@ -793,3 +794,152 @@ SEASTAR_TEST_CASE(tombstone_in_tombstone2) {
         });
     });
 }
+
+SEASTAR_TEST_CASE(test_promoted_index_slicing_of_wide_partition) {
+    return seastar::async([] {
+        auto dir = make_lw_shared<tmpdir>();
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", utf8_type, column_kind::partition_key)
+            .with_column("ck", int32_type, column_kind::clustering_key)
+            .with_column("v", bytes_type)
+            .build();
+
+        auto pk = partition_key::from_exploded(*s, {to_bytes("key1")});
+        auto make_ck = [&] (int v) {
+            return clustering_key::from_exploded(*s, {int32_type->decompose(v)});
+        };
+
+        // Enough data for several promoted index blocks, with a range
+        // tombstone spanning block boundaries.
+        const int nr_rows = 2000;
+        mutation m(pk, s);
+        for (int i = 0; i < nr_rows; ++i) {
+            m.set_clustered_cell(make_ck(i), to_bytes("v"), data_value(bytes(256, int8_t(i))), 2);
+        }
+        auto ttl = gc_clock::now() + std::chrono::seconds(3600);
+        m.partition().apply_delete(*s, range_tombstone(make_ck(100), bound_kind::incl_start,
+                make_ck(1900), bound_kind::incl_end, tombstone(1, ttl)));
+
+        auto mt = make_lw_shared<memtable>(s);
+        mt->apply(m);
+
+        auto sst = make_lw_shared<sstables::sstable>("ks", "cf", dir->path, 1,
+                sstables::sstable::version_types::la, sstables::sstable::format_types::big);
+        sst->write_components(*mt).get();
+        sst->load().get();
+
+        auto key = sstables::key::from_partition_key(*s, pk);
+        auto read = [&] (query::clustering_key_filtering_context ck_filtering) {
+            auto sm = sst->read_row(s, key, std::move(ck_filtering)).get0();
+            return mutation_from_streamed_mutation(std::move(sm)).get0();
+        };
+
+        auto full = read(query::no_clustering_key_filtering);
+        BOOST_REQUIRE(bool(full));
+        BOOST_REQUIRE(*full == m);
+
+        auto check_slice = [&] (int start, int end) {
+            std::vector<range<clustering_key_prefix>> ranges {
+                range<clustering_key_prefix>::make(make_ck(start), make_ck(end))
+            };
+            auto mut = read(query::clustering_key_filtering_context::create_for_ranges(s, ranges));
+            BOOST_REQUIRE(bool(mut));
+            auto& rows = mut->partition().clustered_rows();
+            BOOST_REQUIRE_EQUAL(rows.size(), size_t(end - start + 1));
+            int expected = start;
+            for (auto&& e : rows) {
+                BOOST_REQUIRE(e.key().equal(*s, make_ck(expected++)));
+            }
+            for (int i = start; i <= end; ++i) {
+                auto t = mut->partition().range_tombstone_for_row(*s, make_ck(i));
+                BOOST_REQUIRE_EQUAL(bool(t), i >= 100 && i <= 1900);
+            }
+        };
+
+        check_slice(0, 10);
+        check_slice(1000, 1010);
+        check_slice(1895, 1905);
+        check_slice(nr_rows - 5, nr_rows - 1);
+    });
+}
+
+SEASTAR_TEST_CASE(test_reversed_read_of_wide_partition) {
+    return seastar::async([] {
+        auto dir = make_lw_shared<tmpdir>();
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", utf8_type, column_kind::partition_key)
+            .with_column("ck", int32_type, column_kind::clustering_key)
+            .with_column("s", bytes_type, column_kind::static_column)
+            .with_column("v", bytes_type)
+            .build();
+
+        auto pk = partition_key::from_exploded(*s, {to_bytes("key1")});
+        auto make_ck = [&] (int v) {
+            return clustering_key::from_exploded(*s, {int32_type->decompose(v)});
+        };
+
+        const int nr_rows = 2000;
+        mutation m(pk, s);
+        m.set_static_cell("s", data_value(bytes("static")), 2);
+        for (int i = 0; i < nr_rows; ++i) {
+            m.set_clustered_cell(make_ck(i), to_bytes("v"), data_value(bytes(256, int8_t(i))), 2);
+        }
+        auto ttl = gc_clock::now() + std::chrono::seconds(3600);
+        m.partition().apply_delete(*s, range_tombstone(make_ck(100), bound_kind::incl_start,
+                make_ck(1900), bound_kind::incl_end, tombstone(1, ttl)));
+
+        auto mt = make_lw_shared<memtable>(s);
+        mt->apply(m);
+
+        auto sst = make_lw_shared<sstables::sstable>("ks", "cf", dir->path, 1,
+                sstables::sstable::version_types::la, sstables::sstable::format_types::big);
+        sst->write_components(*mt).get();
+        sst->load().get();
+
+        auto key = sstables::key::from_partition_key(*s, pk);
+
+        // Ranges are given in the reverse order, as in reversed queries.
+        auto check = [&] (std::vector<query::clustering_range> ranges) {
+            auto builder = partition_slice_builder(*s);
+            for (auto&& r : ranges) {
+                builder.with_range(r);
+            }
+            auto slice = builder.reversed().build();
+            auto ck_filtering = query::clustering_key_filtering_context::create(s, slice);
+
+            auto sm = sst->read_row(s, key, ck_filtering).get0();
+            BOOST_REQUIRE(sm);
+            BOOST_REQUIRE(sm->is_reversed());
+            auto mf = (*sm)().get0();
+            BOOST_REQUIRE(mf && mf->is_static_row());
+            std::vector<int> keys;
+            for (mf = (*sm)().get0(); mf; mf = (*sm)().get0()) {
+                if (mf->is_clustering_row()) {
+                    keys.push_back(value_cast<int32_t>(int32_type->deserialize(mf->as_clustering_row().key().get_component(*s, 0))));
+                }
+            }
+            std::vector<int> expected_keys;
+            for (auto&& r : ranges) {
+                auto start = r.start() ? value_cast<int32_t>(int32_type->deserialize(r.start()->value().get_component(*s, 0))) : 0;
+                auto end = r.end() ? value_cast<int32_t>(int32_type->deserialize(r.end()->value().get_component(*s, 0))) : nr_rows - 1;
+                for (int i = end; i >= start; --i) {
+                    expected_keys.push_back(i);
+                }
+            }
+            BOOST_REQUIRE(keys == expected_keys);
+
+            auto mut = mutation_from_streamed_mutation(sst->read_row(s, key, ck_filtering).get0()).get0();
+            BOOST_REQUIRE(bool(mut));
+            for (auto i : expected_keys) {
+                auto t = mut->partition().range_tombstone_for_row(*s, make_ck(i));
+                BOOST_REQUIRE_EQUAL(bool(t), i >= 100 && i <= 1900);
+            }
+        };
+
+        check({ query::clustering_range::make_open_ended_both_sides() });
+        check({ query::clustering_range::make({make_ck(1000)}, {make_ck(1010)}) });
+        check({ query::clustering_range::make({make_ck(1895)}, {make_ck(1905)}),
+                query::clustering_range::make({make_ck(0)}, {make_ck(10)}) });
+        check({ query::clustering_range::make_ending_with({make_ck(150)}) });
+    });
+}
@@ -394,6 +394,11 @@ class test_row_consumer : public row_consumer {
         return proceed::yes;
     }
 
+    virtual proceed consume_counter_cell(bytes_view col_name, bytes_view value, int64_t timestamp) override {
+        count_cell++;
+        return proceed::yes;
+    }
+
     virtual proceed consume_deleted_cell(bytes_view col_name, sstables::deletion_time deltime) override {
         count_deleted_cell++;
         return proceed::yes;
@@ -496,6 +501,10 @@ class count_row_consumer : public row_consumer {
         count_cell++;
         return proceed::yes;
     }
+    virtual proceed consume_counter_cell(bytes_view col_name, bytes_view value, int64_t timestamp) override {
+        count_cell++;
+        return proceed::yes;
+    }
     virtual proceed consume_deleted_cell(bytes_view col_name, sstables::deletion_time deltime) override {
         count_deleted_cell++;
         return proceed::yes;
@@ -138,6 +138,10 @@ class test {
         _sst->_summary.last_key.value = bytes(reinterpret_cast<const signed char*>(last_key.c_str()), last_key.size());
     }
 
+    void set_data_file_size(uint64_t size) {
+        _sst->_data_file_size = size;
+    }
+
     void set_values(sstring first_key, sstring last_key, stats_metadata stats) {
         _sst->_statistics.contents[metadata_type::Stats] = std::make_unique<stats_metadata>(std::move(stats));
         _sst->_summary.first_key.value = bytes(reinterpret_cast<const signed char*>(first_key.c_str()), first_key.size());
@@ -37,6 +37,7 @@
 #include "core/reactor.hh"
 #include "utils/UUID.hh"
 #include "database.hh"
+#include "bytes_ostream.hh"
 #include "net/byteorder.hh"
 #include <seastar/core/scollectd.hh>
 #include <seastar/net/byteorder.hh>
@@ -52,6 +53,7 @@
 #include <string>
 
 #include <lz4.h>
+#include <snappy-c.h>
 
 namespace transport {
 
@@ -184,7 +186,8 @@ class cql_server::response {
     int16_t           _stream;
     cql_binary_opcode _opcode;
     std::experimental::optional<utils::UUID> _tracing_id;
-    std::vector<char> _body;
+    std::experimental::optional<cql_compression> _negotiated_compression;
+    bytes_ostream _body;
 public:
     response(int16_t stream, cql_binary_opcode opcode)
         : _stream{stream}
@@ -195,7 +198,16 @@ class cql_server::response {
         _tracing_id = id;
     }
 
-    scattered_message<char> make_message(uint8_t version);
+    // Requests may be processed on another shard than the connection's, so
+    // the response to STARTUP carries the negotiated compression back to it.
+    void set_negotiated_compression(cql_compression compression) {
+        _negotiated_compression = compression;
+    }
+    const std::experimental::optional<cql_compression>& negotiated_compression() const {
+        return _negotiated_compression;
+    }
+
+    scattered_message<char> make_message(uint8_t version, cql_compression compression, cql_compression_stats& stats);
     void serialize(const event::schema_change& event, uint8_t version);
     void write_byte(uint8_t b);
     void write_int(int32_t n);
@@ -216,14 +228,12 @@ class cql_server::response {
     void write_value(bytes_opt value);
     void write(const cql3::metadata& m);
     void write(const cql3::prepared_metadata& m, uint8_t version);
-    future<> output(output_stream<char>& out, uint8_t version, bool compression);
+    future<> output(output_stream<char>& out, uint8_t version, cql_compression compression, cql_compression_stats& stats);
 
     cql_binary_opcode opcode() const {
         return _opcode;
     }
 private:
-    std::vector<char> compress(const std::vector<char>& body);
-
     template <typename CqlFrameHeaderType>
     sstring make_frame_one(uint8_t version, uint8_t flags, size_t length) {
         size_t extra_len = 0;
@@ -297,6 +307,18 @@ cql_server::setup_collectd() {
             scollectd::type_instance_id("transport", scollectd::per_cpu_plugin_instance,
                     "queue_length", "requests_blocked_memory"),
             scollectd::make_typed(scollectd::data_type::GAUGE, [this] { return _memory_available.waiters(); })),
+        scollectd::add_polled_metric(
+            scollectd::type_instance_id("transport", scollectd::per_cpu_plugin_instance,
+                    "total_bytes", "compression_uncompressed"),
+            scollectd::make_typed(scollectd::data_type::DERIVE, _compression_stats.uncompressed_bytes)),
+        scollectd::add_polled_metric(
+            scollectd::type_instance_id("transport", scollectd::per_cpu_plugin_instance,
+                    "total_bytes", "compression_compressed"),
+            scollectd::make_typed(scollectd::data_type::DERIVE, _compression_stats.compressed_bytes)),
+        scollectd::add_polled_metric(
+            scollectd::type_instance_id("transport", scollectd::per_cpu_plugin_instance,
+                    "derive", "compression_cpu_time_ns"),
+            scollectd::make_typed(scollectd::data_type::DERIVE, _compression_stats.cpu_time_ns)),
     };
 }
 
@@ -562,6 +584,10 @@ cql_server::connection::connection(cql_server& server, connected_socket&& fd, so
 }
 
 cql_server::connection::~connection() {
+    if (_compression_stats.uncompressed_bytes) {
+        logger.debug("connection closed, compressed {} bytes into {} bytes in {} ns", _compression_stats.uncompressed_bytes,
+                _compression_stats.compressed_bytes, _compression_stats.cpu_time_ns);
+    }
     --_server._current_connections;
     _server._connections_list.erase(_server._connections_list.iterator_to(*this));
     _server.maybe_idle();
@@ -651,10 +677,13 @@ future<> cql_server::connection::process_request() {
                         }
                         return std::make_pair(make_foreign(response.first), response.second);
                     });
-                }).then([this, flags] (auto&& response) {
+                }).then([this] (auto&& response) {
                     _client_state.merge(response.second);
-                    bool compression = flags & cql_frame_flags::compression;
-                    return this->write_response(std::move(response.first), compression);
+                    auto& compression = response.first->negotiated_compression();
+                    if (compression) {
+                        _compression = *compression;
+                    }
+                    return this->write_response(std::move(response.first));
                 }).then([buf = std::move(buf)] {
                     // Keep buf alive.
                 });
@@ -668,34 +697,98 @@ future<> cql_server::connection::process_request() {
     });
 }
 
-static inline bytes_view to_bytes_view(temporary_buffer<char>& b)
+// LZ4 bodies are prefixed with their uncompressed length as a 4 byte
+// big-endian integer, Snappy ones carry it in their own encoding.
+static temporary_buffer<char> decompress_lz4(temporary_buffer<char> buf)
 {
-    using byte = bytes_view::value_type;
-    return bytes_view(reinterpret_cast<const byte*>(b.get()), b.size());
+    if (buf.size() < 4) {
+        throw std::runtime_error("Truncated frame");
+    }
+    auto p = reinterpret_cast<const uint8_t*>(buf.get());
+    int32_t uncomp_len = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    if (uncomp_len < 0) {
+        throw std::runtime_error("CQL frame uncompressed length is negative: " + std::to_string(uncomp_len));
+    }
+    buf.trim_front(4);
+    temporary_buffer<char> uncomp{size_t(uncomp_len)};
+    const char* input = buf.get();
+    size_t input_len = buf.size();
+    char *output = uncomp.get_write();
+    size_t output_len = uncomp_len;
+    auto ret = LZ4_decompress_safe(input, output, input_len, output_len);
+    if (ret < 0) {
+        throw std::runtime_error("CQL frame LZ4 uncompression failure");
+    }
+    return uncomp;
+}
+
+static temporary_buffer<char> decompress_snappy(temporary_buffer<char> buf)
+{
+    size_t uncomp_len;
+    if (snappy_uncompressed_length(buf.get(), buf.size(), &uncomp_len) != SNAPPY_OK) {
+        throw std::runtime_error("CQL frame Snappy uncompressed length is invalid");
+    }
+    temporary_buffer<char> uncomp{uncomp_len};
+    if (snappy_uncompress(buf.get(), buf.size(), uncomp.get_write(), &uncomp_len) != SNAPPY_OK) {
+        throw std::runtime_error("CQL frame Snappy uncompression failure");
+    }
+    uncomp.trim(uncomp_len);
+    return uncomp;
+}
+
+// The native protocol expects an LZ4 body to be a single block, which is
+// compressed from contiguous input.
+static temporary_buffer<char> compress_lz4(bytes_view body)
+{
+    auto input = reinterpret_cast<const char*>(body.data());
+    size_t input_len = body.size();
+    temporary_buffer<char> comp(LZ4_COMPRESSBOUND(input_len) + 4);
+    char *output = comp.get_write();
+    output[0] = (input_len >> 24) & 0xFF;
+    output[1] = (input_len >> 16) & 0xFF;
+    output[2] = (input_len >> 8) & 0xFF;
+    output[3] = input_len & 0xFF;
+    auto ret = LZ4_compress(input, output + 4, input_len);
+    if (ret == 0) {
+        throw std::runtime_error("CQL frame LZ4 compression failure");
+    }
+    comp.trim(ret + 4);
+    return comp;
+}
+
+static temporary_buffer<char> compress_snappy(bytes_view body)
+{
+    auto input = reinterpret_cast<const char*>(body.data());
+    size_t output_len = snappy_max_compressed_length(body.size());
+    temporary_buffer<char> comp(output_len);
+    if (snappy_compress(input, body.size(), comp.get_write(), &output_len) != SNAPPY_OK) {
+        throw std::runtime_error("CQL frame Snappy compression failure");
+    }
+    comp.trim(output_len);
+    return comp;
+}
+
+void cql_server::connection::account_compression(const cql_compression_stats& stats)
+{
+    _compression_stats += stats;
+    _server._compression_stats += stats;
 }
 
 future<temporary_buffer<char>> cql_server::connection::read_and_decompress_frame(size_t length, uint8_t flags)
 {
     if (flags & cql_frame_flags::compression) {
-        if (length < 4) {
-            throw std::runtime_error("Truncated frame");
+        if (_compression == cql_compression::none) {
+            throw exceptions::protocol_exception("Received a compressed frame, but no compression was negotiated in STARTUP");
         }
         return _read_buf.read_exactly(length).then([this] (temporary_buffer<char> buf) {
-            auto view = to_bytes_view(buf);
-            int32_t uncomp_len = read_int(view);
-            if (uncomp_len < 0) {
-                throw std::runtime_error("CQL frame uncompressed length is negative: " + std::to_string(uncomp_len));
-            }
-            buf.trim_front(4);
-            temporary_buffer<char> uncomp{size_t(uncomp_len)};
-            const char* input = buf.get();
-            size_t input_len = buf.size();
-            char *output = uncomp.get_write();
-            size_t output_len = uncomp_len;
-            auto ret = LZ4_decompress_safe(input, output, input_len, output_len);
-            if (ret < 0) {
-                throw std::runtime_error("CQL frame LZ4 uncompression failure");
-            }
+            auto start = std::chrono::steady_clock::now();
+            auto compressed_bytes = buf.size();
+            auto uncomp = _compression == cql_compression::lz4 ? decompress_lz4(std::move(buf)) : decompress_snappy(std::move(buf));
+            cql_compression_stats stats;
+            stats.uncompressed_bytes = uncomp.size();
+            stats.compressed_bytes = compressed_bytes;
+            stats.cpu_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            account_compression(stats);
             return make_ready_future<temporary_buffer<char>>(std::move(uncomp));
         });
     }
@@ -712,12 +805,26 @@ unsigned cql_server::connection::pick_request_cpu()
 
 future<response_type> cql_server::connection::process_startup(uint16_t stream, bytes_view buf, service::client_state client_state)
 {
-    /*auto string_map =*/ read_string_map(buf);
+    auto options = read_string_map(buf);
+    std::experimental::optional<cql_compression> negotiated;
+    auto compression = options.find("COMPRESSION");
+    if (compression != options.end()) {
+        auto algorithm = compression->second;
+        std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), ::tolower);
+        if (algorithm == "lz4") {
+            negotiated = cql_compression::lz4;
+        } else if (algorithm == "snappy") {
+            negotiated = cql_compression::snappy;
+        } else {
+            throw exceptions::protocol_exception(sprint("Unknown compression algorithm: %s", compression->second));
+        }
+    }
     auto& a = auth::authenticator::get();
-    if (a.require_authentication()) {
-        return make_ready_future<response_type>(std::make_pair(make_autheticate(stream, a.class_name()), client_state));
+    auto response = a.require_authentication() ? make_autheticate(stream, a.class_name()) : make_ready(stream);
+    if (negotiated) {
+        response->set_negotiated_compression(*negotiated);
     }
-    return make_ready_future<response_type>(std::make_pair(make_ready(stream), client_state));
+    return make_ready_future<response_type>(std::make_pair(response, client_state));
 }
 
 future<response_type> cql_server::connection::process_auth_response(uint16_t stream, bytes_view buf, service::client_state client_state)
@@ -993,6 +1100,7 @@ shared_ptr<cql_server::response> cql_server::connection::make_supported(int16_t
     std::multimap<sstring, sstring> opts;
     opts.insert({"CQL_VERSION", cql3::query_processor::CQL_VERSION});
     opts.insert({"COMPRESSION", "lz4"});
+    opts.insert({"COMPRESSION", "snappy"});
     auto response = make_shared<cql_server::response>(stream, cql_binary_opcode::SUPPORTED);
     response->write_string_multimap(opts);
     return response;
@@ -1092,11 +1200,14 @@ cql_server::connection::make_schema_change_event(const event::schema_change& eve
     return response;
 }
 
-future<> cql_server::connection::write_response(foreign_ptr<shared_ptr<cql_server::response>>&& response, bool compression)
+// Once compression is negotiated, all responses are compressed.
+future<> cql_server::connection::write_response(foreign_ptr<shared_ptr<cql_server::response>>&& response)
 {
-    _ready_to_respond = _ready_to_respond.then([this, compression, response = std::move(response)] () mutable {
-        return do_with(std::move(response), [this, compression] (auto& response) {
-            return response->output(_write_buf, _version, compression).then([this] {
+    _ready_to_respond = _ready_to_respond.then([this, response = std::move(response)] () mutable {
+        return do_with(std::move(response), cql_compression_stats(), [this] (auto& response, auto& stats) {
+            auto f = response->output(_write_buf, _version, _compression, stats);
+            account_compression(stats);
+            return f.then([this] {
                 return _write_buf.flush();
             });
         });
@@ -1363,49 +1474,34 @@ bytes_view_opt cql_server::connection::read_value_view(bytes_view& buf) {
     return {std::move(bv)};
 }
 
-scattered_message<char> cql_server::response::make_message(uint8_t version) {
+// The body is moved into the message, which owns it until the network
+// stack is done with it. Its fragments are sent as they are.
+scattered_message<char> cql_server::response::make_message(uint8_t version, cql_compression compression, cql_compression_stats& stats) {
     scattered_message<char> msg;
-    sstring body{_body.data(), _body.size()};
-    sstring frame = make_frame(version, 0x00, body.size());
-    msg.append(std::move(frame));
-    msg.append(std::move(body));
+    if (compression != cql_compression::none) {
+        auto start = std::chrono::steady_clock::now();
+        auto uncompressed = _body.linearize();
+        auto body = compression == cql_compression::lz4 ? compress_lz4(uncompressed) : compress_snappy(uncompressed);
+        stats.uncompressed_bytes = _body.size();
+        stats.compressed_bytes = body.size();
+        stats.cpu_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        _body = {};
+        msg.append(make_frame(version, cql_frame_flags::compression, body.size()));
+        msg.append_static(body.get(), body.size());
+        msg.on_delete([body = std::move(body)] { });
+        return msg;
+    }
+    msg.append(make_frame(version, 0x00, _body.size()));
+    for (auto&& fragment : _body.fragments()) {
+        msg.append_static(reinterpret_cast<const char*>(fragment.data()), fragment.size());
+    }
+    msg.on_delete([body = std::move(_body)] { });
     return msg;
 }
 
 future<>
-cql_server::response::output(output_stream<char>& out, uint8_t version, bool compression) {
-    uint8_t flags = 0;
-    if (compression) {
-        flags |= cql_frame_flags::compression;
-        _body = compress(_body);
-    }
-    auto frame = make_frame(version, flags, _body.size());
-    auto tmp = temporary_buffer<char>(frame.size());
-    std::copy_n(frame.begin(), frame.size(), tmp.get_write());
-    auto f = out.write(tmp.get(), tmp.size());
-    return f.then([this, &out, tmp = std::move(tmp)] {
-        return out.write(_body.data(), _body.size());
-    });
-}
-
-std::vector<char> cql_server::response::compress(const std::vector<char>& body)
-{
-    const char* input = body.data();
-    size_t input_len = body.size();
-    std::vector<char> comp;
-    comp.resize(LZ4_COMPRESSBOUND(input_len) + 4);
-    char *output = comp.data();
-    output[0] = (input_len >> 24) & 0xFF;
-    output[1] = (input_len >> 16) & 0xFF;
-    output[2] = (input_len >> 8) & 0xFF;
-    output[3] = input_len & 0xFF;
-    auto ret = LZ4_compress(input, output + 4, input_len);
-    if (ret == 0) {
-        throw std::runtime_error("CQL frame LZ4 compression failure");
-    }
-    size_t output_len = ret + 4;
-    comp.resize(output_len);
-    return comp;
+cql_server::response::output(output_stream<char>& out, uint8_t version, cql_compression compression, cql_compression_stats& stats) {
+    return out.write(make_message(version, compression, stats));
 }
 
 void cql_server::response::serialize(const event::schema_change& event, uint8_t version)
@@ -1438,28 +1534,28 @@ void cql_server::response::serialize(const event::schema_change& event, uint8_t
 
 void cql_server::response::write_byte(uint8_t b)
 {
-    _body.insert(_body.end(), b);
+    _body.write(reinterpret_cast<const char*>(&b), sizeof(b));
 }
 
 void cql_server::response::write_int(int32_t n)
 {
     auto u = htonl(n);
     auto *s = reinterpret_cast<const char*>(&u);
-    _body.insert(_body.end(), s, s+sizeof(u));
+    _body.write(s, sizeof(u));
 }
 
 void cql_server::response::write_long(int64_t n)
 {
     auto u = htonq(n);
     auto *s = reinterpret_cast<const char*>(&u);
-    _body.insert(_body.end(), s, s+sizeof(u));
+    _body.write(s, sizeof(u));
 }
 
 void cql_server::response::write_short(uint16_t n)
 {
     auto u = htons(n);
     auto *s = reinterpret_cast<const char*>(&u);
-    _body.insert(_body.end(), s, s+sizeof(u));
+    _body.write(s, sizeof(u));
 }
 
 template<typename T>
@@ -1475,13 +1571,13 @@ T cast_if_fits(size_t v) {
 void cql_server::response::write_string(const sstring& s)
 {
     write_short(cast_if_fits<uint16_t>(s.size()));
-    _body.insert(_body.end(), s.begin(), s.end());
+    _body.write(s.begin(), s.size());
 }
 
 void cql_server::response::write_long_string(const sstring& s)
 {
     write_int(cast_if_fits<int32_t>(s.size()));
-    _body.insert(_body.end(), s.begin(), s.end());
+    _body.write(s.begin(), s.size());
 }
 
 void cql_server::response::write_uuid(utils::UUID uuid)
@@ -1501,13 +1597,13 @@ void cql_server::response::write_string_list(std::vector<sstring> string_list)
 void cql_server::response::write_bytes(bytes b)
 {
     write_int(cast_if_fits<int32_t>(b.size()));
-    _body.insert(_body.end(), b.begin(), b.end());
+    _body.write(b);
 }
 
 void cql_server::response::write_short_bytes(bytes b)
 {
     write_short(cast_if_fits<uint16_t>(b.size()));
-    _body.insert(_body.end(), b.begin(), b.end());
+    _body.write(b);
 }
 
 void cql_server::response::write_option(std::pair<int16_t, data_value> opt)
@@ -1572,7 +1668,7 @@ void cql_server::response::write_value(bytes_opt value)
     }
 
     write_int(value->size());
-    _body.insert(_body.end(), value->begin(), value->end());
+    _body.write(*value);
 }
 
 class type_codec {
@@ -48,6 +48,28 @@ enum cql_frame_flags {
     tracing     = 0x02,
 };
 
+// Frame body compression negotiated by the client in STARTUP.
+enum class cql_compression {
+    none,
+    lz4,
+    snappy,
+};
+
+// Work done on compressing and decompressing frame bodies. The ratio is
+// compressed_bytes / uncompressed_bytes.
+struct cql_compression_stats {
+    uint64_t uncompressed_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    uint64_t cpu_time_ns = 0;
+
+    cql_compression_stats& operator+=(const cql_compression_stats& o) {
+        uncompressed_bytes += o.uncompressed_bytes;
+        compressed_bytes += o.compressed_bytes;
+        cpu_time_ns += o.cpu_time_ns;
+        return *this;
+    }
+};
+
 struct [[gnu::packed]] cql_binary_frame_v1 {
     uint8_t  version;
     uint8_t  flags;
@@ -109,6 +131,7 @@ class cql_server {
     uint64_t _connections = 0;
     uint64_t _requests_served = 0;
     uint64_t _requests_serving = 0;
+    cql_compression_stats _compression_stats;
     cql_load_balance _lb;
 public:
     cql_server(distributed<service::storage_proxy>& proxy, distributed<cql3::query_processor>& qp, cql_load_balance lb);
@@ -132,6 +155,8 @@ class cql_server {
         service::client_state _client_state;
         std::unordered_map<uint16_t, cql_query_state> _query_states;
         unsigned _request_cpu = 0;
+        cql_compression _compression = cql_compression::none;
+        cql_compression_stats _compression_stats;
 
         enum class state : uint8_t {
             UNINITIALIZED, AUTHENTICATION, READY
@@ -157,6 +182,7 @@ class cql_server {
         unsigned pick_request_cpu();
         cql_binary_frame_v3 parse_frame(temporary_buffer<char> buf);
         future<temporary_buffer<char>> read_and_decompress_frame(size_t length, uint8_t flags);
+        void account_compression(const cql_compression_stats& stats);
         future<std::experimental::optional<cql_binary_frame_v3>> read_frame();
         future<response_type> process_startup(uint16_t stream, bytes_view buf, service::client_state client_state);
         future<response_type> process_auth_response(uint16_t stream, bytes_view buf, service::client_state client_state);
@@ -183,7 +209,7 @@ class cql_server {
         shared_ptr<cql_server::response> make_auth_success(int16_t, bytes);
         shared_ptr<cql_server::response> make_auth_challenge(int16_t, bytes);
 
-        future<> write_response(foreign_ptr<shared_ptr<cql_server::response>>&& response, bool compression = false);
+        future<> write_response(foreign_ptr<shared_ptr<cql_server::response>>&& response);
 
         void check_room(bytes_view& buf, size_t n);
         void validate_utf8(sstring_view s);
@@ -1246,68 +1246,17 @@ class decimal_type_impl : public concrete_type<big_decimal> {
     }
 };
 
-class counter_type_impl : public abstract_type {
-public:
-    counter_type_impl() : abstract_type{counter_type_name} { }
-    virtual void serialize(const void* value, bytes::iterator& out) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual size_t serialized_size(const void* value) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual int32_t compare(bytes_view v1, bytes_view v2) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual bool less(bytes_view v1, bytes_view v2) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual size_t hash(bytes_view v) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual data_value deserialize(bytes_view v) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual sstring to_string(const bytes& b) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual bytes from_string(sstring_view text) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
+// The value of a counter column, as seen by CQL, is the sum of the shards
+// of its cells (see counters.hh) and is represented as a bigint.
+struct counter_type_impl : integer_type_impl<int64_t> {
+    counter_type_impl() : integer_type_impl{counter_type_name}
+    { }
+
     virtual bool is_counter() const override {
         return true;
     }
     virtual ::shared_ptr<cql3::cql3_type> as_cql3_type() const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual size_t native_value_size() const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual size_t native_value_alignment() const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual void native_value_copy(const void* from, void* to) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual void native_value_move(void* from, void* to) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual void native_value_destroy(void* object) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual void native_value_delete(void* object) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual void* native_value_clone(const void* object) const override {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual const std::type_info& native_typeid() const {
-        fail(unimplemented::cause::COUNTERS);
-    }
-    virtual bool references_user_type(const sstring& keyspace, const bytes& name) const override {
-        return false;
-    }
-    virtual std::experimental::optional<data_type> update_user_type(const shared_ptr<const user_type_impl> updated) const {
-        return std::experimental::nullopt;
+        return cql3::cql3_type::counter;
     }
 };
 
@@ -24,6 +24,8 @@
 #include <boost/circular_buffer.hpp>
 #include "latency.hh"
 #include <cmath>
+#include <array>
+#include <algorithm>
 #include "core/timer.hh"
 #include <iostream>
 namespace utils {
@@ -194,6 +196,89 @@ inline ihistogram operator +(ihistogram a, const ihistogram& b) {
     return a;
 }
 
+/**
+ * A latency histogram whose counts decay over time, so that percentiles
+ * follow recent behaviour rather than the whole history.
+ *
+ * Bucket limits grow by 20%, which bounds the error of a percentile.
+ * Counts are halved once every half-life. Decay is applied lazily, so idle
+ * histograms cost nothing.
+ */
+class decaying_latency_histogram {
+public:
+    using clock = latency_counter::clock;
+    using duration = latency_counter::duration;
+    static constexpr size_t bucket_count = 90;
+private:
+    std::array<double, bucket_count> _buckets{};
+    double _count = 0;
+    duration _half_life;
+    clock::time_point _last_decay;
+
+    // Upper bounds of the buckets in microseconds, the last one is ~13s.
+    static const std::array<int64_t, bucket_count>& bucket_limits() {
+        static const std::array<int64_t, bucket_count> limits = [] {
+            std::array<int64_t, bucket_count> l;
+            double limit = 1;
+            for (size_t i = 0; i < bucket_count; ++i) {
+                l[i] = std::max<int64_t>(i ? l[i - 1] + 1 : 1, std::llround(limit));
+                limit *= 1.2;
+            }
+            return l;
+        }();
+        return limits;
+    }
+
+    void decay(clock::time_point now) {
+        auto periods = (now - _last_decay) / _half_life;
+        if (periods <= 0) {
+            return;
+        }
+        _last_decay += periods * _half_life;
+        auto factor = std::pow(0.5, periods);
+        for (auto& b : _buckets) {
+            b *= factor;
+        }
+        _count *= factor;
+    }
+public:
+    explicit decaying_latency_histogram(duration half_life = std::chrono::seconds(10))
+        : _half_life(half_life)
+        , _last_decay(clock::now()) {
+    }
+
+    void mark(duration latency, clock::time_point now = clock::now()) {
+        decay(now);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        auto& limits = bucket_limits();
+        auto i = std::lower_bound(limits.begin(), limits.end(), us) - limits.begin();
+        _buckets[std::min<size_t>(i, bucket_count - 1)] += 1;
+        _count += 1;
+    }
+
+    // The decayed number of samples.
+    double count(clock::time_point now = clock::now()) {
+        decay(now);
+        return _count;
+    }
+
+    // Returns the latency below which the fraction p of the recent samples
+    // lie, rounded up to a bucket limit.
+    duration percentile(double p, clock::time_point now = clock::now()) {
+        decay(now);
+        auto& limits = bucket_limits();
+        auto target = p * _count;
+        double seen = 0;
+        for (size_t i = 0; i < bucket_count; ++i) {
+            seen += _buckets[i];
+            if (seen >= target && seen > 0) {
+                return std::chrono::microseconds(limits[i]);
+            }
+        }
+        return std::chrono::microseconds(limits.back());
+    }
+};
+
 struct rate_moving_average {
     uint64_t count = 0;
     double rates[3] = {0};